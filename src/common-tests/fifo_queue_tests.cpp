@@ -0,0 +1,95 @@
+#include "common/fifo_queue.h"
+#include <gtest/gtest.h>
+#include <string>
+
+TEST(FIFOQueue, PODRemoveAdvancesHead)
+{
+  InlineFIFOQueue<u32, 8> queue;
+  for (u32 i = 0; i < 6; i++)
+    queue.Push(i);
+
+  queue.Remove(4);
+  ASSERT_EQ(queue.GetSize(), 2u);
+  ASSERT_EQ(queue.Peek(), 4u);
+  ASSERT_EQ(queue.Peek(1), 5u);
+
+  queue.Remove(0);
+  ASSERT_EQ(queue.GetSize(), 2u);
+  ASSERT_EQ(queue.Peek(), 4u);
+}
+
+TEST(FIFOQueue, PODRemoveWrapsAround)
+{
+  InlineFIFOQueue<u32, 8> queue;
+  for (u32 i = 0; i < 6; i++)
+    queue.Push(i);
+  queue.Remove(6);
+  ASSERT_TRUE(queue.IsEmpty());
+
+  // The head is now near the end, so these straddle the end of the storage.
+  for (u32 i = 10; i < 16; i++)
+    queue.Push(i);
+  queue.Remove(3);
+  ASSERT_EQ(queue.GetSize(), 3u);
+  ASSERT_EQ(queue.Peek(), 13u);
+  ASSERT_EQ(queue.Peek(2), 15u);
+
+  queue.Remove(3);
+  ASSERT_TRUE(queue.IsEmpty());
+}
+
+TEST(FIFOQueue, PODPopRangeReturnsElementsInOrder)
+{
+  InlineFIFOQueue<u32, 8> queue;
+  for (u32 i = 0; i < 5; i++)
+    queue.Push(i);
+
+  u32 values[3] = {};
+  queue.PopRange(values, 3);
+  ASSERT_EQ(values[0], 0u);
+  ASSERT_EQ(values[1], 1u);
+  ASSERT_EQ(values[2], 2u);
+  ASSERT_EQ(queue.GetSize(), 2u);
+  ASSERT_EQ(queue.Peek(), 3u);
+}
+
+TEST(FIFOQueue, PODPopRangeWrapsAround)
+{
+  InlineFIFOQueue<u32, 8> queue;
+  for (u32 i = 0; i < 6; i++)
+    queue.Push(i);
+  queue.Remove(6);
+
+  const u32 data[7] = {20, 21, 22, 23, 24, 25, 26};
+  queue.PushRange(data, 7);
+  ASSERT_EQ(queue.GetContiguousSize(), 2u);
+
+  u32 values[7] = {};
+  queue.PopRange(values, 7);
+  ASSERT_TRUE(queue.IsEmpty());
+  for (u32 i = 0; i < 7; i++)
+    ASSERT_EQ(values[i], data[i]);
+
+  // The queue should still be usable from where the head ended up.
+  queue.Push(30);
+  ASSERT_EQ(queue.Pop(), 30u);
+}
+
+TEST(FIFOQueue, NonPODRemoveAndPopRangeMatchPOD)
+{
+  InlineFIFOQueue<std::string, 4> queue;
+  for (u32 i = 0; i < 3; i++)
+    queue.Push(std::to_string(i));
+  queue.Remove(2);
+  ASSERT_EQ(queue.GetSize(), 1u);
+  ASSERT_EQ(queue.Peek(), "2");
+
+  for (u32 i = 3; i < 6; i++)
+    queue.Push(std::to_string(i));
+
+  std::string values[4];
+  queue.PopRange(values, 4);
+  ASSERT_TRUE(queue.IsEmpty());
+  ASSERT_EQ(values[0], "2");
+  ASSERT_EQ(values[3], "5");
+}
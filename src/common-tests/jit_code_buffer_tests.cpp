@@ -0,0 +1,89 @@
+#include "common/jit_code_buffer.h"
+#include <gtest/gtest.h>
+
+TEST(JitCodeBuffer, CommitUsesFreeSpace)
+{
+  JitCodeBuffer buffer(4096, 4096);
+  u8* start = buffer.GetFreeCodePointer();
+  buffer.CommitCode(100);
+  ASSERT_EQ(buffer.GetFreeCodePointer(), start + 100);
+  ASSERT_EQ(buffer.GetFreeCodeSpace(), 4096u - 100u);
+  ASSERT_EQ(buffer.GetCodeStats().used, 100u);
+}
+
+TEST(JitCodeBuffer, FreedCodeIsReused)
+{
+  JitCodeBuffer buffer(4096, 0);
+  u8* first = buffer.GetFreeCodePointer();
+  buffer.CommitCode(1024);
+  buffer.CommitCode(3072);
+  ASSERT_FALSE(buffer.AllocateCode(512, 0));
+
+  buffer.FreeCode(first, 1024);
+  ASSERT_TRUE(buffer.AllocateCode(512, 0));
+  ASSERT_EQ(buffer.GetFreeCodePointer(), first);
+  ASSERT_EQ(buffer.GetFreeCodeSpace(), 1024u);
+}
+
+TEST(JitCodeBuffer, AdjacentFreeRangesAreMerged)
+{
+  JitCodeBuffer buffer(4096, 0);
+  u8* start = buffer.GetFreeCodePointer();
+  buffer.CommitCode(1024);
+  buffer.CommitCode(1024);
+  buffer.CommitCode(1024);
+  buffer.CommitCode(1024);
+
+  buffer.FreeCode(start, 1024);
+  buffer.FreeCode(start + 2048, 1024);
+  ASSERT_EQ(buffer.GetCodeStats().free_range_count, 2u);
+  ASSERT_EQ(buffer.GetCodeStats().largest_free_range, 1024u);
+
+  buffer.FreeCode(start + 1024, 1024);
+  ASSERT_EQ(buffer.GetCodeStats().free_range_count, 1u);
+  ASSERT_EQ(buffer.GetCodeStats().largest_free_range, 3072u);
+  ASSERT_TRUE(buffer.AllocateCode(3072, 0));
+  ASSERT_EQ(buffer.GetFreeCodePointer(), start);
+}
+
+TEST(JitCodeBuffer, FreeingNextToCurrentRangeGrowsIt)
+{
+  JitCodeBuffer buffer(4096, 0);
+  u8* start = buffer.GetFreeCodePointer();
+  buffer.CommitCode(1024);
+  buffer.FreeCode(start, 1024);
+  ASSERT_EQ(buffer.GetFreeCodePointer(), start);
+  ASSERT_EQ(buffer.GetFreeCodeSpace(), 4096u);
+  ASSERT_EQ(buffer.GetCodeStats().free_range_count, 1u);
+}
+
+TEST(JitCodeBuffer, FragmentationStats)
+{
+  JitCodeBuffer buffer(4096, 0);
+  u8* start = buffer.GetFreeCodePointer();
+  buffer.CommitCode(1024);
+  buffer.CommitCode(1024);
+  buffer.CommitCode(2048);
+
+  buffer.FreeCode(start, 1024);
+  buffer.FreeCode(start + 2048, 2048);
+  const JitCodeBuffer::Stats stats = buffer.GetCodeStats();
+  ASSERT_EQ(stats.used, 1024u);
+  ASSERT_EQ(stats.free, 3072u);
+  ASSERT_EQ(stats.largest_free_range, 2048u);
+  ASSERT_FLOAT_EQ(stats.GetFragmentation(), 1.0f / 3.0f);
+}
+
+TEST(JitCodeBuffer, ResetKeepsReservedCode)
+{
+  JitCodeBuffer buffer(4096, 4096);
+  u8* start = buffer.GetFreeCodePointer();
+  buffer.ReserveCode(256);
+  buffer.CommitCode(1024);
+  buffer.CommitFarCode(1024);
+
+  buffer.Reset();
+  ASSERT_EQ(buffer.GetFreeCodePointer(), start + 256);
+  ASSERT_EQ(buffer.GetFreeCodeSpace(), 4096u - 256u);
+  ASSERT_EQ(buffer.GetFreeFarCodeSpace(), 4096u);
+}
@@ -0,0 +1,124 @@
+#include "common/spsc_ring_buffer.h"
+#include <cstring>
+#include <gtest/gtest.h>
+#include <thread>
+
+TEST(SPSCRingBuffer, RecordsAreReadInOrder)
+{
+  SPSCRingBuffer queue(256);
+  ASSERT_TRUE(queue.IsEmpty());
+  ASSERT_EQ(queue.BeginRead(nullptr), nullptr);
+
+  for (u32 i = 1; i <= 3; i++)
+  {
+    u32* record = static_cast<u32*>(queue.BeginWrite(sizeof(u32) * i));
+    ASSERT_NE(record, nullptr);
+    for (u32 j = 0; j < i; j++)
+      record[j] = i;
+    queue.EndWrite();
+  }
+
+  ASSERT_FALSE(queue.IsEmpty());
+  for (u32 i = 1; i <= 3; i++)
+  {
+    u32 size;
+    const u32* record = static_cast<const u32*>(queue.BeginRead(&size));
+    ASSERT_NE(record, nullptr);
+    ASSERT_EQ(size, sizeof(u32) * i);
+    ASSERT_EQ(record[i - 1], i);
+    queue.EndRead();
+  }
+
+  ASSERT_TRUE(queue.IsEmpty());
+}
+
+TEST(SPSCRingBuffer, UncommittedRecordsAreNotVisible)
+{
+  SPSCRingBuffer queue(256);
+  ASSERT_NE(queue.BeginWrite(16), nullptr);
+  ASSERT_TRUE(queue.IsEmpty());
+
+  queue.EndWrite();
+  u32 size;
+  ASSERT_NE(queue.BeginRead(&size), nullptr);
+  ASSERT_FALSE(queue.IsEmpty());
+
+  queue.EndRead();
+  ASSERT_TRUE(queue.IsEmpty());
+}
+
+TEST(SPSCRingBuffer, FullQueueRejectsWrites)
+{
+  SPSCRingBuffer queue(256);
+  u32 count = 0;
+  while (queue.BeginWrite(56))
+  {
+    queue.EndWrite();
+    count++;
+  }
+
+  ASSERT_EQ(count, 3u);
+
+  u32 size;
+  ASSERT_NE(queue.BeginRead(&size), nullptr);
+  queue.EndRead();
+  ASSERT_NE(queue.BeginWrite(56), nullptr);
+}
+
+TEST(SPSCRingBuffer, RecordsWrapAroundTheEnd)
+{
+  SPSCRingBuffer queue(256);
+  u32 size;
+  for (u32 i = 0; i < 100; i++)
+  {
+    const u32 record_size = queue.GetMaxRecordSize() - (i % 7) * 8;
+    u8* record = static_cast<u8*>(queue.BeginWrite(record_size));
+    ASSERT_NE(record, nullptr);
+    std::memset(record, static_cast<int>(i), record_size);
+    queue.EndWrite();
+
+    const u8* read_record = static_cast<const u8*>(queue.BeginRead(&size));
+    ASSERT_EQ(read_record, record);
+    ASSERT_EQ(size, record_size);
+    ASSERT_EQ(read_record[0], static_cast<u8>(i));
+    ASSERT_EQ(read_record[record_size - 1], static_cast<u8>(i));
+    queue.EndRead();
+  }
+}
+
+TEST(SPSCRingBuffer, ProducerAndConsumerThreads)
+{
+  static constexpr u32 NUM_RECORDS = 100000;
+
+  SPSCRingBuffer queue(4096);
+  std::thread producer([&queue]() {
+    for (u32 i = 0; i < NUM_RECORDS; i++)
+    {
+      const u32 count = 1 + (i % 13);
+      u32* record;
+      while (!(record = static_cast<u32*>(queue.BeginWrite(sizeof(u32) * count))))
+        std::this_thread::yield();
+
+      for (u32 j = 0; j < count; j++)
+        record[j] = i;
+      queue.EndWrite();
+    }
+  });
+
+  bool records_valid = true;
+  for (u32 i = 0; i < NUM_RECORDS; i++)
+  {
+    u32 size;
+    const u32* record;
+    while (!(record = static_cast<const u32*>(queue.BeginRead(&size))))
+      std::this_thread::yield();
+
+    const u32 count = 1 + (i % 13);
+    records_valid &= (size == sizeof(u32) * count && record[0] == i && record[count - 1] == i);
+    queue.EndRead();
+  }
+
+  producer.join();
+  ASSERT_TRUE(records_valid);
+  ASSERT_TRUE(queue.IsEmpty());
+}
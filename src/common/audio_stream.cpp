@@ -218,4 +218,7 @@ void AudioStream::EmptyBuffers()
 {
   std::unique_lock<std::mutex> lock(m_buffer_mutex);
   m_buffer.Clear();
+
+  // A writer waiting for space won't get any from the device while output is paused.
+  m_buffer_draining_cv.notify_one();
 }
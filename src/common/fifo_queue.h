@@ -96,6 +96,16 @@ public:
   const T& Peek() const { return m_ptr[m_head]; }
   const T& Peek(u32 offset) { return m_ptr[(m_head + offset) % CAPACITY]; }
 
+  // POD types don't need destructing, so the elements can be dropped by moving the head
+  template<class Y = T, std::enable_if_t<std::is_pod_v<Y>, int> = 0>
+  void Remove(u32 count)
+  {
+    DebugAssert(m_size >= count);
+    m_head = (m_head + count) % CAPACITY;
+    m_size -= count;
+  }
+
+  template<class Y = T, std::enable_if_t<!std::is_pod_v<Y>, int> = 0>
   void Remove(u32 count)
   {
     DebugAssert(m_size >= count);
@@ -126,6 +136,23 @@ public:
     return val;
   }
 
+  // faster version of PopRange for POD types which can be memcpy()ed
+  template<class Y = T, std::enable_if_t<std::is_pod_v<Y>, int> = 0>
+  void PopRange(T* out_data, u32 count)
+  {
+    DebugAssert(m_size >= count);
+    const u32 size_before_end = std::min(count, CAPACITY - m_head);
+    const u32 size_after_end = count - size_before_end;
+
+    std::memcpy(out_data, &m_ptr[m_head], sizeof(T) * size_before_end);
+    if (size_after_end > 0)
+      std::memcpy(out_data + size_before_end, &m_ptr[0], sizeof(T) * size_after_end);
+
+    m_head = (m_head + count) % CAPACITY;
+    m_size -= count;
+  }
+
+  template<class Y = T, std::enable_if_t<!std::is_pod_v<Y>, int> = 0>
   void PopRange(T* out_data, u32 count)
   {
     DebugAssert(m_size >= count);
@@ -3,6 +3,8 @@
 #include "assert.h"
 #include "cpu_detect.h"
 #include <algorithm>
+#include <cstring>
+#include <iterator>
 
 #if defined(WIN32)
 #include "windows_headers.h"
@@ -15,91 +17,215 @@ JitCodeBuffer::JitCodeBuffer(u32 size /* = 64 * 1024 * 1024 */, u32 far_code_siz
   m_total_size = size + far_code_size;
 
 #if defined(WIN32)
-  m_code_ptr = static_cast<u8*>(VirtualAlloc(nullptr, m_total_size, MEM_COMMIT, PAGE_EXECUTE_READWRITE));
+  m_code.ptr = static_cast<u8*>(VirtualAlloc(nullptr, m_total_size, MEM_COMMIT, PAGE_EXECUTE_READWRITE));
 #elif defined(__linux__) || defined(__ANDROID__) || defined(__APPLE__)
-  m_code_ptr = static_cast<u8*>(
+  m_code.ptr = static_cast<u8*>(
     mmap(nullptr, m_total_size, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
 #else
-  m_code_ptr = nullptr;
+  m_code.ptr = nullptr;
 #endif
-  m_free_code_ptr = m_code_ptr;
-  m_code_size = size;
-  m_code_used = 0;
-
-  m_far_code_ptr = static_cast<u8*>(m_code_ptr) + size;
-  m_free_far_code_ptr = m_far_code_ptr;
-  m_far_code_size = far_code_size;
-  m_far_code_used = 0;
-
-  if (!m_code_ptr)
+  m_code.size = size;
+  m_code.reserve_size = 0;
+  m_code.free_ptr = m_code.ptr;
+  m_code.free_end = m_code.ptr + size;
+  m_code.used = 0;
+
+  m_far_code.ptr = m_code.ptr + size;
+  m_far_code.size = far_code_size;
+  m_far_code.reserve_size = 0;
+  m_far_code.free_ptr = m_far_code.ptr;
+  m_far_code.free_end = m_far_code.ptr + far_code_size;
+  m_far_code.used = 0;
+
+  if (!m_code.ptr)
     Panic("Failed to allocate code space.");
 }
 
 JitCodeBuffer::~JitCodeBuffer()
 {
 #if defined(WIN32)
-  VirtualFree(m_code_ptr, 0, MEM_RELEASE);
+  VirtualFree(m_code.ptr, 0, MEM_RELEASE);
 #elif defined(__linux__) || defined(__ANDROID__) || defined(__APPLE__)
-  munmap(m_code_ptr, m_total_size);
+  munmap(m_code.ptr, m_total_size);
 #endif
 }
 
 void JitCodeBuffer::CommitCode(u32 length)
+{
+  CommitRegion(m_code, length);
+}
+
+void JitCodeBuffer::ReserveCode(u32 length)
+{
+  Assert(m_code.free_ranges.empty());
+  CommitCode(length);
+  m_code.reserve_size = static_cast<u32>(m_code.free_ptr - m_code.ptr);
+}
+
+void JitCodeBuffer::CommitFarCode(u32 length)
+{
+  CommitRegion(m_far_code, length);
+}
+
+bool JitCodeBuffer::AllocateCode(u32 code_length, u32 far_code_length)
+{
+  return AllocateRegion(m_code, code_length) && AllocateRegion(m_far_code, far_code_length);
+}
+
+void JitCodeBuffer::FreeCode(void* ptr, u32 length)
+{
+  FreeRegion(m_code, static_cast<u8*>(ptr), length);
+}
+
+void JitCodeBuffer::FreeFarCode(void* ptr, u32 length)
+{
+  FreeRegion(m_far_code, static_cast<u8*>(ptr), length);
+}
+
+void JitCodeBuffer::Reset()
+{
+  ResetRegion(m_code);
+  ResetRegion(m_far_code);
+}
+
+void JitCodeBuffer::Align(u32 alignment, u8 padding_value)
+{
+  DebugAssert(Common::IsPow2(alignment));
+  const u32 num_padding_bytes =
+    std::min(static_cast<u32>(Common::AlignUpPow2(reinterpret_cast<uintptr_t>(m_code.free_ptr), alignment) -
+                              reinterpret_cast<uintptr_t>(m_code.free_ptr)),
+             GetFreeCodeSpace());
+  std::memset(m_code.free_ptr, padding_value, num_padding_bytes);
+  m_code.free_ptr += num_padding_bytes;
+  m_code.used += num_padding_bytes;
+}
+
+void JitCodeBuffer::ResetRegion(Region& region)
+{
+  if (region.size > region.reserve_size)
+  {
+    std::memset(region.ptr + region.reserve_size, 0, region.size - region.reserve_size);
+    FlushInstructionCache(region.ptr + region.reserve_size, region.size - region.reserve_size);
+  }
+
+  region.free_ranges.clear();
+  region.free_ptr = region.ptr + region.reserve_size;
+  region.free_end = region.ptr + region.size;
+  region.used = region.reserve_size;
+}
+
+void JitCodeBuffer::CommitRegion(Region& region, u32 length)
 {
   if (length == 0)
     return;
 
 #if defined(CPU_ARM) || defined(CPU_AARCH64)
   // ARM instruction and data caches are not coherent, we need to flush after every block.
-  FlushInstructionCache(m_free_code_ptr, length);
+  FlushInstructionCache(region.free_ptr, length);
 #endif
 
-  Assert(length <= (m_code_size - m_code_used));
-  m_free_code_ptr += length;
-  m_code_used += length;
+  Assert(length <= static_cast<u32>(region.free_end - region.free_ptr));
+  region.free_ptr += length;
+  region.used += length;
 }
 
-void JitCodeBuffer::CommitFarCode(u32 length)
+bool JitCodeBuffer::AllocateRegion(Region& region, u32 length)
+{
+  if (static_cast<u32>(region.free_end - region.free_ptr) >= length)
+    return true;
+
+  // Search forward from the current range and wrap around, so recently-freed space near the start isn't reused over
+  // and over while the rest of the buffer sits idle.
+  const u32 current_offset = static_cast<u32>(region.free_ptr - region.ptr);
+  auto iter = region.free_ranges.lower_bound(current_offset);
+  auto found = region.free_ranges.end();
+  for (auto it = iter; it != region.free_ranges.end() && found == region.free_ranges.end(); ++it)
+  {
+    if (it->second >= length)
+      found = it;
+  }
+  for (auto it = region.free_ranges.begin(); it != iter && found == region.free_ranges.end(); ++it)
+  {
+    if (it->second >= length)
+      found = it;
+  }
+  if (found == region.free_ranges.end())
+    return false;
+
+  const u32 found_offset = found->first;
+  const u32 found_length = found->second;
+  region.free_ranges.erase(found);
+
+  // The rest of the current range is still free.
+  if (region.free_end != region.free_ptr)
+    InsertFreeRange(region, current_offset, static_cast<u32>(region.free_end - region.free_ptr));
+
+  region.free_ptr = region.ptr + found_offset;
+  region.free_end = region.free_ptr + found_length;
+  return true;
+}
+
+void JitCodeBuffer::FreeRegion(Region& region, u8* ptr, u32 length)
 {
   if (length == 0)
     return;
 
-#if defined(CPU_ARM) || defined(CPU_AARCH64)
-  // ARM instruction and data caches are not coherent, we need to flush after every block.
-  FlushInstructionCache(m_free_far_code_ptr, length);
-#endif
+  DebugAssert(ptr >= (region.ptr + region.reserve_size) && (ptr + length) <= (region.ptr + region.size));
+  DebugAssert(length <= region.used);
+  region.used -= length;
 
-  Assert(length <= (m_far_code_size - m_far_code_used));
-  m_free_far_code_ptr += length;
-  m_far_code_used += length;
+  // If the merged range touches the current range, grow the current range instead.
+  auto iter = InsertFreeRange(region, static_cast<u32>(ptr - region.ptr), length);
+  u8* const range_start = region.ptr + iter->first;
+  u8* const range_end = range_start + iter->second;
+  if (range_end == region.free_ptr)
+  {
+    region.free_ptr = range_start;
+    region.free_ranges.erase(iter);
+  }
+  else if (range_start == region.free_end)
+  {
+    region.free_end = range_end;
+    region.free_ranges.erase(iter);
+  }
 }
 
-void JitCodeBuffer::Reset()
+std::map<u32, u32>::iterator JitCodeBuffer::InsertFreeRange(Region& region, u32 offset, u32 length)
 {
-  std::memset(m_code_ptr, 0, m_code_size);
-  FlushInstructionCache(m_code_ptr, m_code_size);
-  if (m_far_code_size > 0)
+  auto next = region.free_ranges.lower_bound(offset);
+  DebugAssert(next == region.free_ranges.end() || next->first >= (offset + length));
+  if (next != region.free_ranges.end() && next->first == (offset + length))
   {
-    std::memset(m_far_code_ptr, 0, m_far_code_size);
-    FlushInstructionCache(m_far_code_ptr, m_far_code_size);
+    length += next->second;
+    next = region.free_ranges.erase(next);
   }
-  m_free_code_ptr = m_code_ptr;
-  m_code_used = 0;
 
-  m_free_far_code_ptr = m_far_code_ptr;
-  m_far_code_used = 0;
+  if (next != region.free_ranges.begin())
+  {
+    auto prev = std::prev(next);
+    DebugAssert((prev->first + prev->second) <= offset);
+    if ((prev->first + prev->second) == offset)
+    {
+      prev->second += length;
+      return prev;
+    }
+  }
+
+  return region.free_ranges.emplace_hint(next, offset, length);
 }
 
-void JitCodeBuffer::Align(u32 alignment, u8 padding_value)
+JitCodeBuffer::Stats JitCodeBuffer::GetRegionStats(const Region& region)
 {
-  DebugAssert(Common::IsPow2(alignment));
-  const u32 num_padding_bytes =
-    std::min(static_cast<u32>(Common::AlignUpPow2(reinterpret_cast<uintptr_t>(m_free_code_ptr), alignment) -
-                              reinterpret_cast<uintptr_t>(m_free_code_ptr)),
-             GetFreeCodeSpace());
-  std::memset(m_free_code_ptr, padding_value, num_padding_bytes);
-  m_free_code_ptr += num_padding_bytes;
-  m_code_used += num_padding_bytes;
+  Stats stats = {};
+  stats.size = region.size;
+  stats.used = region.used;
+  stats.free = region.size - region.used;
+  stats.largest_free_range = static_cast<u32>(region.free_end - region.free_ptr);
+  stats.free_range_count = static_cast<u32>(region.free_ranges.size()) + ((stats.largest_free_range > 0) ? 1 : 0);
+  for (const auto& it : region.free_ranges)
+    stats.largest_free_range = std::max(stats.largest_free_range, it.second);
+
+  return stats;
 }
 
 void JitCodeBuffer::FlushInstructionCache(void* address, u32 size)
@@ -112,3 +238,15 @@ void JitCodeBuffer::FlushInstructionCache(void* address, u32 size)
 #error Unknown platform.
 #endif
 }
+
+void JitCodeBuffer::SynchronizeInstructionStream()
+{
+  // x64 keeps instruction fetch coherent with stores from other cores, so there's nothing to do there.
+#if defined(CPU_AARCH64)
+#if defined(_MSC_VER)
+  __isb(_ARM64_BARRIER_SY);
+#else
+  asm volatile("isb" ::: "memory");
+#endif
+#endif
+}
@@ -1,22 +1,54 @@
 #pragma once
 #include "types.h"
+#include <map>
 
 class JitCodeBuffer
 {
 public:
+  struct Stats
+  {
+    u32 size;               // total size of the region, including reserved code
+    u32 used;               // bytes holding committed code
+    u32 free;               // bytes which can still be allocated
+    u32 free_range_count;   // number of separate free ranges
+    u32 largest_free_range; // largest contiguous allocation which can succeed
+
+    /// Fraction of free space which is not part of the largest free range, from 0 (none) to 1.
+    float GetFragmentation() const
+    {
+      return (free > 0) ? (1.0f - (static_cast<float>(largest_free_range) / static_cast<float>(free))) : 0.0f;
+    }
+  };
+
   JitCodeBuffer(u32 size = 64 * 1024 * 1024, u32 far_code_size = 0);
   ~JitCodeBuffer();
 
   void Reset();
 
-  u8* GetFreeCodePointer() const { return m_free_code_ptr; }
-  u32 GetFreeCodeSpace() const { return static_cast<u32>(m_code_size - m_code_used); }
+  u8* GetFreeCodePointer() const { return m_code.free_ptr; }
+  u32 GetFreeCodeSpace() const { return static_cast<u32>(m_code.free_end - m_code.free_ptr); }
+  u32 GetTotalFreeCodeSpace() const { return m_code.size - m_code.used; }
   void CommitCode(u32 length);
 
-  u8* GetFreeFarCodePointer() const { return m_free_far_code_ptr; }
-  u32 GetFreeFarCodeSpace() const { return static_cast<u32>(m_far_code_size - m_far_code_used); }
+  /// Commits code like CommitCode(), but keeps it (and everything before it) when the buffer is reset.
+  /// Used for code which is generated once, such as dispatchers. Must be called before any code is freed.
+  void ReserveCode(u32 length);
+
+  u8* GetFreeFarCodePointer() const { return m_far_code.free_ptr; }
+  u32 GetFreeFarCodeSpace() const { return static_cast<u32>(m_far_code.free_end - m_far_code.free_ptr); }
   void CommitFarCode(u32 length);
 
+  /// Ensures there is at least the specified amount of contiguous space at the free code pointers, moving them to
+  /// another free range if the current one is too small. Returns false if no free range is large enough.
+  bool AllocateCode(u32 code_length, u32 far_code_length);
+
+  /// Returns previously-committed code to the buffer, so the space can be reused. Adjacent free ranges are merged.
+  void FreeCode(void* ptr, u32 length);
+  void FreeFarCode(void* ptr, u32 length);
+
+  Stats GetCodeStats() const { return GetRegionStats(m_code); }
+  Stats GetFarCodeStats() const { return GetRegionStats(m_far_code); }
+
   /// Adjusts the free code pointer to the specified alignment, padding with bytes.
   /// Assumes alignment is a power-of-two.
   void Align(u32 alignment, u8 padding_value);
@@ -24,17 +56,34 @@ public:
   /// Flushes the instruction cache on the host for the specified range.
   static void FlushInstructionCache(void* address, u32 size);
 
+  /// Discards any instructions the calling thread has already fetched. Needed before running code which was written
+  /// and flushed by another thread, since the flush only synchronizes the thread which did it.
+  static void SynchronizeInstructionStream();
+
 private:
-  u8* m_code_ptr;
-  u8* m_free_code_ptr;
-  u32 m_code_size;
-  u32 m_code_used;
+  /// Code is committed from the current free range, [free_ptr, free_end). Freed code goes into free_ranges, which
+  /// doesn't include the current range. When the current range is too small, the next range after it which is large
+  /// enough becomes the current range, so allocations cycle through the buffer like a ring.
+  struct Region
+  {
+    u8* ptr;
+    u8* free_ptr;
+    u8* free_end;
+    u32 size;
+    u32 used;
+    u32 reserve_size;
+    std::map<u32, u32> free_ranges; // offset -> length
+  };
 
-  u8* m_far_code_ptr;
-  u8* m_free_far_code_ptr;
-  u32 m_far_code_size;
-  u32 m_far_code_used;
+  static void ResetRegion(Region& region);
+  static void CommitRegion(Region& region, u32 length);
+  static bool AllocateRegion(Region& region, u32 length);
+  static void FreeRegion(Region& region, u8* ptr, u32 length);
+  static std::map<u32, u32>::iterator InsertFreeRange(Region& region, u32 offset, u32 length);
+  static Stats GetRegionStats(const Region& region);
+
+  Region m_code;
+  Region m_far_code;
 
   u32 m_total_size;
 };
-
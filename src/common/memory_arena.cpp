@@ -0,0 +1,197 @@
+#include "memory_arena.h"
+#include "assert.h"
+#include "log.h"
+#include "string_util.h"
+Log_SetChannel(Common::MemoryArena);
+
+#if defined(WIN32)
+#include "windows_headers.h"
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#if defined(__linux__) || defined(__ANDROID__)
+#include <sys/syscall.h>
+#endif
+#endif
+
+namespace Common {
+
+MemoryArena::MemoryArena() = default;
+
+MemoryArena::~MemoryArena()
+{
+  Destroy();
+}
+
+bool MemoryArena::IsSupported()
+{
+#if defined(__linux__) || defined(__ANDROID__) || defined(__APPLE__)
+  return true;
+#else
+  // Windows can only place views into reserved regions with the placeholder API, which we don't use (yet).
+  return false;
+#endif
+}
+
+u32 MemoryArena::GetPageSize()
+{
+#if defined(WIN32)
+  SYSTEM_INFO si = {};
+  GetSystemInfo(&si);
+  return static_cast<u32>(si.dwPageSize);
+#else
+  return static_cast<u32>(sysconf(_SC_PAGESIZE));
+#endif
+}
+
+void* MemoryArena::ReserveRegion(size_t size)
+{
+#if defined(WIN32)
+  return VirtualAlloc(nullptr, size, MEM_RESERVE, PAGE_NOACCESS);
+#else
+  int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+#ifdef MAP_NORESERVE
+  flags |= MAP_NORESERVE;
+#endif
+  void* ptr = mmap(nullptr, size, PROT_NONE, flags, -1, 0);
+  return (ptr != MAP_FAILED) ? ptr : nullptr;
+#endif
+}
+
+void MemoryArena::ReleaseRegion(void* address, size_t size)
+{
+#if defined(WIN32)
+  VirtualFree(address, 0, MEM_RELEASE);
+#else
+  munmap(address, size);
+#endif
+}
+
+bool MemoryArena::SetPageProtection(void* address, size_t length, bool readable, bool writable, bool executable)
+{
+#if defined(WIN32)
+  static constexpr DWORD protection_table[2][2][2] = {
+    {{PAGE_NOACCESS, PAGE_EXECUTE}, {PAGE_WRITECOPY, PAGE_EXECUTE_WRITECOPY}},
+    {{PAGE_READONLY, PAGE_EXECUTE_READ}, {PAGE_READWRITE, PAGE_EXECUTE_READWRITE}}};
+
+  DWORD old_protect;
+  return static_cast<bool>(VirtualProtect(address, length,
+                                          protection_table[readable][writable][executable], &old_protect));
+#else
+  const int prot = (readable ? PROT_READ : 0) | (writable ? PROT_WRITE : 0) | (executable ? PROT_EXEC : 0);
+  return (mprotect(address, length, prot) == 0);
+#endif
+}
+
+bool MemoryArena::Create(size_t size, bool writable, bool executable)
+{
+  if (IsValid())
+    Destroy();
+
+#if defined(WIN32)
+  const DWORD protect = executable ? (writable ? PAGE_EXECUTE_READWRITE : PAGE_EXECUTE_READ) :
+                                     (writable ? PAGE_READWRITE : PAGE_READONLY);
+  m_file_handle = CreateFileMappingW(INVALID_HANDLE_VALUE, nullptr, protect, static_cast<DWORD>(size >> 32),
+                                     static_cast<DWORD>(size), nullptr);
+  if (!m_file_handle)
+  {
+    Log_ErrorPrintf("CreateFileMapping failed: %u", GetLastError());
+    return false;
+  }
+#else
+#if defined(__linux__) || defined(__ANDROID__)
+  m_shmem_fd = static_cast<int>(syscall(__NR_memfd_create, "duckstation", 0));
+#else
+  const std::string name = StringUtil::StdStringFromFormat("/duckstation_%d", static_cast<int>(getpid()));
+  m_shmem_fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, S_IRUSR | S_IWUSR);
+  if (m_shmem_fd >= 0)
+    shm_unlink(name.c_str());
+#endif
+  if (m_shmem_fd < 0)
+  {
+    Log_ErrorPrintf("Failed to create shared memory object: %d", errno);
+    return false;
+  }
+
+  if (ftruncate(m_shmem_fd, static_cast<off_t>(size)) < 0)
+  {
+    Log_ErrorPrintf("ftruncate(%zu) failed: %d", size, errno);
+    close(m_shmem_fd);
+    m_shmem_fd = -1;
+    return false;
+  }
+#endif
+
+  m_size = size;
+  m_writable = writable;
+  m_executable = executable;
+  return true;
+}
+
+void MemoryArena::Destroy()
+{
+#if defined(WIN32)
+  if (m_file_handle)
+  {
+    CloseHandle(m_file_handle);
+    m_file_handle = nullptr;
+  }
+#else
+  if (m_shmem_fd >= 0)
+  {
+    close(m_shmem_fd);
+    m_shmem_fd = -1;
+  }
+#endif
+
+  m_size = 0;
+}
+
+void* MemoryArena::CreateViewPtr(size_t offset, size_t size, bool writable, bool executable,
+                                 void* fixed_address /* = nullptr */)
+{
+  Assert((offset + size) <= m_size && (!writable || m_writable) && (!executable || m_executable));
+
+#if defined(WIN32)
+  if (fixed_address)
+    return nullptr;
+
+  const DWORD desired_access = FILE_MAP_READ | (writable ? FILE_MAP_WRITE : 0) | (executable ? FILE_MAP_EXECUTE : 0);
+  return MapViewOfFileEx(m_file_handle, desired_access, static_cast<DWORD>(static_cast<u64>(offset) >> 32),
+                         static_cast<DWORD>(offset), size, nullptr);
+#else
+  const int prot = PROT_READ | (writable ? PROT_WRITE : 0) | (executable ? PROT_EXEC : 0);
+  const int flags = (fixed_address != nullptr) ? (MAP_SHARED | MAP_FIXED) : MAP_SHARED;
+  void* ptr = mmap(fixed_address, size, prot, flags, m_shmem_fd, static_cast<off_t>(offset));
+  if (ptr == MAP_FAILED)
+  {
+    Log_ErrorPrintf("mmap(%p, %zu) failed: %d", fixed_address, size, errno);
+    return nullptr;
+  }
+
+  return ptr;
+#endif
+}
+
+bool MemoryArena::ReleaseViewPtr(void* address, size_t size, bool keep_reservation /* = false */)
+{
+#if defined(WIN32)
+  return static_cast<bool>(UnmapViewOfFile(address));
+#else
+  if (keep_reservation)
+  {
+    // Replacing the mapping is atomic, so nothing else can be allocated in the hole.
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED;
+#ifdef MAP_NORESERVE
+    flags |= MAP_NORESERVE;
+#endif
+    return (mmap(address, size, PROT_NONE, flags, -1, 0) != MAP_FAILED);
+  }
+
+  return (munmap(address, size) == 0);
+#endif
+}
+
+} // namespace Common
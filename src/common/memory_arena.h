@@ -0,0 +1,50 @@
+#pragma once
+#include "types.h"
+
+namespace Common {
+
+/// Shared memory object which can be mapped at multiple addresses in the process address space.
+class MemoryArena
+{
+public:
+  MemoryArena();
+  ~MemoryArena();
+
+  /// Returns true if multiple views of the same memory can be created on this platform.
+  static bool IsSupported();
+
+  /// Returns the granularity which page protection can be changed at.
+  static u32 GetPageSize();
+
+  /// Reserves an inaccessible region of address space, which views can later be placed into.
+  static void* ReserveRegion(size_t size);
+  static void ReleaseRegion(void* address, size_t size);
+
+  /// Changes the access permissions of already-mapped pages.
+  static bool SetPageProtection(void* address, size_t length, bool readable, bool writable, bool executable);
+
+  bool IsValid() const { return (m_size > 0); }
+  size_t GetSize() const { return m_size; }
+
+  bool Create(size_t size, bool writable, bool executable);
+  void Destroy();
+
+  /// Maps the range [offset, offset + size) of the arena. If fixed_address is set, the view is placed at that address,
+  /// replacing any reservation which was previously there.
+  void* CreateViewPtr(size_t offset, size_t size, bool writable, bool executable, void* fixed_address = nullptr);
+
+  /// Unmaps a view. If the view was placed inside a reserved region, the address space is re-reserved.
+  bool ReleaseViewPtr(void* address, size_t size, bool keep_reservation = false);
+
+private:
+#if defined(WIN32)
+  void* m_file_handle = nullptr;
+#else
+  int m_shmem_fd = -1;
+#endif
+  size_t m_size = 0;
+  bool m_writable = false;
+  bool m_executable = false;
+};
+
+} // namespace Common
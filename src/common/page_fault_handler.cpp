@@ -0,0 +1,241 @@
+#include "page_fault_handler.h"
+#include "cpu_detect.h"
+#include "log.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <thread>
+Log_SetChannel(Common::PageFaultHandler);
+
+#if defined(WIN32)
+#include "windows_headers.h"
+#elif defined(__linux__) || defined(__ANDROID__) || defined(__APPLE__)
+#include <signal.h>
+#include <ucontext.h>
+#define USE_SIGACTION 1
+#endif
+
+namespace Common::PageFaultHandler {
+
+// Handlers live in fixed slots, so the fault path can walk them without locking. A slot's callback is only assigned
+// while the slot is inactive, and only destroyed once no fault is being dispatched.
+struct HandlerSlot
+{
+  std::atomic<void*> owner{nullptr};
+  std::atomic_bool active{false};
+  Callback callback;
+};
+static constexpr u32 MAX_HANDLERS = 8;
+static std::array<HandlerSlot, MAX_HANDLERS> s_handlers;
+static std::atomic<u32> s_dispatch_count{0};
+static u32 s_handler_count = 0;
+static std::mutex s_registration_lock; // only taken by InstallHandler()/RemoveHandler(), never while dispatching
+static thread_local bool s_in_handler = false;
+
+#if defined(WIN32)
+static PVOID s_veh_handle = nullptr;
+#elif defined(USE_SIGACTION)
+static struct sigaction s_old_sigsegv_action;
+#if defined(__APPLE__)
+static struct sigaction s_old_sigbus_action;
+#endif
+#endif
+
+static HandlerResult DispatchToHandlers(void* exception_pc, void* fault_address, bool is_write)
+{
+  // RemoveHandler() waits for the count to drop to zero before it touches an inactive slot's callback.
+  s_dispatch_count.fetch_add(1);
+
+  HandlerResult result = HandlerResult::ExecuteNextHandler;
+  for (const HandlerSlot& slot : s_handlers)
+  {
+    if (slot.active.load() && slot.callback(exception_pc, fault_address, is_write) == HandlerResult::ContinueExecution)
+    {
+      result = HandlerResult::ContinueExecution;
+      break;
+    }
+  }
+
+  s_dispatch_count.fetch_sub(1);
+  return result;
+}
+
+#if defined(WIN32)
+
+static LONG NTAPI ExceptionHandler(PEXCEPTION_POINTERS exi)
+{
+  if (exi->ExceptionRecord->ExceptionCode != EXCEPTION_ACCESS_VIOLATION || s_in_handler)
+    return EXCEPTION_CONTINUE_SEARCH;
+
+  s_in_handler = true;
+
+#if defined(CPU_X64)
+  void* const exception_pc = reinterpret_cast<void*>(exi->ContextRecord->Rip);
+#else
+  void* const exception_pc = nullptr;
+#endif
+
+  void* const fault_address = reinterpret_cast<void*>(exi->ExceptionRecord->ExceptionInformation[1]);
+  const bool is_write = (exi->ExceptionRecord->ExceptionInformation[0] == 1);
+  const HandlerResult result = DispatchToHandlers(exception_pc, fault_address, is_write);
+
+  s_in_handler = false;
+  return (result == HandlerResult::ContinueExecution) ? EXCEPTION_CONTINUE_EXECUTION : EXCEPTION_CONTINUE_SEARCH;
+}
+
+#elif defined(USE_SIGACTION)
+
+static void RestoreOldAction(int sig)
+{
+  // Restore the previous action and return, the faulting instruction will run again and trap to it. We don't chain
+  // directly, since the old handler may be SIG_DFL, which we'd need to raise anyway.
+#if defined(__APPLE__)
+  if (sig == SIGBUS)
+  {
+    sigaction(SIGBUS, &s_old_sigbus_action, nullptr);
+    return;
+  }
+#endif
+
+  sigaction(SIGSEGV, &s_old_sigsegv_action, nullptr);
+}
+
+static void SignalHandler(int sig, siginfo_t* info, void* ctx)
+{
+  // A fault inside one of our handlers isn't something we can fix up.
+  if (s_in_handler)
+  {
+    RestoreOldAction(sig);
+    return;
+  }
+
+#if defined(__linux__) || defined(__ANDROID__)
+  ucontext_t* uc = static_cast<ucontext_t*>(ctx);
+#if defined(CPU_X64)
+  void* const exception_pc = reinterpret_cast<void*>(uc->uc_mcontext.gregs[REG_RIP]);
+  const bool is_write = (uc->uc_mcontext.gregs[REG_ERR] & 2) != 0;
+#elif defined(CPU_AARCH64)
+  void* const exception_pc = reinterpret_cast<void*>(uc->uc_mcontext.pc);
+  const bool is_write = false;
+#else
+  void* const exception_pc = nullptr;
+  const bool is_write = false;
+#endif
+#elif defined(__APPLE__)
+  ucontext_t* uc = static_cast<ucontext_t*>(ctx);
+#if defined(CPU_X64)
+  void* const exception_pc = reinterpret_cast<void*>(uc->uc_mcontext->__ss.__rip);
+  const bool is_write = (uc->uc_mcontext->__es.__err & 2) != 0;
+#elif defined(CPU_AARCH64)
+  void* const exception_pc = reinterpret_cast<void*>(uc->uc_mcontext->__ss.__pc);
+  const bool is_write = false;
+#else
+  void* const exception_pc = nullptr;
+  const bool is_write = false;
+#endif
+#endif
+
+  s_in_handler = true;
+  const HandlerResult result = DispatchToHandlers(exception_pc, info->si_addr, is_write);
+  s_in_handler = false;
+  if (result == HandlerResult::ContinueExecution)
+    return;
+
+  // Not ours.
+  RestoreOldAction(sig);
+}
+
+#endif
+
+bool InstallHandler(void* owner, Callback callback)
+{
+  std::lock_guard<std::mutex> guard(s_registration_lock);
+  HandlerSlot* free_slot = nullptr;
+  for (HandlerSlot& slot : s_handlers)
+  {
+    void* const slot_owner = slot.owner.load();
+    if (slot_owner == owner)
+      return false;
+    else if (!slot_owner && !free_slot)
+      free_slot = &slot;
+  }
+
+  if (!free_slot)
+  {
+    Log_ErrorPrint("Too many page fault handlers installed");
+    return false;
+  }
+
+  if (s_handler_count == 0)
+  {
+#if defined(WIN32)
+    s_veh_handle = AddVectoredExceptionHandler(1, ExceptionHandler);
+    if (!s_veh_handle)
+    {
+      Log_ErrorPrint("Failed to add vectored exception handler");
+      return false;
+    }
+#elif defined(USE_SIGACTION)
+    struct sigaction sa = {};
+    sa.sa_flags = SA_SIGINFO | SA_NODEFER;
+    sa.sa_sigaction = SignalHandler;
+    if (sigaction(SIGSEGV, &sa, &s_old_sigsegv_action) < 0)
+    {
+      Log_ErrorPrint("Failed to install SIGSEGV handler");
+      return false;
+    }
+#if defined(__APPLE__)
+    if (sigaction(SIGBUS, &sa, &s_old_sigbus_action) < 0)
+    {
+      Log_ErrorPrint("Failed to install SIGBUS handler");
+      return false;
+    }
+#endif
+#else
+    return false;
+#endif
+  }
+
+  // Inactive slots are skipped by the fault path, so the callback can be written before it's published.
+  free_slot->owner.store(owner);
+  free_slot->callback = std::move(callback);
+  free_slot->active.store(true);
+
+  s_handler_count++;
+  return true;
+}
+
+bool RemoveHandler(void* owner)
+{
+  std::lock_guard<std::mutex> guard(s_registration_lock);
+  auto it = std::find_if(s_handlers.begin(), s_handlers.end(),
+                         [owner](const HandlerSlot& slot) { return slot.owner.load() == owner; });
+  if (it == s_handlers.end())
+    return false;
+
+  // A fault on another thread could still be running the callback, so it can't be destroyed until that's done.
+  it->active.store(false);
+  while (s_dispatch_count.load() != 0)
+    std::this_thread::yield();
+
+  it->callback = {};
+  it->owner.store(nullptr);
+
+  if (--s_handler_count == 0)
+  {
+#if defined(WIN32)
+    RemoveVectoredExceptionHandler(s_veh_handle);
+    s_veh_handle = nullptr;
+#elif defined(USE_SIGACTION)
+    sigaction(SIGSEGV, &s_old_sigsegv_action, nullptr);
+#if defined(__APPLE__)
+    sigaction(SIGBUS, &s_old_sigbus_action, nullptr);
+#endif
+#endif
+  }
+
+  return true;
+}
+
+} // namespace Common::PageFaultHandler
@@ -0,0 +1,22 @@
+#pragma once
+#include "types.h"
+#include <functional>
+
+namespace Common::PageFaultHandler {
+
+enum class HandlerResult
+{
+  ContinueExecution,
+  ExecuteNextHandler,
+};
+
+/// Called with the host instruction pointer which faulted, the address which was accessed, and whether it was a write
+/// (if the platform can tell us). Runs in signal/exception context on the thread which faulted. Faults are only raised
+/// synchronously by accesses to memory we protected, never from inside the allocator, so handlers may allocate and log.
+/// They must not take locks the faulting code could be holding, and a fault inside a handler isn't dispatched.
+using Callback = std::function<HandlerResult(void* exception_pc, void* fault_address, bool is_write)>;
+
+bool InstallHandler(void* owner, Callback callback);
+bool RemoveHandler(void* owner);
+
+} // namespace Common::PageFaultHandler
@@ -0,0 +1,93 @@
+#include "spsc_ring_buffer.h"
+#include "align.h"
+#include "assert.h"
+#include <cstring>
+
+SPSCRingBuffer::SPSCRingBuffer(u32 size) : m_size(Common::AlignUpPow2(size, ALIGNMENT))
+{
+  m_buffer = new u8[m_size];
+}
+
+SPSCRingBuffer::~SPSCRingBuffer()
+{
+  delete[] m_buffer;
+}
+
+void* SPSCRingBuffer::BeginWrite(u32 size)
+{
+  const u32 total_size = HEADER_SIZE + Common::AlignUpPow2(size, ALIGNMENT);
+  DebugAssert(size <= GetMaxRecordSize());
+
+  const u32 write_pos = m_write_pos.load(std::memory_order_relaxed);
+  const u32 read_pos = m_read_pos.load(std::memory_order_acquire);
+
+  // The write position may never catch up to the read position, otherwise the queue would look empty.
+  u32 record_pos;
+  if (write_pos >= read_pos)
+  {
+    if ((write_pos + total_size) < m_size || ((write_pos + total_size) == m_size && read_pos != 0))
+    {
+      record_pos = write_pos;
+    }
+    else if (total_size < read_pos)
+    {
+      // Not enough space before the end of the buffer, so the reader has to skip back to the start.
+      const u32 marker = WRAP_MARKER;
+      std::memcpy(&m_buffer[write_pos], &marker, sizeof(marker));
+      record_pos = 0;
+    }
+    else
+    {
+      return nullptr;
+    }
+  }
+  else
+  {
+    if ((write_pos + total_size) >= read_pos)
+      return nullptr;
+
+    record_pos = write_pos;
+  }
+
+  std::memcpy(&m_buffer[record_pos], &size, sizeof(size));
+  m_pending_write_pos = (record_pos + total_size) % m_size;
+  return &m_buffer[record_pos + HEADER_SIZE];
+}
+
+void SPSCRingBuffer::EndWrite()
+{
+  m_write_pos.store(m_pending_write_pos, std::memory_order_release);
+}
+
+const void* SPSCRingBuffer::BeginRead(u32* size)
+{
+  u32 read_pos = m_read_pos.load(std::memory_order_relaxed);
+  const u32 write_pos = m_write_pos.load(std::memory_order_acquire);
+  if (read_pos == write_pos)
+    return nullptr;
+
+  u32 record_size;
+  std::memcpy(&record_size, &m_buffer[read_pos], sizeof(record_size));
+  if (record_size == WRAP_MARKER)
+  {
+    read_pos = 0;
+    std::memcpy(&record_size, &m_buffer[read_pos], sizeof(record_size));
+  }
+
+  *size = record_size;
+  m_pending_read_pos = (read_pos + HEADER_SIZE + Common::AlignUpPow2(record_size, ALIGNMENT)) % m_size;
+  return &m_buffer[read_pos + HEADER_SIZE];
+}
+
+void SPSCRingBuffer::EndRead()
+{
+  m_read_pos.store(m_pending_read_pos, std::memory_order_release);
+}
+
+void SPSCRingBuffer::Reset()
+{
+  m_write_pos.store(0, std::memory_order_relaxed);
+  m_read_pos.store(0, std::memory_order_relaxed);
+  m_pending_write_pos = 0;
+  m_pending_read_pos = 0;
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include "types.h"
+#include <atomic>
+
+/// Lock-free queue of variable-sized records, for passing work from exactly one producer thread to exactly one
+/// consumer thread. Neither side blocks; callers are responsible for waiting when the queue is full or empty.
+class SPSCRingBuffer
+{
+public:
+  SPSCRingBuffer(u32 size);
+  ~SPSCRingBuffer();
+
+  /// Largest record which is guaranteed to fit once the queue is empty, in bytes.
+  u32 GetMaxRecordSize() const { return (m_size / 2) - (HEADER_SIZE * 2); }
+
+  /// Returns true if the consumer has finished with every record which has been written.
+  bool IsEmpty() const
+  {
+    return m_read_pos.load(std::memory_order_acquire) == m_write_pos.load(std::memory_order_acquire);
+  }
+
+  /// Returns a pointer to space for a record of the specified size, or nullptr if there is not enough free space.
+  /// The record is not visible to the consumer until EndWrite() is called. Producer only.
+  void* BeginWrite(u32 size);
+  void EndWrite();
+
+  /// Returns a pointer to the oldest record and its size, or nullptr if the queue is empty. The record's space is not
+  /// released until EndRead() is called. Consumer only.
+  const void* BeginRead(u32* size);
+  void EndRead();
+
+  /// Discards all records. Neither side may be accessing the queue.
+  void Reset();
+
+private:
+  enum : u32
+  {
+    HEADER_SIZE = 8,
+    ALIGNMENT = 8,
+    WRAP_MARKER = 0xFFFFFFFFu
+  };
+
+  u8* m_buffer;
+  u32 m_size;
+
+  // Positions are kept on separate cache lines, so the producer and consumer don't contend.
+  alignas(64) std::atomic<u32> m_write_pos{0};
+  u32 m_pending_write_pos = 0;
+
+  alignas(64) std::atomic<u32> m_read_pos{0};
+  u32 m_pending_read_pos = 0;
+};
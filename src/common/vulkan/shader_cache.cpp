@@ -425,6 +425,9 @@ ShaderCache::CacheIndexKey ShaderCache::GetCacheKey(ShaderCompiler::Type type, c
 std::optional<ShaderCompiler::SPIRVCodeVector> ShaderCache::GetShaderSPV(ShaderCompiler::Type type,
                                                                          std::string_view shader_code)
 {
+  // Shaders can be requested from a background compile thread, so serialize access to the index and blob file.
+  std::lock_guard<std::mutex> guard(m_index_mutex);
+
   const auto key = GetCacheKey(type, shader_code);
   auto iter = m_index.find(key);
   if (iter == m_index.end())
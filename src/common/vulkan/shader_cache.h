@@ -5,6 +5,7 @@
 #include "vulkan_loader.h"
 #include <cstdio>
 #include <memory>
+#include <mutex>
 #include <optional>
 #include <string>
 #include <string_view>
@@ -91,6 +92,7 @@ private:
   std::string m_pipeline_cache_filename;
 
   CacheIndex m_index;
+  std::mutex m_index_mutex;
 
   VkPipelineCache m_pipeline_cache = VK_NULL_HANDLE;
   bool m_debug = false;
@@ -0,0 +1,341 @@
+#include "core/gpu_sw.h"
+#include <gtest/gtest.h>
+#include <array>
+#include <memory>
+#include <random>
+#include <vector>
+
+// Befriended by GPU_SW, so it must live in the global namespace.
+class GPU_SWTest : public ::testing::Test
+{
+protected:
+  using RenderCommand = GPU::RenderCommand;
+
+  enum : u32
+  {
+    VRAM_WIDTH = GPU::VRAM_WIDTH,
+    VRAM_HEIGHT = GPU::VRAM_HEIGHT,
+    MAX_THREADS = GPU_SW::MAX_THREADS,
+
+    NUM_PRIMITIVES = 2000,
+    NUM_SPANS = 4096,
+
+    // Keeps primitives small enough for the test to run quickly, while still spanning several bands.
+    MAX_PRIMITIVE_EXTENT = 160,
+    MAX_TRANSFER_EXTENT = 96
+  };
+
+  static std::unique_ptr<GPU_SW> CreateGPU(u32 thread_count)
+  {
+    std::unique_ptr<GPU_SW> gpu = std::make_unique<GPU_SW>();
+    gpu->StartThreads(thread_count);
+    return gpu;
+  }
+
+  u32 RandomRange(u32 min, u32 max) { return min + (static_cast<u32>(m_rng()) % (max - min + 1)); }
+  s32 RandomRange(s32 min, s32 max) { return min + static_cast<s32>(static_cast<u32>(m_rng()) % (max - min + 1)); }
+  bool RandomBool() { return (m_rng() & 1) != 0; }
+
+  u32 RandomPosition(s32 center_x, s32 center_y)
+  {
+    const s32 x = center_x + RandomRange(-s32(MAX_PRIMITIVE_EXTENT / 2), s32(MAX_PRIMITIVE_EXTENT / 2));
+    const s32 y = center_y + RandomRange(-s32(MAX_PRIMITIVE_EXTENT / 2), s32(MAX_PRIMITIVE_EXTENT / 2));
+    return (static_cast<u32>(x) & 0xFFFu) | ((static_cast<u32>(y) & 0xFFFu) << 16);
+  }
+
+  u32 RandomColor() { return static_cast<u32>(m_rng()) & 0xFFFFFFu; }
+  u32 RandomTexcoord() { return static_cast<u32>(m_rng()) & 0xFFFFu; }
+
+  void RandomizeDrawingState(GPU_SW* gpu)
+  {
+    // Texture page, transparency mode, texture mode and dithering.
+    gpu->SetDrawMode(Truncate16(static_cast<u32>(m_rng()) & 0x3FFu));
+    gpu->SetTexturePalette(Truncate16(static_cast<u32>(m_rng())));
+    gpu->SetTextureWindow(RandomBool() ? 0 : static_cast<u32>(m_rng()));
+    gpu->m_GPUSTAT.set_mask_while_drawing = RandomBool();
+    gpu->m_GPUSTAT.check_mask_before_draw = RandomBool();
+
+    if (RandomBool())
+    {
+      gpu->m_drawing_area.Set(0, 0, VRAM_WIDTH - 1, VRAM_HEIGHT - 1);
+    }
+    else
+    {
+      const u32 left = RandomRange(0u, VRAM_WIDTH - 1);
+      const u32 top = RandomRange(0u, VRAM_HEIGHT - 1);
+      gpu->m_drawing_area.Set(left, top, RandomRange(left, VRAM_WIDTH - 1), RandomRange(top, VRAM_HEIGHT - 1));
+    }
+
+    gpu->m_drawing_offset.x = RandomRange(-64, 64);
+    gpu->m_drawing_offset.y = RandomRange(-64, 64);
+  }
+
+  void DrawRandomPolygon(GPU_SW* gpu)
+  {
+    RenderCommand rc{};
+    rc.primitive = GPU::Primitive::Polygon;
+    rc.color_for_first_vertex = RandomColor();
+    rc.raw_texture_enable = RandomBool();
+    rc.transparency_enable = RandomBool();
+    rc.texture_enable = RandomBool();
+    rc.quad_polygon = RandomBool();
+    rc.shading_enable = RandomBool();
+
+    const s32 center_x = RandomRange(0, s32(VRAM_WIDTH) - 1);
+    const s32 center_y = RandomRange(0, s32(VRAM_HEIGHT) - 1);
+    std::array<u32, 12> words;
+    u32 num_words = 0;
+    for (u32 i = 0; i < (rc.quad_polygon ? 4u : 3u); i++)
+    {
+      if (rc.shading_enable && i > 0)
+        words[num_words++] = RandomColor();
+      words[num_words++] = RandomPosition(center_x, center_y);
+      if (rc.texture_enable)
+        words[num_words++] = RandomTexcoord();
+    }
+
+    gpu->m_render_command.bits = rc.bits;
+    gpu->DispatchRenderCommand(words.data());
+  }
+
+  void DrawRandomRectangle(GPU_SW* gpu)
+  {
+    RenderCommand rc{};
+    rc.primitive = GPU::Primitive::Rectangle;
+    rc.color_for_first_vertex = RandomColor();
+    rc.raw_texture_enable = RandomBool();
+    rc.transparency_enable = RandomBool();
+    rc.texture_enable = RandomBool();
+    rc.rectangle_size = static_cast<GPU::DrawRectangleSize>(RandomRange(0u, 3u));
+
+    std::array<u32, 3> words;
+    u32 num_words = 0;
+    words[num_words++] = RandomPosition(RandomRange(0, s32(VRAM_WIDTH) - 1), RandomRange(0, s32(VRAM_HEIGHT) - 1));
+    if (rc.texture_enable)
+      words[num_words++] = RandomTexcoord();
+    if (rc.rectangle_size == GPU::DrawRectangleSize::Variable)
+      words[num_words++] = RandomRange(0u, MAX_PRIMITIVE_EXTENT) | (RandomRange(0u, MAX_PRIMITIVE_EXTENT) << 16);
+
+    gpu->m_render_command.bits = rc.bits;
+    gpu->DispatchRenderCommand(words.data());
+  }
+
+  void DrawRandomLine(GPU_SW* gpu)
+  {
+    RenderCommand rc{};
+    rc.primitive = GPU::Primitive::Line;
+    rc.color_for_first_vertex = RandomColor();
+    rc.transparency_enable = RandomBool();
+    rc.shading_enable = RandomBool();
+
+    const s32 center_x = RandomRange(0, s32(VRAM_WIDTH) - 1);
+    const s32 center_y = RandomRange(0, s32(VRAM_HEIGHT) - 1);
+    std::array<u32, 3> words;
+    u32 num_words = 0;
+    words[num_words++] = RandomPosition(center_x, center_y);
+    if (rc.shading_enable)
+      words[num_words++] = RandomColor();
+    words[num_words++] = RandomPosition(center_x, center_y);
+
+    gpu->m_render_command.bits = rc.bits;
+    gpu->DispatchRenderCommand(words.data());
+  }
+
+  /// Renders a stream of random primitives and transfers, which only depends on the seed.
+  void RenderRandomStream(GPU_SW* gpu, u32 seed)
+  {
+    m_rng.seed(seed);
+
+    // Start from noise, so every texture mode, palette and mask bit setting has something to work with.
+    std::vector<u16> data(VRAM_WIDTH * VRAM_HEIGHT);
+    for (u16& value : data)
+      value = Truncate16(static_cast<u32>(m_rng()));
+    gpu->UpdateVRAM(0, 0, VRAM_WIDTH, VRAM_HEIGHT, data.data());
+
+    for (u32 i = 0; i < NUM_PRIMITIVES; i++)
+    {
+      if ((i % 16) == 0)
+        RandomizeDrawingState(gpu);
+
+      switch (m_rng() % 8)
+      {
+        case 0:
+          gpu->FillVRAM(RandomRange(0u, VRAM_WIDTH - 1), RandomRange(0u, VRAM_HEIGHT - 1),
+                        RandomRange(1u, MAX_TRANSFER_EXTENT), RandomRange(1u, MAX_TRANSFER_EXTENT), RandomColor());
+          break;
+
+        case 1:
+          gpu->CopyVRAM(RandomRange(0u, VRAM_WIDTH - 1), RandomRange(0u, VRAM_HEIGHT - 1),
+                        RandomRange(0u, VRAM_WIDTH - 1), RandomRange(0u, VRAM_HEIGHT - 1),
+                        RandomRange(1u, MAX_TRANSFER_EXTENT), RandomRange(1u, MAX_TRANSFER_EXTENT));
+          break;
+
+        case 2:
+        {
+          const u32 width = RandomRange(1u, MAX_TRANSFER_EXTENT);
+          const u32 height = RandomRange(1u, MAX_TRANSFER_EXTENT);
+          gpu->UpdateVRAM(RandomRange(0u, VRAM_WIDTH - 1), RandomRange(0u, VRAM_HEIGHT - 1), width, height,
+                          data.data() + RandomRange(0u, VRAM_WIDTH * (VRAM_HEIGHT - MAX_TRANSFER_EXTENT)));
+        }
+        break;
+
+        case 3:
+        case 4:
+          DrawRandomPolygon(gpu);
+          break;
+
+        case 5:
+        case 6:
+          DrawRandomRectangle(gpu);
+          break;
+
+        default:
+          DrawRandomLine(gpu);
+          break;
+      }
+    }
+
+    gpu->Sync();
+  }
+
+  static void CompareVRAM(const GPU_SW& expected, const GPU_SW& actual, const char* description)
+  {
+    for (u32 y = 0; y < VRAM_HEIGHT; y++)
+    {
+      for (u32 x = 0; x < VRAM_WIDTH; x++)
+      {
+        ASSERT_EQ(expected.GetPixel(x, y), actual.GetPixel(x, y))
+          << "pixel (" << x << ", " << y << ") differs with " << description;
+      }
+    }
+  }
+
+  /// Shades random spans with SIMD where it is available, and one pixel at a time, and compares the results.
+  void CompareRandomSpans(bool texture_enable, bool raw_texture_enable, bool transparency_enable,
+                          bool dithering_enable)
+  {
+    static constexpr u32 SPAN_WIDTH = GPU_SW::SPAN_WIDTH;
+
+    std::unique_ptr<GPU_SW> simd = CreateGPU(0);
+    std::unique_ptr<GPU_SW> scalar = CreateGPU(0);
+    for (u32 i = 0; i < VRAM_WIDTH * VRAM_HEIGHT; i++)
+      simd->m_vram[i] = scalar->m_vram[i] = Truncate16(static_cast<u32>(m_rng()));
+
+    const GPU_SW::ShadeSpanFunction ShadeSpan =
+      simd->GetShadeSpanFunction(texture_enable, raw_texture_enable, transparency_enable, dithering_enable);
+
+    for (u32 i = 0; i < NUM_SPANS; i++)
+    {
+      GPU_SW::SWDrawCommand cmd{};
+      cmd.type = GPU_SW::SWCommandType::DrawPolygon;
+      cmd.params.band_mask = GPU_SW::ALL_BANDS;
+      cmd.params.mask_and = RandomBool() ? 0x8000 : 0;
+      cmd.params.mask_or = RandomBool() ? 0x8000 : 0;
+      cmd.params.interlaced_rendering = (m_rng() % 4) == 0;
+      cmd.params.active_line_lsb = static_cast<u8>(RandomBool());
+      cmd.rc.primitive = GPU::Primitive::Polygon;
+      cmd.rc.texture_enable = texture_enable;
+      cmd.rc.raw_texture_enable = raw_texture_enable;
+      cmd.rc.transparency_enable = transparency_enable;
+      cmd.dithering_enable = dithering_enable;
+      cmd.texture_mode = static_cast<GPU::TextureMode>(RandomRange(0u, 2u));
+      cmd.transparency_mode = static_cast<GPU::TransparencyMode>(RandomRange(0u, 3u));
+      if (RandomBool())
+      {
+        cmd.texture_window_mask_x = static_cast<u8>(m_rng() & 0x1F);
+        cmd.texture_window_mask_y = static_cast<u8>(m_rng() & 0x1F);
+        cmd.texture_window_offset_x = static_cast<u8>(m_rng() & 0x1F);
+        cmd.texture_window_offset_y = static_cast<u8>(m_rng() & 0x1F);
+      }
+      cmd.texture_page_x = RandomRange(0u, 15u) * 64;
+      cmd.texture_page_y = RandomRange(0u, 1u) * 256;
+      cmd.texture_palette_x = RandomRange(0u, 63u) * 16;
+      cmd.texture_palette_y = RandomRange(0u, VRAM_HEIGHT - 1);
+
+      // The SIMD path reads every texel before writing any pixel, so the span must not overlap the texture.
+      static constexpr std::array<u32, 3> texture_page_widths = {{64, 128, 256}};
+      static constexpr std::array<u32, 3> palette_widths = {{16, 256, 0}};
+      const u32 mode = static_cast<u32>(cmd.texture_mode);
+      const Common::Rectangle<u32> texture_page_rect = Common::Rectangle<u32>::FromExtents(
+        cmd.texture_page_x, cmd.texture_page_y, texture_page_widths[mode], GPU::TEXTURE_PAGE_HEIGHT);
+      const Common::Rectangle<u32> palette_rect =
+        Common::Rectangle<u32>::FromExtents(cmd.texture_palette_x, cmd.texture_palette_y, palette_widths[mode], 1);
+
+      u32 x, y;
+      Common::Rectangle<u32> span_rect;
+      do
+      {
+        x = RandomRange(0u, VRAM_WIDTH - SPAN_WIDTH);
+        y = RandomRange(0u, VRAM_HEIGHT - 1);
+        span_rect = Common::Rectangle<u32>::FromExtents(x, y, SPAN_WIDTH, 1);
+      } while (texture_enable && (span_rect.Intersects(texture_page_rect) ||
+                                  (palette_widths[mode] > 0 && span_rect.Intersects(palette_rect))));
+
+      const u32 pixel_mask = RandomBool() ? 0xFFu : (static_cast<u32>(m_rng()) & 0xFFu);
+      GPU_SW::SWSpan span;
+      for (u32 j = 0; j < SPAN_WIDTH; j++)
+      {
+        span.r[j] = static_cast<u8>(m_rng());
+        span.g[j] = static_cast<u8>(m_rng());
+        span.b[j] = static_cast<u8>(m_rng());
+        span.texcoord_x[j] = static_cast<u8>(m_rng());
+        span.texcoord_y[j] = static_cast<u8>(m_rng());
+      }
+
+      cmd.samples_own_output = false;
+      (simd.get()->*ShadeSpan)(&cmd, nullptr, x, y, SPAN_WIDTH, pixel_mask, span);
+
+      // Spans of primitives which sample their own output are always shaded one pixel at a time.
+      cmd.samples_own_output = true;
+      (scalar.get()->*ShadeSpan)(&cmd, nullptr, x, y, SPAN_WIDTH, pixel_mask, span);
+
+      for (u32 j = 0; j < SPAN_WIDTH; j++)
+      {
+        ASSERT_EQ(scalar->GetPixel(x + j, y), simd->GetPixel(x + j, y))
+          << "pixel (" << (x + j) << ", " << y << ") differs, texture mode " << mode << ", transparency mode "
+          << static_cast<u32>(cmd.transparency_mode) << ", mask and " << cmd.params.mask_and << ", mask or "
+          << cmd.params.mask_or;
+      }
+    }
+  }
+
+  std::mt19937 m_rng;
+};
+
+TEST_F(GPU_SWTest, MultiThreadedRenderingMatchesSingleThread)
+{
+  for (const u32 seed : {1u, 2u, 3u})
+  {
+    std::unique_ptr<GPU_SW> reference = CreateGPU(1);
+    RenderRandomStream(reference.get(), seed);
+
+    for (const u32 thread_count : {2u, 3u, static_cast<u32>(MAX_THREADS)})
+    {
+      std::unique_ptr<GPU_SW> gpu = CreateGPU(thread_count);
+      RenderRandomStream(gpu.get(), seed);
+
+      const std::string description = std::to_string(thread_count) + " threads, seed " + std::to_string(seed);
+      CompareVRAM(*reference, *gpu, description.c_str());
+      if (HasFatalFailure())
+        return;
+    }
+  }
+}
+
+TEST_F(GPU_SWTest, SIMDSpansMatchScalarPixels)
+{
+  m_rng.seed(1);
+  for (u32 combo = 0; combo < (1u << 4); combo++)
+  {
+    const bool texture_enable = (combo & 1) != 0;
+    const bool raw_texture_enable = (combo & 2) != 0;
+    const bool transparency_enable = (combo & 4) != 0;
+    const bool dithering_enable = (combo & 8) != 0;
+    SCOPED_TRACE(testing::Message() << "texture " << texture_enable << ", raw texture " << raw_texture_enable
+                                    << ", transparency " << transparency_enable << ", dithering " << dithering_enable);
+
+    CompareRandomSpans(texture_enable, raw_texture_enable, transparency_enable, dithering_enable);
+    if (HasFatalFailure())
+      return;
+  }
+}
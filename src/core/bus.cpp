@@ -15,7 +15,9 @@
 #include "sio.h"
 #include "spu.h"
 #include "timers.h"
+#include <algorithm>
 #include <cstdio>
+#include <cstring>
 Log_SetChannel(Bus);
 
 #define FIXUP_WORD_READ_OFFSET(offset) ((offset) & ~u32(3))
@@ -32,9 +34,29 @@ ALWAYS_INLINE static void FixupUnalignedWordAccessW32(u32& offset, u32& value)
   value <<= byte_offset * 8;
 }
 
-Bus::Bus() = default;
+Bus::Bus()
+{
+  if (m_memory_arena.Create(RAM_SIZE, true, false))
+    m_ram = static_cast<u8*>(m_memory_arena.CreateViewPtr(0, RAM_SIZE, true, false));
+
+  if (!m_ram)
+  {
+    Log_WarningPrint("Failed to allocate RAM from shared memory, fastmem will not be available");
+    m_ram_heap = std::make_unique<u8[]>(RAM_SIZE);
+    m_ram = m_ram_heap.get();
+  }
+
+  m_code_protection_page_size = std::max<u32>(Common::MemoryArena::GetPageSize(), CPU_CODE_CACHE_PAGE_SIZE);
+}
+
+Bus::~Bus()
+{
+  UpdateFastmemViews(false, false);
+  SetRAMWriteProtection(false);
 
-Bus::~Bus() = default;
+  if (!m_ram_heap)
+    m_memory_arena.ReleaseViewPtr(m_ram, RAM_SIZE);
+}
 
 void Bus::Initialize(CPU::Core* cpu, CPU::CodeCache* cpu_code_cache, DMA* dma,
                      InterruptController* interrupt_controller, GPU* gpu, CDROM* cdrom, Pad* pad, Timers* timers,
@@ -55,7 +77,7 @@ void Bus::Initialize(CPU::Core* cpu, CPU::CodeCache* cpu_code_cache, DMA* dma,
 
 void Bus::Reset()
 {
-  m_ram.fill(static_cast<u8>(0));
+  std::memset(m_ram, 0, RAM_SIZE);
   m_MEMCTRL.exp1_base = 0x1F000000;
   m_MEMCTRL.exp2_base = 0x1F802000;
   m_MEMCTRL.exp1_delay_size.bits = 0x0013243F;
@@ -76,7 +98,7 @@ bool Bus::DoState(StateWrapper& sw)
   sw.Do(&m_bios_access_time);
   sw.Do(&m_cdrom_access_time);
   sw.Do(&m_spu_access_time);
-  sw.DoBytes(m_ram.data(), m_ram.size());
+  sw.DoBytes(m_ram, RAM_SIZE);
   sw.DoBytes(m_bios.data(), m_bios.size());
   sw.DoArray(m_MEMCTRL.regs, countof(m_MEMCTRL.regs));
   sw.Do(&m_ram_size_reg);
@@ -186,6 +208,27 @@ void Bus::SetBIOS(const std::vector<u8>& image)
   std::copy(image.cbegin(), image.cend(), m_bios.begin());
 }
 
+bool Bus::IsIdlePollableAddress(PhysicalMemoryAddress address, u32 size)
+{
+  // Timers count by themselves, GPUSTAT follows the raster, and most other registers pop from a FIFO when they're read.
+  // The CD-ROM status register is fine on its own, but wider reads include the response and data FIFOs.
+  const auto InRange = [address, size](u32 base, u32 range_size) {
+    return (address >= base && (address + size) <= (base + range_size));
+  };
+  return (address + size) <= RAM_MIRROR_END || InRange(BIOS_BASE, BIOS_SIZE) ||
+         InRange(INTERRUPT_CONTROLLER_BASE, INTERRUPT_CONTROLLER_SIZE) || InRange(DMA_BASE, DMA_SIZE) ||
+         InRange(CDROM_BASE, 1);
+}
+
+TickCount Bus::GetICacheFillTicks(PhysicalMemoryAddress address) const
+{
+  const u32 word_count = (CPU::ICACHE_LINE_SIZE - (address & (CPU::ICACHE_LINE_SIZE - 1))) / sizeof(u32);
+  if (address < RAM_MIRROR_END)
+    return RAM_READ_TICKS + static_cast<TickCount>(word_count - 1);
+  else
+    return GetInstructionReadTicks(address) * static_cast<TickCount>(word_count);
+}
+
 std::tuple<TickCount, TickCount, TickCount> Bus::CalculateMemoryTiming(MEMDELAY mem_delay, COMDELAY common_delay)
 {
   // from nocash spec
@@ -224,6 +267,7 @@ std::tuple<TickCount, TickCount, TickCount> Bus::CalculateMemoryTiming(MEMDELAY
 
 void Bus::RecalculateMemoryTimings()
 {
+  const TickCount old_bios_word_time = m_bios_access_time[static_cast<u32>(MemoryAccessSize::Word)];
   std::tie(m_bios_access_time[0], m_bios_access_time[1], m_bios_access_time[2]) =
     CalculateMemoryTiming(m_MEMCTRL.bios_delay_size, m_MEMCTRL.common_delay);
   std::tie(m_cdrom_access_time[0], m_cdrom_access_time[1], m_cdrom_access_time[2]) =
@@ -240,6 +284,10 @@ void Bus::RecalculateMemoryTimings()
   Log_TracePrintf("SPU Memory Timing: %u bit bus, byte=%d, halfword=%d, word=%d",
                   m_MEMCTRL.spu_delay_size.data_bus_16bit ? 16 : 8, m_spu_access_time[0] + 1, m_spu_access_time[1] + 1,
                   m_spu_access_time[2] + 1);
+
+  // Blocks include the BIOS wait states in their fetch timing when they're compiled.
+  if (m_cpu_code_cache && m_bios_access_time[static_cast<u32>(MemoryAccessSize::Word)] != old_bios_word_time)
+    m_cpu_code_cache->InvalidateFetchTimings();
 }
 
 TickCount Bus::DoInvalidAccess(MemoryAccessType type, MemoryAccessSize size, PhysicalMemoryAddress address, u32& value)
@@ -588,6 +636,213 @@ void Bus::DoInvalidateCodeCache(u32 page_index)
   m_cpu_code_cache->InvalidateBlocksWithPageIndex(page_index);
 }
 
+bool Bus::UpdateFastmemViews(bool enabled, bool isolate_cache)
+{
+  if (!enabled)
+  {
+    if (!m_fastmem_base)
+      return true;
+
+    for (FastmemView& view : m_fastmem_views)
+    {
+      if (view.pointer)
+      {
+        m_memory_arena.ReleaseViewPtr(view.pointer, RAM_SIZE, true);
+        view.pointer = nullptr;
+      }
+    }
+
+    Common::MemoryArena::ReleaseRegion(m_fastmem_base, FASTMEM_REGION_SIZE);
+    m_fastmem_base = nullptr;
+    return true;
+  }
+
+  if (m_fastmem_base)
+  {
+    SetFastmemCacheIsolated(isolate_cache);
+    return true;
+  }
+
+  if (m_ram_heap || !Common::MemoryArena::IsSupported())
+    return false;
+
+  m_fastmem_base = static_cast<u8*>(Common::MemoryArena::ReserveRegion(FASTMEM_REGION_SIZE));
+  if (!m_fastmem_base)
+  {
+    Log_ErrorPrint("Failed to reserve address space for fastmem region");
+    return false;
+  }
+
+  // RAM and its mirrors in KUSEG, KSEG0 and KSEG1. Everything else is left unmapped, so accesses fault.
+  static constexpr std::array<std::pair<u32, bool>, FASTMEM_SEGMENT_COUNT> segments = {
+    {{UINT32_C(0x00000000), true}, {UINT32_C(0x80000000), true}, {UINT32_C(0xA0000000), false}}};
+  u32 view_index = 0;
+  for (const auto& [segment_base, cached] : segments)
+  {
+    for (u32 mirror = 0; mirror < FASTMEM_MIRROR_COUNT; mirror++)
+    {
+      u8* map_address = m_fastmem_base + segment_base + (mirror * RAM_SIZE);
+      FastmemView& view = m_fastmem_views[view_index++];
+      view.pointer = static_cast<u8*>(m_memory_arena.CreateViewPtr(0, RAM_SIZE, true, false, map_address));
+      view.cached_segment = cached;
+      if (!view.pointer)
+      {
+        Log_ErrorPrintf("Failed to map RAM at fastmem address %p", map_address);
+        UpdateFastmemViews(false, false);
+        return false;
+      }
+    }
+  }
+
+  m_fastmem_cache_isolated = isolate_cache;
+  UpdateFastmemProtection();
+
+  Log_InfoPrintf("Fastmem base: %p", m_fastmem_base);
+  return true;
+}
+
+void Bus::SetRAMWriteProtection(bool enabled)
+{
+  // Stores to clean pages are free if code pages are protected instead, since the bitset doesn't need to be checked.
+  enabled &= (!m_ram_heap && m_code_protection_page_size <= RAM_SIZE);
+  if (m_ram_write_protection == enabled)
+    return;
+
+  if (!enabled)
+  {
+    // Pick up any stores which already faulted, the pages are checked on every store from now on.
+    Common::MemoryArena::SetPageProtection(m_ram, RAM_SIZE, true, true, false);
+    m_ram_write_protection = false;
+    InvalidatePendingCodePages();
+    Common::PageFaultHandler::RemoveHandler(this);
+    return;
+  }
+
+  if (!Common::PageFaultHandler::InstallHandler(this, std::bind(&Bus::RAMPageFaultHandler, this, std::placeholders::_1,
+                                                                std::placeholders::_2, std::placeholders::_3)))
+  {
+    Log_WarningPrint("Failed to install page fault handler, code pages will be checked on every store");
+    return;
+  }
+
+  m_ram_write_protection = true;
+  ProtectCodePages();
+}
+
+void Bus::SetFastmemCacheIsolated(bool isolated)
+{
+  if (!m_fastmem_base || m_fastmem_cache_isolated == isolated)
+    return;
+
+  m_fastmem_cache_isolated = isolated;
+  UpdateFastmemProtection();
+}
+
+void Bus::SetCodePageProtection(u32 page_index, bool writable)
+{
+  // Host pages can be larger than code pages, so only unprotect when none of the neighbours contain code.
+  const u32 code_pages_per_host_page = m_code_protection_page_size / CPU_CODE_CACHE_PAGE_SIZE;
+  const u32 first_code_page = page_index - (page_index % code_pages_per_host_page);
+  if (writable)
+  {
+    for (u32 i = 0; i < code_pages_per_host_page; i++)
+    {
+      if (m_ram_code_bits[first_code_page + i])
+        return;
+    }
+  }
+
+  const u32 offset = first_code_page * CPU_CODE_CACHE_PAGE_SIZE;
+  if (m_ram_write_protection)
+    Common::MemoryArena::SetPageProtection(m_ram + offset, m_code_protection_page_size, true, writable, false);
+
+  if (!m_fastmem_base)
+    return;
+
+  for (const FastmemView& view : m_fastmem_views)
+  {
+    // Stores to the cached segments are always dropped while the cache is isolated.
+    const bool view_writable = writable && !(view.cached_segment && m_fastmem_cache_isolated);
+    Common::MemoryArena::SetPageProtection(view.pointer + offset, m_code_protection_page_size, true, view_writable,
+                                           false);
+  }
+}
+
+void Bus::UpdateFastmemProtection()
+{
+  for (const FastmemView& view : m_fastmem_views)
+  {
+    const bool view_writable = !(view.cached_segment && m_fastmem_cache_isolated);
+    Common::MemoryArena::SetPageProtection(view.pointer, RAM_SIZE, true, view_writable, false);
+  }
+
+  ProtectCodePages();
+}
+
+void Bus::ProtectCodePages()
+{
+  const u32 code_pages_per_host_page = m_code_protection_page_size / CPU_CODE_CACHE_PAGE_SIZE;
+  for (u32 page = 0; page < CPU_CODE_CACHE_PAGE_COUNT; page += code_pages_per_host_page)
+  {
+    for (u32 i = 0; i < code_pages_per_host_page; i++)
+    {
+      if (m_ram_code_bits[page + i])
+      {
+        SetCodePageProtection(page, false);
+        break;
+      }
+    }
+  }
+}
+
+Common::PageFaultHandler::HandlerResult Bus::RAMPageFaultHandler(void* exception_pc, void* fault_address,
+                                                                 bool is_write)
+{
+  // RAM is always readable, so any fault inside it is a store to a code page.
+  u8* const address = static_cast<u8*>(fault_address);
+  if (!m_ram_write_protection || address < m_ram || address >= (m_ram + RAM_SIZE))
+    return Common::PageFaultHandler::HandlerResult::ExecuteNextHandler;
+
+  const u32 code_pages_per_host_page = m_code_protection_page_size / CPU_CODE_CACHE_PAGE_SIZE;
+  const u32 page_index = static_cast<u32>(address - m_ram) / CPU_CODE_CACHE_PAGE_SIZE;
+  const u32 first_code_page = page_index - (page_index % code_pages_per_host_page);
+
+  // The store could be to any of the code pages in the host page, so they all have to go. Freeing and unlinking blocks
+  // isn't safe in signal context, so that's left to the execution loop, see DoRAMAccess() and CodeCache::Execute().
+  for (u32 i = 0; i < code_pages_per_host_page; i++)
+  {
+    if (m_ram_code_bits[first_code_page + i])
+      m_pending_code_invalidation_bits[first_code_page + i] = true;
+  }
+  m_code_invalidation_pending.store(true, std::memory_order_release);
+
+  // The page stays writable until the invalidation clears the code bits, further stores don't need to fault.
+  Common::MemoryArena::SetPageProtection(m_ram + (first_code_page * CPU_CODE_CACHE_PAGE_SIZE),
+                                         m_code_protection_page_size, true, true, false);
+  return Common::PageFaultHandler::HandlerResult::ContinueExecution;
+}
+
+void Bus::StopBlockForCodeInvalidation()
+{
+  m_cpu->SetDowncount(0);
+}
+
+void Bus::InvalidatePendingCodePages()
+{
+  if (!m_code_invalidation_pending.exchange(false, std::memory_order_acquire))
+    return;
+
+  for (u32 page = 0; page < CPU_CODE_CACHE_PAGE_COUNT; page++)
+  {
+    if (!m_pending_code_invalidation_bits[page])
+      continue;
+
+    m_pending_code_invalidation_bits[page] = false;
+    if (m_ram_code_bits[page])
+      DoInvalidateCodeCache(page);
+  }
+}
+
 u32 Bus::DoReadDMA(MemoryAccessSize size, u32 offset)
 {
   return FIXUP_WORD_READ_VALUE(offset, m_dma->ReadRegister(FIXUP_WORD_READ_OFFSET(offset)));
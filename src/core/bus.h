@@ -1,8 +1,12 @@
 #pragma once
 #include "common/bitfield.h"
+#include "common/memory_arena.h"
+#include "common/page_fault_handler.h"
 #include "types.h"
 #include <array>
+#include <atomic>
 #include <bitset>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -29,6 +33,9 @@ class Bus
   friend DMA;
 
 public:
+  /// Number of cycles a CPU read from RAM takes.
+  static constexpr TickCount RAM_READ_TICKS = 4;
+
   Bus();
   ~Bus();
 
@@ -76,14 +83,87 @@ public:
   /// Returns true if the address specified is writable (RAM).
   ALWAYS_INLINE static bool IsRAMAddress(PhysicalMemoryAddress address) { return address < RAM_MIRROR_END; }
 
+  /// Returns true if reading the address has no side effects, and its value only changes when the CPU writes to it or
+  /// an event runs, e.g. RAM or the interrupt status. Loops reading only these addresses are waiting for an event.
+  static bool IsIdlePollableAddress(PhysicalMemoryAddress address, u32 size);
+
+  /// Returns the number of cycles an uncached instruction fetch from the address waits for, i.e. from RAM or BIOS.
+  ALWAYS_INLINE TickCount GetInstructionReadTicks(PhysicalMemoryAddress address) const
+  {
+    if (address < RAM_MIRROR_END)
+      return RAM_READ_TICKS;
+    else if (address >= BIOS_BASE && address < (BIOS_BASE + BIOS_SIZE))
+      return m_bios_access_time[static_cast<u32>(MemoryAccessSize::Word)];
+    else
+      return 0;
+  }
+
+  /// Returns the number of cycles an instruction cache miss at the address waits for. The line is filled from the
+  /// missed word to its end, which is a burst from RAM, but each word is a separate access for the BIOS.
+  TickCount GetICacheFillTicks(PhysicalMemoryAddress address) const;
+
+  /// Returns the host pointer backing a RAM address, for the recompiler to read from directly.
+  ALWAYS_INLINE u8* GetRAMPointer(PhysicalMemoryAddress address) const { return &m_ram[address & RAM_MASK]; }
+
   /// Flags a RAM region as code, so we know when to invalidate blocks.
-  ALWAYS_INLINE void SetRAMCodePage(u32 index) { m_ram_code_bits[index] = true; }
+  ALWAYS_INLINE void SetRAMCodePage(u32 index)
+  {
+    if (m_ram_code_bits[index])
+      return;
+
+    m_ram_code_bits[index] = true;
+    if (m_ram_write_protection || m_fastmem_base)
+      SetCodePageProtection(index, false);
+  }
 
   /// Unflags a RAM region as code, the code cache will no longer be notified when writes occur.
-  ALWAYS_INLINE void ClearRAMCodePage(u32 index) { m_ram_code_bits[index] = false; }
+  ALWAYS_INLINE void ClearRAMCodePage(u32 index)
+  {
+    if (!m_ram_code_bits[index])
+      return;
+
+    m_ram_code_bits[index] = false;
+    if (m_ram_write_protection || m_fastmem_base)
+      SetCodePageProtection(index, true);
+  }
 
   /// Clears all code bits for RAM regions.
-  ALWAYS_INLINE void ClearRAMCodePageFlags() { m_ram_code_bits.reset(); }
+  ALWAYS_INLINE void ClearRAMCodePageFlags()
+  {
+    m_ram_code_bits.reset();
+    m_pending_code_invalidation_bits.reset();
+    m_code_invalidation_pending.store(false, std::memory_order_relaxed);
+    if (m_ram_write_protection)
+      Common::MemoryArena::SetPageProtection(m_ram, RAM_SIZE, true, true, false);
+    if (m_fastmem_base)
+      UpdateFastmemProtection();
+  }
+
+  /// Returns true if code pages are write-protected in host memory, rather than checked on every store.
+  ALWAYS_INLINE bool IsRAMWriteProtectionEnabled() const { return m_ram_write_protection; }
+
+  /// Write-protects code pages in RAM, if the host supports it. Only worth it when the code cache is in use, otherwise
+  /// every host-side copy into a page with code faults.
+  void SetRAMWriteProtection(bool enabled);
+
+  /// Returns true if a store to a write-protected code page has happened since the last InvalidatePendingCodePages().
+  ALWAYS_INLINE bool HasPendingCodeInvalidation() const
+  {
+    return m_code_invalidation_pending.load(std::memory_order_relaxed);
+  }
+
+  /// Invalidates the code pages which were stored to while write-protected. Call from the execution loop.
+  void InvalidatePendingCodePages();
+
+  /// Returns the base of the 4GB fastmem region, or nullptr if it has not been created.
+  ALWAYS_INLINE u8* GetFastmemBase() const { return m_fastmem_base; }
+
+  /// Creates or destroys the fastmem region, where RAM is mapped at its virtual addresses in KUSEG/KSEG0/KSEG1.
+  /// Pages containing code are write-protected, so stores to them fault and can be redirected to the slow path.
+  bool UpdateFastmemViews(bool enabled, bool isolate_cache);
+
+  /// Write-protects the cached segments while the cache is isolated, so stores are dropped by the slow path.
+  void SetFastmemCacheIsolated(bool isolated);
 
 private:
   enum : u32
@@ -140,6 +220,21 @@ private:
     MEMCTRL_REG_COUNT = 9
   };
 
+  enum : u32
+  {
+    FASTMEM_SEGMENT_COUNT = 3,
+    FASTMEM_MIRROR_COUNT = RAM_MIRROR_END / RAM_SIZE,
+    FASTMEM_VIEW_COUNT = FASTMEM_SEGMENT_COUNT * FASTMEM_MIRROR_COUNT
+  };
+
+  static constexpr u64 FASTMEM_REGION_SIZE = UINT64_C(0x100000000);
+
+  struct FastmemView
+  {
+    u8* pointer;
+    bool cached_segment;
+  };
+
   union MEMDELAY
   {
     u32 bits;
@@ -238,8 +333,20 @@ private:
 
   void DoInvalidateCodeCache(u32 page_index);
 
+  /// Changes the protection of the host page containing a code page, in RAM and all fastmem views.
+  void SetCodePageProtection(u32 page_index, bool writable);
+  void UpdateFastmemProtection();
+  void ProtectCodePages();
+
+  /// Records the code pages a store to a write-protected page in RAM hit, so they can be invalidated outside of the
+  /// fault handler.
+  Common::PageFaultHandler::HandlerResult RAMPageFaultHandler(void* exception_pc, void* fault_address, bool is_write);
+
+  /// Ends the current block after a store which faulted, so the execution loop can invalidate the pages it hit.
+  void StopBlockForCodeInvalidation();
+
   /// Direct access to RAM - used by DMA.
-  ALWAYS_INLINE u8* GetRAM() { return m_ram.data(); }
+  ALWAYS_INLINE u8* GetRAM() { return m_ram; }
 
   /// Returns the number of cycles stolen by DMA RAM access.
   ALWAYS_INLINE static TickCount GetDMARAMTickCount(u32 word_count)
@@ -254,6 +361,10 @@ private:
   /// Invalidates any code pages which overlap the specified range.
   ALWAYS_INLINE void InvalidateCodePages(PhysicalMemoryAddress address, u32 word_count)
   {
+    // The copy has already faulted if it touched any code pages.
+    if (m_ram_write_protection)
+      return;
+
     const u32 start_page = address / CPU_CODE_CACHE_PAGE_SIZE;
     const u32 end_page = (address + word_count * sizeof(u32)) / CPU_CODE_CACHE_PAGE_SIZE;
     for (u32 page = start_page; page <= end_page; page++)
@@ -282,7 +393,9 @@ private:
   std::array<TickCount, 3> m_spu_access_time = {};
 
   std::bitset<CPU_CODE_CACHE_PAGE_COUNT> m_ram_code_bits{};
-  std::array<u8, RAM_SIZE> m_ram{};   // 2MB RAM
+  std::bitset<CPU_CODE_CACHE_PAGE_COUNT> m_pending_code_invalidation_bits{};
+  std::atomic_bool m_code_invalidation_pending{false};
+  u8* m_ram = nullptr;                // 2MB RAM
   std::array<u8, BIOS_SIZE> m_bios{}; // 512K BIOS ROM
   std::vector<u8> m_exp1_rom;
 
@@ -290,6 +403,17 @@ private:
   u32 m_ram_size_reg = 0;
 
   std::string m_tty_line_buffer;
+
+  // RAM is allocated from a shared memory object, so it can be mapped into the fastmem region multiple times.
+  Common::MemoryArena m_memory_arena;
+  std::unique_ptr<u8[]> m_ram_heap;
+  u8* m_fastmem_base = nullptr;
+  std::array<FastmemView, FASTMEM_VIEW_COUNT> m_fastmem_views = {};
+  bool m_fastmem_cache_isolated = false;
+
+  // Protection can only be changed for whole host pages, which may cover several code pages.
+  u32 m_code_protection_page_size = 0;
+  bool m_ram_write_protection = false;
 };
 
 #include "bus.inl"
@@ -25,8 +25,9 @@ TickCount Bus::DoRAMAccess(u32 offset, u32& value)
   }
   else
   {
+    // With write protection, stores to code pages fault and invalidate them instead.
     const u32 page_index = offset / CPU_CODE_CACHE_PAGE_SIZE;
-    if (m_ram_code_bits[page_index])
+    if (!m_ram_write_protection && m_ram_code_bits[page_index])
       DoInvalidateCodeCache(page_index);
 
     if constexpr (size == MemoryAccessSize::Byte)
@@ -42,9 +43,13 @@ TickCount Bus::DoRAMAccess(u32 offset, u32& value)
     {
       std::memcpy(&m_ram[offset], &value, sizeof(u32));
     }
+
+    // If that faulted, leave the current block at its end rather than following a link into the stored-to page.
+    if (m_code_invalidation_pending.load(std::memory_order_relaxed))
+      StopBlockForCodeInvalidation();
   }
 
-  return (type == MemoryAccessType::Read) ? 4 : 0;
+  return (type == MemoryAccessType::Read) ? RAM_READ_TICKS : 0;
 }
 
 template<MemoryAccessType type, MemoryAccessSize size>
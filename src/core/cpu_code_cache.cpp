@@ -1,5 +1,8 @@
 #include "cpu_code_cache.h"
+#include "common/byte_stream.h"
+#include "common/file_system.h"
 #include "common/log.h"
+#include "common/timer.h"
 #include "cpu_core.h"
 #include "cpu_disasm.h"
 #include "system.h"
@@ -17,32 +20,91 @@ constexpr bool USE_BLOCK_LINKING = true;
 static constexpr u32 RECOMPILER_CODE_CACHE_SIZE = 32 * 1024 * 1024;
 static constexpr u32 RECOMPILER_FAR_CODE_CACHE_SIZE = 32 * 1024 * 1024;
 
-CodeCache::CodeCache() = default;
+// When the code buffer is full, at least this much code is evicted at a time, so it doesn't fill again immediately.
+static constexpr u32 RECOMPILER_EVICTION_SIZE = RECOMPILER_CODE_CACHE_SIZE / 16;
+
+// Indirect exits which change target more often than this go to the dispatcher when the target doesn't match, instead
+// of being linked again every time.
+static constexpr u32 MAX_INDIRECT_EXIT_RELINKS = 8;
+
+CodeCache::CodeCache()
+{
+  ResetFastMap();
+}
 
 CodeCache::~CodeCache()
 {
   if (m_system)
+  {
+#ifdef WITH_RECOMPILER
+    StopCompileThread();
+    if (m_use_recompiler)
+      LogCodeBufferStats();
+#endif
     Flush();
+
+#ifdef WITH_RECOMPILER
+    m_bus->UpdateFastmemViews(false, false);
+    m_core->m_fastmem_base = nullptr;
+    Common::PageFaultHandler::RemoveHandler(this);
+#endif
+  }
 }
 
-void CodeCache::Initialize(System* system, Core* core, Bus* bus, bool use_recompiler)
+void CodeCache::Initialize(System* system, Core* core, Bus* bus, bool use_recompiler, bool use_threaded_interpreter,
+                           bool use_fastmem, bool use_threaded_compile, bool use_idle_loop_skipping,
+                           bool use_accurate_timing)
 {
   m_system = system;
   m_core = core;
   m_bus = bus;
+  m_use_threaded_interpreter = use_threaded_interpreter;
+  m_use_idle_loop_skipping = use_idle_loop_skipping;
+  m_use_accurate_timing = use_accurate_timing;
 
 #ifdef WITH_RECOMPILER
   m_use_recompiler = use_recompiler;
-  m_code_buffer = std::make_unique<JitCodeBuffer>(RECOMPILER_CODE_CACHE_SIZE, RECOMPILER_FAR_CODE_CACHE_SIZE);
-  m_asm_functions = std::make_unique<Recompiler::ASMFunctions>();
-  m_asm_functions->Generate(m_code_buffer.get());
+  m_use_fastmem = use_fastmem;
+  m_use_threaded_compile = use_threaded_compile;
+
+  // Executable memory isn't available on some hosts, so don't ask for it unless we need it.
+  if (m_use_recompiler)
+    CreateCodeBuffer();
+
+  if (!Common::PageFaultHandler::InstallHandler(this, std::bind(&CodeCache::PageFaultHandler, this,
+                                                                std::placeholders::_1, std::placeholders::_2,
+                                                                std::placeholders::_3)))
+  {
+    Log_ErrorPrint("Failed to install page fault handler, fastmem will not be available");
+    m_use_fastmem = false;
+  }
+
+  UpdateFastmemViews();
+
+  if (m_use_threaded_compile)
+    StartCompileThread();
 #else
   m_use_recompiler = false;
+  m_use_fastmem = false;
+  m_use_threaded_compile = false;
 #endif
 }
 
 void CodeCache::Execute()
 {
+  if (m_bus->HasPendingCodeInvalidation())
+    m_bus->InvalidatePendingCodePages();
+  if (m_flush_pending)
+    Flush();
+
+#ifdef WITH_RECOMPILER
+  if (m_use_recompiler)
+  {
+    ExecuteRecompiler();
+    return;
+  }
+#endif
+
   CodeBlockKey next_block_key = GetNextBlockKey();
 
   while (m_core->m_pending_ticks < m_core->m_downcount)
@@ -75,11 +137,15 @@ void CodeCache::Execute()
     LogCurrentState();
 #endif
 
-    if (m_use_recompiler)
-      block->host_code(m_core);
+    // The recompiler has its own loop, see ExecuteRecompiler().
+    if (m_use_threaded_interpreter)
+      InterpretThreadedBlock(*block);
     else
       InterpretCachedBlock(*block);
 
+    if (block->idle_loop && m_core->m_regs.pc == block->GetPC())
+      SkipIdleLoop(block);
+
     if (m_core->m_pending_ticks >= m_core->m_downcount)
       break;
     else if (m_core->HasPendingInterrupt() || !USE_BLOCK_LINKING)
@@ -90,7 +156,7 @@ void CodeCache::Execute()
     {
       // we can jump straight to it if there's no pending interrupts
       // ensure it's not a self-modifying block
-      if (!block->invalidated || RevalidateBlock(block))
+      if ((!block->invalidated && !block->manual_check) || RevalidateBlock(block))
         goto reexecute_block;
     }
     else if (!block->invalidated)
@@ -101,7 +167,7 @@ void CodeCache::Execute()
       {
         if (linked_block->key.bits == next_block_key.bits)
         {
-          if (linked_block->invalidated && !RevalidateBlock(linked_block))
+          if ((linked_block->invalidated || linked_block->manual_check) && !RevalidateBlock(linked_block))
           {
             // CanExecuteBlock can result in a block flush, so stop iterating here.
             break;
@@ -129,6 +195,124 @@ void CodeCache::Execute()
   m_core->m_regs.npc = m_core->m_regs.pc;
 }
 
+void CodeCache::ExecuteRecompiler()
+{
+#ifdef WITH_RECOMPILER
+  PublishCompileResults();
+
+  if (m_asm_functions->execute)
+  {
+    m_asm_functions->execute(m_core);
+  }
+  else
+  {
+    while (m_core->m_pending_ticks < m_core->m_downcount)
+    {
+      if (m_core->HasPendingInterrupt())
+      {
+        m_core->SafeReadMemoryWord(m_core->m_regs.pc, &m_core->m_next_instruction.bits);
+        m_core->DispatchInterrupt();
+      }
+
+      // The fast map only holds valid blocks, so we can skip the lookup and revalidation if it's there.
+      CodeBlock::HostCodePointer host_code = m_core->InUserMode() ? nullptr : FastMapLookup(m_core->m_regs.pc);
+      if (!host_code)
+      {
+        host_code = LookupNextHostCode();
+        if (!host_code)
+          continue;
+      }
+
+      host_code(m_core);
+    }
+  }
+#endif
+
+  // in case we switch to interpreter...
+  m_core->m_regs.npc = m_core->m_regs.pc;
+}
+
+CodeBlock::HostCodePointer CodeCache::LookupNextHostCode()
+{
+#ifdef WITH_RECOMPILER
+  PublishCompileResults();
+#endif
+
+  CodeBlock* block = LookupBlock(GetNextBlockKey());
+  if (!block)
+  {
+    Log_WarningPrintf("Falling back to uncached interpreter at 0x%08X", m_core->GetRegs().pc);
+    InterpretUncachedBlock();
+    return nullptr;
+  }
+
+  // Host code is still being compiled on the worker thread, or was evicted and needs to be compiled again.
+  if (!block->host_code)
+  {
+#ifdef WITH_RECOMPILER
+    if (block->pending_compile_id == 0 && CompileHostCode(block))
+      AddBlockToFastMap(block);
+#endif
+
+    if (!block->host_code)
+    {
+      InterpretCachedBlock(*block);
+      return nullptr;
+    }
+  }
+
+  return block->host_code;
+}
+
+CodeBlock::HostCodePointer CodeCache::LinkBlockExit(void* host_jump)
+{
+  const CodeBlock::HostCodePointer host_code = LookupNextHostCode();
+#ifdef RECOMPILER_BLOCK_LINKING
+  // Only blocks in the fast map can be jumped to directly, since they're removed from it when they're invalidated.
+  const u32 pc = m_core->m_regs.pc;
+  if (!host_code || m_core->InUserMode() || FastMapLookup(pc) != host_code)
+    return host_code;
+
+  // Compiling the next block could have evicted the one we came from, so look it up again.
+  auto iter = m_host_code_blocks.upper_bound(host_jump);
+  if (iter == m_host_code_blocks.begin())
+    return host_code;
+
+  CodeBlock* block = (--iter)->second;
+  auto exit = std::find_if(block->host_exits.begin(), block->host_exits.end(),
+                           [host_jump](const BlockExitInfo& bei) { return bei.host_jump == host_jump; });
+  if (exit == block->host_exits.end() || (!exit->host_target_pc && exit->target_pc != pc))
+    return host_code;
+
+  if (exit->target)
+  {
+    UnlinkBlockExit(block, *exit);
+    if (++exit->relink_count == MAX_INDIRECT_EXIT_RELINKS)
+    {
+      Log_DevPrintf("Indirect exit in block %08X changes target too often, using the dispatcher", block->GetPC());
+      Recompiler::CodeGenerator::BackpatchIndirectBlockExitMiss(*exit, m_asm_functions->dispatcher);
+    }
+  }
+
+  const auto next_iter = m_host_code_blocks.find(reinterpret_cast<void*>(host_code));
+  if (next_iter == m_host_code_blocks.end())
+    return host_code;
+
+  CodeBlock* next_block = next_iter->second;
+  if (exit->host_target_pc)
+  {
+    exit->target_pc = pc;
+    Recompiler::CodeGenerator::BackpatchIndirectBlockExitTarget(*exit, pc);
+  }
+
+  Recompiler::CodeGenerator::BackpatchBlockExit(*exit, reinterpret_cast<const void*>(host_code));
+  exit->target = next_block;
+  LinkBlock(block, next_block);
+#endif
+
+  return host_code;
+}
+
 void CodeCache::SetUseRecompiler(bool enable)
 {
 #ifdef WITH_RECOMPILER
@@ -137,21 +321,303 @@ void CodeCache::SetUseRecompiler(bool enable)
 
   m_use_recompiler = enable;
   Flush();
+  if (enable)
+    CreateCodeBuffer();
+
+  UpdateFastmemViews();
+#endif
+}
+
+void CodeCache::SetUseThreadedInterpreter(bool enable)
+{
+  if (m_use_threaded_interpreter == enable)
+    return;
+
+  // Blocks need to be decoded again.
+  m_use_threaded_interpreter = enable;
+  Flush();
+}
+
+void CodeCache::SetUseFastmem(bool enable)
+{
+#ifdef WITH_RECOMPILER
+  if (m_use_fastmem == enable)
+    return;
+
+  m_use_fastmem = enable;
+  Flush();
+  UpdateFastmemViews();
+#endif
+}
+
+void CodeCache::SetUseThreadedCompile(bool enable)
+{
+#ifdef WITH_RECOMPILER
+  if (m_use_threaded_compile == enable)
+    return;
+
+  // Blocks which are still waiting for the worker wouldn't get any code otherwise.
+  Flush();
+  m_use_threaded_compile = enable;
+  if (enable)
+    StartCompileThread();
+  else
+    StopCompileThread();
+#endif
+}
+
+void CodeCache::SetUseIdleLoopSkipping(bool enable)
+{
+  if (m_use_idle_loop_skipping == enable)
+    return;
+
+  // Blocks are only checked for idle loops when they're compiled.
+  m_use_idle_loop_skipping = enable;
+  Flush();
+}
+
+void CodeCache::SetUseAccurateTiming(bool enable)
+{
+  if (m_use_accurate_timing == enable)
+    return;
+
+  // Fetch timing is worked out when blocks are compiled.
+  m_use_accurate_timing = enable;
+  Flush();
+}
+
+void CodeCache::InvalidateFetchTimings()
+{
+  // The timings are changed by a store, so the block doing it could still be running.
+  if (m_use_accurate_timing)
+    m_flush_pending = true;
+}
+
+void CodeCache::UpdateFastmemViews()
+{
+#ifdef WITH_RECOMPILER
+  const bool enable = m_use_recompiler && m_use_fastmem;
+  if (!m_bus->UpdateFastmemViews(enable, m_core->m_cop0_regs.sr.Isc) && enable)
+    Log_WarningPrint("Failed to create fastmem region, memory accesses will use the slow path");
+
+  m_core->m_fastmem_base = m_bus->GetFastmemBase();
 #endif
 }
 
 void CodeCache::Flush()
 {
+#ifdef WITH_RECOMPILER
+  CancelCompileJobs();
+#endif
+
+  m_flush_pending = false;
   m_bus->ClearRAMCodePageFlags();
   for (auto& it : m_ram_block_map)
     it.clear();
+  m_ram_page_invalidate_info = {};
+  m_ram_manual_check_pages.reset();
+
+  // Remember what was compiled, so it can be compiled again ahead of time.
+  const std::unordered_map<u32, BlockMetadata> pending_blocks = GetAllBlockMetadata();
+  m_pending_block_metadata.clear();
+  m_pending_block_metadata.reserve(pending_blocks.size());
+  for (const auto& it : pending_blocks)
+    m_pending_block_metadata.push_back(it.second);
+  m_next_pending_block = 0;
 
   for (const auto& it : m_blocks)
     delete it.second;
   m_blocks.clear();
+  ResetFastMap();
+#ifdef WITH_RECOMPILER
+  m_loadstore_backpatch_info.clear();
+  m_host_code_blocks.clear();
+  m_eviction_cursor = nullptr;
+
+  std::lock_guard<std::mutex> guard(m_code_buffer_mutex);
+  if (m_code_buffer)
+    m_code_buffer->Reset();
+#endif
+}
+
+static u64 HashInstructionWord(u64 hash, u32 word)
+{
+  // FNV-1a, we only need to tell whether the code has been loaded yet.
+  for (u32 i = 0; i < sizeof(word); i++)
+    hash = (hash ^ ((word >> (i * 8)) & 0xFFu)) * UINT64_C(0x100000001B3);
+
+  return hash;
+}
+
+static constexpr u64 INITIAL_CODE_HASH = UINT64_C(0xCBF29CE484222325);
+
+u64 CodeCache::HashBlockInstructions(const CodeBlock& block)
+{
+  u64 hash = INITIAL_CODE_HASH;
+  for (const CodeBlockInstruction& cbi : block.instructions)
+    hash = HashInstructionWord(hash, cbi.instruction.bits);
+
+  return hash;
+}
+
+bool CodeCache::HashGuestCode(CodeBlockKey key, u32 instruction_count, u64* hash) const
+{
+  u64 current_hash = INITIAL_CODE_HASH;
+  u32 pc = key.GetPC();
+  for (u32 i = 0; i < instruction_count; i++, pc += sizeof(Instruction))
+  {
+    // Reading from non-memory regions could have side effects.
+    const PhysicalMemoryAddress phys_addr = pc & PHYSICAL_MEMORY_ADDRESS_MASK;
+    u32 word;
+    if (!m_bus->IsCacheableAddress(phys_addr) ||
+        m_bus->DispatchAccess<MemoryAccessType::Read, MemoryAccessSize::Word>(phys_addr, word) < 0)
+    {
+      return false;
+    }
+
+    current_hash = HashInstructionWord(current_hash, word);
+  }
+
+  *hash = current_hash;
+  return true;
+}
+
+std::unordered_map<u32, CodeCache::BlockMetadata> CodeCache::GetAllBlockMetadata() const
+{
+  // Blocks which are pending could also have been compiled since, so remove duplicates.
+  std::unordered_map<u32, BlockMetadata> blocks;
+  for (const BlockMetadata& md : m_pending_block_metadata)
+    blocks[md.key] = md;
+  for (const auto& it : m_blocks)
+  {
+    const CodeBlock* block = it.second;
+    if (block && !block->invalidated)
+    {
+      blocks[block->key.bits] = BlockMetadata{block->key.bits, static_cast<u32>(block->instructions.size()),
+                                              HashBlockInstructions(*block)};
+    }
+  }
+
+  return blocks;
+}
+
+bool CodeCache::LoadBlockMetadata(const char* filename)
+{
+  ClearBlockMetadata();
+
+  std::unique_ptr<ByteStream> stream = FileSystem::OpenFile(filename, BYTESTREAM_OPEN_READ | BYTESTREAM_OPEN_STREAMED);
+  if (!stream)
+    return false;
+
+  u32 signature, version, count;
+  if (!stream->Read2(&signature, sizeof(signature)) || !stream->Read2(&version, sizeof(version)) ||
+      !stream->Read2(&count, sizeof(count)) || signature != BLOCK_METADATA_SIGNATURE ||
+      version != BLOCK_METADATA_VERSION)
+  {
+    Log_WarningPrintf("Block metadata file '%s' is corrupted or from an older version", filename);
+    return false;
+  }
+
+  m_pending_block_metadata.resize(count);
+  if (count > 0 && !stream->Read2(m_pending_block_metadata.data(), sizeof(BlockMetadata) * count))
+  {
+    Log_WarningPrintf("Block metadata file '%s' is truncated", filename);
+    ClearBlockMetadata();
+    return false;
+  }
+
+  Log_InfoPrintf("Loaded %u blocks from '%s'", count, filename);
+  return true;
+}
+
+bool CodeCache::SaveBlockMetadata(const char* filename)
+{
+  const std::unordered_map<u32, BlockMetadata> blocks = GetAllBlockMetadata();
+  if (blocks.empty())
+    return true;
+
+  std::unique_ptr<ByteStream> stream =
+    FileSystem::OpenFile(filename, BYTESTREAM_OPEN_CREATE | BYTESTREAM_OPEN_WRITE | BYTESTREAM_OPEN_TRUNCATE |
+                                     BYTESTREAM_OPEN_ATOMIC_UPDATE | BYTESTREAM_OPEN_STREAMED);
+  if (!stream)
+  {
+    Log_ErrorPrintf("Failed to open '%s' for writing", filename);
+    return false;
+  }
+
+  const u32 signature = BLOCK_METADATA_SIGNATURE;
+  const u32 version = BLOCK_METADATA_VERSION;
+  const u32 count = static_cast<u32>(blocks.size());
+  bool result = stream->Write2(&signature, sizeof(signature));
+  result &= stream->Write2(&version, sizeof(version));
+  result &= stream->Write2(&count, sizeof(count));
+  for (const auto& it : blocks)
+    result &= stream->Write2(&it.second, sizeof(it.second));
+
+  if (!result || !stream->Commit())
+  {
+    Log_ErrorPrintf("Failed to write block metadata to '%s'", filename);
+    stream->Discard();
+    return false;
+  }
+
+  Log_InfoPrintf("Saved %u blocks to '%s'", count, filename);
+  return true;
+}
+
+void CodeCache::ClearBlockMetadata()
+{
+  m_pending_block_metadata.clear();
+  m_next_pending_block = 0;
+}
+
+void CodeCache::PrecompileBlocksFromMetadata(double time_limit_ms)
+{
+  Common::Timer timer;
+  u32 compiled_count = 0;
+
+  // Each pending block is checked at most once per call, since most won't be in memory yet.
+  const size_t check_count = m_pending_block_metadata.size();
+  for (size_t i = 0; i < check_count && !m_pending_block_metadata.empty(); i++)
+  {
+    if (timer.GetTimeMilliseconds() >= time_limit_ms)
+      break;
+
 #ifdef WITH_RECOMPILER
-  m_code_buffer->Reset();
+    // Don't precompile our way into a flush, blocks which are actually executed are more important.
+    if (m_use_recompiler && GetFreeCodeSpace() < (RECOMPILER_CODE_CACHE_SIZE / 2))
+      break;
 #endif
+
+    if (m_next_pending_block >= m_pending_block_metadata.size())
+      m_next_pending_block = 0;
+
+    const BlockMetadata md = m_pending_block_metadata[m_next_pending_block];
+    CodeBlockKey key;
+    key.bits = md.key;
+
+    u64 hash;
+    if (m_blocks.find(key.bits) == m_blocks.end())
+    {
+      if (!HashGuestCode(key, md.instruction_count, &hash) || hash != md.code_hash)
+      {
+        m_next_pending_block++;
+        continue;
+      }
+
+      if (LookupBlock(key))
+        compiled_count++;
+    }
+
+    m_pending_block_metadata[m_next_pending_block] = m_pending_block_metadata.back();
+    m_pending_block_metadata.pop_back();
+  }
+
+  if (compiled_count > 0)
+  {
+    Log_DevPrintf("Precompiled %u blocks in %.2f ms, %zu remaining", compiled_count, timer.GetTimeMilliseconds(),
+                  m_pending_block_metadata.size());
+  }
 }
 
 void CodeCache::LogCurrentState()
@@ -185,8 +651,11 @@ CodeBlock* CodeCache::LookupBlock(CodeBlockKey key)
   {
     // ensure it hasn't been invalidated
     CodeBlock* existing_block = iter->second;
-    if (!existing_block || !existing_block->invalidated || RevalidateBlock(existing_block))
+    if (!existing_block || (!existing_block->invalidated && !existing_block->manual_check) ||
+        RevalidateBlock(existing_block))
+    {
       return existing_block;
+    }
   }
 
   CodeBlock* block = new CodeBlock(key);
@@ -194,6 +663,7 @@ CodeBlock* CodeCache::LookupBlock(CodeBlockKey key)
   {
     // add it to the page map if it's in ram
     AddBlockToPageMap(block);
+    AddBlockToFastMap(block);
   }
   else
   {
@@ -224,9 +694,17 @@ bool CodeCache::RevalidateBlock(CodeBlock* block)
   // re-add it to the page map since it's still up-to-date
   block->invalidated = false;
   AddBlockToPageMap(block);
+  AddBlockToFastMap(block);
   return true;
 
 recompile:
+#ifdef WITH_RECOMPILER
+  {
+    std::lock_guard<std::mutex> guard(m_code_buffer_mutex);
+    FreeHostCode(block);
+  }
+#endif
+
   block->instructions.clear();
   if (!CompileBlock(block))
   {
@@ -236,43 +714,202 @@ recompile:
   }
 
   // re-add to page map again
+  block->invalidated = false;
   if (block->IsInRAM())
     AddBlockToPageMap(block);
 
+  AddBlockToFastMap(block);
   return true;
 }
 
-bool CodeCache::CompileBlock(CodeBlock* block)
+static void MarkDeadInstructions(CodeBlock* block)
 {
-  u32 pc = block->GetPC();
-  bool is_branch_delay_slot = false;
-  bool is_load_delay_slot = false;
-
-#if 0
-  if (pc == 0x0005aa90)
-    __debugbreak();
-#endif
-
-  for (;;)
+  // Walk backwards, tracking which registers are read before they're next written. Anything which could trap or
+  // leave the block needs all registers to be correct, so everything is live before it.
+  constexpr u32 ALL_REGISTERS = UINT32_C(0xFFFFFFFF);
+  u32 live_regs = ALL_REGISTERS;
+  for (auto it = block->instructions.rbegin(); it != block->instructions.rend(); ++it)
   {
-    CodeBlockInstruction cbi = {};
+    CodeBlockInstruction& cbi = *it;
+    u32 read_mask;
+    Reg write_reg;
+    if (!GetALUInstructionRegisterUsage(cbi.instruction, &read_mask, &write_reg))
+    {
+      live_regs = ALL_REGISTERS;
+      continue;
+    }
 
-    const PhysicalMemoryAddress phys_addr = pc & PHYSICAL_MEMORY_ADDRESS_MASK;
-    if (!m_bus->IsCacheableAddress(phys_addr) ||
-        m_bus->DispatchAccess<MemoryAccessType::Read, MemoryAccessSize::Word>(phys_addr, cbi.instruction.bits) < 0 ||
-        !IsInvalidInstruction(cbi.instruction))
+    if (write_reg == Reg::zero)
+      continue;
+
+    // Writes in a load delay slot cancel the pending load, so they have to be kept.
+    const u32 write_mask = UINT32_C(1) << static_cast<u8>(write_reg);
+    if (!(live_regs & write_mask) && !cbi.is_load_delay_slot)
     {
-      break;
+      cbi.is_dead = true;
+      continue;
     }
 
-    cbi.pc = pc;
-    cbi.is_branch_delay_slot = is_branch_delay_slot;
-    cbi.is_load_delay_slot = is_load_delay_slot;
+    live_regs = (live_regs & ~write_mask) | read_mask;
+  }
+}
+
+static void MarkSkippableLoadDelays(CodeBlock* block)
+{
+  // If the instruction in the delay slot doesn't read the loaded register, nothing can observe the old value, and the
+  // load can behave as a normal register write. Exceptions in the delay slot complete the load anyway. The slot has to
+  // be in the same block, since a load in a branch delay slot is followed by the branch target.
+  for (size_t i = 0; (i + 1) < block->instructions.size(); i++)
+  {
+    CodeBlockInstruction& cbi = block->instructions[i];
+    if (!cbi.has_load_delay)
+      continue;
+
+    const Reg load_reg = cbi.instruction.i.rt;
+    const CodeBlockInstruction& delay_slot = block->instructions[i + 1];
+    if (GetInstructionReadRegisterMask(delay_slot.instruction) & (UINT32_C(1) << static_cast<u8>(load_reg)))
+      continue;
+
+    // A second load to the same register discards the first, so the old value is still visible after the slot.
+    if (delay_slot.has_load_delay && delay_slot.instruction.i.rt == load_reg)
+      continue;
+
+    cbi.skip_load_delay = true;
+  }
+}
+
+/// Returns the register written by an instruction which can be part of an idle loop, i.e. a load or an ALU instruction.
+static bool GetIdleLoopInstructionWriteReg(const Instruction& instruction, Reg* write_reg)
+{
+  u32 read_mask;
+  if (GetALUInstructionRegisterUsage(instruction, &read_mask, write_reg))
+    return true;
+
+  switch (instruction.op)
+  {
+    case InstructionOp::lb:
+    case InstructionOp::lbu:
+    case InstructionOp::lh:
+    case InstructionOp::lhu:
+    case InstructionOp::lw:
+      *write_reg = instruction.i.rt;
+      return true;
+
+    default:
+      return false;
+  }
+}
+
+static bool IsIdleLoop(const CodeBlock& block)
+{
+  // An idle loop branches back to the start of the block, and only loads from memory and computes with the results in
+  // between. If every register it writes is written before it's read, each iteration only depends on memory and the
+  // registers the loop doesn't touch. So once it goes around, it keeps going around until memory changes, which needs
+  // an event to run. Which memory is read is checked when the loop runs, since the addresses aren't known here.
+  const size_t count = block.instructions.size();
+  if (count < 2)
+    return false;
+
+  const CodeBlockInstruction& branch = block.instructions[count - 2];
+  const Instruction bi = branch.instruction;
+  u32 target;
+  switch (bi.op)
+  {
+    case InstructionOp::j:
+      target = ((branch.pc + 4) & UINT32_C(0xF0000000)) | (bi.j.target << 2);
+      break;
+
+    case InstructionOp::b:
+      // bltzal/bgezal write $ra even when they're not taken.
+      if ((static_cast<u8>(bi.i.rt.GetValue()) & u8(0x1E)) == u8(0x10))
+        return false;
+
+      target = branch.pc + 4 + (bi.i.imm_sext32() << 2);
+      break;
+
+    case InstructionOp::beq:
+    case InstructionOp::bne:
+    case InstructionOp::blez:
+    case InstructionOp::bgtz:
+      target = branch.pc + 4 + (bi.i.imm_sext32() << 2);
+      break;
+
+    default:
+      return false;
+  }
+  if (target != block.GetPC())
+    return false;
+
+  u32 loop_written_regs = 0;
+  for (const CodeBlockInstruction& cbi : block.instructions)
+  {
+    Reg write_reg;
+    if (&cbi == &branch)
+      continue;
+    if (!GetIdleLoopInstructionWriteReg(cbi.instruction, &write_reg))
+      return false;
+
+    loop_written_regs |= (UINT32_C(1) << static_cast<u8>(write_reg));
+  }
+  loop_written_regs &= ~UINT32_C(1);
+
+  // Loaded values only become visible after the load delay slot, so reading them in the slot reads the previous
+  // iteration's.
+  u32 written_regs = 0;
+  u32 delayed_load_regs = 0;
+  for (const CodeBlockInstruction& cbi : block.instructions)
+  {
+    const u32 read_mask = GetInstructionReadRegisterMask(cbi.instruction);
+    if (read_mask & loop_written_regs & ~written_regs)
+      return false;
+
+    written_regs |= delayed_load_regs;
+    delayed_load_regs = 0;
+
+    Reg write_reg;
+    if (&cbi != &branch && GetIdleLoopInstructionWriteReg(cbi.instruction, &write_reg))
+    {
+      if (cbi.has_load_delay)
+        delayed_load_regs = (UINT32_C(1) << static_cast<u8>(write_reg));
+      else
+        written_regs |= (UINT32_C(1) << static_cast<u8>(write_reg));
+    }
+  }
+
+  return true;
+}
+
+bool CodeCache::CompileBlock(CodeBlock* block)
+{
+  u32 pc = block->GetPC();
+  bool is_branch_delay_slot = false;
+  bool is_load_delay_slot = false;
+
+#if 0
+  if (pc == 0x0005aa90)
+    __debugbreak();
+#endif
+
+  for (;;)
+  {
+    CodeBlockInstruction cbi = {};
+
+    const PhysicalMemoryAddress phys_addr = pc & PHYSICAL_MEMORY_ADDRESS_MASK;
+    if (!m_bus->IsCacheableAddress(phys_addr) ||
+        m_bus->DispatchAccess<MemoryAccessType::Read, MemoryAccessSize::Word>(phys_addr, cbi.instruction.bits) < 0 ||
+        !IsInvalidInstruction(cbi.instruction))
+    {
+      break;
+    }
+
+    cbi.pc = pc;
+    cbi.is_branch_delay_slot = is_branch_delay_slot;
+    cbi.is_load_delay_slot = is_load_delay_slot;
     cbi.is_branch_instruction = IsBranchInstruction(cbi.instruction);
     cbi.is_load_instruction = IsMemoryLoadInstruction(cbi.instruction);
     cbi.is_store_instruction = IsMemoryStoreInstruction(cbi.instruction);
     cbi.has_load_delay = InstructionHasLoadDelay(cbi.instruction);
-    cbi.can_trap = CanInstructionTrap(cbi.instruction, m_core->InUserMode());
+    cbi.can_trap = CanInstructionTrap(cbi.instruction, block->key.user_mode);
 
     // instruction is decoded now
     block->instructions.push_back(cbi);
@@ -297,6 +934,15 @@ bool CodeCache::CompileBlock(CodeBlock* block)
   if (!block->instructions.empty())
   {
     block->instructions.back().is_last_instruction = true;
+    MarkDeadInstructions(block);
+    MarkSkippableLoadDelays(block);
+    block->idle_loop = m_use_idle_loop_skipping && IsIdleLoop(*block);
+    if (block->idle_loop)
+      Log_DevPrintf("Block at 0x%08X is an idle loop", block->GetPC());
+    if (m_use_accurate_timing)
+      ComputeFetchTicks(block);
+    if (m_use_threaded_interpreter)
+      DecodeThreadedCode(block);
 
 #ifdef _DEBUG
     SmallString disasm;
@@ -317,38 +963,59 @@ bool CodeCache::CompileBlock(CodeBlock* block)
 
 #ifdef WITH_RECOMPILER
   if (m_use_recompiler)
-  {
-    // Ensure we're not going to run out of space while compiling this block.
-    if (m_code_buffer->GetFreeCodeSpace() <
-          (block->instructions.size() * Recompiler::MAX_NEAR_HOST_BYTES_PER_INSTRUCTION) ||
-        m_code_buffer->GetFreeFarCodeSpace() <
-          (block->instructions.size() * Recompiler::MAX_FAR_HOST_BYTES_PER_INSTRUCTION))
-    {
-      Log_WarningPrintf("Out of code space, flushing all blocks.");
-      Flush();
-    }
-
-    Recompiler::CodeGenerator codegen(m_core, m_code_buffer.get(), *m_asm_functions.get());
-    if (!codegen.CompileBlock(block, &block->host_code, &block->host_code_size))
-    {
-      Log_ErrorPrintf("Failed to compile host code for block at 0x%08X", block->key.GetPC());
-      return false;
-    }
-  }
+    return CompileHostCode(block);
 #endif
 
   return true;
 }
 
+void CodeCache::DecodeThreadedCode(CodeBlock* block)
+{
+  // The interpreter state is only fully updated where it could be observed, i.e. exceptions and delay slots. It's also
+  // brought up to date at the start of the block, since the previous block could have ended with a branch.
+  block->threaded_code.clear();
+  block->threaded_code.reserve(block->instructions.size() + 1);
+  for (size_t i = 0; i < block->instructions.size(); i++)
+  {
+    const CodeBlockInstruction& cbi = block->instructions[i];
+    const bool needs_full_state =
+      (i == 0 || cbi.is_last_instruction || cbi.is_branch_delay_slot || cbi.is_load_delay_slot || cbi.has_load_delay);
+    ThreadedInstruction ti =
+      DecodeThreadedInstruction(cbi.instruction, cbi.pc, cbi.is_branch_delay_slot, needs_full_state);
+    if (cbi.is_dead)
+      ti.op = ti.NeedsFullState() ? ThreadedOp::nop_full : ThreadedOp::nop;
+
+    block->threaded_code.push_back(ti);
+  }
+
+  ThreadedInstruction end = {};
+  end.op = ThreadedOp::end;
+  block->threaded_code.push_back(end);
+}
+
 void CodeCache::InvalidateBlocksWithPageIndex(u32 page_index)
 {
   DebugAssert(page_index < CPU_CODE_CACHE_PAGE_COUNT);
+
+  // Pages mixing code and frequently-written data would otherwise be recompiled or revalidated constantly, paying for
+  // a fault each time when they're protected. Stop tracking them, and check each block's code when it's looked up.
+  PageInvalidateInfo& info = m_ram_page_invalidate_info[page_index];
+  const u32 frame_number = m_system->GetFrameNumber();
+  info.count = ((frame_number - info.last_frame) <= MANUAL_CHECK_WINDOW_FRAMES) ? (info.count + 1) : 1;
+  info.last_frame = frame_number;
+  if (info.count >= MANUAL_CHECK_INVALIDATE_COUNT && !m_ram_manual_check_pages[page_index])
+  {
+    Log_DevPrintf("Code page %u is written too often, switching to manual checks", page_index);
+    m_ram_manual_check_pages[page_index] = true;
+  }
+
   auto& blocks = m_ram_block_map[page_index];
   for (CodeBlock* block : blocks)
   {
     // Invalidate forces the block to be checked again.
     Log_DebugPrintf("Invalidating block at 0x%08X", block->GetPC());
     block->invalidated = true;
+    RemoveBlockFromFastMap(block);
   }
 
   // Block will be re-added next execution.
@@ -363,9 +1030,18 @@ void CodeCache::FlushBlock(CodeBlock* block)
   Log_DevPrintf("Flushing block at address 0x%08X", block->GetPC());
 
   // if it's been invalidated it won't be in the page map
-  if (block->invalidated)
+  if (!block->invalidated)
     RemoveBlockFromPageMap(block);
 
+  RemoveBlockFromFastMap(block);
+  UnlinkBlock(block);
+#ifdef WITH_RECOMPILER
+  {
+    std::lock_guard<std::mutex> guard(m_code_buffer_mutex);
+    FreeHostCode(block);
+  }
+#endif
+
   m_blocks.erase(iter);
   delete block;
 }
@@ -377,6 +1053,15 @@ void CodeCache::AddBlockToPageMap(CodeBlock* block)
 
   const u32 start_page = block->GetStartPageIndex();
   const u32 end_page = block->GetEndPageIndex();
+  for (u32 page = start_page; page <= end_page; page++)
+  {
+    if (m_ram_manual_check_pages[page])
+    {
+      block->manual_check = true;
+      return;
+    }
+  }
+
   for (u32 page = start_page; page <= end_page; page++)
   {
     m_ram_block_map[page].push_back(block);
@@ -386,7 +1071,7 @@ void CodeCache::AddBlockToPageMap(CodeBlock* block)
 
 void CodeCache::RemoveBlockFromPageMap(CodeBlock* block)
 {
-  if (!block->IsInRAM())
+  if (!block->IsInRAM() || block->manual_check)
     return;
 
   const u32 start_page = block->GetStartPageIndex();
@@ -400,6 +1085,45 @@ void CodeCache::RemoveBlockFromPageMap(CodeBlock* block)
   }
 }
 
+void CodeCache::ResetFastMap()
+{
+  // Page zero is the shared null page.
+  m_fast_map_pages.clear();
+  m_fast_map_pages.push_back(std::make_unique<CodeBlock::HostCodePointer[]>(FAST_MAP_PAGE_SIZE));
+  m_fast_map.fill(m_fast_map_pages.front().get());
+}
+
+void CodeCache::AddBlockToFastMap(CodeBlock* block)
+{
+  // Blocks which need their code checked have to go through the lookup.
+  if (block->key.user_mode || !block->host_code || block->manual_check)
+    return;
+
+  const u32 pc = block->GetPC();
+  FastMapPage& page = m_fast_map[pc >> FAST_MAP_PAGE_SHIFT];
+  if (page == m_fast_map_pages.front().get())
+  {
+    m_fast_map_pages.push_back(std::make_unique<CodeBlock::HostCodePointer[]>(FAST_MAP_PAGE_SIZE));
+    page = m_fast_map_pages.back().get();
+  }
+
+  page[(pc & ((1u << FAST_MAP_PAGE_SHIFT) - 1)) / sizeof(Instruction)] = block->host_code;
+}
+
+void CodeCache::RemoveBlockFromFastMap(CodeBlock* block)
+{
+  if (block->key.user_mode)
+    return;
+
+  const u32 pc = block->GetPC();
+  FastMapPage page = m_fast_map[pc >> FAST_MAP_PAGE_SHIFT];
+  if (page != m_fast_map_pages.front().get())
+    page[(pc & ((1u << FAST_MAP_PAGE_SHIFT) - 1)) / sizeof(Instruction)] = nullptr;
+
+  // Linked exits skip the fast map, so they have to go through the dispatcher again too.
+  UnlinkBlockExitsTo(block);
+}
+
 void CodeCache::LinkBlock(CodeBlock* from, CodeBlock* to)
 {
   Log_DebugPrintf("Linking block %p(%08x) to %p(%08x)", from, from->GetPC(), to, to->GetPC());
@@ -426,11 +1150,232 @@ void CodeCache::UnlinkBlock(CodeBlock* block)
   block->link_successors.clear();
 }
 
+void CodeCache::UnlinkBlockExit(CodeBlock* block, BlockExitInfo& exit)
+{
+#ifdef RECOMPILER_BLOCK_LINKING
+  Log_DebugPrintf("Unlinking exit of block %p(%08x) from %p(%08x)", block, block->GetPC(), exit.target,
+                  exit.target->GetPC());
+  Recompiler::CodeGenerator::BackpatchBlockExit(exit, exit.host_link_stub);
+
+  // The links are already gone if the block is being flushed.
+  auto successor_iter = std::find(block->link_successors.begin(), block->link_successors.end(), exit.target);
+  if (successor_iter != block->link_successors.end())
+    block->link_successors.erase(successor_iter);
+
+  auto predecessor_iter =
+    std::find(exit.target->link_predecessors.begin(), exit.target->link_predecessors.end(), block);
+  if (predecessor_iter != exit.target->link_predecessors.end())
+    exit.target->link_predecessors.erase(predecessor_iter);
+
+  exit.target = nullptr;
+#endif
+}
+
+void CodeCache::UnlinkBlockExitsTo(CodeBlock* block)
+{
+  // Links without host exits are only used by the cached interpreter.
+  if (!m_use_recompiler || block->link_predecessors.empty())
+    return;
+
+  // Unlinking modifies the predecessor list.
+  const std::vector<CodeBlock*> predecessors(block->link_predecessors);
+  for (CodeBlock* predecessor : predecessors)
+  {
+    for (BlockExitInfo& exit : predecessor->host_exits)
+    {
+      if (exit.target == block)
+        UnlinkBlockExit(predecessor, exit);
+    }
+  }
+}
+
+void CodeCache::UnlinkBlockExitsFrom(CodeBlock* block)
+{
+  for (BlockExitInfo& exit : block->host_exits)
+  {
+    if (!exit.target)
+      continue;
+
+    // The code is going away, so there's no need to patch it.
+    auto successor_iter = std::find(block->link_successors.begin(), block->link_successors.end(), exit.target);
+    if (successor_iter != block->link_successors.end())
+      block->link_successors.erase(successor_iter);
+
+    auto predecessor_iter =
+      std::find(exit.target->link_predecessors.begin(), exit.target->link_predecessors.end(), block);
+    if (predecessor_iter != exit.target->link_predecessors.end())
+      exit.target->link_predecessors.erase(predecessor_iter);
+  }
+
+  block->host_exits.clear();
+}
+
+void CodeCache::SkipIdleLoop()
+{
+  // We're returning to the block's code, so it mustn't be revalidated or recompiled here.
+  const BlockMap::iterator iter = m_blocks.find(GetNextBlockKey().bits);
+  if (iter != m_blocks.end() && iter->second && iter->second->idle_loop)
+    SkipIdleLoop(iter->second);
+}
+
+void CodeCache::SkipIdleLoop(CodeBlock* block)
+{
+  // A pending interrupt is dispatched before the next iteration, so it would be delayed. This is checked without
+  // clearing the interrupt delay, since it'll be checked again before the loop runs.
+  const u32 sr = m_core->m_cop0_regs.sr.bits;
+  if ((sr & UINT32_C(1)) && ((sr & m_core->m_cop0_regs.cause.bits) & (UINT32_C(0xFF) << 8)) != 0)
+    return;
+
+  if (!CanSkipIdleLoop(*block))
+  {
+    // The registers the addresses come from are rarely changed outside the loop, so don't keep checking.
+    Log_DevPrintf("Idle loop at 0x%08X reads from I/O, not skipping it", block->GetPC());
+    block->idle_loop = false;
+    return;
+  }
+
+  m_core->m_pending_ticks = std::max(m_core->m_pending_ticks, m_core->m_downcount);
+}
+
+bool CodeCache::CanSkipIdleLoop(const CodeBlock& block) const
+{
+  // Work out the addresses of the loads. Registers the loop doesn't write have their current values, and others are
+  // known when they're built from constants, e.g. lui+ori, which covers most polling of I/O registers.
+  std::array<u32, static_cast<u8>(Reg::count)> values;
+  std::copy(std::begin(m_core->m_regs.r), std::begin(m_core->m_regs.r) + values.size(), values.begin());
+  u32 known_regs = UINT32_C(0xFFFFFFFF);
+  for (const CodeBlockInstruction& cbi : block.instructions)
+  {
+    u32 read_mask;
+    Reg write_reg;
+    if (GetALUInstructionRegisterUsage(cbi.instruction, &read_mask, &write_reg))
+      known_regs &= ~(UINT32_C(1) << static_cast<u8>(write_reg));
+    else if (cbi.is_load_instruction)
+      known_regs &= ~(UINT32_C(1) << static_cast<u8>(cbi.instruction.i.rt.GetValue()));
+  }
+  known_regs |= UINT32_C(1);
+
+  const auto SetKnownValue = [&values, &known_regs](u8 reg, u32 value) {
+    values[reg] = (reg != 0) ? value : 0;
+    known_regs |= (UINT32_C(1) << reg);
+  };
+  const auto SetUnknownValue = [&known_regs](u8 reg) { known_regs &= ~(UINT32_C(1) << reg) | UINT32_C(1); };
+
+  for (const CodeBlockInstruction& cbi : block.instructions)
+  {
+    const Instruction inst = cbi.instruction;
+    const u8 rs = static_cast<u8>(inst.i.rs.GetValue());
+    const u8 rt = static_cast<u8>(inst.i.rt.GetValue());
+    const bool rs_known = (known_regs & (UINT32_C(1) << rs)) != 0;
+    u32 size;
+    switch (inst.op)
+    {
+      case InstructionOp::lb:
+      case InstructionOp::lbu:
+        size = sizeof(u8);
+        break;
+      case InstructionOp::lh:
+      case InstructionOp::lhu:
+        size = sizeof(u16);
+        break;
+      case InstructionOp::lw:
+        size = sizeof(u32);
+        break;
+
+      case InstructionOp::lui:
+        SetKnownValue(rt, inst.i.imm_zext32() << 16);
+        continue;
+      case InstructionOp::ori:
+        if (rs_known)
+          SetKnownValue(rt, values[rs] | inst.i.imm_zext32());
+        else
+          SetUnknownValue(rt);
+        continue;
+      case InstructionOp::addiu:
+        if (rs_known)
+          SetKnownValue(rt, values[rs] + inst.i.imm_sext32());
+        else
+          SetUnknownValue(rt);
+        continue;
+
+      default:
+      {
+        u32 read_mask;
+        Reg write_reg;
+        if (GetALUInstructionRegisterUsage(inst, &read_mask, &write_reg))
+          SetUnknownValue(static_cast<u8>(write_reg));
+        continue;
+      }
+    }
+
+    if (!rs_known)
+      return false;
+
+    // The scratchpad is only visible through KUSEG and KSEG0, and KSEG2 has the cache control register.
+    const VirtualMemoryAddress address = values[rs] + inst.i.imm_sext32();
+    const u32 segment = address >> 29;
+    const PhysicalMemoryAddress phys_addr = address & PHYSICAL_MEMORY_ADDRESS_MASK;
+    if (segment == 0x06 || segment == 0x07)
+      return false;
+    if ((phys_addr & Core::DCACHE_LOCATION_MASK) == Core::DCACHE_LOCATION)
+    {
+      if (segment != 0x00 && segment != 0x04)
+        return false;
+    }
+    else if (!Bus::IsIdlePollableAddress(phys_addr, size))
+    {
+      return false;
+    }
+
+    SetUnknownValue(rt);
+  }
+
+  return true;
+}
+
+void CodeCache::ComputeFetchTicks(CodeBlock* block)
+{
+  const PhysicalMemoryAddress phys_addr = block->key.GetPCPhysicalAddress();
+  const PhysicalMemoryAddress phys_line_addr = phys_addr & ~(ICACHE_LINE_SIZE - 1u);
+  const u32 last_line_pc = (block->GetPC() + block->GetSizeInBytes() - INSTRUCTION_SIZE) & ~(ICACHE_LINE_SIZE - 1u);
+
+  block->uncached_fetch_ticks =
+    m_bus->GetInstructionReadTicks(phys_addr) * static_cast<TickCount>(block->instructions.size());
+  block->icache_first_line_fill_ticks = m_bus->GetICacheFillTicks(phys_addr);
+  block->icache_line_fill_ticks = m_bus->GetICacheFillTicks(phys_line_addr);
+  block->icache_line_count = ((last_line_pc - (block->GetPC() & ~(ICACHE_LINE_SIZE - 1u))) / ICACHE_LINE_SIZE) + 1;
+}
+
+void CodeCache::AddBlockFetchTicks(const CodeBlock& block)
+{
+  if (!Core::IsCachedAddress(block.GetPC()) || !m_core->IsICacheEnabled())
+  {
+    m_core->m_pending_ticks += block.uncached_fetch_ticks;
+    return;
+  }
+
+  u32 line_pc = block.GetPC();
+  for (u32 i = 0; i < block.icache_line_count; i++)
+  {
+    u32& tag = m_core->m_icache_tags[Core::GetICacheLine(line_pc)];
+    if (tag != Core::GetICacheTag(line_pc))
+    {
+      tag = Core::GetICacheTag(line_pc);
+      m_core->m_pending_ticks += (i == 0) ? block.icache_first_line_fill_ticks : block.icache_line_fill_ticks;
+    }
+
+    line_pc = (line_pc & ~(ICACHE_LINE_SIZE - 1u)) + ICACHE_LINE_SIZE;
+  }
+}
+
 void CodeCache::InterpretCachedBlock(const CodeBlock& block)
 {
   // set up the state so we've already fetched the instruction
   DebugAssert(m_core->m_regs.pc == block.GetPC());
 
+  if (m_use_accurate_timing)
+    AddBlockFetchTicks(block);
+
   m_core->m_regs.npc = block.GetPC() + 4;
 
   for (const CodeBlockInstruction& cbi : block.instructions)
@@ -463,6 +1408,16 @@ void CodeCache::InterpretCachedBlock(const CodeBlock& block)
   m_core->m_next_instruction_is_branch_delay_slot = false;
 }
 
+void CodeCache::InterpretThreadedBlock(const CodeBlock& block)
+{
+  DebugAssert(m_core->m_regs.pc == block.GetPC());
+  if (m_use_accurate_timing)
+    AddBlockFetchTicks(block);
+
+  m_core->m_regs.npc = block.GetPC() + 4;
+  m_core->ExecuteThreadedCode(block.threaded_code.data());
+}
+
 void CodeCache::InterpretUncachedBlock()
 {
   Panic("Fixme with regards to re-fetching PC");
@@ -504,4 +1459,383 @@ void CodeCache::InterpretUncachedBlock()
   }
 }
 
+#ifdef WITH_RECOMPILER
+
+// Upper bounds for the host code of a block, which is reserved before compiling it.
+static u32 GetMaxNearHostCodeSize(const CodeBlock& block)
+{
+  u32 gte_instruction_count = 0;
+  for (const CodeBlockInstruction& cbi : block.instructions)
+  {
+    if (cbi.instruction.op == InstructionOp::cop2 && !cbi.instruction.cop.IsCommonInstruction())
+      gte_instruction_count++;
+  }
+
+  return static_cast<u32>(block.instructions.size()) * Recompiler::MAX_NEAR_HOST_BYTES_PER_INSTRUCTION +
+         gte_instruction_count * Recompiler::MAX_NEAR_HOST_BYTES_PER_GTE_INSTRUCTION +
+         block.icache_line_count * Recompiler::MAX_NEAR_HOST_BYTES_PER_ICACHE_LINE +
+         Recompiler::MAX_NEAR_HOST_BYTES_PER_BLOCK;
+}
+
+static u32 GetMaxFarHostCodeSize(const CodeBlock& block)
+{
+  return static_cast<u32>(block.instructions.size()) * Recompiler::MAX_FAR_HOST_BYTES_PER_INSTRUCTION +
+         Recompiler::MAX_FAR_HOST_BYTES_PER_BLOCK;
+}
+
+void CodeCache::CreateCodeBuffer()
+{
+  if (m_code_buffer)
+    return;
+
+  m_code_buffer = std::make_unique<JitCodeBuffer>(RECOMPILER_CODE_CACHE_SIZE, RECOMPILER_FAR_CODE_CACHE_SIZE);
+  m_asm_functions = std::make_unique<Recompiler::ASMFunctions>();
+  m_asm_functions->Generate(m_code_buffer.get(), this);
+}
+
+bool CodeCache::CompileHostCode(CodeBlock* block)
+{
+  if (m_use_threaded_compile)
+  {
+    QueueCompileJob(block);
+    return true;
+  }
+
+  std::lock_guard<std::mutex> guard(m_code_buffer_mutex);
+
+  // Ensure we're not going to run out of space while compiling this block.
+  if (!MakeCodeSpace(GetMaxNearHostCodeSize(*block), GetMaxFarHostCodeSize(*block)))
+  {
+    Log_ErrorPrintf("Out of code space for block at 0x%08X", block->key.GetPC());
+    return false;
+  }
+
+  Recompiler::CodeGenerator codegen(m_core, this, m_code_buffer.get(), *m_asm_functions.get(),
+                                    m_core->m_fastmem_base != nullptr, m_use_accurate_timing);
+  if (!codegen.CompileBlock(block, &block->host_code, &block->host_code_size))
+  {
+    Log_ErrorPrintf("Failed to compile host code for block at 0x%08X", block->key.GetPC());
+    return false;
+  }
+
+  block->host_far_code = codegen.GetFarCode();
+  block->host_far_code_size = codegen.GetFarCodeSize();
+  block->host_exits = codegen.GetBlockExitInfo();
+  m_host_code_blocks.emplace(reinterpret_cast<void*>(block->host_code), block);
+  for (const LoadStoreBackpatchInfo& lbi : codegen.GetLoadStoreBackpatchInfo())
+    m_loadstore_backpatch_info.emplace(lbi.host_pc, lbi);
+
+  return true;
+}
+
+u32 CodeCache::GetFreeCodeSpace()
+{
+  std::lock_guard<std::mutex> guard(m_code_buffer_mutex);
+  return m_code_buffer->GetTotalFreeCodeSpace();
+}
+
+bool CodeCache::MakeCodeSpace(u32 code_size, u32 far_code_size)
+{
+  if (m_code_buffer->AllocateCode(code_size, far_code_size))
+    return true;
+
+  // Invalidated blocks have most likely been overwritten, and would need new code anyway.
+  const u32 old_evicted_block_count = m_evicted_block_count;
+  for (const auto& it : m_blocks)
+  {
+    CodeBlock* block = it.second;
+    if (block && block->invalidated && block->host_code)
+    {
+      FreeHostCode(block);
+      m_evicted_block_count++;
+    }
+  }
+
+  // Then go around the buffer from where we left off, so the most recently compiled blocks survive the longest. Code
+  // which is still waiting to be published can't be freed, so this can fail with the worker thread.
+  bool result = m_code_buffer->AllocateCode(code_size, far_code_size);
+  while (!result && !m_host_code_blocks.empty())
+  {
+    EvictHostCode(RECOMPILER_EVICTION_SIZE);
+    result = m_code_buffer->AllocateCode(code_size, far_code_size);
+  }
+
+  Log_InfoPrintf("Out of code space, evicted %u blocks", m_evicted_block_count - old_evicted_block_count);
+  LogCodeBufferStats();
+  return result;
+}
+
+void CodeCache::EvictHostCode(u32 size)
+{
+  u32 freed_size = 0;
+  auto iter = m_host_code_blocks.lower_bound(m_eviction_cursor);
+  while (freed_size < size && !m_host_code_blocks.empty())
+  {
+    if (iter == m_host_code_blocks.end())
+      iter = m_host_code_blocks.begin();
+
+    CodeBlock* block = iter->second;
+    ++iter;
+
+    freed_size += block->host_code_size;
+    FreeHostCode(block);
+    m_evicted_block_count++;
+  }
+
+  m_eviction_cursor = (iter != m_host_code_blocks.end()) ? iter->first : nullptr;
+}
+
+void CodeCache::FreeHostCode(CodeBlock* block)
+{
+  if (!block->host_code)
+    return;
+
+  RemoveBlockFromFastMap(block);
+  UnlinkBlockExitsFrom(block);
+
+  // Faults can't come from this code anymore, and the space could be reused by another block's fastmem accesses.
+  u8* const host_code = reinterpret_cast<u8*>(block->host_code);
+  m_loadstore_backpatch_info.erase(m_loadstore_backpatch_info.lower_bound(host_code),
+                                   m_loadstore_backpatch_info.lower_bound(host_code + block->host_code_size));
+  m_host_code_blocks.erase(host_code);
+
+  m_code_buffer->FreeCode(host_code, block->host_code_size);
+  m_code_buffer->FreeFarCode(block->host_far_code, block->host_far_code_size);
+  block->host_code = nullptr;
+  block->host_code_size = 0;
+  block->host_far_code = nullptr;
+  block->host_far_code_size = 0;
+}
+
+void CodeCache::LogCodeBufferStats()
+{
+  const JitCodeBuffer::Stats code_stats = m_code_buffer->GetCodeStats();
+  const JitCodeBuffer::Stats far_code_stats = m_code_buffer->GetFarCodeStats();
+  Log_InfoPrintf("Code buffer: %u/%u KB used, %u free ranges, %.1f%% fragmented, %u blocks evicted in total",
+                 code_stats.used / 1024, code_stats.size / 1024, code_stats.free_range_count,
+                 code_stats.GetFragmentation() * 100.0f, m_evicted_block_count);
+  Log_InfoPrintf("Far code buffer: %u/%u KB used, %u free ranges, %.1f%% fragmented", far_code_stats.used / 1024,
+                 far_code_stats.size / 1024, far_code_stats.free_range_count,
+                 far_code_stats.GetFragmentation() * 100.0f);
+}
+
+void CodeCache::StartCompileThread()
+{
+  if (m_compile_thread.joinable())
+    return;
+
+  m_compile_thread_shutdown = false;
+  m_compile_thread = std::thread(&CodeCache::CompileThreadEntryPoint, this);
+}
+
+void CodeCache::StopCompileThread()
+{
+  if (!m_compile_thread.joinable())
+    return;
+
+  {
+    std::lock_guard<std::mutex> guard(m_compile_queue_mutex);
+    m_compile_thread_shutdown = true;
+  }
+
+  m_compile_queue_cv.notify_one();
+  m_compile_thread.join();
+  CancelCompileJobs();
+}
+
+void CodeCache::CompileThreadEntryPoint()
+{
+  std::unique_lock<std::mutex> lock(m_compile_queue_mutex);
+  for (;;)
+  {
+    m_compile_queue_cv.wait(lock, [this]() { return m_compile_thread_shutdown || !m_compile_jobs.empty(); });
+    if (m_compile_thread_shutdown)
+      break;
+
+    CompileJob job = std::move(m_compile_jobs.front());
+    m_compile_jobs.pop_front();
+    lock.unlock();
+
+    CompileResult result = {job.id, job.block.key, nullptr, 0, nullptr, 0, false, {}};
+    {
+      std::lock_guard<std::mutex> buffer_guard(m_code_buffer_mutex);
+
+      // The CPU thread evicts blocks when it sees this, since their code can't be freed while they're running.
+      if (!m_code_buffer->AllocateCode(GetMaxNearHostCodeSize(job.block), GetMaxFarHostCodeSize(job.block)))
+      {
+        result.out_of_space = true;
+      }
+      else
+      {
+        Recompiler::CodeGenerator codegen(m_core, this, m_code_buffer.get(), *m_asm_functions.get(), job.use_fastmem,
+                                          job.use_accurate_timing);
+        if (codegen.CompileBlock(&job.block, &result.host_code, &result.host_code_size))
+        {
+          result.host_far_code = codegen.GetFarCode();
+          result.host_far_code_size = codegen.GetFarCodeSize();
+          result.backpatch_info = codegen.GetLoadStoreBackpatchInfo();
+          result.exits = codegen.GetBlockExitInfo();
+        }
+        else
+        {
+          Log_ErrorPrintf("Failed to compile host code for block at 0x%08X", job.block.GetPC());
+        }
+      }
+
+      lock.lock();
+      m_compile_results.push_back(std::move(result));
+      m_compile_results_ready.store(true, std::memory_order_release);
+    }
+  }
+}
+
+void CodeCache::QueueCompileJob(CodeBlock* block)
+{
+  DebugAssert(!block->host_code);
+  block->pending_compile_id = m_next_compile_id++;
+  if (m_next_compile_id == 0)
+    m_next_compile_id = 1;
+
+  CompileJob job = {block->pending_compile_id, m_core->m_fastmem_base != nullptr, m_use_accurate_timing,
+                    CodeBlock(block->key)};
+  job.block.instructions.reserve(block->instructions.size());
+  for (const CodeBlockInstruction& cbi : block->instructions)
+    job.block.instructions.push_back(cbi);
+  job.block.idle_loop = block->idle_loop;
+  job.block.uncached_fetch_ticks = block->uncached_fetch_ticks;
+  job.block.icache_first_line_fill_ticks = block->icache_first_line_fill_ticks;
+  job.block.icache_line_fill_ticks = block->icache_line_fill_ticks;
+  job.block.icache_line_count = block->icache_line_count;
+  {
+    std::lock_guard<std::mutex> guard(m_compile_queue_mutex);
+    m_compile_jobs.push_back(std::move(job));
+  }
+
+  m_compile_queue_cv.notify_one();
+}
+
+void CodeCache::PublishCompileResults()
+{
+  if (!m_compile_results_ready.load(std::memory_order_acquire))
+    return;
+
+  std::vector<CompileResult> results;
+  {
+    std::lock_guard<std::mutex> guard(m_compile_queue_mutex);
+    results.swap(m_compile_results);
+    m_compile_results_ready.store(false, std::memory_order_relaxed);
+  }
+
+  for (const CompileResult& result : results)
+  {
+    // The block could have been flushed or recompiled since the job was queued.
+    auto iter = m_blocks.find(result.key.bits);
+    CodeBlock* block = (iter != m_blocks.end()) ? iter->second : nullptr;
+    if (!block || block->pending_compile_id != result.id)
+    {
+      if (result.host_code)
+      {
+        std::lock_guard<std::mutex> guard(m_code_buffer_mutex);
+        m_code_buffer->FreeCode(reinterpret_cast<void*>(result.host_code), result.host_code_size);
+        m_code_buffer->FreeFarCode(result.host_far_code, result.host_far_code_size);
+      }
+
+      continue;
+    }
+
+    // Make room and try again. The block is interpreted in the meantime.
+    block->pending_compile_id = 0;
+    if (result.out_of_space)
+    {
+      {
+        std::lock_guard<std::mutex> guard(m_code_buffer_mutex);
+        MakeCodeSpace(GetMaxNearHostCodeSize(*block), GetMaxFarHostCodeSize(*block));
+      }
+
+      QueueCompileJob(block);
+      continue;
+    }
+
+    // If compilation failed, the block stays interpreted.
+    if (!result.host_code)
+      continue;
+
+    block->host_code = result.host_code;
+    block->host_code_size = result.host_code_size;
+    block->host_far_code = result.host_far_code;
+    block->host_far_code_size = result.host_far_code_size;
+    block->host_exits = result.exits;
+    m_host_code_blocks.emplace(reinterpret_cast<void*>(block->host_code), block);
+    for (const LoadStoreBackpatchInfo& lbi : result.backpatch_info)
+      m_loadstore_backpatch_info.emplace(lbi.host_pc, lbi);
+
+    // Invalidated blocks are added back to the fast map when they're revalidated.
+    if (!block->invalidated)
+      AddBlockToFastMap(block);
+  }
+
+  // The worker flushed the caches for the code it wrote, but this thread could have fetched stale instructions.
+  JitCodeBuffer::SynchronizeInstructionStream();
+}
+
+void CodeCache::CancelCompileJobs()
+{
+  {
+    std::lock_guard<std::mutex> guard(m_compile_queue_mutex);
+    m_compile_jobs.clear();
+  }
+
+  // Once we have the code buffer, the worker isn't in the middle of a job, and anything it picks up after this can't
+  // match a block, so the results can be thrown away.
+  std::lock_guard<std::mutex> buffer_guard(m_code_buffer_mutex);
+  std::lock_guard<std::mutex> guard(m_compile_queue_mutex);
+  for (const CompileResult& result : m_compile_results)
+  {
+    if (result.host_code)
+    {
+      m_code_buffer->FreeCode(reinterpret_cast<void*>(result.host_code), result.host_code_size);
+      m_code_buffer->FreeFarCode(result.host_far_code, result.host_far_code_size);
+    }
+  }
+  m_compile_results.clear();
+  m_compile_results_ready.store(false, std::memory_order_relaxed);
+}
+
+Common::PageFaultHandler::HandlerResult CodeCache::PageFaultHandler(void* exception_pc, void* fault_address,
+                                                                    bool is_write)
+{
+  u8* const fastmem_base = m_core->m_fastmem_base;
+  if (!fastmem_base || static_cast<u8*>(fault_address) < fastmem_base ||
+      static_cast<u8*>(fault_address) >= (fastmem_base + UINT64_C(0x100000000)))
+  {
+    return Common::PageFaultHandler::HandlerResult::ExecuteNextHandler;
+  }
+
+  Log_DevPrintf("Page fault handler invoked at PC=%p Address=%p %s, fastmem offset 0x%08X", exception_pc,
+                fault_address, is_write ? "(write)" : "(read)",
+                static_cast<u32>(static_cast<u8*>(fault_address) - fastmem_base));
+
+  auto iter = m_loadstore_backpatch_info.find(exception_pc);
+  if (iter == m_loadstore_backpatch_info.end())
+  {
+    Log_ErrorPrintf("Fastmem fault at PC=%p was not from a backpatchable load/store", exception_pc);
+    return Common::PageFaultHandler::HandlerResult::ExecuteNextHandler;
+  }
+
+  // The access is rewritten to always go through the slow path, and execution resumes at the jump.
+  Recompiler::CodeGenerator::BackpatchLoadStore(iter->second);
+  m_loadstore_backpatch_info.erase(iter);
+  return Common::PageFaultHandler::HandlerResult::ContinueExecution;
+}
+
+#else
+
+Common::PageFaultHandler::HandlerResult CodeCache::PageFaultHandler(void* exception_pc, void* fault_address,
+                                                                    bool is_write)
+{
+  return Common::PageFaultHandler::HandlerResult::ExecuteNextHandler;
+}
+
+#endif // WITH_RECOMPILER
+
 } // namespace CPU
@@ -1,8 +1,16 @@
 #pragma once
 #include "common/bitfield.h"
+#include "common/page_fault_handler.h"
 #include "cpu_types.h"
 #include <array>
+#include <atomic>
+#include <bitset>
+#include <condition_variable>
+#include <deque>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <thread>
 #include <unordered_map>
 #include <vector>
 
@@ -54,6 +62,32 @@ struct CodeBlockInstruction
   bool is_last_instruction : 1;
   bool has_load_delay : 1;
   bool can_trap : 1;
+  bool is_dead : 1; // result is overwritten before it's read, so the recompiler can skip it
+  bool skip_load_delay : 1; // delay slot doesn't read the loaded register, so it can be written immediately
+};
+
+/// A fastmem load/store in host code, which is replaced by a jump to its slow path when it faults.
+struct LoadStoreBackpatchInfo
+{
+  void* host_pc;         // the instruction which accesses the fastmem region
+  void* host_slowmem_pc; // slow path, which calls the memory access thunk
+  u32 host_code_size;    // bytes available for the jump, including padding
+  u32 guest_pc;
+};
+
+struct CodeBlock;
+
+/// A jump at the end of a block's host code, which goes to its link stub until the next block is known, and then
+/// straight to that block. Indirect exits first compare the PC with the last target they were linked to.
+struct BlockExitInfo
+{
+  void* host_jump;        // jump to the linked block, or the link stub
+  void* host_link_stub;   // passes host_jump to the code cache, which links the exit to the block at the current PC
+  void* host_target_pc;   // indirect exits only, the immediate which the PC is compared with
+  void* host_miss_jump;   // indirect exits only, taken when the PC doesn't match
+  u32 target_pc;          // PC the exit is taken for, or the last linked PC for indirect exits
+  u32 relink_count;       // number of times an indirect exit has changed target
+  CodeBlock* target;      // block the exit is linked to, if any
 };
 
 struct CodeBlock
@@ -66,12 +100,35 @@ struct CodeBlock
   u32 host_code_size = 0;
   HostCodePointer host_code = nullptr;
 
+  // Slow paths, which are freed along with the host code.
+  void* host_far_code = nullptr;
+  u32 host_far_code_size = 0;
+
   std::vector<CodeBlockInstruction> instructions;
+  std::vector<ThreadedInstruction> threaded_code; // only decoded for the threaded-code interpreter
   std::vector<CodeBlock*> link_predecessors;
   std::vector<CodeBlock*> link_successors;
+  std::vector<BlockExitInfo> host_exits; // linkable exits in the host code
 
   bool invalidated = false;
 
+  // The block is on a page which is written too often to protect, so its code is compared with memory before it runs.
+  bool manual_check = false;
+
+  // The block loops back to its start, and each iteration only reads memory, so it can be skipped until an event runs.
+  bool idle_loop = false;
+
+  // Instruction fetch timing, only computed when accurate timing is enabled. Without the i-cache, every instruction
+  // waits for memory. With it, each line the block covers is looked up when the block starts, and misses fill the rest
+  // of the line, which for the first line is from the block's PC.
+  TickCount uncached_fetch_ticks = 0;
+  TickCount icache_first_line_fill_ticks = 0;
+  TickCount icache_line_fill_ticks = 0;
+  u32 icache_line_count = 0;
+
+  // Non-zero while the host code is being compiled on the worker thread. Results for older requests are ignored.
+  u32 pending_compile_id = 0;
+
   const u32 GetPC() const { return key.GetPC(); }
   const u32 GetSizeInBytes() const { return static_cast<u32>(instructions.size()) * sizeof(Instruction); }
   const u32 GetStartPageIndex() const { return (key.GetPCPhysicalAddress() / CPU_CODE_CACHE_PAGE_SIZE); }
@@ -92,7 +149,8 @@ public:
   CodeCache();
   ~CodeCache();
 
-  void Initialize(System* system, Core* core, Bus* bus, bool use_recompiler);
+  void Initialize(System* system, Core* core, Bus* bus, bool use_recompiler, bool use_threaded_interpreter,
+                  bool use_fastmem, bool use_threaded_compile, bool use_idle_loop_skipping, bool use_accurate_timing);
   void Execute();
 
   /// Flushes the code cache, forcing all blocks to be recompiled.
@@ -101,12 +159,114 @@ public:
   /// Changes whether the recompiler is enabled.
   void SetUseRecompiler(bool enable);
 
+  /// Changes whether blocks are pre-decoded and run by the threaded-code interpreter, when the recompiler is disabled.
+  void SetUseThreadedInterpreter(bool enable);
+
+  /// Changes whether the recompiler accesses RAM directly through the fastmem region.
+  void SetUseFastmem(bool enable);
+
+  /// Changes whether host code is compiled on a worker thread. Blocks are interpreted until their code is ready.
+  void SetUseThreadedCompile(bool enable);
+
+  /// Changes whether idle loops are detected, and skipped ahead to the next event.
+  void SetUseIdleLoopSkipping(bool enable);
+
+  /// Changes whether blocks include the wait states of their instruction fetches, and look up the i-cache.
+  void SetUseAccurateTiming(bool enable);
+
+  /// Flushes all blocks before the next Execute(), because the memory timings their fetch ticks use have changed.
+  void InvalidateFetchTimings();
+
   /// Invalidates all blocks which are in the range of the specified code page.
   void InvalidateBlocksWithPageIndex(u32 page_index);
 
+  /// Loads the shapes of blocks compiled in a previous run, so they can be compiled ahead of time.
+  bool LoadBlockMetadata(const char* filename);
+
+  /// Saves the shapes of all compiled blocks, along with any from the last load which haven't been compiled yet.
+  bool SaveBlockMetadata(const char* filename);
+
+  /// Forgets any blocks from the last metadata load, e.g. when the running game changes.
+  void ClearBlockMetadata();
+
+  /// Compiles blocks from the loaded metadata whose guest code is now in memory, until the time limit expires.
+  void PrecompileBlocksFromMetadata(double time_limit_ms);
+
+  /// Direct-mapped table of host code for each kernel-mode PC, split into lazily-allocated pages.
+  /// Unused entries are null, and unused pages all point to a shared null page, so lookups never need a branch.
+  enum : u32
+  {
+    FAST_MAP_PAGE_SHIFT = 16,
+    FAST_MAP_PAGE_COUNT = 0x10000,
+    FAST_MAP_PAGE_SIZE = (1u << FAST_MAP_PAGE_SHIFT) / sizeof(Instruction),
+  };
+  using FastMapPage = CodeBlock::HostCodePointer*;
+
+  const FastMapPage* GetFastMap() const { return m_fast_map.data(); }
+
+  /// Returns the host code for the block at the current PC, compiling it if needed. If the block can't be compiled,
+  /// it is interpreted instead, and null is returned. Used by the dispatcher when the fast map misses.
+  CodeBlock::HostCodePointer LookupNextHostCode();
+
+  /// Looks up the next block like LookupNextHostCode(), and links the block exit at host_jump to it, so later runs of
+  /// the exit skip the dispatcher. Used by block exits the first time they're taken, or when their target changes.
+  CodeBlock::HostCodePointer LinkBlockExit(void* host_jump);
+
+  /// Skips ahead to the next event if the idle loop at the current PC would only spin until then. Used by recompiled
+  /// idle loops when they're about to go around again.
+  void SkipIdleLoop();
+
 private:
   using BlockMap = std::unordered_map<u32, CodeBlock*>;
 
+  enum : u32
+  {
+    BLOCK_METADATA_SIGNATURE = 0x4B4C4243, // CBLK
+    BLOCK_METADATA_VERSION = 1,
+  };
+
+  struct BlockMetadata
+  {
+    u32 key;
+    u32 instruction_count;
+    u64 code_hash;
+  };
+
+  enum : u32
+  {
+    // Pages which are invalidated this many times, each within the window of the last, are no longer protected.
+    MANUAL_CHECK_INVALIDATE_COUNT = 8,
+    MANUAL_CHECK_WINDOW_FRAMES = 60,
+  };
+
+  struct PageInvalidateInfo
+  {
+    u32 count;
+    u32 last_frame;
+  };
+
+  /// A block which has been decoded on the CPU thread, waiting for host code from the worker thread.
+  struct CompileJob
+  {
+    u32 id;
+    bool use_fastmem;
+    bool use_accurate_timing;
+    CodeBlock block;
+  };
+
+  struct CompileResult
+  {
+    u32 id;
+    CodeBlockKey key;
+    CodeBlock::HostCodePointer host_code;
+    u32 host_code_size;
+    void* host_far_code;
+    u32 host_far_code_size;
+    bool out_of_space;
+    std::vector<LoadStoreBackpatchInfo> backpatch_info;
+    std::vector<BlockExitInfo> exits;
+  };
+
   void LogCurrentState();
 
   /// Returns the block key for the current execution state.
@@ -115,11 +275,68 @@ private:
   /// Looks up the block in the cache if it's already been compiled.
   CodeBlock* LookupBlock(CodeBlockKey key);
 
+  /// Returns the host code for the block at the specified PC, or null if it has not been compiled or is invalidated.
+  ALWAYS_INLINE CodeBlock::HostCodePointer FastMapLookup(u32 pc) const
+  {
+    return m_fast_map[pc >> FAST_MAP_PAGE_SHIFT][(pc & ((1u << FAST_MAP_PAGE_SHIFT) - 1)) / sizeof(Instruction)];
+  }
+
+  void ResetFastMap();
+  void AddBlockToFastMap(CodeBlock* block);
+  void RemoveBlockFromFastMap(CodeBlock* block);
+
+  void ExecuteRecompiler();
+
   /// Can the current block execute? This will re-validate the block if necessary.
   /// The block can also be flushed if recompilation failed, so ignore the pointer if false is returned.
   bool RevalidateBlock(CodeBlock* block);
 
   bool CompileBlock(CodeBlock* block);
+
+  /// Pre-decodes a block's instructions for the threaded-code interpreter.
+  static void DecodeThreadedCode(CodeBlock* block);
+
+  /// Allocates the code buffer and generates the dispatcher, the first time the recompiler is enabled.
+  void CreateCodeBuffer();
+
+  /// Compiles host code for a decoded block, or queues it for the worker thread.
+  bool CompileHostCode(CodeBlock* block);
+
+  /// Returns the total free space in the code buffer, which may be in use by the worker thread.
+  u32 GetFreeCodeSpace();
+
+  /// Makes room in the code buffer for the specified amount of code, evicting blocks if needed. Evicted blocks are
+  /// kept, and get new host code the next time they're looked up. Called with the code buffer lock held.
+  bool MakeCodeSpace(u32 code_size, u32 far_code_size);
+
+  /// Frees the host code of the oldest blocks in the code buffer, until at least the specified amount is freed.
+  void EvictHostCode(u32 size);
+
+  /// Removes a block's host code from the fast map and returns it to the code buffer. Called with the code buffer lock
+  /// held.
+  void FreeHostCode(CodeBlock* block);
+
+  void LogCodeBufferStats();
+
+  void StartCompileThread();
+  void StopCompileThread();
+  void CompileThreadEntryPoint();
+  void QueueCompileJob(CodeBlock* block);
+
+  /// Hands over host code from the worker thread to its blocks, making it visible to the dispatcher.
+  void PublishCompileResults();
+
+  /// Drops queued jobs and results, and waits for the worker to stop using the code buffer.
+  void CancelCompileJobs();
+
+  /// Hashes the code of a compiled block, or the guest code in memory at a block's location, to detect whether it has
+  /// been loaded yet. HashGuestCode() returns false if the memory can't be read.
+  static u64 HashBlockInstructions(const CodeBlock& block);
+  bool HashGuestCode(CodeBlockKey key, u32 instruction_count, u64* hash) const;
+
+  /// Returns the pending blocks and the compiled ones, with one entry per block. Compiled blocks take priority, since
+  /// they're the most recent version of the code.
+  std::unordered_map<u32, BlockMetadata> GetAllBlockMetadata() const;
   void FlushBlock(CodeBlock* block);
   void AddBlockToPageMap(CodeBlock* block);
   void RemoveBlockFromPageMap(CodeBlock* block);
@@ -130,9 +347,34 @@ private:
   /// Unlink all blocks which point to this block, and any that this block links to.
   void UnlinkBlock(CodeBlock* block);
 
+  /// Points a block exit back at its link stub, and removes the link between the blocks.
+  void UnlinkBlockExit(CodeBlock* block, BlockExitInfo& exit);
+
+  /// Unlinks any block exits which jump to this block's host code, e.g. when it's invalidated or freed.
+  void UnlinkBlockExitsTo(CodeBlock* block);
+
+  /// Forgets about this block's exits, when its host code is freed.
+  void UnlinkBlockExitsFrom(CodeBlock* block);
+
+  /// Skips ahead to the next event if nothing but an event can make the idle loop exit, i.e. no interrupt is pending
+  /// and the loop only reads from memory which doesn't change by itself. Called when the loop is about to go around.
+  void SkipIdleLoop(CodeBlock* block);
+  bool CanSkipIdleLoop(const CodeBlock& block) const;
+
+  /// Works out a block's instruction fetch timing, and adds it to the pending ticks before the block runs.
+  void ComputeFetchTicks(CodeBlock* block);
+  void AddBlockFetchTicks(const CodeBlock& block);
+
   void InterpretCachedBlock(const CodeBlock& block);
+  void InterpretThreadedBlock(const CodeBlock& block);
   void InterpretUncachedBlock();
 
+  /// Maps or unmaps the fastmem region depending on whether the recompiler can use it.
+  void UpdateFastmemViews();
+
+  /// Backpatches fastmem accesses which fault (i.e. non-RAM or code page stores) to use the slow path.
+  Common::PageFaultHandler::HandlerResult PageFaultHandler(void* exception_pc, void* fault_address, bool is_write);
+
   System* m_system = nullptr;
   Core* m_core = nullptr;
   Bus* m_bus = nullptr;
@@ -140,13 +382,45 @@ private:
 #ifdef WITH_RECOMPILER
   std::unique_ptr<JitCodeBuffer> m_code_buffer;
   std::unique_ptr<Recompiler::ASMFunctions> m_asm_functions;
+  std::map<void*, LoadStoreBackpatchInfo> m_loadstore_backpatch_info;
+
+  // Blocks with host code, ordered by location, so the oldest part of the code buffer can be evicted first.
+  std::map<void*, CodeBlock*> m_host_code_blocks;
+  void* m_eviction_cursor = nullptr;
+  u32 m_evicted_block_count = 0;
+
+  // The worker holds the code buffer lock while emitting code. Lock order is code buffer, then queue.
+  std::thread m_compile_thread;
+  std::mutex m_code_buffer_mutex;
+  std::mutex m_compile_queue_mutex;
+  std::condition_variable m_compile_queue_cv;
+  std::deque<CompileJob> m_compile_jobs;
+  std::vector<CompileResult> m_compile_results;
+  std::atomic_bool m_compile_results_ready{false};
+  bool m_compile_thread_shutdown = false;
+  u32 m_next_compile_id = 1;
 #endif
 
   BlockMap m_blocks;
 
+  std::array<FastMapPage, FAST_MAP_PAGE_COUNT> m_fast_map;
+  std::vector<std::unique_ptr<CodeBlock::HostCodePointer[]>> m_fast_map_pages;
+
   bool m_use_recompiler = false;
+  bool m_use_threaded_interpreter = false;
+  bool m_use_fastmem = false;
+  bool m_use_threaded_compile = false;
+  bool m_use_idle_loop_skipping = false;
+  bool m_use_accurate_timing = false;
+  bool m_flush_pending = false;
 
   std::array<std::vector<CodeBlock*>, CPU_CODE_CACHE_PAGE_COUNT> m_ram_block_map;
+  std::array<PageInvalidateInfo, CPU_CODE_CACHE_PAGE_COUNT> m_ram_page_invalidate_info = {};
+  std::bitset<CPU_CODE_CACHE_PAGE_COUNT> m_ram_manual_check_pages;
+
+  // Blocks from the metadata file or a flush which haven't been compiled yet.
+  std::vector<BlockMetadata> m_pending_block_metadata;
+  size_t m_next_pending_block = 0;
 };
 
 } // namespace CPU
\ No newline at end of file
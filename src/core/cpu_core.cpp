@@ -67,6 +67,8 @@ void Core::Reset()
 
   m_cop2.Reset();
 
+  InvalidateICache();
+  UpdateCacheIsolation();
   SetPC(RESET_VECTOR);
 }
 
@@ -105,6 +107,13 @@ bool Core::DoState(StateWrapper& sw)
   if (!m_cop2.DoState(sw))
     return false;
 
+  // The i-cache is only used for timing, so it starts out empty rather than being saved.
+  if (sw.IsReading())
+  {
+    InvalidateICache();
+    UpdateCacheIsolation();
+  }
+
   return !sw.HasError();
 }
 
@@ -509,6 +518,7 @@ void Core::WriteCop0Reg(Cop0Reg reg, u32 value)
       m_cop0_regs.sr.bits =
         (m_cop0_regs.sr.bits & ~Cop0Registers::SR::WRITE_MASK) | (value & Cop0Registers::SR::WRITE_MASK);
       Log_DebugPrintf("COP0 SR <- %08X (now %08X)", value, m_cop0_regs.sr.bits);
+      UpdateCacheIsolation();
     }
     break;
 
@@ -526,6 +536,44 @@ void Core::WriteCop0Reg(Cop0Reg reg, u32 value)
   }
 }
 
+void Core::UpdateCacheIsolation()
+{
+  // The BIOS flushes the i-cache by isolating it and writing to every line, which we don't emulate the stores of.
+  if (m_cop0_regs.sr.Isc)
+    InvalidateICache();
+
+  m_bus->SetFastmemCacheIsolated(m_cop0_regs.sr.Isc);
+}
+
+void Core::SetAccurateTiming(bool enable)
+{
+  m_accurate_timing = enable;
+  InvalidateICache();
+}
+
+TickCount Core::GetInstructionFetchTicks(VirtualMemoryAddress address)
+{
+  if (IsCachedAddress(address) && IsICacheEnabled())
+    return FillICacheLine(address);
+  else
+    return m_bus->GetInstructionReadTicks(address & PHYSICAL_MEMORY_ADDRESS_MASK);
+}
+
+TickCount Core::FillICacheLine(VirtualMemoryAddress address)
+{
+  u32& tag = m_icache_tags[GetICacheLine(address)];
+  if (tag == GetICacheTag(address))
+    return 0;
+
+  tag = GetICacheTag(address);
+  return m_bus->GetICacheFillTicks(address & PHYSICAL_MEMORY_ADDRESS_MASK);
+}
+
+void Core::InvalidateICache()
+{
+  m_icache_tags.fill(ICACHE_INVALID_TAG);
+}
+
 void Core::WriteCacheControl(u32 value)
 {
   Log_WarningPrintf("Cache control <- 0x%08X", value);
@@ -632,6 +680,9 @@ bool Core::FetchInstruction()
     return false;
   }
 
+  if (m_accurate_timing)
+    m_pending_ticks += GetInstructionFetchTicks(m_regs.npc);
+
   m_regs.pc = m_regs.npc;
   m_regs.npc += sizeof(m_next_instruction.bits);
   return true;
@@ -1359,4 +1410,380 @@ void Core::ExecuteCop2Instruction()
   }
 }
 
+// Computed goto is a GCC/Clang extension, other compilers dispatch the same handlers through a switch.
+#if defined(__GNUC__) || defined(__clang__)
+#define CPU_THREADED_INTERPRETER_COMPUTED_GOTO 1
+#endif
+
+void Core::ExecuteThreadedCode(const ThreadedInstruction* code)
+{
+  const ThreadedInstruction* ti = code;
+
+  // Same state updates as the cached interpreter does for each instruction.
+#define BEGIN_FULL_STATE()                                                                                             \
+  m_current_instruction.bits = ti->instruction.bits;                                                                   \
+  m_current_instruction_pc = ti->pc;                                                                                   \
+  m_current_instruction_in_branch_delay_slot = ti->is_branch_delay_slot;                                               \
+  m_current_instruction_was_branch_taken = m_branch_was_taken;                                                         \
+  m_branch_was_taken = false;                                                                                          \
+  m_exception_raised = false;
+
+#define BEGIN_INSTRUCTION()                                                                                            \
+  m_pending_ticks++;                                                                                                   \
+  m_regs.pc = m_regs.npc;                                                                                              \
+  m_regs.npc += sizeof(u32);
+
+#define END_FULL_STATE()                                                                                               \
+  if (ti->NeedsFullState())                                                                                            \
+  {                                                                                                                    \
+    UpdateLoadDelay();                                                                                                 \
+    if (m_exception_raised)                                                                                            \
+      goto op_end;                                                                                                     \
+  }
+
+#ifdef CPU_THREADED_INTERPRETER_COMPUTED_GOTO
+  static const void* const handlers[] = {
+#define HANDLER_LABELS(name) &&op_##name, &&op_##name##_full,
+    CPU_THREADED_INTERPRETER_OPS(HANDLER_LABELS)
+#undef HANDLER_LABELS
+    &&op_end};
+  static_assert(countof(handlers) == static_cast<size_t>(ThreadedOp::count), "all handlers are present");
+
+#define DISPATCH() goto* handlers[static_cast<u8>(ti->op)]
+#define HANDLER(name)                                                                                                  \
+  op_##name##_full : BEGIN_FULL_STATE() op_##name : BEGIN_INSTRUCTION()
+#define END_HANDLER()                                                                                                  \
+  END_FULL_STATE()                                                                                                     \
+  ti++;                                                                                                                \
+  DISPATCH();
+
+  DISPATCH();
+#else
+#define HANDLER(name)                                                                                                  \
+  case ThreadedOp::name##_full:                                                                                        \
+    BEGIN_FULL_STATE()                                                                                                 \
+    [[fallthrough]];                                                                                                   \
+  case ThreadedOp::name:                                                                                               \
+    BEGIN_INSTRUCTION()
+#define END_HANDLER() break;
+
+  for (;;)
+  {
+    switch (ti->op)
+    {
+#endif
+
+  HANDLER(nop) {}
+  END_HANDLER()
+
+  HANDLER(sll) { WriteReg(ti->rd, ReadReg(ti->rt) << ti->imm); }
+  END_HANDLER()
+
+  HANDLER(srl) { WriteReg(ti->rd, ReadReg(ti->rt) >> ti->imm); }
+  END_HANDLER()
+
+  HANDLER(sra) { WriteReg(ti->rd, static_cast<u32>(static_cast<s32>(ReadReg(ti->rt)) >> ti->imm)); }
+  END_HANDLER()
+
+  HANDLER(sllv) { WriteReg(ti->rd, ReadReg(ti->rt) << (ReadReg(ti->rs) & UINT32_C(0x1F))); }
+  END_HANDLER()
+
+  HANDLER(srlv) { WriteReg(ti->rd, ReadReg(ti->rt) >> (ReadReg(ti->rs) & UINT32_C(0x1F))); }
+  END_HANDLER()
+
+  HANDLER(srav)
+  {
+    WriteReg(ti->rd, static_cast<u32>(static_cast<s32>(ReadReg(ti->rt)) >> (ReadReg(ti->rs) & UINT32_C(0x1F))));
+  }
+  END_HANDLER()
+
+  HANDLER(and_) { WriteReg(ti->rd, ReadReg(ti->rs) & ReadReg(ti->rt)); }
+  END_HANDLER()
+
+  HANDLER(or_) { WriteReg(ti->rd, ReadReg(ti->rs) | ReadReg(ti->rt)); }
+  END_HANDLER()
+
+  HANDLER(xor_) { WriteReg(ti->rd, ReadReg(ti->rs) ^ ReadReg(ti->rt)); }
+  END_HANDLER()
+
+  HANDLER(nor) { WriteReg(ti->rd, ~(ReadReg(ti->rs) | ReadReg(ti->rt))); }
+  END_HANDLER()
+
+  HANDLER(add)
+  {
+    const u32 old_value = ReadReg(ti->rs);
+    const u32 add_value = ReadReg(ti->rt);
+    const u32 new_value = old_value + add_value;
+    if (AddOverflow(old_value, add_value, new_value))
+      RaiseException(Exception::Ov);
+    else
+      WriteReg(ti->rd, new_value);
+  }
+  END_HANDLER()
+
+  HANDLER(addu) { WriteReg(ti->rd, ReadReg(ti->rs) + ReadReg(ti->rt)); }
+  END_HANDLER()
+
+  HANDLER(sub)
+  {
+    const u32 old_value = ReadReg(ti->rs);
+    const u32 sub_value = ReadReg(ti->rt);
+    const u32 new_value = old_value - sub_value;
+    if (SubOverflow(old_value, sub_value, new_value))
+      RaiseException(Exception::Ov);
+    else
+      WriteReg(ti->rd, new_value);
+  }
+  END_HANDLER()
+
+  HANDLER(subu) { WriteReg(ti->rd, ReadReg(ti->rs) - ReadReg(ti->rt)); }
+  END_HANDLER()
+
+  HANDLER(slt)
+  {
+    WriteReg(ti->rd, BoolToUInt32(static_cast<s32>(ReadReg(ti->rs)) < static_cast<s32>(ReadReg(ti->rt))));
+  }
+  END_HANDLER()
+
+  HANDLER(sltu) { WriteReg(ti->rd, BoolToUInt32(ReadReg(ti->rs) < ReadReg(ti->rt))); }
+  END_HANDLER()
+
+  HANDLER(mfhi) { WriteReg(ti->rd, m_regs.hi); }
+  END_HANDLER()
+
+  HANDLER(mthi) { m_regs.hi = ReadReg(ti->rs); }
+  END_HANDLER()
+
+  HANDLER(mflo) { WriteReg(ti->rd, m_regs.lo); }
+  END_HANDLER()
+
+  HANDLER(mtlo) { m_regs.lo = ReadReg(ti->rs); }
+  END_HANDLER()
+
+  HANDLER(mult)
+  {
+    const u64 result = static_cast<u64>(static_cast<s64>(SignExtend64(ReadReg(ti->rs))) *
+                                        static_cast<s64>(SignExtend64(ReadReg(ti->rt))));
+    m_regs.hi = Truncate32(result >> 32);
+    m_regs.lo = Truncate32(result);
+  }
+  END_HANDLER()
+
+  HANDLER(multu)
+  {
+    const u64 result = ZeroExtend64(ReadReg(ti->rs)) * ZeroExtend64(ReadReg(ti->rt));
+    m_regs.hi = Truncate32(result >> 32);
+    m_regs.lo = Truncate32(result);
+  }
+  END_HANDLER()
+
+  HANDLER(div)
+  {
+    const s32 num = static_cast<s32>(ReadReg(ti->rs));
+    const s32 denom = static_cast<s32>(ReadReg(ti->rt));
+    if (denom == 0)
+    {
+      m_regs.lo = (num >= 0) ? UINT32_C(0xFFFFFFFF) : UINT32_C(1);
+      m_regs.hi = static_cast<u32>(num);
+    }
+    else if (static_cast<u32>(num) == UINT32_C(0x80000000) && denom == -1)
+    {
+      m_regs.lo = UINT32_C(0x80000000);
+      m_regs.hi = 0;
+    }
+    else
+    {
+      m_regs.lo = static_cast<u32>(num / denom);
+      m_regs.hi = static_cast<u32>(num % denom);
+    }
+  }
+  END_HANDLER()
+
+  HANDLER(divu)
+  {
+    const u32 num = ReadReg(ti->rs);
+    const u32 denom = ReadReg(ti->rt);
+    if (denom == 0)
+    {
+      m_regs.lo = UINT32_C(0xFFFFFFFF);
+      m_regs.hi = num;
+    }
+    else
+    {
+      m_regs.lo = num / denom;
+      m_regs.hi = num % denom;
+    }
+  }
+  END_HANDLER()
+
+  HANDLER(jr) { Branch(ReadReg(ti->rs)); }
+  END_HANDLER()
+
+  HANDLER(jalr)
+  {
+    const u32 target = ReadReg(ti->rs);
+    WriteReg(ti->rd, m_regs.npc);
+    Branch(target);
+  }
+  END_HANDLER()
+
+  HANDLER(lui) { WriteReg(ti->rt, ti->imm); }
+  END_HANDLER()
+
+  HANDLER(andi) { WriteReg(ti->rt, ReadReg(ti->rs) & ti->imm); }
+  END_HANDLER()
+
+  HANDLER(ori) { WriteReg(ti->rt, ReadReg(ti->rs) | ti->imm); }
+  END_HANDLER()
+
+  HANDLER(xori) { WriteReg(ti->rt, ReadReg(ti->rs) ^ ti->imm); }
+  END_HANDLER()
+
+  HANDLER(addi)
+  {
+    const u32 old_value = ReadReg(ti->rs);
+    const u32 new_value = old_value + ti->imm;
+    if (AddOverflow(old_value, ti->imm, new_value))
+      RaiseException(Exception::Ov);
+    else
+      WriteReg(ti->rt, new_value);
+  }
+  END_HANDLER()
+
+  HANDLER(addiu) { WriteReg(ti->rt, ReadReg(ti->rs) + ti->imm); }
+  END_HANDLER()
+
+  HANDLER(slti) { WriteReg(ti->rt, BoolToUInt32(static_cast<s32>(ReadReg(ti->rs)) < static_cast<s32>(ti->imm))); }
+  END_HANDLER()
+
+  HANDLER(sltiu) { WriteReg(ti->rt, BoolToUInt32(ReadReg(ti->rs) < ti->imm)); }
+  END_HANDLER()
+
+  HANDLER(lb)
+  {
+    u8 value;
+    if (ReadMemoryByte(ReadReg(ti->rs) + ti->imm, &value))
+      WriteRegDelayed(ti->rt, SignExtend32(value));
+  }
+  END_HANDLER()
+
+  HANDLER(lbu)
+  {
+    u8 value;
+    if (ReadMemoryByte(ReadReg(ti->rs) + ti->imm, &value))
+      WriteRegDelayed(ti->rt, ZeroExtend32(value));
+  }
+  END_HANDLER()
+
+  HANDLER(lh)
+  {
+    u16 value;
+    if (ReadMemoryHalfWord(ReadReg(ti->rs) + ti->imm, &value))
+      WriteRegDelayed(ti->rt, SignExtend32(value));
+  }
+  END_HANDLER()
+
+  HANDLER(lhu)
+  {
+    u16 value;
+    if (ReadMemoryHalfWord(ReadReg(ti->rs) + ti->imm, &value))
+      WriteRegDelayed(ti->rt, ZeroExtend32(value));
+  }
+  END_HANDLER()
+
+  HANDLER(lw)
+  {
+    u32 value;
+    if (ReadMemoryWord(ReadReg(ti->rs) + ti->imm, &value))
+      WriteRegDelayed(ti->rt, value);
+  }
+  END_HANDLER()
+
+  HANDLER(sb) { WriteMemoryByte(ReadReg(ti->rs) + ti->imm, Truncate8(ReadReg(ti->rt))); }
+  END_HANDLER()
+
+  HANDLER(sh) { WriteMemoryHalfWord(ReadReg(ti->rs) + ti->imm, Truncate16(ReadReg(ti->rt))); }
+  END_HANDLER()
+
+  HANDLER(sw) { WriteMemoryWord(ReadReg(ti->rs) + ti->imm, ReadReg(ti->rt)); }
+  END_HANDLER()
+
+  // Branch targets are relative to the PC register, which isn't the instruction's address in a branch delay slot.
+  HANDLER(j) { Branch((m_regs.pc & UINT32_C(0xF0000000)) | ti->imm); }
+  END_HANDLER()
+
+  HANDLER(jal)
+  {
+    WriteReg(Reg::ra, m_regs.npc);
+    Branch((m_regs.pc & UINT32_C(0xF0000000)) | ti->imm);
+  }
+  END_HANDLER()
+
+  HANDLER(beq)
+  {
+    if (ReadReg(ti->rs) == ReadReg(ti->rt))
+      Branch(m_regs.pc + ti->imm);
+  }
+  END_HANDLER()
+
+  HANDLER(bne)
+  {
+    if (ReadReg(ti->rs) != ReadReg(ti->rt))
+      Branch(m_regs.pc + ti->imm);
+  }
+  END_HANDLER()
+
+  HANDLER(bgtz)
+  {
+    if (static_cast<s32>(ReadReg(ti->rs)) > 0)
+      Branch(m_regs.pc + ti->imm);
+  }
+  END_HANDLER()
+
+  HANDLER(blez)
+  {
+    if (static_cast<s32>(ReadReg(ti->rs)) <= 0)
+      Branch(m_regs.pc + ti->imm);
+  }
+  END_HANDLER()
+
+  HANDLER(b)
+  {
+    const u8 rt = static_cast<u8>(ti->rt);
+    const bool bgez = ConvertToBoolUnchecked(rt & u8(1));
+    const bool branch = (static_cast<s32>(ReadReg(ti->rs)) < 0) ^ bgez;
+    if ((rt & u8(0x1E)) == u8(0x10))
+      WriteReg(Reg::ra, m_regs.npc);
+
+    if (branch)
+      Branch(m_regs.pc + ti->imm);
+  }
+  END_HANDLER()
+
+  HANDLER(interpret) { ExecuteInstruction(); }
+  END_HANDLER()
+
+#ifndef CPU_THREADED_INTERPRETER_COMPUTED_GOTO
+      case ThreadedOp::end:
+      default:
+        goto op_end;
+    }
+
+    END_FULL_STATE()
+    ti++;
+  }
+#endif
+
+op_end:
+  // cleanup so the interpreter can kick in if needed
+  m_next_instruction_is_branch_delay_slot = false;
+
+#undef BEGIN_FULL_STATE
+#undef BEGIN_INSTRUCTION
+#undef END_FULL_STATE
+#undef DISPATCH
+#undef HANDLER
+#undef END_HANDLER
+}
+
 } // namespace CPU
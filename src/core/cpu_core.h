@@ -16,6 +16,7 @@ namespace CPU {
 class CodeCache;
 
 namespace Recompiler {
+class ASMFunctions;
 class CodeGenerator;
 class Thunks;
 } // namespace Recompiler
@@ -30,6 +31,7 @@ public:
   static constexpr PhysicalMemoryAddress DCACHE_SIZE = UINT32_C(0x00000400);
 
   friend CodeCache;
+  friend Recompiler::ASMFunctions;
   friend Recompiler::CodeGenerator;
   friend Recompiler::Thunks;
 
@@ -69,6 +71,9 @@ public:
   void SetExternalInterrupt(u8 bit);
   void ClearExternalInterrupt(u8 bit);
 
+  /// Enables or disables adding the wait states of instruction fetches, and emulating the instruction cache.
+  void SetAccurateTiming(bool enable);
+
 private:
   template<MemoryAccessType type, MemoryAccessSize size>
   TickCount DoMemoryAccess(VirtualMemoryAddress address, u32& value);
@@ -106,6 +111,33 @@ private:
     m_next_load_delay_reg = Reg::count;
   }
 
+  // i-cache helpers, only KUSEG and KSEG0 fetches are cached
+  ALWAYS_INLINE static bool IsCachedAddress(VirtualMemoryAddress address)
+  {
+    const u32 segment = address >> 29;
+    return (segment == 0x00 || segment == 0x04);
+  }
+  ALWAYS_INLINE static u32 GetICacheLine(VirtualMemoryAddress address)
+  {
+    return (address / ICACHE_LINE_SIZE) % ICACHE_LINES;
+  }
+  ALWAYS_INLINE static u32 GetICacheTag(VirtualMemoryAddress address)
+  {
+    return address & PHYSICAL_MEMORY_ADDRESS_MASK & ~(ICACHE_LINE_SIZE - 1u);
+  }
+  ALWAYS_INLINE bool IsICacheEnabled() const
+  {
+    return (m_cache_control & (1u << CACHE_CONTROL_ICACHE_ENABLE_BIT)) != 0;
+  }
+
+  // Returns the number of cycles fetching the instruction at the address waits for, filling its i-cache line on a miss.
+  TickCount GetInstructionFetchTicks(VirtualMemoryAddress address);
+
+  // Looks up the i-cache line holding the address, filling it on a miss. Returns the number of cycles the fill took.
+  TickCount FillICacheLine(VirtualMemoryAddress address);
+
+  void InvalidateICache();
+
   // Fetches the instruction at m_regs.npc
   bool FetchInstruction();
   void ExecuteInstruction();
@@ -113,6 +145,10 @@ private:
   void ExecuteCop2Instruction();
   void Branch(u32 target);
 
+  // Runs pre-decoded instructions until the end of the block or an exception. Used by the cached interpreter in place
+  // of fetching and decoding each instruction, behaves the same as calling ExecuteInstruction() for each.
+  void ExecuteThreadedCode(const ThreadedInstruction* code);
+
   // exceptions
   u32 GetExceptionVector(Exception excode) const;
   void RaiseException(Exception excode);
@@ -137,8 +173,14 @@ private:
   std::optional<u32> ReadCop0Reg(Cop0Reg reg);
   void WriteCop0Reg(Cop0Reg reg, u32 value);
 
+  // updates the fastmem views and i-cache after cache isolation is toggled
+  void UpdateCacheIsolation();
+
   Bus* m_bus = nullptr;
 
+  // base of the 4GB fastmem region, only set when the recompiler is using fastmem
+  u8* m_fastmem_base = nullptr;
+
   // ticks the CPU has executed
   TickCount m_pending_ticks = 0;
   TickCount m_downcount = MAX_SLICE_SIZE;
@@ -166,6 +208,10 @@ private:
   u32 m_cache_control = 0;
   System* m_system = nullptr;
 
+  // instruction cache tags, only used for timing when accurate timing is enabled
+  bool m_accurate_timing = false;
+  std::array<u32, ICACHE_LINES> m_icache_tags = {};
+
   // data cache (used as scratchpad)
   std::array<u8, DCACHE_SIZE> m_dcache = {};
 
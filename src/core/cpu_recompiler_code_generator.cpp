@@ -23,9 +23,16 @@ bool CodeGenerator::CompileBlock(const CodeBlock* block, CodeBlock::HostCodePoin
   m_block = block;
   m_block_start = block->instructions.data();
   m_block_end = block->instructions.data() + block->instructions.size();
+  m_loadstore_backpatch_info.clear();
+  m_static_exit_pc_count = 0;
+  m_indirect_exit = false;
+  m_block_exit_info.clear();
+  ComputeLiveGuestRegisters();
 
   EmitBeginBlock();
   BlockPrologue();
+  if (m_accurate_timing)
+    EmitICacheCheck();
 
   const CodeBlockInstruction* cbi = m_block_start;
   while (cbi != m_block_end)
@@ -36,8 +43,10 @@ bool CodeGenerator::CompileBlock(const CodeBlock* block, CodeBlock::HostCodePoin
     Log_DebugPrintf("Compiling instruction '%s'", disasm.GetCharArray());
 #endif
 
+    m_register_cache.SetLiveGuestRegisters(m_live_guest_registers[cbi - m_block_start]);
     if (!CompileInstruction(*cbi))
     {
+      m_register_cache.SetLiveGuestRegisters(UINT32_C(0xFFFFFFFF));
       m_block_end = nullptr;
       m_block_start = nullptr;
       m_block = nullptr;
@@ -47,7 +56,18 @@ bool CodeGenerator::CompileBlock(const CodeBlock* block, CodeBlock::HostCodePoin
     cbi++;
   }
 
+  // Blocks which don't end with a branch continue at the next instruction, unless they always raise an exception.
+  const CodeBlockInstruction& last_cbi = *(m_block_end - 1);
+  if (m_static_exit_pc_count == 0 && !m_indirect_exit && !last_cbi.is_branch_instruction &&
+      !last_cbi.is_branch_delay_slot && !IsExitBlockInstruction(last_cbi.instruction))
+  {
+    AddStaticBlockExit(last_cbi.pc + 4);
+  }
+
+  m_register_cache.SetLiveGuestRegisters(UINT32_C(0xFFFFFFFF));
   BlockEpilogue();
+  if (block->idle_loop)
+    EmitIdleLoopCheck();
   EmitEndBlock();
 
   FinalizeBlock(out_host_code, out_host_code_size);
@@ -62,8 +82,114 @@ bool CodeGenerator::CompileBlock(const CodeBlock* block, CodeBlock::HostCodePoin
   return true;
 }
 
+void CodeGenerator::AddStaticBlockExit(u32 pc)
+{
+  DebugAssert(m_static_exit_pc_count < m_static_exit_pcs.size());
+  m_static_exit_pcs[m_static_exit_pc_count++] = pc;
+}
+
+void CodeGenerator::EmitIdleLoopCheck()
+{
+  // Only when the loop is going around again, everything else goes through the regular exits.
+  LabelType not_looping;
+  Value pc = m_register_cache.AllocateScratch(RegSize_32);
+  EmitLoadCPUStructField(pc.host_reg, RegSize_32, offsetof(Core, m_regs.pc));
+  EmitConditionalBranch(Condition::NotEqual, false, pc.host_reg, Value::FromConstantU32(m_block->GetPC()),
+                        &not_looping);
+  pc.ReleaseAndClear();
+
+  EmitFunctionCall(nullptr, &Thunks::SkipIdleLoop, Value::FromConstantU64(reinterpret_cast<uintptr_t>(m_code_cache)));
+  EmitBindLabel(&not_looping);
+}
+
+void CodeGenerator::EmitICacheCheck()
+{
+  // Uncached blocks always take the same time to fetch, so it's added along with the instruction cycles.
+  if (!Core::IsCachedAddress(m_block->GetPC()))
+  {
+    m_delayed_cycles_add += m_block->uncached_fetch_ticks;
+    return;
+  }
+
+  // The line checks can be too long for a short jump over them, so the uncommon disabled case goes to far code.
+  void* icache_disabled = GetCurrentFarCodePointer();
+  LabelType icache_enabled;
+  Value temp = m_register_cache.AllocateScratch(RegSize_32);
+  EmitLoadCPUStructField(temp.host_reg, RegSize_32, offsetof(Core, m_cache_control));
+  EmitTest(temp.host_reg, Value::FromConstantU32(UINT32_C(1) << CACHE_CONTROL_ICACHE_ENABLE_BIT));
+  EmitConditionalBranch(Condition::NotZero, false, &icache_enabled);
+  EmitBranch(icache_disabled);
+  EmitBindLabel(&icache_enabled);
+
+  u32 line_pc = m_block->GetPC();
+  for (u32 i = 0; i < m_block->icache_line_count; i++)
+  {
+    const u32 tag_offset = offsetof(Core, m_icache_tags) + Core::GetICacheLine(line_pc) * sizeof(u32);
+    const u32 tag = Core::GetICacheTag(line_pc);
+    const TickCount fill_ticks = (i == 0) ? m_block->icache_first_line_fill_ticks : m_block->icache_line_fill_ticks;
+
+    LabelType hit;
+    EmitLoadCPUStructField(temp.host_reg, RegSize_32, tag_offset);
+    EmitConditionalBranch(Condition::Equal, false, temp.host_reg, Value::FromConstantU32(tag), &hit);
+    EmitStoreCPUStructField(tag_offset, Value::FromConstantU32(tag));
+    EmitAddCPUStructField(offsetof(Core, m_pending_ticks), Value::FromConstantU32(static_cast<u32>(fill_ticks)));
+    EmitBindLabel(&hit);
+
+    line_pc = (line_pc & ~(ICACHE_LINE_SIZE - 1u)) + ICACHE_LINE_SIZE;
+  }
+
+  temp.ReleaseAndClear();
+
+  void* done = GetCurrentNearCodePointer();
+  SwitchToFarCode();
+  DebugAssert(GetCurrentFarCodePointer() == icache_disabled);
+  EmitAddCPUStructField(offsetof(Core, m_pending_ticks),
+                        Value::FromConstantU32(static_cast<u32>(m_block->uncached_fetch_ticks)));
+  EmitBranch(done);
+  SwitchToNearCode();
+}
+
+void CodeGenerator::ComputeLiveGuestRegisters()
+{
+  // Walk backwards, tracking which registers are read before they're next written. Registers aren't needed by the
+  // block after it ends, since anything dirty is written back. Only ALU instructions are known to overwrite their
+  // destination, which errs on the side of keeping registers.
+  m_live_guest_registers.resize(m_block->instructions.size());
+
+  u32 live_regs = 0;
+  for (size_t i = m_block->instructions.size(); i > 0; i--)
+  {
+    const CodeBlockInstruction& cbi = m_block->instructions[i - 1];
+    m_live_guest_registers[i - 1] = live_regs;
+    if (cbi.is_dead)
+      continue;
+
+    u32 read_mask;
+    Reg write_reg;
+    if (GetALUInstructionRegisterUsage(cbi.instruction, &read_mask, &write_reg))
+    {
+      if (write_reg != Reg::zero)
+        live_regs &= ~(UINT32_C(1) << static_cast<u8>(write_reg));
+    }
+    else
+    {
+      read_mask = GetInstructionReadRegisterMask(cbi.instruction);
+    }
+
+    live_regs |= read_mask;
+  }
+}
+
 bool CodeGenerator::CompileInstruction(const CodeBlockInstruction& cbi)
 {
+  if (cbi.is_dead)
+  {
+    // The result is overwritten before it's read, so only the PC and cycles need updating.
+    InstructionPrologue(cbi, 1);
+    InstructionEpilogue(cbi);
+    return true;
+  }
+
   bool result;
   switch (cbi.instruction.op)
   {
@@ -924,6 +1050,16 @@ void CodeGenerator::InstructionEpilogue(const CodeBlockInstruction& cbi)
     m_next_load_delay_dirty = false;
     m_load_delay_dirty = true;
   }
+
+  m_register_cache.ReleaseDeadGuestRegisters();
+}
+
+void CodeGenerator::WriteLoadResult(const CodeBlockInstruction& cbi, Reg reg, Value&& value)
+{
+  if (cbi.skip_load_delay)
+    m_register_cache.WriteGuestRegister(reg, std::move(value));
+  else
+    m_register_cache.WriteGuestRegisterDelayed(reg, std::move(value));
 }
 
 void CodeGenerator::AddPendingCycles(bool commit)
@@ -937,6 +1073,48 @@ void CodeGenerator::AddPendingCycles(bool commit)
     m_delayed_cycles_add = 0;
 }
 
+bool CodeGenerator::CanUseFastmemForAddress(const Value& address, RegSize size) const
+{
+  if (!m_fastmem_enabled)
+    return false;
+
+  if (!address.IsConstant())
+    return true;
+
+  // Constant addresses outside of RAM would always fault, and misaligned ones need to raise an exception.
+  return IsConstantRAMAddress(address, size);
+}
+
+static bool IsAlignedConstantAddress(VirtualMemoryAddress vaddr, RegSize size)
+{
+  const u32 alignment_mask = (size == RegSize_32) ? 3u : ((size == RegSize_16) ? 1u : 0u);
+  return (vaddr & alignment_mask) == 0;
+}
+
+bool CodeGenerator::IsConstantScratchpadAddress(const Value& address, RegSize size)
+{
+  if (!address.IsConstant())
+    return false;
+
+  // KSEG1 is uncached, so the scratchpad isn't visible there.
+  const VirtualMemoryAddress vaddr = static_cast<VirtualMemoryAddress>(address.constant_value);
+  const u32 segment = vaddr >> 29;
+  return (segment == 0x00 || segment == 0x04) &&
+         ((vaddr & PHYSICAL_MEMORY_ADDRESS_MASK) & Core::DCACHE_LOCATION_MASK) == Core::DCACHE_LOCATION &&
+         IsAlignedConstantAddress(vaddr, size);
+}
+
+bool CodeGenerator::IsConstantRAMAddress(const Value& address, RegSize size)
+{
+  if (!address.IsConstant())
+    return false;
+
+  const VirtualMemoryAddress vaddr = static_cast<VirtualMemoryAddress>(address.constant_value);
+  const u32 segment = vaddr >> 29;
+  return (segment == 0x00 || segment == 0x04 || segment == 0x05) &&
+         Bus::IsRAMAddress(vaddr & PHYSICAL_MEMORY_ADDRESS_MASK) && IsAlignedConstantAddress(vaddr, size);
+}
+
 void CodeGenerator::SetCurrentInstructionPC(const CodeBlockInstruction& cbi)
 {
   EmitStoreCPUStructField(offsetof(Core, m_current_instruction_pc), Value::FromConstantU32(cbi.pc));
@@ -1133,7 +1311,7 @@ bool CodeGenerator::Compile_Load(const CodeBlockInstruction& cbi)
       break;
   }
 
-  m_register_cache.WriteGuestRegisterDelayed(cbi.instruction.i.rt, std::move(result));
+  WriteLoadResult(cbi, cbi.instruction.i.rt, std::move(result));
 
   InstructionEpilogue(cbi);
   return true;
@@ -1329,7 +1507,23 @@ bool CodeGenerator::Compile_Branch(const CodeBlockInstruction& cbi)
 {
   InstructionPrologue(cbi, 1);
 
-  auto DoBranch = [this](Condition condition, const Value& lhs, const Value& rhs, Reg lr_reg, Value&& branch_target) {
+  auto DoBranch = [this, &cbi](Condition condition, const Value& lhs, const Value& rhs, Reg lr_reg,
+                               Value&& branch_target) {
+    // The branch before the last delay slot decides where the block exits to.
+    if ((&cbi + 2) == m_block_end)
+    {
+      if (branch_target.IsConstant())
+      {
+        AddStaticBlockExit(static_cast<u32>(branch_target.constant_value));
+        if (condition != Condition::Always)
+          AddStaticBlockExit(cbi.pc + 8);
+      }
+      else
+      {
+        m_indirect_exit = true;
+      }
+    }
+
     // ensure the lr register is flushed, since we want it's correct value after the branch
     // we don't want to invalidate it yet because of "jalr r0, r0", branch_target could be the lr_reg.
     if (lr_reg != Reg::count && lr_reg != Reg::zero)
@@ -1611,7 +1805,7 @@ bool CodeGenerator::Compile_cop0(const CodeBlockInstruction& cbi)
           // coprocessor loads are load-delayed
           Value value = m_register_cache.AllocateScratch(RegSize_32);
           EmitLoadCPUStructField(value.host_reg, value.size, offset);
-          m_register_cache.WriteGuestRegisterDelayed(cbi.instruction.r.rt, std::move(value));
+          WriteLoadResult(cbi, cbi.instruction.r.rt, std::move(value));
         }
         else
         {
@@ -1626,6 +1820,10 @@ bool CodeGenerator::Compile_cop0(const CodeBlockInstruction& cbi)
             }
 
             EmitStoreCPUStructField(offset, value);
+
+            // the fastmem views need to be write-protected, and the i-cache flushed, when the cache is isolated
+            if (reg == Cop0Reg::SR && (m_fastmem_enabled || m_accurate_timing))
+              EmitFunctionCall(nullptr, &Thunks::UpdateCacheIsolation, m_register_cache.GetCPUPtr());
           }
         }
 
@@ -1701,6 +1899,33 @@ bool CodeGenerator::Compile_cop0(const CodeBlockInstruction& cbi)
   }
 }
 
+bool CodeGenerator::IsGTEFlagOverwrittenLater(const CodeBlockInstruction& cbi) const
+{
+  for (const CodeBlockInstruction* next = &cbi + 1; next != m_block_end; next++)
+  {
+    // an exception would leave the block with FLAG visible to the handler
+    if (next->can_trap)
+      return false;
+
+    const Instruction& instruction = next->instruction;
+    if (instruction.op != InstructionOp::cop2)
+      continue;
+
+    // every command clears FLAG before executing
+    if (!instruction.cop.IsCommonInstruction())
+      return true;
+
+    const CopCommonInstruction common_op = instruction.cop.CommonOp();
+    if ((common_op == CopCommonInstruction::cfcn || common_op == CopCommonInstruction::ctcn) &&
+        static_cast<u32>(instruction.r.rd.GetValue()) == 31)
+    {
+      return false;
+    }
+  }
+
+  return false;
+}
+
 Value CodeGenerator::DoGTERegisterRead(u32 index)
 {
   Value value = m_register_cache.AllocateScratch(RegSize_32);
@@ -1723,7 +1948,7 @@ Value CodeGenerator::DoGTERegisterRead(u32 index)
 
     default:
     {
-      EmitLoadCPUStructField(value.host_reg, RegSize_32, offsetof(Core, m_cop2.m_regs.r32[index]));
+      EmitLoadCPUStructField(value.host_reg, RegSize_32, offsetof(Core, m_cop2.m_regs.r32[0]) + (index * sizeof(u32)));
     }
     break;
   }
@@ -1752,7 +1977,7 @@ void CodeGenerator::DoGTERegisterWrite(u32 index, const Value& value)
     {
       // sign-extend z component of vector registers
       Value temp = ConvertValueSize(value.ViewAsSize(RegSize_16), RegSize_32, true);
-      EmitStoreCPUStructField(offsetof(Core, m_cop2.m_regs.r32[index]), temp);
+      EmitStoreCPUStructField(offsetof(Core, m_cop2.m_regs.r32[0]) + (index * sizeof(u32)), temp);
       return;
     }
     break;
@@ -1765,7 +1990,7 @@ void CodeGenerator::DoGTERegisterWrite(u32 index, const Value& value)
     {
       // zero-extend unsigned values
       Value temp = ConvertValueSize(value.ViewAsSize(RegSize_16), RegSize_32, false);
-      EmitStoreCPUStructField(offsetof(Core, m_cop2.m_regs.r32[index]), temp);
+      EmitStoreCPUStructField(offsetof(Core, m_cop2.m_regs.r32[0]) + (index * sizeof(u32)), temp);
       return;
     }
     break;
@@ -1808,7 +2033,7 @@ void CodeGenerator::DoGTERegisterWrite(u32 index, const Value& value)
     default:
     {
       // written as-is, 2x16 or 1x32 bits
-      EmitStoreCPUStructField(offsetof(Core, m_cop2.m_regs.r32[index]), value);
+      EmitStoreCPUStructField(offsetof(Core, m_cop2.m_regs.r32[0]) + (index * sizeof(u32)), value);
       return;
     }
   }
@@ -1851,7 +2076,7 @@ bool CodeGenerator::Compile_cop2(const CodeBlockInstruction& cbi)
                         ((cbi.instruction.cop.CommonOp() == CopCommonInstruction::cfcn) ? 32 : 0);
 
         InstructionPrologue(cbi, 1);
-        m_register_cache.WriteGuestRegisterDelayed(cbi.instruction.r.rt, DoGTERegisterRead(reg));
+        WriteLoadResult(cbi, cbi.instruction.r.rt, DoGTERegisterRead(reg));
         InstructionEpilogue(cbi);
         return true;
       }
@@ -1874,11 +2099,25 @@ bool CodeGenerator::Compile_cop2(const CodeBlockInstruction& cbi)
   }
   else
   {
-    // forward everything to the GTE.
     InstructionPrologue(cbi, 1);
 
-    Value instruction_bits = Value::FromConstantU32(cbi.instruction.bits & GTE::Instruction::REQUIRED_BITS_MASK);
-    EmitFunctionCall(nullptr, &Thunks::ExecuteGTEInstruction, m_register_cache.GetCPUPtr(), instruction_bits);
+    const GTE::Instruction gte_instruction{cbi.instruction.bits & GTE::Instruction::REQUIRED_BITS_MASK};
+    if (!EmitInlineGTEInstruction(gte_instruction, !IsGTEFlagOverwrittenLater(cbi)))
+    {
+      // call the command's handler directly, it's known at compile time
+      Value instruction_bits = Value::FromConstantU32(gte_instruction.bits);
+      const GTE::Core::InstructionHandler handler = GTE::Core::GetInstructionHandler(gte_instruction);
+      if (handler)
+      {
+        Value gte_ptr = AddValues(m_register_cache.GetCPUPtr(),
+                                  Value::FromConstant(offsetof(Core, m_cop2), HostPointerSize), false);
+        EmitFunctionCall(nullptr, handler, gte_ptr, instruction_bits);
+      }
+      else
+      {
+        EmitFunctionCall(nullptr, &Thunks::ExecuteGTEInstruction, m_register_cache.GetCPUPtr(), instruction_bits);
+      }
+    }
 
     InstructionEpilogue(cbi);
     return true;
@@ -2,6 +2,7 @@
 #include <array>
 #include <initializer_list>
 #include <utility>
+#include <vector>
 
 #include "common/jit_code_buffer.h"
 
@@ -10,21 +11,47 @@
 #include "cpu_recompiler_thunks.h"
 #include "cpu_recompiler_types.h"
 #include "cpu_types.h"
+#include "gte_types.h"
 
 namespace CPU::Recompiler {
 
 class CodeGenerator
 {
 public:
-  CodeGenerator(Core* cpu, JitCodeBuffer* code_buffer, const ASMFunctions& asm_functions);
+  CodeGenerator(Core* cpu, CodeCache* code_cache, JitCodeBuffer* code_buffer, const ASMFunctions& asm_functions,
+                bool fastmem, bool accurate_timing);
   ~CodeGenerator();
 
   static u32 CalculateRegisterOffset(Reg reg);
   static const char* GetHostRegName(HostReg reg, RegSize size = HostPointerSize);
   static void AlignCodeBuffer(JitCodeBuffer* code_buffer);
 
+  /// Replaces a faulting fastmem access with a jump to its slow path.
+  static void BackpatchLoadStore(const LoadStoreBackpatchInfo& lbi);
+
+#ifdef RECOMPILER_BLOCK_LINKING
+  /// Points a block exit at the next block's host code, or back at its link stub.
+  static void BackpatchBlockExit(const BlockExitInfo& bei, const void* host_code);
+
+  /// Replaces the PC which an indirect block exit compares with, when it's linked to a new target.
+  static void BackpatchIndirectBlockExitTarget(const BlockExitInfo& bei, u32 target_pc);
+
+  /// Replaces where an indirect block exit goes when the PC doesn't match its target.
+  static void BackpatchIndirectBlockExitMiss(const BlockExitInfo& bei, const void* host_code);
+#endif
+
   bool CompileBlock(const CodeBlock* block, CodeBlock::HostCodePointer* out_host_code, u32* out_host_code_size);
 
+  /// Fastmem accesses in the last compiled block, which need to be registered with the fault handler.
+  const std::vector<LoadStoreBackpatchInfo>& GetLoadStoreBackpatchInfo() const { return m_loadstore_backpatch_info; }
+
+  /// Exits of the last compiled block which can be linked to the next block.
+  const std::vector<BlockExitInfo>& GetBlockExitInfo() const { return m_block_exit_info; }
+
+  /// Slow path code of the last compiled block, which has to be freed along with the block.
+  void* GetFarCode() const { return m_far_code; }
+  u32 GetFarCodeSize() const { return m_far_code_size; }
+
   //////////////////////////////////////////////////////////////////////////
   // Code Generation
   //////////////////////////////////////////////////////////////////////////
@@ -65,7 +92,18 @@ public:
 
   // Automatically generates an exception handler.
   Value EmitLoadGuestMemory(const CodeBlockInstruction& cbi, const Value& address, RegSize size);
+  void EmitLoadGuestMemoryFastmem(const CodeBlockInstruction& cbi, const Value& address, RegSize size, Value& result);
+  void EmitLoadGuestMemorySlowmem(const CodeBlockInstruction& cbi, const Value& address, RegSize size, Value& result,
+                                  bool in_far_code);
   void EmitStoreGuestMemory(const CodeBlockInstruction& cbi, const Value& address, const Value& value);
+  void EmitStoreGuestMemoryFastmem(const CodeBlockInstruction& cbi, const Value& address, const Value& value);
+  void EmitStoreGuestMemorySlowmem(const CodeBlockInstruction& cbi, const Value& address, const Value& value,
+                                   Value& result, bool in_far_code);
+
+  // Accesses with addresses known at compile time, which don't need the thunks.
+  void EmitLoadScratchpad(const Value& address, RegSize size, Value& result);
+  void EmitStoreScratchpad(const Value& address, const Value& value);
+  void EmitLoadGuestRAMDirect(const Value& address, RegSize size, Value& result);
 
   // Unconditional branch to pointer. May allocate a scratch register.
   void EmitBranch(const void* address, bool allow_scratch = true);
@@ -120,6 +158,9 @@ public:
     EmitFunctionCallPtr(return_value, reinterpret_cast<const void**>(ptr), arg1, arg2, arg3, arg4);
   }
 
+  /// Emits a GTE command inline, if the backend supports it. FLAG is only written if update_flags is set.
+  bool EmitInlineGTEInstruction(GTE::Instruction inst, bool update_flags);
+
   // Host register saving.
   void EmitPushHostReg(HostReg reg, u32 position);
   void EmitPopHostReg(HostReg reg, u32 position);
@@ -151,6 +192,18 @@ private:
 
   void SwitchToFarCode();
   void SwitchToNearCode();
+
+  /// Records a PC which the block can end at, so an exit for it is generated.
+  void AddStaticBlockExit(u32 pc);
+
+  /// Calls the code cache to skip ahead to the next event when an idle loop is about to go around again.
+  void EmitIdleLoopCheck();
+
+  /// Adds the block's instruction fetch wait states, looking up the i-cache lines it covers if it's cached.
+  void EmitICacheCheck();
+
+  /// Emits the far code which an unlinked block exit jumps to.
+  void EmitBlockExitLinkStub(void* host_jump);
   void* GetCurrentCodePointer() const;
   void* GetCurrentNearCodePointer() const;
   void* GetCurrentFarCodePointer() const;
@@ -166,12 +219,28 @@ private:
   void SetCurrentInstructionPC(const CodeBlockInstruction& cbi);
   void AddPendingCycles(bool commit);
 
+  /// Writes the result of a load-delayed instruction, skipping the delay if the block doesn't observe it.
+  void WriteLoadResult(const CodeBlockInstruction& cbi, Reg reg, Value&& value);
+
+  /// Returns true if the access can use the fastmem region, i.e. the address is not a known non-RAM constant.
+  bool CanUseFastmemForAddress(const Value& address, RegSize size) const;
+
+  /// Returns true if the address is a constant, aligned, and falls within the scratchpad or RAM respectively.
+  static bool IsConstantScratchpadAddress(const Value& address, RegSize size);
+  static bool IsConstantRAMAddress(const Value& address, RegSize size);
+
+  /// Returns true if FLAG is cleared by a later GTE command in the block, before anything can read it.
+  bool IsGTEFlagOverwrittenLater(const CodeBlockInstruction& cbi) const;
+
   Value DoGTERegisterRead(u32 index);
   void DoGTERegisterWrite(u32 index, const Value& value);
 
   //////////////////////////////////////////////////////////////////////////
   // Instruction Code Generators
   //////////////////////////////////////////////////////////////////////////
+  /// Fills m_live_guest_registers with the GPRs which each instruction in the block leaves live.
+  void ComputeLiveGuestRegisters();
+
   bool CompileInstruction(const CodeBlockInstruction& cbi);
   bool Compile_Fallback(const CodeBlockInstruction& cbi);
   bool Compile_Bitwise(const CodeBlockInstruction& cbi);
@@ -189,6 +258,7 @@ private:
   bool Compile_cop2(const CodeBlockInstruction& cbi);
 
   Core* m_cpu;
+  CodeCache* m_code_cache;
   JitCodeBuffer* m_code_buffer;
   const ASMFunctions& m_asm_functions;
   const CodeBlock* m_block = nullptr;
@@ -201,6 +271,21 @@ private:
 
   TickCount m_delayed_cycles_add = 0;
 
+  bool m_fastmem_enabled = false;
+  bool m_accurate_timing = false;
+  std::vector<LoadStoreBackpatchInfo> m_loadstore_backpatch_info;
+  std::vector<u32> m_live_guest_registers;
+
+  // Where the block can go when it ends, if it's known at compile time. Blocks ending in an indirect jump instead
+  // have an exit which is linked to its last target.
+  std::array<u32, 2> m_static_exit_pcs = {};
+  u32 m_static_exit_pc_count = 0;
+  bool m_indirect_exit = false;
+  std::vector<BlockExitInfo> m_block_exit_info;
+
+  void* m_far_code = nullptr;
+  u32 m_far_code_size = 0;
+
   // whether various flags need to be reset.
   bool m_current_instruction_in_branch_delay_slot_dirty = false;
   bool m_branch_was_taken_dirty = false;
@@ -9,6 +9,7 @@ namespace a64 = vixl::aarch64;
 namespace CPU::Recompiler {
 
 constexpr HostReg RCPUPTR = 19;
+constexpr HostReg RMEMBASEPTR = 20;
 constexpr HostReg RRETURN = 0;
 constexpr HostReg RARG1 = 0;
 constexpr HostReg RARG2 = 1;
@@ -70,13 +71,20 @@ static const a64::XRegister GetCPUPtrReg()
   return GetHostReg64(RCPUPTR);
 }
 
-CodeGenerator::CodeGenerator(Core* cpu, JitCodeBuffer* code_buffer, const ASMFunctions& asm_functions)
-  : m_cpu(cpu), m_code_buffer(code_buffer), m_asm_functions(asm_functions), m_register_cache(*this),
+static const a64::XRegister GetFastmemBasePtrReg()
+{
+  return GetHostReg64(RMEMBASEPTR);
+}
+
+CodeGenerator::CodeGenerator(Core* cpu, CodeCache* code_cache, JitCodeBuffer* code_buffer,
+                             const ASMFunctions& asm_functions, bool fastmem, bool accurate_timing)
+  : m_cpu(cpu), m_code_cache(code_cache), m_code_buffer(code_buffer), m_asm_functions(asm_functions),
+    m_register_cache(*this),
     m_near_emitter(static_cast<vixl::byte*>(code_buffer->GetFreeCodePointer()), code_buffer->GetFreeCodeSpace(),
                    a64::PositionDependentCode),
     m_far_emitter(static_cast<vixl::byte*>(code_buffer->GetFreeFarCodePointer()), code_buffer->GetFreeFarCodeSpace(),
                   a64::PositionDependentCode),
-    m_emit(&m_near_emitter)
+    m_emit(&m_near_emitter), m_fastmem_enabled(fastmem), m_accurate_timing(accurate_timing)
 {
   // remove the temporaries from vixl's list to prevent it from using them.
   // eventually we won't use the macro assembler and this won't be a problem...
@@ -172,11 +180,23 @@ void CodeGenerator::EmitBeginBlock()
   const bool cpu_reg_allocated = m_register_cache.AllocateHostReg(RCPUPTR);
   DebugAssert(cpu_reg_allocated);
   m_emit->Mov(GetCPUPtrReg(), GetHostReg64(RARG1));
+
+  // Load the fastmem base, it can't change within a block.
+  if (m_fastmem_enabled)
+  {
+    const bool fastmem_reg_allocated = m_register_cache.AllocateHostReg(RMEMBASEPTR);
+    DebugAssert(fastmem_reg_allocated);
+    UNREFERENCED_VARIABLE(fastmem_reg_allocated);
+    m_emit->Ldr(GetFastmemBasePtrReg(), a64::MemOperand(GetCPUPtrReg(), offsetof(Core, m_fastmem_base)));
+  }
 }
 
 void CodeGenerator::EmitEndBlock()
 {
   m_register_cache.FreeHostReg(RCPUPTR);
+  if (m_fastmem_enabled)
+    m_register_cache.FreeHostReg(RMEMBASEPTR);
+
   m_register_cache.PopCalleeSavedRegisters(true);
 
   m_emit->Add(a64::sp, a64::sp, FUNCTION_STACK_SIZE);
@@ -227,6 +247,8 @@ void CodeGenerator::FinalizeBlock(CodeBlock::HostCodePointer* out_host_code, u32
 
   *out_host_code = reinterpret_cast<CodeBlock::HostCodePointer>(m_code_buffer->GetFreeCodePointer());
   *out_host_code_size = m_near_emitter.GetSizeOfCodeGenerated();
+  m_far_code = m_code_buffer->GetFreeFarCodePointer();
+  m_far_code_size = static_cast<u32>(m_far_emitter.GetSizeOfCodeGenerated());
 
   m_code_buffer->CommitCode(m_near_emitter.GetSizeOfCodeGenerated());
   m_code_buffer->CommitFarCode(m_far_emitter.GetSizeOfCodeGenerated());
@@ -1212,11 +1234,162 @@ void CodeGenerator::EmitAddCPUStructField(u32 offset, const Value& value)
 
 Value CodeGenerator::EmitLoadGuestMemory(const CodeBlockInstruction& cbi, const Value& address, RegSize size)
 {
-  const Value pc = Value::FromConstantU32(cbi.pc);
-  AddPendingCycles(true);
-
   // We need to use the full 64 bits here since we test the sign bit result.
   Value result = m_register_cache.AllocateScratch(RegSize_64);
+  if (IsConstantScratchpadAddress(address, size))
+  {
+    EmitLoadScratchpad(address, size, result);
+  }
+  else if (IsConstantRAMAddress(address, size))
+  {
+    EmitLoadGuestRAMDirect(address, size, result);
+  }
+  else if (CanUseFastmemForAddress(address, size))
+  {
+    EmitLoadGuestMemoryFastmem(cbi, address, size, result);
+  }
+  else
+  {
+    AddPendingCycles(true);
+    EmitLoadGuestMemorySlowmem(cbi, address, size, result, false);
+  }
+
+  // Downcast to ignore upper 56/48/32 bits. This should be a noop.
+  switch (size)
+  {
+    case RegSize_8:
+      ConvertValueSizeInPlace(&result, RegSize_8, false);
+      break;
+
+    case RegSize_16:
+      ConvertValueSizeInPlace(&result, RegSize_16, false);
+      break;
+
+    case RegSize_32:
+      ConvertValueSizeInPlace(&result, RegSize_32, false);
+      break;
+
+    default:
+      UnreachableCode();
+      break;
+  }
+
+  return result;
+}
+
+void CodeGenerator::EmitLoadGuestRAMDirect(const Value& address, RegSize size, Value& result)
+{
+  // RAM reads can't fault or have side effects, so a known address can be read from the backing memory directly.
+  const u8* ram_ptr = m_cpu->GetBus()->GetRAMPointer(static_cast<u32>(address.constant_value));
+  m_emit->Mov(GetHostReg64(result.host_reg), reinterpret_cast<uintptr_t>(ram_ptr));
+  switch (size)
+  {
+    case RegSize_8:
+      m_emit->Ldrb(GetHostReg32(result.host_reg), a64::MemOperand(GetHostReg64(result.host_reg)));
+      break;
+
+    case RegSize_16:
+      m_emit->Ldrh(GetHostReg32(result.host_reg), a64::MemOperand(GetHostReg64(result.host_reg)));
+      break;
+
+    case RegSize_32:
+      m_emit->Ldr(GetHostReg32(result.host_reg), a64::MemOperand(GetHostReg64(result.host_reg)));
+      break;
+
+    default:
+      UnreachableCode();
+      break;
+  }
+
+  m_delayed_cycles_add += Bus::RAM_READ_TICKS;
+}
+
+void CodeGenerator::EmitLoadGuestMemoryFastmem(const CodeBlockInstruction& cbi, const Value& address, RegSize size,
+                                               Value& result)
+{
+  // The slow path returns to the block, so it can't be the first user of a callee-saved register. Touch the scratch
+  // register which function calls will use here, so it's saved in near code.
+  m_register_cache.AllocateScratch(RegSize_64).ReleaseAndClear();
+
+  // The result register doubles as the address for constants, since it's not needed until the load.
+  HostReg address_reg;
+  if (address.IsConstant())
+  {
+    m_emit->Mov(GetHostReg32(result.host_reg), static_cast<u32>(address.constant_value));
+    address_reg = result.host_reg;
+  }
+  else
+  {
+    address_reg = address.host_reg;
+
+    // Misaligned accesses raise an exception, so send those through the slow path.
+    if (size != RegSize_8)
+    {
+      a64::Label aligned;
+      m_emit->Tst(GetHostReg32(address_reg), (size == RegSize_16) ? 1 : 3);
+      m_emit->B(a64::eq, &aligned);
+      EmitBranch(GetCurrentFarCodePointer(), false);
+      m_emit->Bind(&aligned);
+    }
+  }
+
+  LoadStoreBackpatchInfo bpi;
+  bpi.host_pc = GetCurrentNearCodePointer();
+  bpi.guest_pc = cbi.pc;
+
+  const a64::MemOperand fastmem_address(GetFastmemBasePtrReg(), GetHostReg32(address_reg), a64::UXTW);
+  switch (size)
+  {
+    case RegSize_8:
+      m_emit->Ldrb(GetHostReg32(result.host_reg), fastmem_address);
+      break;
+
+    case RegSize_16:
+      m_emit->Ldrh(GetHostReg32(result.host_reg), fastmem_address);
+      break;
+
+    case RegSize_32:
+      m_emit->Ldr(GetHostReg32(result.host_reg), fastmem_address);
+      break;
+
+    default:
+      UnreachableCode();
+      break;
+  }
+
+  bpi.host_code_size = static_cast<u32>(static_cast<u8*>(GetCurrentNearCodePointer()) - static_cast<u8*>(bpi.host_pc));
+
+  // The cycles for the access are only added on the fast path, the thunk adds its own.
+  const TickCount pending_cycles = m_delayed_cycles_add;
+  m_delayed_cycles_add += Bus::RAM_READ_TICKS;
+
+  // slow path, taken for misaligned or non-RAM accesses, and after backpatching
+  m_register_cache.PushState();
+  SwitchToFarCode();
+  bpi.host_slowmem_pc = GetCurrentFarCodePointer();
+
+  if (pending_cycles > 0)
+    EmitAddCPUStructField(offsetof(Core, m_pending_ticks), Value::FromConstantU32(static_cast<u32>(pending_cycles)));
+
+  m_delayed_cycles_add = 0;
+  EmitLoadGuestMemorySlowmem(cbi, address, size, result, true);
+  m_delayed_cycles_add = pending_cycles + Bus::RAM_READ_TICKS;
+
+  // undo what the near code will add later
+  EmitAddCPUStructField(offsetof(Core, m_pending_ticks),
+                        Value::FromConstantU32(static_cast<u32>(-m_delayed_cycles_add)));
+
+  EmitBranch(GetCurrentNearCodePointer(), false);
+  SwitchToNearCode();
+  m_register_cache.PopState();
+
+  m_loadstore_backpatch_info.push_back(bpi);
+}
+
+void CodeGenerator::EmitLoadGuestMemorySlowmem(const CodeBlockInstruction& cbi, const Value& address, RegSize size,
+                                               Value& result, bool in_far_code)
+{
+  const Value pc = Value::FromConstantU32(cbi.pc);
 
   // NOTE: This can leave junk in the upper bits
   switch (size)
@@ -1242,29 +1415,96 @@ Value CodeGenerator::EmitLoadGuestMemory(const CodeBlockInstruction& cbi, const
 
   a64::Label load_okay;
   m_emit->Tbz(GetHostReg64(result.host_reg), 63, &load_okay);
-  EmitBranch(GetCurrentFarCodePointer());
-  m_emit->Bind(&load_okay);
 
-  // load exception path
-  SwitchToFarCode();
-  EmitExceptionExit();
-  SwitchToNearCode();
+  if (in_far_code)
+  {
+    // we're already in far code, so the exception path can go inline
+    EmitExceptionExit();
+  }
+  else
+  {
+    EmitBranch(GetCurrentFarCodePointer());
+
+    // load exception path
+    SwitchToFarCode();
+    EmitExceptionExit();
+    SwitchToNearCode();
+  }
+
+  m_emit->Bind(&load_okay);
 
   m_register_cache.PopState();
+}
 
-  // Downcast to ignore upper 56/48/32 bits. This should be a noop.
-  switch (size)
+void CodeGenerator::EmitStoreGuestMemory(const CodeBlockInstruction& cbi, const Value& address, const Value& value)
+{
+  // RAM stores still have to go through the thunk or fastmem, so code invalidation is triggered.
+  if (IsConstantScratchpadAddress(address, value.size))
+  {
+    EmitStoreScratchpad(address, value);
+  }
+  else if (CanUseFastmemForAddress(address, value.size))
+  {
+    EmitStoreGuestMemoryFastmem(cbi, address, value);
+  }
+  else
+  {
+    AddPendingCycles(true);
+    Value result = m_register_cache.AllocateScratch(RegSize_8);
+    EmitStoreGuestMemorySlowmem(cbi, address, value, result, false);
+  }
+}
+
+void CodeGenerator::EmitStoreGuestMemoryFastmem(const CodeBlockInstruction& cbi, const Value& address,
+                                                const Value& value)
+{
+  // The slow path's result register has to be allocated here, since allocating in far code could save a register.
+  Value result = m_register_cache.AllocateScratch(RegSize_8);
+  m_register_cache.AllocateScratch(RegSize_64).ReleaseAndClear();
+
+  Value temp_address;
+  HostReg address_reg;
+  if (address.IsConstant())
+  {
+    temp_address = m_register_cache.AllocateScratch(RegSize_32);
+    m_emit->Mov(GetHostReg32(temp_address.host_reg), static_cast<u32>(address.constant_value));
+    address_reg = temp_address.host_reg;
+  }
+  else
+  {
+    address_reg = address.host_reg;
+
+    // Misaligned accesses raise an exception, so send those through the slow path.
+    if (value.size != RegSize_8)
+    {
+      a64::Label aligned;
+      m_emit->Tst(GetHostReg32(address_reg), (value.size == RegSize_16) ? 1 : 3);
+      m_emit->B(a64::eq, &aligned);
+      EmitBranch(GetCurrentFarCodePointer(), false);
+      m_emit->Bind(&aligned);
+    }
+  }
+
+  // zero is stored from wzr, other constants need a register
+  const Value value_in_hr = GetValueInHostRegister(value);
+
+  LoadStoreBackpatchInfo bpi;
+  bpi.host_pc = GetCurrentNearCodePointer();
+  bpi.guest_pc = cbi.pc;
+
+  const a64::MemOperand fastmem_address(GetFastmemBasePtrReg(), GetHostReg32(address_reg), a64::UXTW);
+  switch (value.size)
   {
     case RegSize_8:
-      ConvertValueSizeInPlace(&result, RegSize_8, false);
+      m_emit->Strb(GetHostReg32(value_in_hr.host_reg), fastmem_address);
       break;
 
     case RegSize_16:
-      ConvertValueSizeInPlace(&result, RegSize_16, false);
+      m_emit->Strh(GetHostReg32(value_in_hr.host_reg), fastmem_address);
       break;
 
     case RegSize_32:
-      ConvertValueSizeInPlace(&result, RegSize_32, false);
+      m_emit->Str(GetHostReg32(value_in_hr.host_reg), fastmem_address);
       break;
 
     default:
@@ -1272,15 +1512,34 @@ Value CodeGenerator::EmitLoadGuestMemory(const CodeBlockInstruction& cbi, const
       break;
   }
 
-  return result;
+  bpi.host_code_size = static_cast<u32>(static_cast<u8*>(GetCurrentNearCodePointer()) - static_cast<u8*>(bpi.host_pc));
+
+  // slow path, taken for misaligned or non-RAM accesses, and after backpatching
+  m_register_cache.PushState();
+  SwitchToFarCode();
+  bpi.host_slowmem_pc = GetCurrentFarCodePointer();
+
+  // RAM writes don't take any cycles, so the near code doesn't have to commit its cycles
+  const TickCount pending_cycles = m_delayed_cycles_add;
+  AddPendingCycles(true);
+  EmitStoreGuestMemorySlowmem(cbi, address, value, result, true);
+  if (pending_cycles > 0)
+  {
+    m_delayed_cycles_add = pending_cycles;
+    EmitAddCPUStructField(offsetof(Core, m_pending_ticks), Value::FromConstantU32(static_cast<u32>(-pending_cycles)));
+  }
+
+  EmitBranch(GetCurrentNearCodePointer(), false);
+  SwitchToNearCode();
+  m_register_cache.PopState();
+
+  m_loadstore_backpatch_info.push_back(bpi);
 }
 
-void CodeGenerator::EmitStoreGuestMemory(const CodeBlockInstruction& cbi, const Value& address, const Value& value)
+void CodeGenerator::EmitStoreGuestMemorySlowmem(const CodeBlockInstruction& cbi, const Value& address,
+                                                const Value& value, Value& result, bool in_far_code)
 {
   const Value pc = Value::FromConstantU32(cbi.pc);
-  AddPendingCycles(true);
-
-  Value result = m_register_cache.AllocateScratch(RegSize_8);
 
   switch (value.size)
   {
@@ -1305,13 +1564,23 @@ void CodeGenerator::EmitStoreGuestMemory(const CodeBlockInstruction& cbi, const
 
   a64::Label store_okay;
   m_emit->Cbnz(GetHostReg64(result.host_reg), &store_okay);
-  EmitBranch(GetCurrentFarCodePointer());
-  m_emit->Bind(&store_okay);
 
-  // store exception path
-  SwitchToFarCode();
-  EmitExceptionExit();
-  SwitchToNearCode();
+  if (in_far_code)
+  {
+    // we're already in far code, so the exception path can go inline
+    EmitExceptionExit();
+  }
+  else
+  {
+    EmitBranch(GetCurrentFarCodePointer());
+
+    // store exception path
+    SwitchToFarCode();
+    EmitExceptionExit();
+    SwitchToNearCode();
+  }
+
+  m_emit->Bind(&store_okay);
 
   m_register_cache.PopState();
 }
@@ -1637,6 +1906,30 @@ void CodeGenerator::EmitBindLabel(LabelType* label)
   m_emit->Bind(label);
 }
 
-void ASMFunctions::Generate(JitCodeBuffer* code_buffer) {}
+bool CodeGenerator::EmitInlineGTEInstruction(GTE::Instruction inst, bool update_flags)
+{
+  // Not implemented yet, the handlers are called instead.
+  return false;
+}
+
+void CodeGenerator::BackpatchLoadStore(const LoadStoreBackpatchInfo& lbi)
+{
+  Log_DevPrintf("Backpatching %p (guest PC 0x%08X) to slowmem at %p", lbi.host_pc, lbi.guest_pc, lbi.host_slowmem_pc);
+
+  // check jump distance
+  const s64 jump_distance =
+    static_cast<s64>(reinterpret_cast<intptr_t>(lbi.host_slowmem_pc) - reinterpret_cast<intptr_t>(lbi.host_pc));
+  Assert(Common::IsAligned(jump_distance, 4));
+  Assert(a64::Instruction::IsValidImmPCOffset(a64::UncondBranchType, jump_distance >> 2));
+
+  // turn it into a jump to the slowmem handler
+  a64::MacroAssembler emit(static_cast<vixl::byte*>(lbi.host_pc), lbi.host_code_size, a64::PositionDependentCode);
+  emit.b(jump_distance >> 2);
+  emit.FinalizeCode();
+
+  JitCodeBuffer::FlushInstructionCache(lbi.host_pc, lbi.host_code_size);
+}
+
+void ASMFunctions::Generate(JitCodeBuffer* code_buffer, CodeCache* code_cache) {}
 
 } // namespace CPU::Recompiler
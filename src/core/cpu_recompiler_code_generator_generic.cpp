@@ -22,4 +22,28 @@ void CodeGenerator::EmitStoreInterpreterLoadDelay(Reg reg, const Value& value)
   m_load_delay_dirty = true;
 }
 
+void CodeGenerator::EmitLoadScratchpad(const Value& address, RegSize size, Value& result)
+{
+  // Scratchpad accesses don't take any cycles.
+  const u32 offset = static_cast<u32>(address.constant_value) & Core::DCACHE_OFFSET_MASK;
+  EmitLoadCPUStructField(result.host_reg, size, offsetof(Core, m_dcache) + offset);
+}
+
+void CodeGenerator::EmitStoreScratchpad(const Value& address, const Value& value)
+{
+  const u32 offset = static_cast<u32>(address.constant_value) & Core::DCACHE_OFFSET_MASK;
+
+  // Writes are dropped while the cache is isolated.
+  LabelType skip_store;
+  {
+    Value sr = m_register_cache.AllocateScratch(RegSize_32);
+    EmitLoadCPUStructField(sr.host_reg, RegSize_32, offsetof(Core, m_cop0_regs.sr.bits));
+    EmitTest(sr.host_reg, Value::FromConstantU32(UINT32_C(1) << 16));
+    EmitConditionalBranch(Condition::NotZero, false, &skip_store);
+  }
+
+  EmitStoreCPUStructField(offsetof(Core, m_dcache) + offset, value);
+  EmitBindLabel(&skip_store);
+}
+
 } // namespace CPU::Recompiler
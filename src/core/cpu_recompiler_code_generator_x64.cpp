@@ -1,11 +1,18 @@
+#include "common/log.h"
 #include "cpu_core.h"
 #include "cpu_recompiler_code_generator.h"
 #include "cpu_recompiler_thunks.h"
+#include "xbyak_util.h"
+#include <algorithm>
+#include <cstring>
+#include <limits>
+Log_SetChannel(CPU::Recompiler);
 
 namespace CPU::Recompiler {
 
 #if defined(ABI_WIN64)
 constexpr HostReg RCPUPTR = Xbyak::Operand::RBP;
+constexpr HostReg RMEMBASEPTR = Xbyak::Operand::RBX;
 constexpr HostReg RRETURN = Xbyak::Operand::RAX;
 constexpr HostReg RARG1 = Xbyak::Operand::RCX;
 constexpr HostReg RARG2 = Xbyak::Operand::RDX;
@@ -15,6 +22,7 @@ constexpr u32 FUNCTION_CALL_SHADOW_SPACE = 32;
 constexpr u64 FUNCTION_CALL_STACK_ALIGNMENT = 16;
 #elif defined(ABI_SYSV)
 constexpr HostReg RCPUPTR = Xbyak::Operand::RBP;
+constexpr HostReg RMEMBASEPTR = Xbyak::Operand::RBX;
 constexpr HostReg RRETURN = Xbyak::Operand::RAX;
 constexpr HostReg RARG1 = Xbyak::Operand::RDI;
 constexpr HostReg RARG2 = Xbyak::Operand::RSI;
@@ -24,6 +32,13 @@ constexpr u32 FUNCTION_CALL_SHADOW_SPACE = 0;
 constexpr u64 FUNCTION_CALL_STACK_ALIGNMENT = 16;
 #endif
 
+// Size of a jmp rel32, which replaces fastmem accesses when backpatching.
+constexpr u32 BACKPATCH_JUMP_SIZE = 5;
+
+// Sizes of the jmp rel32 and jne rel32 in block exits, which are replaced when linking.
+constexpr u32 BLOCK_EXIT_JUMP_SIZE = 5;
+constexpr u32 BLOCK_EXIT_MISS_JUMP_SIZE = 6;
+
 static const Xbyak::Reg8 GetHostReg8(HostReg reg)
 {
   return Xbyak::Reg8(reg, reg >= Xbyak::Operand::SPL);
@@ -73,10 +88,17 @@ static const Xbyak::Reg64 GetCPUPtrReg()
   return GetHostReg64(RCPUPTR);
 }
 
-CodeGenerator::CodeGenerator(Core* cpu, JitCodeBuffer* code_buffer, const ASMFunctions& asm_functions)
-  : m_cpu(cpu), m_code_buffer(code_buffer), m_asm_functions(asm_functions), m_register_cache(*this),
-    m_near_emitter(code_buffer->GetFreeCodeSpace(), code_buffer->GetFreeCodePointer()),
-    m_far_emitter(code_buffer->GetFreeFarCodeSpace(), code_buffer->GetFreeFarCodePointer()), m_emit(&m_near_emitter)
+static const Xbyak::Reg64 GetFastmemBasePtrReg()
+{
+  return GetHostReg64(RMEMBASEPTR);
+}
+
+CodeGenerator::CodeGenerator(Core* cpu, CodeCache* code_cache, JitCodeBuffer* code_buffer,
+                             const ASMFunctions& asm_functions, bool fastmem, bool accurate_timing)
+  : m_cpu(cpu), m_code_cache(code_cache), m_code_buffer(code_buffer), m_asm_functions(asm_functions),
+    m_register_cache(*this), m_near_emitter(code_buffer->GetFreeCodeSpace(), code_buffer->GetFreeCodePointer()),
+    m_far_emitter(code_buffer->GetFreeFarCodeSpace(), code_buffer->GetFreeFarCodePointer()), m_emit(&m_near_emitter),
+    m_fastmem_enabled(fastmem), m_accurate_timing(accurate_timing)
 {
   InitHostRegs();
 }
@@ -131,9 +153,7 @@ void CodeGenerator::InitHostRegs()
   m_register_cache.SetCallerSavedHostRegs({Xbyak::Operand::RAX, Xbyak::Operand::RCX, Xbyak::Operand::RDX,
                                            Xbyak::Operand::R8, Xbyak::Operand::R9, Xbyak::Operand::R10,
                                            Xbyak::Operand::R11});
-  m_register_cache.SetCalleeSavedHostRegs({Xbyak::Operand::RBX, Xbyak::Operand::RBP, Xbyak::Operand::RDI,
-                                           Xbyak::Operand::RSI, Xbyak::Operand::RSP, Xbyak::Operand::R12,
-                                           Xbyak::Operand::R13, Xbyak::Operand::R14, Xbyak::Operand::R15});
+  // Callee-saved registers are saved once by the dispatcher, so blocks don't need to save them.
   m_register_cache.SetCPUPtrHostReg(RCPUPTR);
 #elif defined(ABI_SYSV)
   m_register_cache.SetHostRegAllocationOrder(
@@ -145,9 +165,7 @@ void CodeGenerator::InitHostRegs()
   m_register_cache.SetCallerSavedHostRegs({Xbyak::Operand::RAX, Xbyak::Operand::RDI, Xbyak::Operand::RSI,
                                            Xbyak::Operand::RDX, Xbyak::Operand::RCX, Xbyak::Operand::R8,
                                            Xbyak::Operand::R9, Xbyak::Operand::R10, Xbyak::Operand::R11});
-  m_register_cache.SetCalleeSavedHostRegs({Xbyak::Operand::RBX, Xbyak::Operand::RSP, Xbyak::Operand::RBP,
-                                           Xbyak::Operand::R12, Xbyak::Operand::R13, Xbyak::Operand::R14,
-                                           Xbyak::Operand::R15});
+  // Callee-saved registers are saved once by the dispatcher, so blocks don't need to save them.
   m_register_cache.SetCPUPtrHostReg(RCPUPTR);
 #endif
 }
@@ -184,18 +202,96 @@ Value CodeGenerator::GetValueInHostRegister(const Value& value)
 
 void CodeGenerator::EmitBeginBlock()
 {
-  // Store the CPU struct pointer.
+  // The dispatcher has already loaded the CPU struct pointer and fastmem base, we just need to reserve them.
   const bool cpu_reg_allocated = m_register_cache.AllocateHostReg(RCPUPTR);
   DebugAssert(cpu_reg_allocated);
-  m_emit->mov(GetCPUPtrReg(), GetHostReg64(RARG1));
+
+  if (m_fastmem_enabled)
+  {
+    const bool fastmem_reg_allocated = m_register_cache.AllocateHostReg(RMEMBASEPTR);
+    DebugAssert(fastmem_reg_allocated);
+    UNREFERENCED_VARIABLE(fastmem_reg_allocated);
+  }
 }
 
 void CodeGenerator::EmitEndBlock()
 {
   m_register_cache.FreeHostReg(RCPUPTR);
-  m_register_cache.PopCalleeSavedRegisters(true);
+  if (m_fastmem_enabled)
+    m_register_cache.FreeHostReg(RMEMBASEPTR);
+
+  if (m_static_exit_pc_count == 0 && !m_indirect_exit)
+  {
+    m_emit->jmp(m_asm_functions.dispatcher, Xbyak::CodeGenerator::T_NEAR);
+    return;
+  }
+
+  // Do the dispatcher's checks here, so the exits can go straight to the next block. Anything which needs the
+  // dispatcher's attention goes there instead. Without a pending interrupt, the dispatcher only clears the delay.
+  const Xbyak::Reg64 cpu_reg = GetCPUPtrReg();
+  const void* dispatcher = m_asm_functions.dispatcher;
+  Xbyak::Label no_interrupt;
+  m_emit->mov(m_emit->eax, m_emit->dword[cpu_reg + offsetof(Core, m_pending_ticks)]);
+  m_emit->cmp(m_emit->eax, m_emit->dword[cpu_reg + offsetof(Core, m_downcount)]);
+  m_emit->jge(dispatcher);
+  m_emit->mov(m_emit->eax, m_emit->dword[cpu_reg + offsetof(Core, m_cop0_regs.sr.bits)]);
+  m_emit->test(m_emit->al, 2);
+  m_emit->jnz(dispatcher);
+  m_emit->test(m_emit->al, 1);
+  m_emit->jz(no_interrupt);
+  m_emit->and_(m_emit->eax, m_emit->dword[cpu_reg + offsetof(Core, m_cop0_regs.cause.bits)]);
+  m_emit->test(m_emit->eax, UINT32_C(0xFF) << 8);
+  m_emit->jnz(dispatcher);
+  m_emit->L(no_interrupt);
+  m_emit->mov(m_emit->byte[cpu_reg + offsetof(Core, m_interrupt_delay)], 0);
+
+  // The PC is compared even when it's known, in case an instruction we fell back to changed it.
+  for (u32 i = 0; i < m_static_exit_pc_count; i++)
+  {
+    const u32 pc = m_static_exit_pcs[i];
+    const bool last_exit = (i == (m_static_exit_pc_count - 1)) && !m_indirect_exit;
+    Xbyak::Label next_exit;
+    m_emit->cmp(m_emit->dword[cpu_reg + offsetof(Core, m_regs.pc)], pc);
+    if (last_exit)
+      m_emit->jne(dispatcher);
+    else
+      m_emit->jne(next_exit, Xbyak::CodeGenerator::T_NEAR);
+
+    BlockExitInfo bei = {};
+    bei.host_link_stub = GetCurrentFarCodePointer();
+    bei.host_jump = GetCurrentNearCodePointer();
+    bei.target_pc = pc;
+    m_emit->jmp(bei.host_link_stub, Xbyak::CodeGenerator::T_NEAR);
+    EmitBlockExitLinkStub(bei.host_jump);
+    m_block_exit_info.push_back(bei);
+    m_emit->L(next_exit);
+  }
 
-  m_emit->ret();
+  if (m_indirect_exit)
+  {
+    // The immediate is replaced with the PC of the last target. Until then, it's misaligned so it never matches, and
+    // too large for the short encoding.
+    constexpr u32 unlinked_pc = UINT32_C(0x7FFFFFFF);
+    BlockExitInfo bei = {};
+    bei.host_link_stub = GetCurrentFarCodePointer();
+    m_emit->cmp(m_emit->dword[cpu_reg + offsetof(Core, m_regs.pc)], unlinked_pc);
+    bei.host_target_pc = static_cast<u8*>(GetCurrentNearCodePointer()) - sizeof(u32);
+    bei.host_miss_jump = GetCurrentNearCodePointer();
+    m_emit->jne(bei.host_link_stub);
+    bei.host_jump = GetCurrentNearCodePointer();
+    bei.target_pc = unlinked_pc;
+    m_emit->jmp(bei.host_link_stub, Xbyak::CodeGenerator::T_NEAR);
+    EmitBlockExitLinkStub(bei.host_jump);
+    m_block_exit_info.push_back(bei);
+  }
+}
+
+void CodeGenerator::EmitBlockExitLinkStub(void* host_jump)
+{
+  SwitchToFarCode();
+  m_emit->mov(GetHostReg64(RARG2), reinterpret_cast<size_t>(host_jump));
+  m_emit->jmp(m_asm_functions.link_block_exit, Xbyak::CodeGenerator::T_NEAR);
+  SwitchToNearCode();
 }
 
 void CodeGenerator::EmitExceptionExit()
@@ -212,8 +308,7 @@ void CodeGenerator::EmitExceptionExit()
   // technically RaiseException() and FlushPipeline() have already been called, but that should be okay
   m_register_cache.FlushLoadDelay(false);
 
-  m_register_cache.PopCalleeSavedRegisters(false);
-  m_emit->ret();
+  m_emit->jmp(m_asm_functions.dispatcher, Xbyak::CodeGenerator::T_NEAR);
 }
 
 void CodeGenerator::EmitExceptionExitOnBool(const Value& value)
@@ -241,6 +336,8 @@ void CodeGenerator::FinalizeBlock(CodeBlock::HostCodePointer* out_host_code, u32
   const u32 far_size = static_cast<u32>(m_far_emitter.getSize());
   *out_host_code = m_near_emitter.getCode<CodeBlock::HostCodePointer>();
   *out_host_code_size = near_size;
+  m_far_code = m_far_emitter.getCode<void*>();
+  m_far_code_size = far_size;
   m_code_buffer->CommitCode(near_size);
   m_code_buffer->CommitFarCode(far_size);
 
@@ -1635,11 +1732,163 @@ void CodeGenerator::EmitAddCPUStructField(u32 offset, const Value& value)
 
 Value CodeGenerator::EmitLoadGuestMemory(const CodeBlockInstruction& cbi, const Value& address, RegSize size)
 {
-  const Value pc = Value::FromConstantU32(cbi.pc);
-  AddPendingCycles(true);
-
   // We need to use the full 64 bits here since we test the sign bit result.
   Value result = m_register_cache.AllocateScratch(RegSize_64);
+  if (IsConstantScratchpadAddress(address, size))
+  {
+    EmitLoadScratchpad(address, size, result);
+  }
+  else if (IsConstantRAMAddress(address, size))
+  {
+    EmitLoadGuestRAMDirect(address, size, result);
+  }
+  else if (CanUseFastmemForAddress(address, size))
+  {
+    EmitLoadGuestMemoryFastmem(cbi, address, size, result);
+  }
+  else
+  {
+    AddPendingCycles(true);
+    EmitLoadGuestMemorySlowmem(cbi, address, size, result, false);
+  }
+
+  // Downcast to ignore upper 56/48/32 bits. This should be a noop.
+  switch (size)
+  {
+    case RegSize_8:
+      ConvertValueSizeInPlace(&result, RegSize_8, false);
+      break;
+
+    case RegSize_16:
+      ConvertValueSizeInPlace(&result, RegSize_16, false);
+      break;
+
+    case RegSize_32:
+      ConvertValueSizeInPlace(&result, RegSize_32, false);
+      break;
+
+    default:
+      UnreachableCode();
+      break;
+  }
+
+  return result;
+}
+
+void CodeGenerator::EmitLoadGuestRAMDirect(const Value& address, RegSize size, Value& result)
+{
+  // RAM reads can't fault or have side effects, so a known address can be read from the backing memory directly.
+  const u8* ram_ptr = m_cpu->GetBus()->GetRAMPointer(static_cast<u32>(address.constant_value));
+  m_emit->mov(GetHostReg64(result.host_reg), reinterpret_cast<size_t>(ram_ptr));
+  switch (size)
+  {
+    case RegSize_8:
+      m_emit->movzx(GetHostReg32(result.host_reg), m_emit->byte[GetHostReg64(result.host_reg)]);
+      break;
+
+    case RegSize_16:
+      m_emit->movzx(GetHostReg32(result.host_reg), m_emit->word[GetHostReg64(result.host_reg)]);
+      break;
+
+    case RegSize_32:
+      m_emit->mov(GetHostReg32(result.host_reg), m_emit->dword[GetHostReg64(result.host_reg)]);
+      break;
+
+    default:
+      UnreachableCode();
+      break;
+  }
+
+  m_delayed_cycles_add += Bus::RAM_READ_TICKS;
+}
+
+void CodeGenerator::EmitLoadGuestMemoryFastmem(const CodeBlockInstruction& cbi, const Value& address, RegSize size,
+                                               Value& result)
+{
+  // The result register doubles as the address for constants, since it's not needed until the load.
+  HostReg address_reg;
+  if (address.IsConstant())
+  {
+    m_emit->mov(GetHostReg32(result.host_reg), static_cast<u32>(address.constant_value));
+    address_reg = result.host_reg;
+  }
+  else
+  {
+    address_reg = address.host_reg;
+
+    // The upper half of the host register isn't guaranteed to be clear, it depends on what last wrote to it.
+    m_emit->mov(GetHostReg32(address_reg), GetHostReg32(address_reg));
+
+    // Misaligned accesses raise an exception, so send those through the slow path.
+    if (size != RegSize_8)
+    {
+      m_emit->test(GetHostReg32(address_reg), (size == RegSize_16) ? 1 : 3);
+      m_emit->jnz(GetCurrentFarCodePointer());
+    }
+  }
+
+  LoadStoreBackpatchInfo bpi;
+  bpi.host_pc = GetCurrentNearCodePointer();
+  bpi.guest_pc = cbi.pc;
+
+  const auto fastmem_address = GetFastmemBasePtrReg() + GetHostReg64(address_reg);
+  switch (size)
+  {
+    case RegSize_8:
+      m_emit->movzx(GetHostReg32(result.host_reg), m_emit->byte[fastmem_address]);
+      break;
+
+    case RegSize_16:
+      m_emit->movzx(GetHostReg32(result.host_reg), m_emit->word[fastmem_address]);
+      break;
+
+    case RegSize_32:
+      m_emit->mov(GetHostReg32(result.host_reg), m_emit->dword[fastmem_address]);
+      break;
+
+    default:
+      UnreachableCode();
+      break;
+  }
+
+  // Pad with nops so there's room for the jump when backpatching.
+  const u32 fastmem_size =
+    static_cast<u32>(static_cast<u8*>(GetCurrentNearCodePointer()) - static_cast<u8*>(bpi.host_pc));
+  for (u32 i = fastmem_size; i < BACKPATCH_JUMP_SIZE; i++)
+    m_emit->nop();
+  bpi.host_code_size = std::max(fastmem_size, BACKPATCH_JUMP_SIZE);
+
+  // The cycles for the access are only added on the fast path, the thunk adds its own.
+  const TickCount pending_cycles = m_delayed_cycles_add;
+  m_delayed_cycles_add += Bus::RAM_READ_TICKS;
+
+  // slow path, taken for misaligned or non-RAM accesses, and after backpatching
+  m_register_cache.PushState();
+  SwitchToFarCode();
+  bpi.host_slowmem_pc = GetCurrentFarCodePointer();
+
+  if (pending_cycles > 0)
+    EmitAddCPUStructField(offsetof(Core, m_pending_ticks), Value::FromConstantU32(static_cast<u32>(pending_cycles)));
+
+  m_delayed_cycles_add = 0;
+  EmitLoadGuestMemorySlowmem(cbi, address, size, result, true);
+  m_delayed_cycles_add = pending_cycles + Bus::RAM_READ_TICKS;
+
+  // undo what the near code will add later
+  EmitAddCPUStructField(offsetof(Core, m_pending_ticks),
+                        Value::FromConstantU32(static_cast<u32>(-m_delayed_cycles_add)));
+
+  EmitBranch(GetCurrentNearCodePointer(), false);
+  SwitchToNearCode();
+  m_register_cache.PopState();
+
+  m_loadstore_backpatch_info.push_back(bpi);
+}
+
+void CodeGenerator::EmitLoadGuestMemorySlowmem(const CodeBlockInstruction& cbi, const Value& address, RegSize size,
+                                               Value& result, bool in_far_code)
+{
+  const Value pc = Value::FromConstantU32(cbi.pc);
 
   // NOTE: This can leave junk in the upper bits
   switch (size)
@@ -1662,6 +1911,21 @@ Value CodeGenerator::EmitLoadGuestMemory(const CodeBlockInstruction& cbi, const
   }
 
   m_emit->test(GetHostReg64(result.host_reg), GetHostReg64(result.host_reg));
+
+  if (in_far_code)
+  {
+    // we're already in far code, so skip over the exception path inline
+    Xbyak::Label load_okay;
+    m_emit->jns(load_okay);
+
+    m_register_cache.PushState();
+    EmitExceptionExit();
+    m_register_cache.PopState();
+
+    m_emit->L(load_okay);
+    return;
+  }
+
   m_emit->js(GetCurrentFarCodePointer());
 
   m_register_cache.PushState();
@@ -1672,36 +1936,128 @@ Value CodeGenerator::EmitLoadGuestMemory(const CodeBlockInstruction& cbi, const
   SwitchToNearCode();
 
   m_register_cache.PopState();
+}
 
-  // Downcast to ignore upper 56/48/32 bits. This should be a noop.
-  switch (size)
+void CodeGenerator::EmitStoreGuestMemory(const CodeBlockInstruction& cbi, const Value& address, const Value& value)
+{
+  // RAM stores still have to go through the thunk or fastmem, so code invalidation is triggered.
+  if (IsConstantScratchpadAddress(address, value.size))
+  {
+    EmitStoreScratchpad(address, value);
+  }
+  else if (CanUseFastmemForAddress(address, value.size))
+  {
+    EmitStoreGuestMemoryFastmem(cbi, address, value);
+  }
+  else
+  {
+    AddPendingCycles(true);
+    Value result = m_register_cache.AllocateScratch(RegSize_8);
+    EmitStoreGuestMemorySlowmem(cbi, address, value, result, false);
+  }
+}
+
+void CodeGenerator::EmitStoreGuestMemoryFastmem(const CodeBlockInstruction& cbi, const Value& address,
+                                                const Value& value)
+{
+  // The slow path's result register has to be allocated here, since allocating in far code could push a register.
+  Value result = m_register_cache.AllocateScratch(RegSize_8);
+
+  Value temp_address;
+  HostReg address_reg;
+  if (address.IsConstant())
+  {
+    temp_address = m_register_cache.AllocateScratch(RegSize_32);
+    m_emit->mov(GetHostReg32(temp_address.host_reg), static_cast<u32>(address.constant_value));
+    address_reg = temp_address.host_reg;
+  }
+  else
+  {
+    address_reg = address.host_reg;
+
+    // The upper half of the host register isn't guaranteed to be clear, it depends on what last wrote to it.
+    m_emit->mov(GetHostReg32(address_reg), GetHostReg32(address_reg));
+
+    // Misaligned accesses raise an exception, so send those through the slow path.
+    if (value.size != RegSize_8)
+    {
+      m_emit->test(GetHostReg32(address_reg), (value.size == RegSize_16) ? 1 : 3);
+      m_emit->jnz(GetCurrentFarCodePointer());
+    }
+  }
+
+  LoadStoreBackpatchInfo bpi;
+  bpi.host_pc = GetCurrentNearCodePointer();
+  bpi.guest_pc = cbi.pc;
+
+  const auto fastmem_address = GetFastmemBasePtrReg() + GetHostReg64(address_reg);
+  switch (value.size)
   {
     case RegSize_8:
-      ConvertValueSizeInPlace(&result, RegSize_8, false);
-      break;
+    {
+      if (value.IsConstant())
+        m_emit->mov(m_emit->byte[fastmem_address], Truncate8(value.constant_value));
+      else
+        m_emit->mov(m_emit->byte[fastmem_address], GetHostReg8(value.host_reg));
+    }
+    break;
 
     case RegSize_16:
-      ConvertValueSizeInPlace(&result, RegSize_16, false);
-      break;
+    {
+      if (value.IsConstant())
+        m_emit->mov(m_emit->word[fastmem_address], Truncate16(value.constant_value));
+      else
+        m_emit->mov(m_emit->word[fastmem_address], GetHostReg16(value.host_reg));
+    }
+    break;
 
     case RegSize_32:
-      ConvertValueSizeInPlace(&result, RegSize_32, false);
-      break;
+    {
+      if (value.IsConstant())
+        m_emit->mov(m_emit->dword[fastmem_address], Truncate32(value.constant_value));
+      else
+        m_emit->mov(m_emit->dword[fastmem_address], GetHostReg32(value.host_reg));
+    }
+    break;
 
     default:
       UnreachableCode();
       break;
   }
 
-  return result;
+  // Pad with nops so there's room for the jump when backpatching.
+  const u32 fastmem_size =
+    static_cast<u32>(static_cast<u8*>(GetCurrentNearCodePointer()) - static_cast<u8*>(bpi.host_pc));
+  for (u32 i = fastmem_size; i < BACKPATCH_JUMP_SIZE; i++)
+    m_emit->nop();
+  bpi.host_code_size = std::max(fastmem_size, BACKPATCH_JUMP_SIZE);
+
+  // slow path, taken for misaligned or non-RAM accesses, and after backpatching
+  m_register_cache.PushState();
+  SwitchToFarCode();
+  bpi.host_slowmem_pc = GetCurrentFarCodePointer();
+
+  // RAM writes don't take any cycles, so the near code doesn't have to commit its cycles
+  const TickCount pending_cycles = m_delayed_cycles_add;
+  AddPendingCycles(true);
+  EmitStoreGuestMemorySlowmem(cbi, address, value, result, true);
+  if (pending_cycles > 0)
+  {
+    m_delayed_cycles_add = pending_cycles;
+    EmitAddCPUStructField(offsetof(Core, m_pending_ticks), Value::FromConstantU32(static_cast<u32>(-pending_cycles)));
+  }
+
+  EmitBranch(GetCurrentNearCodePointer(), false);
+  SwitchToNearCode();
+  m_register_cache.PopState();
+
+  m_loadstore_backpatch_info.push_back(bpi);
 }
 
-void CodeGenerator::EmitStoreGuestMemory(const CodeBlockInstruction& cbi, const Value& address, const Value& value)
+void CodeGenerator::EmitStoreGuestMemorySlowmem(const CodeBlockInstruction& cbi, const Value& address,
+                                                const Value& value, Value& result, bool in_far_code)
 {
   const Value pc = Value::FromConstantU32(cbi.pc);
-  AddPendingCycles(true);
-
-  Value result = m_register_cache.AllocateScratch(RegSize_8);
 
   switch (value.size)
   {
@@ -1725,12 +2081,24 @@ void CodeGenerator::EmitStoreGuestMemory(const CodeBlockInstruction& cbi, const
   m_register_cache.PushState();
 
   m_emit->test(GetHostReg8(result), GetHostReg8(result));
-  m_emit->jz(GetCurrentFarCodePointer());
 
-  // store exception path
-  SwitchToFarCode();
-  EmitExceptionExit();
-  SwitchToNearCode();
+  if (in_far_code)
+  {
+    // we're already in far code, so skip over the exception path inline
+    Xbyak::Label store_okay;
+    m_emit->jnz(store_okay);
+    EmitExceptionExit();
+    m_emit->L(store_okay);
+  }
+  else
+  {
+    m_emit->jz(GetCurrentFarCodePointer());
+
+    // store exception path
+    SwitchToFarCode();
+    EmitExceptionExit();
+    SwitchToNearCode();
+  }
 
   m_register_cache.PopState();
 }
@@ -2047,6 +2415,727 @@ void CodeGenerator::EmitBindLabel(LabelType* label)
   m_emit->L(*label);
 }
 
-void ASMFunctions::Generate(JitCodeBuffer* code_buffer) {}
+namespace {
+
+/// Host registers and addressing for the GTE commands which are emitted inline. The vector registers are xmm0-5, which
+/// are caller-saved on both ABIs, and aren't used by any other generated code.
+struct InlineGTEContext
+{
+  Xbyak::CodeGenerator* emit;
+  u32 regs_offset; // offset of the GTE registers in the CPU struct
+  bool update_flags;
+  Xbyak::Reg32 flags;
+  Xbyak::Reg64 temp[3];
+  Xbyak::Reg64 rcx; // variable shift counts have to be in CL
+  const u8* unr_table;
+
+  Xbyak::RegExp Address(u32 offset) const { return GetCPUPtrReg() + (regs_offset + offset); }
+};
+
+} // namespace
+
+// The three rows of a matrix multiply are kept as 64-bit sums, with rows 3 and 2 in the low register and row 1 in the
+// high register. Reversing the rows means packing the low halves of both gives the MAC/IR flag bit order directly.
+static const Xbyak::Xmm GTE_SUM_LO = Xbyak::Xmm(0);
+static const Xbyak::Xmm GTE_SUM_HI = Xbyak::Xmm(1);
+static const Xbyak::Xmm GTE_TEMP0 = Xbyak::Xmm(2);
+static const Xbyak::Xmm GTE_TEMP1 = Xbyak::Xmm(3);
+static const Xbyak::Xmm GTE_TEMP2 = Xbyak::Xmm(4);
+static const Xbyak::Xmm GTE_TEMP3 = Xbyak::Xmm(5);
+
+static bool HostSupportsInlineGTEMatrixCommands()
+{
+  static const bool supported = Xbyak::util::Cpu().has(Xbyak::util::Cpu::tSSE41);
+  return supported;
+}
+
+// Sign-extends both 64-bit lanes of src from 44 bits. There's no 64-bit arithmetic shift before AVX-512, so the sign is
+// shifted in separately.
+static void EmitGTESignExtendMAC(const InlineGTEContext& ctx, const Xbyak::Xmm& dst, const Xbyak::Xmm& src)
+{
+  Xbyak::CodeGenerator* emit = ctx.emit;
+  emit->movdqa(dst, src);
+  emit->psllq(dst, 20);
+  emit->pshufd(GTE_TEMP3, dst, 0xF5);
+  emit->psrad(GTE_TEMP3, 31);
+  emit->psllq(GTE_TEMP3, 44);
+  emit->psrlq(dst, 20);
+  emit->por(dst, GTE_TEMP3);
+}
+
+// Raises the MAC1-3 overflow and underflow flags for sums which changed when sign-extended from 44 bits.
+static void EmitGTECheckMACFlags(const InlineGTEContext& ctx, const Xbyak::Xmm& lo_extended,
+                                 const Xbyak::Xmm& hi_extended)
+{
+  Xbyak::CodeGenerator* emit = ctx.emit;
+  const Xbyak::Reg32 mismatch = ctx.temp[1].cvt32();
+  const Xbyak::Reg32 negative = ctx.temp[2].cvt32();
+
+  // lanes: MAC3, MAC2, MAC1, unused
+  emit->movdqa(GTE_TEMP2, lo_extended);
+  emit->pcmpeqq(GTE_TEMP2, GTE_SUM_LO);
+  emit->movdqa(GTE_TEMP3, hi_extended);
+  emit->pcmpeqq(GTE_TEMP3, GTE_SUM_HI);
+  emit->shufps(GTE_TEMP2, GTE_TEMP3, 0x88);
+  emit->movmskps(mismatch, GTE_TEMP2);
+  emit->movdqa(GTE_TEMP3, GTE_SUM_LO);
+  emit->shufps(GTE_TEMP3, GTE_SUM_HI, 0xDD);
+  emit->movmskps(negative, GTE_TEMP3);
+
+  emit->not_(mismatch);
+  emit->and_(mismatch, 7);
+  emit->and_(negative, mismatch);
+  emit->xor_(mismatch, negative);
+  emit->shl(negative, 25);
+  emit->or_(ctx.flags, negative);
+  emit->shl(mismatch, 28);
+  emit->or_(ctx.flags, mismatch);
+}
+
+// Saturates the MAC1-3 values in mac (MAC3, MAC2, MAC1 order) to the IR range, and raises the IR flags in flag_rows.
+static void EmitGTESaturateIR(const InlineGTEContext& ctx, const Xbyak::Xmm& ir, const Xbyak::Xmm& mac, bool lm,
+                              u32 flag_rows)
+{
+  Xbyak::CodeGenerator* emit = ctx.emit;
+  emit->movdqa(ir, mac);
+  emit->packssdw(ir, ir);
+  if (lm)
+  {
+    emit->pxor(GTE_TEMP3, GTE_TEMP3);
+    emit->pmaxsw(ir, GTE_TEMP3);
+  }
+  emit->pmovsxwd(ir, ir);
+
+  if (ctx.update_flags)
+  {
+    const Xbyak::Reg32 saturated = ctx.temp[1].cvt32();
+    emit->movdqa(GTE_TEMP3, ir);
+    emit->pcmpeqd(GTE_TEMP3, mac);
+    emit->movmskps(saturated, GTE_TEMP3);
+    emit->not_(saturated);
+    emit->and_(saturated, flag_rows);
+    emit->shl(saturated, 22);
+    emit->or_(ctx.flags, saturated);
+  }
+}
+
+// Adds the products of one matrix column and vector component to the row sums.
+static void EmitGTEMultiplyColumn(const InlineGTEContext& ctx, u32 matrix, u32 vector, u32 col)
+{
+  Xbyak::CodeGenerator* emit = ctx.emit;
+  const Xbyak::Reg32 value = ctx.temp[1].cvt32();
+
+  // pmaddwd with the upper halves zeroed is an exact 16x16->32 multiply, one row per 32-bit lane
+  emit->pxor(GTE_TEMP0, GTE_TEMP0);
+  for (u32 row = 0; row < 3; row++)
+  {
+    const u8 position = static_cast<u8>((2 - row) * 2);
+    if (matrix < 3)
+    {
+      static constexpr std::array<u32, 3> matrix_offsets = {
+        {offsetof(GTE::Regs, RT), offsetof(GTE::Regs, LLM), offsetof(GTE::Regs, LCM)}};
+      emit->pinsrw(GTE_TEMP0, emit->word[ctx.Address(matrix_offsets[matrix] + (row * 3 + col) * sizeof(s16))],
+                   position);
+    }
+    else if (row == 0 && col < 2)
+    {
+      // buggy matrix: -R*16, R*16, IR0 / RT13 x3 / RT22 x3
+      emit->movzx(value, emit->byte[ctx.Address(offsetof(GTE::Regs, RGBC))]);
+      emit->shl(value, 4);
+      if (col == 0)
+        emit->neg(value);
+      emit->pinsrw(GTE_TEMP0, value, position);
+    }
+    else
+    {
+      const u32 offset = (row == 0) ? offsetof(GTE::Regs, IR0) :
+                                      (offsetof(GTE::Regs, RT) + ((row == 1) ? 2 : 4) * sizeof(s16));
+      emit->pinsrw(GTE_TEMP0, emit->word[ctx.Address(offset)], position);
+    }
+  }
+
+  const u32 vector_offset = (vector < 3) ? (offsetof(GTE::Regs, V0) + vector * 8 + col * sizeof(s16)) :
+                                           (offsetof(GTE::Regs, IR1) + col * sizeof(u32));
+  emit->movzx(value, emit->word[ctx.Address(vector_offset)]);
+  emit->movd(GTE_TEMP1, value);
+  emit->pshufd(GTE_TEMP1, GTE_TEMP1, 0);
+  emit->pmaddwd(GTE_TEMP0, GTE_TEMP1);
+
+  emit->pmovsxdq(GTE_TEMP1, GTE_TEMP0);
+  emit->paddq(GTE_SUM_LO, GTE_TEMP1);
+  emit->pshufd(GTE_TEMP1, GTE_TEMP0, 0xEE);
+  emit->pmovsxdq(GTE_TEMP1, GTE_TEMP1);
+  emit->paddq(GTE_SUM_HI, GTE_TEMP1);
+}
+
+// Loads a translation vector shifted left by 12 as the initial row sums.
+static void EmitGTELoadTranslation(const InlineGTEContext& ctx, u32 translation)
+{
+  static constexpr std::array<u32, 3> translation_offsets = {
+    {offsetof(GTE::Regs, TR), offsetof(GTE::Regs, BK), offsetof(GTE::Regs, FC)}};
+
+  Xbyak::CodeGenerator* emit = ctx.emit;
+  const u32 offset = translation_offsets[translation];
+  emit->pmovsxdq(GTE_SUM_LO, emit->qword[ctx.Address(offset + sizeof(s32))]);
+  emit->pshufd(GTE_SUM_LO, GTE_SUM_LO, 0x4E);
+  emit->movd(GTE_SUM_HI, emit->dword[ctx.Address(offset)]);
+  emit->pmovsxdq(GTE_SUM_HI, GTE_SUM_HI);
+  emit->psllq(GTE_SUM_LO, 12);
+  emit->psllq(GTE_SUM_HI, 12);
+}
+
+// MAC1-3 = (translation * 1000h + matrix * vector) SAR shift, IR1-3 = saturated MAC1-3. With the FC translation, the
+// hardware's buggy path is emulated, where the first column is only used for the IR flags. For RTPS, the IR3 flag is
+// left to the caller, and the row 3 sum is returned in temp[0].
+static void EmitGTEMatrixMultiply(const InlineGTEContext& ctx, u32 matrix, u32 vector, u32 translation, u8 shift,
+                                  bool lm, bool rtp)
+{
+  Xbyak::CodeGenerator* emit = ctx.emit;
+
+  u32 first_col = 0;
+  if (translation == 2)
+  {
+    // IR1-3 = (FC * 1000h + column 1 * VX) SAR shift, without lm, which only matters for the flags
+    if (ctx.update_flags)
+    {
+      EmitGTELoadTranslation(ctx, translation);
+      EmitGTEMultiplyColumn(ctx, matrix, vector, 0);
+      EmitGTESignExtendMAC(ctx, GTE_TEMP0, GTE_SUM_LO);
+      EmitGTESignExtendMAC(ctx, GTE_TEMP1, GTE_SUM_HI);
+      EmitGTECheckMACFlags(ctx, GTE_TEMP0, GTE_TEMP1);
+      if (shift != 0)
+      {
+        emit->psrlq(GTE_TEMP0, shift);
+        emit->psrlq(GTE_TEMP1, shift);
+      }
+      emit->shufps(GTE_TEMP0, GTE_TEMP1, 0x88);
+      EmitGTESaturateIR(ctx, GTE_TEMP1, GTE_TEMP0, false, 7);
+    }
+
+    first_col = 1;
+    emit->pxor(GTE_SUM_LO, GTE_SUM_LO);
+    emit->pxor(GTE_SUM_HI, GTE_SUM_HI);
+  }
+  else if (translation == 3)
+  {
+    emit->pxor(GTE_SUM_LO, GTE_SUM_LO);
+    emit->pxor(GTE_SUM_HI, GTE_SUM_HI);
+  }
+  else
+  {
+    EmitGTELoadTranslation(ctx, translation);
+  }
+
+  for (u32 col = first_col; col < 3; col++)
+  {
+    EmitGTEMultiplyColumn(ctx, matrix, vector, col);
+
+    // a single product can't overflow, so there's nothing to check without a translation
+    if (col == first_col && translation >= 2)
+      continue;
+
+    // every sum is checked, but the last one isn't sign-extended
+    if (col < 2 || ctx.update_flags)
+    {
+      EmitGTESignExtendMAC(ctx, GTE_TEMP0, GTE_SUM_LO);
+      EmitGTESignExtendMAC(ctx, GTE_TEMP1, GTE_SUM_HI);
+      if (ctx.update_flags)
+        EmitGTECheckMACFlags(ctx, GTE_TEMP0, GTE_TEMP1);
+      if (col < 2)
+      {
+        emit->movdqa(GTE_SUM_LO, GTE_TEMP0);
+        emit->movdqa(GTE_SUM_HI, GTE_TEMP1);
+      }
+    }
+  }
+
+  if (rtp)
+    emit->movq(ctx.temp[0], GTE_SUM_LO);
+
+  // only the low 32 bits are kept, so a logical shift gives the same result as an arithmetic one
+  if (shift != 0)
+  {
+    emit->psrlq(GTE_SUM_LO, shift);
+    emit->psrlq(GTE_SUM_HI, shift);
+  }
+  emit->shufps(GTE_SUM_LO, GTE_SUM_HI, 0x88);
+  EmitGTESaturateIR(ctx, GTE_TEMP0, GTE_SUM_LO, lm, rtp ? 6 : 7);
+
+  // back to MAC1, MAC2, MAC3 order
+  emit->pshufd(GTE_SUM_LO, GTE_SUM_LO, 0xC6);
+  emit->pshufd(GTE_TEMP0, GTE_TEMP0, 0xC6);
+  emit->movq(emit->qword[ctx.Address(offsetof(GTE::Regs, MAC1))], GTE_SUM_LO);
+  emit->pextrd(emit->dword[ctx.Address(offsetof(GTE::Regs, MAC3))], GTE_SUM_LO, 2);
+  emit->movq(emit->qword[ctx.Address(offsetof(GTE::Regs, IR1))], GTE_TEMP0);
+  emit->pextrd(emit->dword[ctx.Address(offsetof(GTE::Regs, IR3))], GTE_TEMP0, 2);
+}
+
+// Raises the MAC0 overflow or underflow flag if the 64-bit value doesn't fit in 32 bits.
+static void EmitGTECheckMAC0Flags(const InlineGTEContext& ctx, const Xbyak::Reg64& value, const Xbyak::Reg64& temp)
+{
+  if (!ctx.update_flags)
+    return;
+
+  Xbyak::CodeGenerator* emit = ctx.emit;
+  Xbyak::Label done;
+  emit->movsxd(temp, value.cvt32());
+  emit->cmp(temp, value);
+  emit->je(done);
+  emit->mov(temp, value);
+  emit->sar(temp, 63);
+  emit->and_(temp.cvt32(), 0xFFFF8000u); // 8000h (underflow) if negative, 10000h (overflow) otherwise
+  emit->add(temp.cvt32(), 0x10000);
+  emit->or_(ctx.flags, temp.cvt32());
+  emit->L(done);
+}
+
+// Clamps value to min..max, raising flag_bit if it was outside. The range has to be either 0..max or -(max + 1)..max.
+static void EmitGTEClamp(const InlineGTEContext& ctx, const Xbyak::Reg32& value, const Xbyak::Reg32& temp, s32 min,
+                         s32 max, u32 flag_bit)
+{
+  Xbyak::CodeGenerator* emit = ctx.emit;
+  Xbyak::Label in_range;
+  if (min == 0)
+  {
+    emit->cmp(value, static_cast<u32>(max));
+    emit->jbe(in_range);
+  }
+  else
+  {
+    emit->lea(temp, emit->ptr[value.cvt64() + static_cast<u32>(-min)]);
+    emit->cmp(temp, static_cast<u32>(max - min));
+    emit->jbe(in_range);
+  }
+
+  if (ctx.update_flags)
+    emit->or_(ctx.flags, UINT32_C(1) << flag_bit);
+
+  // all ones if negative, i.e. below the range
+  emit->sar(value, 31);
+  if (min == 0)
+  {
+    emit->not_(value);
+    emit->and_(value, static_cast<u32>(max));
+  }
+  else
+  {
+    emit->xor_(value, static_cast<u32>(max));
+  }
+  emit->L(in_range);
+}
+
+// Perspective transformation of one vertex, see GTE::Core::RTPS().
+static void EmitGTEPerspectiveTransform(const InlineGTEContext& ctx, u32 vector, u8 shift, bool lm, bool last)
+{
+  Xbyak::CodeGenerator* emit = ctx.emit;
+  const Xbyak::Reg64 result = ctx.temp[0];
+  const Xbyak::Reg64 value = ctx.temp[1];
+  const Xbyak::Reg64 temp = ctx.temp[2];
+  const Xbyak::Reg64 rcx = ctx.rcx;
+
+  // IR1-3 = MAC1-3 = (TR * 1000h + RT * V) SAR shift
+  EmitGTEMatrixMultiply(ctx, 0, vector, 0, shift, lm, true);
+
+  // The IR3 flag is based on MAC3 SAR 12, regardless of lm and shift. SZ3 = MAC3 SAR 12 too.
+  emit->mov(value, result);
+  emit->sar(value, 12);
+  if (ctx.update_flags)
+  {
+    Xbyak::Label ir3_in_range;
+    emit->lea(temp.cvt32(), emit->ptr[value + 0x8000]);
+    emit->cmp(temp.cvt32(), 0xFFFF);
+    emit->jbe(ir3_in_range);
+    emit->or_(ctx.flags, UINT32_C(1) << 22);
+    emit->L(ir3_in_range);
+  }
+  EmitGTEClamp(ctx, value.cvt32(), temp.cvt32(), 0, 0xFFFF, 18);
+  emit->movdqu(GTE_TEMP0, emit->xword[ctx.Address(offsetof(GTE::Regs, SZ1))]);
+  emit->movdqu(emit->xword[ctx.Address(offsetof(GTE::Regs, SZ0))], GTE_TEMP0);
+  emit->mov(emit->dword[ctx.Address(offsetof(GTE::Regs, SZ3))], value.cvt32());
+
+  // result = UNRDivide(H, SZ3)
+  Xbyak::Label divide;
+  Xbyak::Label divide_done;
+  emit->movzx(result.cvt32(), emit->word[ctx.Address(offsetof(GTE::Regs, H))]);
+  emit->lea(temp.cvt32(), emit->ptr[value + value]);
+  emit->cmp(temp.cvt32(), result.cvt32());
+  emit->ja(divide);
+  if (ctx.update_flags)
+    emit->or_(ctx.flags, UINT32_C(1) << 17);
+  emit->mov(result.cvt32(), 0x1FFFF);
+  emit->jmp(divide_done);
+
+  emit->L(divide);
+  emit->bsr(rcx.cvt32(), value.cvt32());
+  emit->xor_(rcx.cvt32(), 15);
+  emit->shl(result.cvt32(), emit->cl);
+  emit->shl(value.cvt32(), emit->cl);
+
+  // the divisor has bit 15 set after normalizing, so ORing in 8000h isn't needed
+  emit->mov(temp.cvt32(), value.cvt32());
+  emit->and_(temp.cvt32(), 0x7FFF);
+  emit->add(temp.cvt32(), 0x40);
+  emit->shr(temp.cvt32(), 7);
+  emit->mov(rcx, reinterpret_cast<size_t>(ctx.unr_table));
+  emit->movzx(temp.cvt32(), emit->byte[rcx + temp]);
+  emit->add(temp.cvt32(), 0x101);
+
+  // d = ((divisor * -x) + 80h) SAR 8, recip = ((x * (20000h + d)) + 80h) SAR 8
+  emit->mov(rcx.cvt32(), temp.cvt32());
+  emit->neg(rcx.cvt32());
+  emit->imul(rcx.cvt32(), value.cvt32());
+  emit->add(rcx.cvt32(), 0x80);
+  emit->sar(rcx.cvt32(), 8);
+  emit->add(rcx.cvt32(), 0x20000);
+  emit->imul(rcx.cvt32(), temp.cvt32());
+  emit->add(rcx.cvt32(), 0x80);
+  emit->sar(rcx.cvt32(), 8);
+
+  // result = min(1FFFFh, (lhs * recip + 8000h) SHR 16)
+  emit->imul(result, rcx);
+  emit->add(result, 0x8000);
+  emit->shr(result, 16);
+  emit->mov(rcx.cvt32(), 0x1FFFF);
+  emit->cmp(result.cvt32(), rcx.cvt32());
+  emit->cmova(result.cvt32(), rcx.cvt32());
+  emit->L(divide_done);
+
+  // SX2 = (result * IR1 + OFX) SAR 16, SY2 = (result * IR2 + OFY) SAR 16
+  emit->movsxd(value, emit->dword[ctx.Address(offsetof(GTE::Regs, IR1))]);
+  emit->imul(value, result);
+  emit->movsxd(temp, emit->dword[ctx.Address(offsetof(GTE::Regs, OFX))]);
+  emit->add(value, temp);
+  EmitGTECheckMAC0Flags(ctx, value, temp);
+  emit->sar(value, 16);
+  EmitGTEClamp(ctx, value.cvt32(), temp.cvt32(), -0x400, 0x3FF, 14);
+
+  emit->movsxd(temp, emit->dword[ctx.Address(offsetof(GTE::Regs, IR2))]);
+  emit->imul(temp, result);
+  emit->movsxd(rcx, emit->dword[ctx.Address(offsetof(GTE::Regs, OFY))]);
+  emit->add(temp, rcx);
+  EmitGTECheckMAC0Flags(ctx, temp, rcx);
+  emit->sar(temp, 16);
+  EmitGTEClamp(ctx, temp.cvt32(), rcx.cvt32(), -0x400, 0x3FF, 13);
+
+  emit->movq(GTE_TEMP0, emit->qword[ctx.Address(offsetof(GTE::Regs, SXY1))]);
+  emit->movq(emit->qword[ctx.Address(offsetof(GTE::Regs, SXY0))], GTE_TEMP0);
+  emit->movzx(value.cvt32(), value.cvt16());
+  emit->shl(temp.cvt32(), 16);
+  emit->or_(value.cvt32(), temp.cvt32());
+  emit->mov(emit->dword[ctx.Address(offsetof(GTE::Regs, SXY2))], value.cvt32());
+
+  if (last)
+  {
+    // MAC0 = result * DQA + DQB, IR0 = MAC0 SAR 12
+    emit->movsx(value, emit->word[ctx.Address(offsetof(GTE::Regs, DQA))]);
+    emit->imul(value, result);
+    emit->movsxd(temp, emit->dword[ctx.Address(offsetof(GTE::Regs, DQB))]);
+    emit->add(value, temp);
+    emit->mov(emit->dword[ctx.Address(offsetof(GTE::Regs, MAC0))], value.cvt32());
+    EmitGTECheckMAC0Flags(ctx, value, temp);
+    emit->sar(value, 12);
+    EmitGTEClamp(ctx, value.cvt32(), temp.cvt32(), 0, 0x1000, 12);
+    emit->mov(emit->dword[ctx.Address(offsetof(GTE::Regs, IR0))], value.cvt32());
+  }
+}
+
+bool CodeGenerator::EmitInlineGTEInstruction(GTE::Instruction inst, bool update_flags)
+{
+  switch (inst.command)
+  {
+    case 0x06: // NCLIP
+    case 0x2D: // AVSZ3
+    case 0x2E: // AVSZ4
+      break;
+
+    case 0x01: // RTPS
+    case 0x12: // MVMVA
+    case 0x30: // RTPT
+    {
+      if (!HostSupportsInlineGTEMatrixCommands())
+        return false;
+
+      m_register_cache.EnsureHostRegFree(Xbyak::Operand::RCX);
+      Value rcx = m_register_cache.AllocateScratch(RegSize_64, Xbyak::Operand::RCX);
+      Value flags = m_register_cache.AllocateScratch(RegSize_32);
+      Value temp0 = m_register_cache.AllocateScratch(RegSize_64);
+      Value temp1 = m_register_cache.AllocateScratch(RegSize_64);
+      Value temp2 = m_register_cache.AllocateScratch(RegSize_64);
+      const InlineGTEContext ctx = {m_emit,
+                                    static_cast<u32>(offsetof(Core, m_cop2.m_regs)),
+                                    update_flags,
+                                    GetHostReg32(flags),
+                                    {GetHostReg64(temp0), GetHostReg64(temp1), GetHostReg64(temp2)},
+                                    GetHostReg64(rcx),
+                                    GTE::Core::s_unr_table.data()};
+
+      if (update_flags)
+        m_emit->xor_(ctx.flags, ctx.flags);
+
+      const u8 shift = inst.GetShift();
+      const bool lm = inst.lm;
+      if (inst.command == 0x12)
+      {
+        EmitGTEMatrixMultiply(ctx, inst.mvmva_multiply_matrix, inst.mvmva_multiply_vector,
+                              inst.mvmva_translation_vector, shift, lm, false);
+      }
+      else if (inst.command == 0x01)
+      {
+        EmitGTEPerspectiveTransform(ctx, 0, shift, lm, true);
+      }
+      else
+      {
+        for (u32 vector = 0; vector < 3; vector++)
+          EmitGTEPerspectiveTransform(ctx, vector, shift, lm, vector == 2);
+      }
+
+      if (update_flags)
+      {
+        // bits 30..23, 18..13 OR'ed
+        Xbyak::Label no_error;
+        m_emit->test(ctx.flags, UINT32_C(0x7F87E000));
+        m_emit->jz(no_error);
+        m_emit->or_(ctx.flags, UINT32_C(0x80000000));
+        m_emit->L(no_error);
+        m_emit->mov(m_emit->dword[GetCPUPtrReg() + offsetof(Core, m_cop2.m_regs.FLAG.bits)], ctx.flags);
+      }
+
+      return true;
+    }
+
+    default:
+      return false;
+  }
+
+  const auto GTEReg = [this](u32 index, u32 byte_offset) {
+    return m_emit->word[GetCPUPtrReg() + (offsetof(Core, m_cop2.m_regs.r32[0]) + (index * sizeof(u32)) + byte_offset)];
+  };
+
+  // MAC0 is computed at 64 bits, then truncated.
+  Value result = m_register_cache.AllocateScratch(RegSize_64);
+  Value temp = m_register_cache.AllocateScratch(RegSize_64);
+  Value temp2 = m_register_cache.AllocateScratch(RegSize_64);
+  const Xbyak::Reg64 result_reg = GetHostReg64(result);
+  const Xbyak::Reg64 temp_reg = GetHostReg64(temp);
+  const Xbyak::Reg64 temp2_reg = GetHostReg64(temp2);
+
+  if (inst.command == 0x06)
+  {
+    // MAC0 = SX0*SY1 + SX1*SY2 + SX2*SY0 - SX0*SY2 - SX1*SY0 - SX2*SY1
+    static constexpr std::array<std::array<u32, 2>, 6> terms = {
+      {{12, 13}, {13, 14}, {14, 12}, {12, 14}, {13, 12}, {14, 13}}};
+    m_emit->xor_(result_reg.cvt32(), result_reg.cvt32());
+    for (u32 i = 0; i < static_cast<u32>(terms.size()); i++)
+    {
+      m_emit->movsx(temp_reg, GTEReg(terms[i][0], 0));
+      m_emit->movsx(temp2_reg, GTEReg(terms[i][1], 2));
+      m_emit->imul(temp_reg, temp2_reg);
+      if (i < 3)
+        m_emit->add(result_reg, temp_reg);
+      else
+        m_emit->sub(result_reg, temp_reg);
+    }
+  }
+  else
+  {
+    // MAC0 = ZSF3 * (SZ1 + SZ2 + SZ3), or ZSF4 * (SZ0 + SZ1 + SZ2 + SZ3)
+    const u32 first_sz = (inst.command == 0x2D) ? 17 : 16;
+    m_emit->movzx(result_reg.cvt32(), GTEReg(first_sz, 0));
+    for (u32 index = first_sz + 1; index <= 19; index++)
+    {
+      m_emit->movzx(temp_reg.cvt32(), GTEReg(index, 0));
+      m_emit->add(result_reg.cvt32(), temp_reg.cvt32());
+    }
+    m_emit->movsx(temp_reg, GTEReg((inst.command == 0x2D) ? 61 : 62, 0));
+    m_emit->imul(result_reg, temp_reg);
+  }
+
+  m_emit->mov(m_emit->dword[GetCPUPtrReg() + offsetof(Core, m_cop2.m_regs.MAC0)], result_reg.cvt32());
+
+  // Every flag which can be raised here is also part of the error bit.
+  const Xbyak::Reg32 flag_reg = temp2_reg.cvt32();
+  if (update_flags)
+  {
+    Xbyak::Label mac0_done;
+    Xbyak::Label mac0_not_overflow;
+    m_emit->xor_(flag_reg, flag_reg);
+    m_emit->cmp(result_reg, 0x7FFFFFFF);
+    m_emit->jle(mac0_not_overflow);
+    m_emit->mov(flag_reg, UINT32_C(0x80010000));
+    m_emit->jmp(mac0_done);
+    m_emit->L(mac0_not_overflow);
+    m_emit->cmp(result_reg, std::numeric_limits<s32>::min());
+    m_emit->jge(mac0_done);
+    m_emit->mov(flag_reg, UINT32_C(0x80008000));
+    m_emit->L(mac0_done);
+  }
+
+  if (inst.command != 0x06)
+  {
+    // OTZ = clamp(MAC0 >> 12, 0, 0xFFFF)
+    Xbyak::Label otz_saturated;
+    Xbyak::Label otz_done;
+    m_emit->mov(temp_reg, result_reg);
+    m_emit->sar(temp_reg, 12);
+    m_emit->cmp(temp_reg.cvt32(), 0);
+    m_emit->jge(otz_saturated);
+    m_emit->xor_(temp_reg.cvt32(), temp_reg.cvt32());
+    if (update_flags)
+      m_emit->or_(flag_reg, UINT32_C(0x80040000));
+    m_emit->jmp(otz_done);
+    m_emit->L(otz_saturated);
+    m_emit->cmp(temp_reg.cvt32(), 0xFFFF);
+    m_emit->jle(otz_done);
+    m_emit->mov(temp_reg.cvt32(), 0xFFFF);
+    if (update_flags)
+      m_emit->or_(flag_reg, UINT32_C(0x80040000));
+    m_emit->L(otz_done);
+    m_emit->mov(m_emit->dword[GetCPUPtrReg() + offsetof(Core, m_cop2.m_regs.dr32[7])], temp_reg.cvt32());
+  }
+
+  if (update_flags)
+    m_emit->mov(m_emit->dword[GetCPUPtrReg() + offsetof(Core, m_cop2.m_regs.FLAG.bits)], flag_reg);
+
+  return true;
+}
+
+void CodeGenerator::BackpatchLoadStore(const LoadStoreBackpatchInfo& lbi)
+{
+  Log_DevPrintf("Backpatching %p (guest PC 0x%08X) to slowmem at %p", lbi.host_pc, lbi.guest_pc, lbi.host_slowmem_pc);
+
+  // turn it into a jump to the slowmem handler
+  Xbyak::CodeGenerator cg(lbi.host_code_size, lbi.host_pc);
+  cg.jmp(lbi.host_slowmem_pc, Xbyak::CodeGenerator::T_NEAR);
+
+  const u32 nops = lbi.host_code_size - static_cast<u32>(cg.getSize());
+  for (u32 i = 0; i < nops; i++)
+    cg.nop();
+
+  JitCodeBuffer::FlushInstructionCache(lbi.host_pc, lbi.host_code_size);
+}
+
+void CodeGenerator::BackpatchBlockExit(const BlockExitInfo& bei, const void* host_code)
+{
+  Xbyak::CodeGenerator cg(BLOCK_EXIT_JUMP_SIZE, bei.host_jump);
+  cg.jmp(host_code, Xbyak::CodeGenerator::T_NEAR);
+  JitCodeBuffer::FlushInstructionCache(bei.host_jump, BLOCK_EXIT_JUMP_SIZE);
+}
+
+void CodeGenerator::BackpatchIndirectBlockExitTarget(const BlockExitInfo& bei, u32 target_pc)
+{
+  std::memcpy(bei.host_target_pc, &target_pc, sizeof(target_pc));
+  JitCodeBuffer::FlushInstructionCache(bei.host_target_pc, sizeof(target_pc));
+}
+
+void CodeGenerator::BackpatchIndirectBlockExitMiss(const BlockExitInfo& bei, const void* host_code)
+{
+  Xbyak::CodeGenerator cg(BLOCK_EXIT_MISS_JUMP_SIZE, bei.host_miss_jump);
+  cg.jne(host_code);
+  JitCodeBuffer::FlushInstructionCache(bei.host_miss_jump, BLOCK_EXIT_MISS_JUMP_SIZE);
+}
+
+void ASMFunctions::Generate(JitCodeBuffer* code_buffer, CodeCache* code_cache)
+{
+#if defined(ABI_WIN64)
+  static constexpr std::array<HostReg, 8> callee_saved_regs = {
+    {Xbyak::Operand::RBX, Xbyak::Operand::RBP, Xbyak::Operand::RDI, Xbyak::Operand::RSI, Xbyak::Operand::R12,
+     Xbyak::Operand::R13, Xbyak::Operand::R14, Xbyak::Operand::R15}};
+#elif defined(ABI_SYSV)
+  static constexpr std::array<HostReg, 6> callee_saved_regs = {{Xbyak::Operand::RBX, Xbyak::Operand::RBP,
+                                                                Xbyak::Operand::R12, Xbyak::Operand::R13,
+                                                                Xbyak::Operand::R14, Xbyak::Operand::R15}};
+#endif
+
+  // An even number of pushes leaves the stack in the same state as on entry to a function, so blocks can call out.
+  static_assert((callee_saved_regs.size() % 2) == 0, "stack is aligned after saving registers");
+  constexpr u32 call_stack_adjust = 8 + FUNCTION_CALL_SHADOW_SPACE;
+
+  Xbyak::CodeGenerator cg(code_buffer->GetFreeCodeSpace(), code_buffer->GetFreeCodePointer());
+  const Xbyak::Reg64 cpu_reg = GetCPUPtrReg();
+  Xbyak::Label dispatch_loop, no_interrupt, lookup_miss, exit_dispatcher;
+
+  // void execute(Core* cpu)
+  execute = cg.getCurr<void (*)(Core*)>();
+  for (HostReg reg : callee_saved_regs)
+    cg.push(GetHostReg64(reg));
+
+  cg.mov(cpu_reg, GetHostReg64(RARG1));
+  cg.mov(GetFastmemBasePtrReg(), cg.qword[cpu_reg + offsetof(Core, m_fastmem_base)]);
+
+  // Blocks jump back here when they finish. The downcount has to be reloaded every time, since any memory access or
+  // function call can schedule an event.
+  cg.L(dispatch_loop);
+  dispatcher = cg.getCurr<const void*>();
+  cg.mov(cg.eax, cg.dword[cpu_reg + offsetof(Core, m_pending_ticks)]);
+  cg.cmp(cg.eax, cg.dword[cpu_reg + offsetof(Core, m_downcount)]);
+  cg.jge(exit_dispatcher, Xbyak::CodeGenerator::T_NEAR);
+
+  // Inlined HasPendingInterrupt(), which always clears the interrupt delay.
+  cg.movzx(cg.ecx, cg.byte[cpu_reg + offsetof(Core, m_interrupt_delay)]);
+  cg.mov(cg.byte[cpu_reg + offsetof(Core, m_interrupt_delay)], 0);
+  cg.mov(cg.eax, cg.dword[cpu_reg + offsetof(Core, m_cop0_regs.sr.bits)]);
+  cg.test(cg.al, 1);
+  cg.jz(no_interrupt);
+  cg.mov(cg.edx, cg.dword[cpu_reg + offsetof(Core, m_cop0_regs.cause.bits)]);
+  cg.and_(cg.edx, cg.eax);
+  cg.test(cg.edx, UINT32_C(0xFF) << 8);
+  cg.jz(no_interrupt);
+  cg.test(cg.ecx, cg.ecx);
+  cg.jnz(no_interrupt);
+  cg.sub(cg.rsp, call_stack_adjust);
+  cg.mov(GetHostReg64(RARG1), cpu_reg);
+  cg.mov(cg.rax, reinterpret_cast<size_t>(&Thunks::DispatchInterrupt));
+  cg.call(cg.rax);
+  cg.add(cg.rsp, call_stack_adjust);
+  cg.mov(cg.eax, cg.dword[cpu_reg + offsetof(Core, m_cop0_regs.sr.bits)]);
+  cg.L(no_interrupt);
+
+  // User mode blocks aren't in the fast map.
+  cg.test(cg.eax, 2);
+  cg.jnz(lookup_miss);
+
+  // Look up the block in the fast map, a null entry means it's not compiled or it was invalidated.
+  static_assert(sizeof(CodeBlock::HostCodePointer) == 8 && sizeof(CodeCache::FastMapPage) == 8);
+  cg.mov(cg.eax, cg.dword[cpu_reg + offsetof(Core, m_regs.pc)]);
+  cg.mov(cg.ecx, cg.eax);
+  cg.shr(cg.ecx, CodeCache::FAST_MAP_PAGE_SHIFT);
+  cg.mov(cg.rdx, reinterpret_cast<size_t>(code_cache->GetFastMap()));
+  cg.mov(cg.rdx, cg.qword[cg.rdx + cg.rcx * 8]);
+  cg.and_(cg.eax, ((1u << CodeCache::FAST_MAP_PAGE_SHIFT) - 1) & ~UINT32_C(3));
+  cg.mov(cg.rax, cg.qword[cg.rdx + cg.rax * 2]);
+  cg.test(cg.rax, cg.rax);
+  cg.jz(lookup_miss);
+  cg.jmp(cg.rax);
+
+  // Compile the block, or interpret it if that fails.
+  cg.L(lookup_miss);
+  cg.sub(cg.rsp, call_stack_adjust);
+  cg.mov(GetHostReg64(RARG1), reinterpret_cast<size_t>(code_cache));
+  cg.mov(cg.rax, reinterpret_cast<size_t>(&Thunks::LookupNextHostCode));
+  cg.call(cg.rax);
+  cg.add(cg.rsp, call_stack_adjust);
+  cg.test(cg.rax, cg.rax);
+  cg.jz(dispatch_loop, Xbyak::CodeGenerator::T_NEAR);
+  cg.jmp(cg.rax);
+
+  // Link a block exit to the next block, and run it. The blocks have already done the checks above.
+  link_block_exit = cg.getCurr<const void*>();
+  cg.sub(cg.rsp, call_stack_adjust);
+  cg.mov(GetHostReg64(RARG1), reinterpret_cast<size_t>(code_cache));
+  cg.mov(cg.rax, reinterpret_cast<size_t>(&Thunks::LinkBlockExit));
+  cg.call(cg.rax);
+  cg.add(cg.rsp, call_stack_adjust);
+  cg.test(cg.rax, cg.rax);
+  cg.jz(dispatch_loop, Xbyak::CodeGenerator::T_NEAR);
+  cg.jmp(cg.rax);
+
+  cg.L(exit_dispatcher);
+  for (auto it = callee_saved_regs.rbegin(); it != callee_saved_regs.rend(); ++it)
+    cg.pop(GetHostReg64(*it));
+  cg.ret();
+
+  cg.ready();
+  code_buffer->ReserveCode(static_cast<u32>(cg.getSize()));
+}
 
 } // namespace CPU::Recompiler
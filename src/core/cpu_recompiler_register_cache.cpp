@@ -182,8 +182,23 @@ u32 RegisterCache::GetFreeHostRegisters() const
   return count;
 }
 
-HostReg RegisterCache::AllocateHostReg(HostRegState state /* = HostRegState::InUse */)
+HostReg RegisterCache::AllocateHostReg(HostRegState state /* = HostRegState::InUse */,
+                                       bool prefer_caller_saved /* = false */)
 {
+  if (prefer_caller_saved)
+  {
+    for (u32 i = 0; i < m_state.available_count; i++)
+    {
+      const HostReg reg = m_host_register_allocation_order[i];
+      if ((m_state.host_reg_state[reg] & (HostRegState::Usable | HostRegState::InUse | HostRegState::CallerSaved)) ==
+          (HostRegState::Usable | HostRegState::CallerSaved))
+      {
+        if (AllocateHostReg(reg, state))
+          return reg;
+      }
+    }
+  }
+
   // try for a free register in allocation order
   for (u32 i = 0; i < m_state.available_count; i++)
   {
@@ -264,7 +279,7 @@ Value RegisterCache::AllocateScratch(RegSize size, HostReg reg /* = HostReg_Inva
 {
   if (reg == HostReg_Invalid)
   {
-    reg = AllocateHostReg();
+    reg = AllocateHostReg(HostRegState::InUse, true);
   }
   else
   {
@@ -401,6 +416,8 @@ Value RegisterCache::ReadGuestRegister(Reg guest_reg, bool cache /* = true */, b
     return Value::FromConstantU32(0);
   }
 
+  MarkGuestRegisterAccessed(guest_reg);
+
   Value& cache_value = m_state.guest_reg_state[static_cast<u8>(guest_reg)];
   if (cache_value.IsValid())
   {
@@ -487,6 +504,7 @@ Value RegisterCache::ReadGuestRegister(Reg guest_reg, bool cache /* = true */, b
 
 Value RegisterCache::ReadGuestRegisterToScratch(Reg guest_reg)
 {
+  MarkGuestRegisterAccessed(guest_reg);
   HostReg host_reg = AllocateHostReg();
 
   Value& cache_value = m_state.guest_reg_state[static_cast<u8>(guest_reg)];
@@ -524,6 +542,8 @@ Value RegisterCache::WriteGuestRegister(Reg guest_reg, Value&& value)
   if (guest_reg == Reg::zero)
     return std::move(value);
 
+  MarkGuestRegisterAccessed(guest_reg);
+
   // cancel any load delay delay
   if (m_state.load_delay_register == guest_reg)
   {
@@ -739,14 +759,62 @@ bool RegisterCache::EvictOneGuestRegister()
   if (m_state.guest_reg_order_count == 0)
     return false;
 
-  // evict the register used the longest time ago
+  // evict the register used the longest time ago, unless there's one which won't be read again
   Reg evict_reg = m_state.guest_reg_order[m_state.guest_reg_order_count - 1];
+  for (u32 i = m_state.guest_reg_order_count; i > 0; i--)
+  {
+    const Reg reg = m_state.guest_reg_order[i - 1];
+    if (!IsGuestRegisterLive(reg))
+    {
+      evict_reg = reg;
+      break;
+    }
+  }
+
   Log_ProfilePrintf("Evicting guest register %s", GetRegName(evict_reg));
   FlushGuestRegister(evict_reg, true, true);
 
   return HasFreeHostRegister();
 }
 
+void RegisterCache::SetLiveGuestRegisters(u32 live_mask)
+{
+  m_live_guest_registers = live_mask;
+  m_accessed_guest_registers = 0;
+}
+
+void RegisterCache::ReleaseDeadGuestRegisters()
+{
+  // the instruction is complete, so its own registers can go too
+  m_accessed_guest_registers = 0;
+
+  for (u8 reg = 0; reg < static_cast<u8>(Reg::count); reg++)
+  {
+    const Value& cache_value = m_state.guest_reg_state[reg];
+    if (cache_value.IsInHostRegister() && !cache_value.IsDirty() && !IsGuestRegisterLive(static_cast<Reg>(reg)))
+    {
+      Log_DebugPrintf("Releasing dead guest register %s", GetRegName(static_cast<Reg>(reg)));
+      InvalidateGuestRegister(static_cast<Reg>(reg));
+    }
+  }
+}
+
+bool RegisterCache::IsGuestRegisterLive(Reg reg) const
+{
+  // HI/LO and the PC aren't part of the liveness mask.
+  if (static_cast<u8>(reg) >= 32)
+    return true;
+
+  const u32 mask = UINT32_C(1) << static_cast<u8>(reg);
+  return ((m_live_guest_registers | m_accessed_guest_registers) & mask) != 0;
+}
+
+void RegisterCache::MarkGuestRegisterAccessed(Reg reg)
+{
+  if (static_cast<u8>(reg) < 32)
+    m_accessed_guest_registers |= UINT32_C(1) << static_cast<u8>(reg);
+}
+
 void RegisterCache::ClearRegisterFromOrder(Reg reg)
 {
   for (u32 i = 0; i < m_state.guest_reg_order_count; i++)
@@ -202,9 +202,10 @@ public:
   u32 GetUsedHostRegisters() const;
   u32 GetFreeHostRegisters() const;
 
-  /// Allocates a new host register. If there are no free registers, the guest register which was accessed the longest
-  /// time ago will be evicted.
-  HostReg AllocateHostReg(HostRegState state = HostRegState::InUse);
+  /// Allocates a new host register. If there are no free registers, a guest register which isn't read again in the
+  /// block is evicted, otherwise the one which was accessed the longest time ago. Short-lived values can prefer
+  /// caller-saved registers, leaving the callee-saved registers for guest registers which are kept across calls.
+  HostReg AllocateHostReg(HostRegState state = HostRegState::InUse, bool prefer_caller_saved = false);
 
   /// Allocates a specific host register. If this register is not free, returns false.
   bool AllocateHostReg(HostReg reg, HostRegState state = HostRegState::InUse);
@@ -299,7 +300,19 @@ public:
   void FlushAllGuestRegisters(bool invalidate, bool clear_dirty);
   bool EvictOneGuestRegister();
 
+  /// Sets the GPRs which are read after the current instruction in the block, before being overwritten. Call before
+  /// compiling each instruction. Registers outside the mask are evicted first, and released by
+  /// ReleaseDeadGuestRegisters().
+  void SetLiveGuestRegisters(u32 live_mask);
+
+  /// Frees the host registers of cached GPRs which aren't dirty and aren't live, so they don't need to be preserved
+  /// across function calls. Call at the end of the instruction.
+  void ReleaseDeadGuestRegisters();
+
 private:
+  bool IsGuestRegisterLive(Reg reg) const;
+  void MarkGuestRegisterAccessed(Reg reg);
+
   void ClearRegisterFromOrder(Reg reg);
   void PushRegisterToOrder(Reg reg);
   void AppendRegisterToOrder(Reg reg);
@@ -329,6 +342,11 @@ private:
   } m_state;
 
   std::stack<RegAllocState> m_state_stack;
+
+  // Liveness of GPRs for the instruction being compiled. Registers accessed by the instruction are never released or
+  // preferred for eviction, since the instruction could still be using them.
+  u32 m_live_guest_registers = UINT32_C(0xFFFFFFFF);
+  u32 m_accessed_guest_registers = 0;
 };
 
 } // namespace CPU::Recompiler
\ No newline at end of file
@@ -164,4 +164,31 @@ void Thunks::WriteGTERegister(Core* cpu, u32 reg, u32 value)
   cpu->m_cop2.WriteRegister(reg, value);
 }
 
+void Thunks::UpdateCacheIsolation(Core* cpu)
+{
+  cpu->UpdateCacheIsolation();
+}
+
+void Thunks::DispatchInterrupt(Core* cpu)
+{
+  // DispatchInterrupt() holds off for GTE instructions, so it needs to know what the next instruction is.
+  cpu->SafeReadMemoryWord(cpu->m_regs.pc, &cpu->m_next_instruction.bits);
+  cpu->DispatchInterrupt();
+}
+
+CodeBlock::HostCodePointer Thunks::LookupNextHostCode(CodeCache* code_cache)
+{
+  return code_cache->LookupNextHostCode();
+}
+
+CodeBlock::HostCodePointer Thunks::LinkBlockExit(CodeCache* code_cache, void* host_jump)
+{
+  return code_cache->LinkBlockExit(host_jump);
+}
+
+void Thunks::SkipIdleLoop(CodeCache* code_cache)
+{
+  code_cache->SkipIdleLoop();
+}
+
 } // namespace CPU::Recompiler
\ No newline at end of file
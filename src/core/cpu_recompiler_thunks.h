@@ -1,4 +1,5 @@
 #pragma once
+#include "cpu_code_cache.h"
 #include "cpu_types.h"
 
 class JitCodeBuffer;
@@ -47,6 +48,11 @@ public:
   static void ExecuteGTEInstruction(Core* cpu, u32 instruction_bits);
   static u32 ReadGTERegister(Core* cpu, u32 reg);
   static void WriteGTERegister(Core* cpu, u32 reg, u32 value);
+  static void UpdateCacheIsolation(Core* cpu);
+  static void DispatchInterrupt(Core* cpu);
+  static CodeBlock::HostCodePointer LookupNextHostCode(CodeCache* code_cache);
+  static CodeBlock::HostCodePointer LinkBlockExit(CodeCache* code_cache, void* host_jump);
+  static void SkipIdleLoop(CodeCache* code_cache);
 };
 
 class ASMFunctions
@@ -59,7 +65,16 @@ public:
   void (*write_memory_word)(u32 address, u16 value);
   void (*write_memory_dword)(u32 address, u32 value);
 
-  void Generate(JitCodeBuffer* code_buffer);
+  /// Runs blocks until the downcount is reached, without returning to C++ between them. Null if not supported.
+  void (*execute)(Core* cpu) = nullptr;
+
+  /// Blocks jump here when they exit, to check for interrupts/events and find the next block.
+  const void* dispatcher = nullptr;
+
+  /// Unlinked block exits jump here with the address of their jump in RARG2, to link it to the next block.
+  const void* link_block_exit = nullptr;
+
+  void Generate(JitCodeBuffer* code_buffer, CodeCache* code_cache);
 };
 
 } // namespace Recompiler
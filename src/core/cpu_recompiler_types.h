@@ -74,9 +74,23 @@ constexpr RegSize HostPointerSize = RegSize_64;
 constexpr u32 MAX_NEAR_HOST_BYTES_PER_INSTRUCTION = 64;
 constexpr u32 MAX_FAR_HOST_BYTES_PER_INSTRUCTION = 128;
 
+// Extra space for GTE commands, RTPT is the largest of the ones emitted inline.
+constexpr u32 MAX_NEAR_HOST_BYTES_PER_GTE_INSTRUCTION = 4096;
+
+// Space for the exits at the end of each block, and their link stubs. Far code also has the i-cache disabled path
+// of the i-cache check with accurate timing.
+constexpr u32 MAX_NEAR_HOST_BYTES_PER_BLOCK = 128;
+constexpr u32 MAX_FAR_HOST_BYTES_PER_BLOCK = 96;
+
+// Space for the i-cache tag check of each line a block covers, with accurate timing.
+constexpr u32 MAX_NEAR_HOST_BYTES_PER_ICACHE_LINE = 64;
+
 // Are shifts implicitly masked to 0..31?
 constexpr bool SHIFTS_ARE_IMPLICITLY_MASKED = true;
 
+// Block exits can be patched to jump straight to the next block, see CodeCache::LinkBlockExit().
+#define RECOMPILER_BLOCK_LINKING 1
+
 // ABI selection
 #if defined(WIN32)
 #define ABI_WIN64 1
@@ -102,9 +116,23 @@ constexpr RegSize HostPointerSize = RegSize_64;
 constexpr u32 MAX_NEAR_HOST_BYTES_PER_INSTRUCTION = 64;
 constexpr u32 MAX_FAR_HOST_BYTES_PER_INSTRUCTION = 128;
 
+// Extra space for GTE commands, which are all calls here.
+constexpr u32 MAX_NEAR_HOST_BYTES_PER_GTE_INSTRUCTION = 0;
+
+// Space for the exits at the end of each block, and their link stubs. Far code also has the i-cache disabled path
+// of the i-cache check with accurate timing.
+constexpr u32 MAX_NEAR_HOST_BYTES_PER_BLOCK = 128;
+constexpr u32 MAX_FAR_HOST_BYTES_PER_BLOCK = 96;
+
+// Space for the i-cache tag check of each line a block covers, with accurate timing.
+constexpr u32 MAX_NEAR_HOST_BYTES_PER_ICACHE_LINE = 64;
+
 // Are shifts implicitly masked to 0..31?
 constexpr bool SHIFTS_ARE_IMPLICITLY_MASKED = true;
 
+// Blocks return to the caller rather than a dispatcher here, so their exits can't be linked. RECOMPILER_BLOCK_LINKING
+// is left undefined.
+
 #else
 
 using HostReg = int;
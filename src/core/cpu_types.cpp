@@ -243,4 +243,314 @@ bool IsInvalidInstruction(const Instruction& instruction)
   return true;
 }
 
-} // namespace CPU
\ No newline at end of file
+static constexpr u32 RegMask(Reg reg)
+{
+  return (UINT32_C(1) << static_cast<u8>(reg));
+}
+
+bool GetALUInstructionRegisterUsage(const Instruction& instruction, u32* read_mask, Reg* write_reg)
+{
+  switch (instruction.op)
+  {
+    case InstructionOp::lui:
+      *read_mask = 0;
+      *write_reg = instruction.i.rt;
+      return true;
+
+    case InstructionOp::andi:
+    case InstructionOp::ori:
+    case InstructionOp::xori:
+    case InstructionOp::addiu:
+    case InstructionOp::slti:
+    case InstructionOp::sltiu:
+      *read_mask = RegMask(instruction.i.rs);
+      *write_reg = instruction.i.rt;
+      return true;
+
+    case InstructionOp::funct:
+    {
+      switch (instruction.r.funct)
+      {
+        case InstructionFunct::sll:
+        case InstructionFunct::srl:
+        case InstructionFunct::sra:
+          *read_mask = RegMask(instruction.r.rt);
+          *write_reg = instruction.r.rd;
+          return true;
+
+        case InstructionFunct::sllv:
+        case InstructionFunct::srlv:
+        case InstructionFunct::srav:
+        case InstructionFunct::and_:
+        case InstructionFunct::or_:
+        case InstructionFunct::xor_:
+        case InstructionFunct::nor:
+        case InstructionFunct::addu:
+        case InstructionFunct::subu:
+        case InstructionFunct::slt:
+        case InstructionFunct::sltu:
+          *read_mask = RegMask(instruction.r.rs) | RegMask(instruction.r.rt);
+          *write_reg = instruction.r.rd;
+          return true;
+
+        // HI/LO aren't tracked, so these only write the GPR.
+        case InstructionFunct::mfhi:
+        case InstructionFunct::mflo:
+          *read_mask = 0;
+          *write_reg = instruction.r.rd;
+          return true;
+
+        default:
+          return false;
+      }
+    }
+
+    default:
+      return false;
+  }
+}
+
+u32 GetInstructionReadRegisterMask(const Instruction& instruction)
+{
+  u32 read_mask;
+  Reg write_reg;
+  if (GetALUInstructionRegisterUsage(instruction, &read_mask, &write_reg))
+    return read_mask;
+
+  switch (instruction.op)
+  {
+    case InstructionOp::j:
+    case InstructionOp::jal:
+      return 0;
+
+    case InstructionOp::b:
+    case InstructionOp::blez:
+    case InstructionOp::bgtz:
+    case InstructionOp::addi:
+    case InstructionOp::lb:
+    case InstructionOp::lh:
+    case InstructionOp::lw:
+    case InstructionOp::lbu:
+    case InstructionOp::lhu:
+    case InstructionOp::lwc0:
+    case InstructionOp::lwc1:
+    case InstructionOp::lwc2:
+    case InstructionOp::lwc3:
+    case InstructionOp::swc0:
+    case InstructionOp::swc1:
+    case InstructionOp::swc2:
+    case InstructionOp::swc3:
+      return RegMask(instruction.i.rs);
+
+    // lwl/lwr merge with the old value of rt.
+    case InstructionOp::beq:
+    case InstructionOp::bne:
+    case InstructionOp::lwl:
+    case InstructionOp::lwr:
+    case InstructionOp::sb:
+    case InstructionOp::sh:
+    case InstructionOp::sw:
+    case InstructionOp::swl:
+    case InstructionOp::swr:
+      return RegMask(instruction.i.rs) | RegMask(instruction.i.rt);
+
+    case InstructionOp::cop0:
+    case InstructionOp::cop2:
+    {
+      if (instruction.cop.IsCommonInstruction())
+      {
+        const CopCommonInstruction common_op = instruction.cop.CommonOp();
+        if (common_op == CopCommonInstruction::mtcn || common_op == CopCommonInstruction::ctcn)
+          return RegMask(instruction.r.rt);
+      }
+
+      // Moves from the coprocessor, rfe, and GTE commands don't read GPRs.
+      return 0;
+    }
+
+    case InstructionOp::funct:
+    {
+      switch (instruction.r.funct)
+      {
+        case InstructionFunct::syscall:
+        case InstructionFunct::break_:
+          return 0;
+
+        case InstructionFunct::jr:
+        case InstructionFunct::jalr:
+        case InstructionFunct::mthi:
+        case InstructionFunct::mtlo:
+          return RegMask(instruction.r.rs);
+
+        case InstructionFunct::add:
+        case InstructionFunct::sub:
+        case InstructionFunct::mult:
+        case InstructionFunct::multu:
+        case InstructionFunct::div:
+        case InstructionFunct::divu:
+          return RegMask(instruction.r.rs) | RegMask(instruction.r.rt);
+
+        default:
+          return UINT32_C(0xFFFFFFFF);
+      }
+    }
+
+    default:
+      return UINT32_C(0xFFFFFFFF);
+  }
+}
+
+ThreadedInstruction DecodeThreadedInstruction(const Instruction& instruction, u32 pc, bool is_branch_delay_slot,
+                                              bool needs_full_state)
+{
+  ThreadedInstruction ti = {};
+  ti.instruction.bits = instruction.bits;
+  ti.pc = pc;
+  ti.is_branch_delay_slot = is_branch_delay_slot;
+  ti.rs = instruction.i.rs;
+  ti.rt = instruction.i.rt;
+  ti.rd = instruction.r.rd;
+
+  u32 read_mask;
+  Reg write_reg;
+  ThreadedOp op = ThreadedOp::interpret;
+  if (GetALUInstructionRegisterUsage(instruction, &read_mask, &write_reg) && write_reg == Reg::zero)
+  {
+    op = ThreadedOp::nop;
+  }
+  else
+  {
+    switch (instruction.op)
+    {
+      case InstructionOp::funct:
+      {
+        ti.imm = instruction.r.shamt;
+        switch (instruction.r.funct)
+        {
+            // clang-format off
+          case InstructionFunct::sll: op = ThreadedOp::sll; break;
+          case InstructionFunct::srl: op = ThreadedOp::srl; break;
+          case InstructionFunct::sra: op = ThreadedOp::sra; break;
+          case InstructionFunct::sllv: op = ThreadedOp::sllv; break;
+          case InstructionFunct::srlv: op = ThreadedOp::srlv; break;
+          case InstructionFunct::srav: op = ThreadedOp::srav; break;
+          case InstructionFunct::and_: op = ThreadedOp::and_; break;
+          case InstructionFunct::or_: op = ThreadedOp::or_; break;
+          case InstructionFunct::xor_: op = ThreadedOp::xor_; break;
+          case InstructionFunct::nor: op = ThreadedOp::nor; break;
+          case InstructionFunct::add: op = ThreadedOp::add; break;
+          case InstructionFunct::addu: op = ThreadedOp::addu; break;
+          case InstructionFunct::sub: op = ThreadedOp::sub; break;
+          case InstructionFunct::subu: op = ThreadedOp::subu; break;
+          case InstructionFunct::slt: op = ThreadedOp::slt; break;
+          case InstructionFunct::sltu: op = ThreadedOp::sltu; break;
+          case InstructionFunct::mfhi: op = ThreadedOp::mfhi; break;
+          case InstructionFunct::mthi: op = ThreadedOp::mthi; break;
+          case InstructionFunct::mflo: op = ThreadedOp::mflo; break;
+          case InstructionFunct::mtlo: op = ThreadedOp::mtlo; break;
+          case InstructionFunct::mult: op = ThreadedOp::mult; break;
+          case InstructionFunct::multu: op = ThreadedOp::multu; break;
+          case InstructionFunct::div: op = ThreadedOp::div; break;
+          case InstructionFunct::divu: op = ThreadedOp::divu; break;
+          case InstructionFunct::jr: op = ThreadedOp::jr; break;
+          case InstructionFunct::jalr: op = ThreadedOp::jalr; break;
+          default: break;
+            // clang-format on
+        }
+      }
+      break;
+
+      case InstructionOp::lui:
+        op = ThreadedOp::lui;
+        ti.imm = instruction.i.imm_zext32() << 16;
+        break;
+
+      case InstructionOp::andi:
+      case InstructionOp::ori:
+      case InstructionOp::xori:
+        op = (instruction.op == InstructionOp::andi) ?
+               ThreadedOp::andi :
+               ((instruction.op == InstructionOp::ori) ? ThreadedOp::ori : ThreadedOp::xori);
+        ti.imm = instruction.i.imm_zext32();
+        break;
+
+      case InstructionOp::beq:
+      case InstructionOp::bne:
+      case InstructionOp::bgtz:
+      case InstructionOp::blez:
+      case InstructionOp::b:
+      {
+        // clang-format off
+        switch (instruction.op)
+        {
+          case InstructionOp::beq: op = ThreadedOp::beq; break;
+          case InstructionOp::bne: op = ThreadedOp::bne; break;
+          case InstructionOp::bgtz: op = ThreadedOp::bgtz; break;
+          case InstructionOp::blez: op = ThreadedOp::blez; break;
+          default: op = ThreadedOp::b; break;
+        }
+        // clang-format on
+        ti.imm = instruction.i.imm_sext32() << 2;
+      }
+      break;
+
+      case InstructionOp::j:
+      case InstructionOp::jal:
+        op = (instruction.op == InstructionOp::j) ? ThreadedOp::j : ThreadedOp::jal;
+        ti.imm = instruction.j.target << 2;
+        break;
+
+      default:
+      {
+        ti.imm = instruction.i.imm_sext32();
+        switch (instruction.op)
+        {
+            // clang-format off
+          case InstructionOp::addi: op = ThreadedOp::addi; break;
+          case InstructionOp::addiu: op = ThreadedOp::addiu; break;
+          case InstructionOp::slti: op = ThreadedOp::slti; break;
+          case InstructionOp::sltiu: op = ThreadedOp::sltiu; break;
+          case InstructionOp::lb: op = ThreadedOp::lb; break;
+          case InstructionOp::lbu: op = ThreadedOp::lbu; break;
+          case InstructionOp::lh: op = ThreadedOp::lh; break;
+          case InstructionOp::lhu: op = ThreadedOp::lhu; break;
+          case InstructionOp::lw: op = ThreadedOp::lw; break;
+          case InstructionOp::sb: op = ThreadedOp::sb; break;
+          case InstructionOp::sh: op = ThreadedOp::sh; break;
+          case InstructionOp::sw: op = ThreadedOp::sw; break;
+          default: break;
+            // clang-format on
+        }
+      }
+      break;
+    }
+  }
+
+  switch (op)
+  {
+    case ThreadedOp::add:
+    case ThreadedOp::sub:
+    case ThreadedOp::addi:
+    case ThreadedOp::lb:
+    case ThreadedOp::lbu:
+    case ThreadedOp::lh:
+    case ThreadedOp::lhu:
+    case ThreadedOp::lw:
+    case ThreadedOp::sb:
+    case ThreadedOp::sh:
+    case ThreadedOp::sw:
+    case ThreadedOp::jr:
+    case ThreadedOp::jalr:
+    case ThreadedOp::interpret:
+      needs_full_state = true;
+      break;
+
+    default:
+      break;
+  }
+
+  ti.op = needs_full_state ? static_cast<ThreadedOp>(static_cast<u8>(op) + 1) : op;
+  return ti;
+}
+
+} // namespace CPU
@@ -16,6 +16,16 @@ enum : u32
   INSTRUCTION_SIZE = sizeof(u32)
 };
 
+// Direct-mapped 4KB instruction cache, used for KUSEG and KSEG0 fetches when enabled in the cache control register.
+enum : u32
+{
+  ICACHE_LINE_SIZE = 16,
+  ICACHE_LINES = 256,
+  ICACHE_SIZE = ICACHE_LINE_SIZE * ICACHE_LINES,
+  ICACHE_INVALID_TAG = 0xFFFFFFFF,
+  CACHE_CONTROL_ICACHE_ENABLE_BIT = 11
+};
+
 enum class Reg : u8
 {
   zero,
@@ -222,6 +232,52 @@ bool IsExitBlockInstruction(const Instruction& instruction);
 bool CanInstructionTrap(const Instruction& instruction, bool in_user_mode);
 bool IsInvalidInstruction(const Instruction& instruction);
 
+/// Returns the registers used by an ALU instruction which can't trap, and has no effects other than writing
+/// write_reg (which may be $zero). Returns false for all other instructions.
+bool GetALUInstructionRegisterUsage(const Instruction& instruction, u32* read_mask, Reg* write_reg);
+
+/// Returns a mask of the GPRs which an instruction reads. Unknown instructions are assumed to read all registers.
+u32 GetInstructionReadRegisterMask(const Instruction& instruction);
+
+// Handlers for the threaded-code interpreter. Anything which isn't listed goes through the regular interpreter.
+#define CPU_THREADED_INTERPRETER_OPS(X)                                                                                \
+  X(nop)                                                                                                               \
+  X(sll) X(srl) X(sra) X(sllv) X(srlv) X(srav) X(and_) X(or_) X(xor_) X(nor) X(add) X(addu) X(sub) X(subu) X(slt)     \
+  X(sltu) X(mfhi) X(mthi) X(mflo) X(mtlo) X(mult) X(multu) X(div) X(divu) X(jr) X(jalr) X(lui) X(andi) X(ori)         \
+  X(xori) X(addi) X(addiu) X(slti) X(sltiu) X(lb) X(lbu) X(lh) X(lhu) X(lw) X(sb) X(sh) X(sw) X(j) X(jal) X(beq)      \
+  X(bne) X(bgtz) X(blez) X(b) X(interpret)
+
+/// Each handler has a variant which keeps the full interpreter state up to date, which is needed for instructions which
+/// can raise exceptions, are in a delay slot, or are at the start or end of a block. The other variant only updates the
+/// PC and cycle count. Full variants always have the low bit set.
+enum class ThreadedOp : u8
+{
+#define CPU_THREADED_INTERPRETER_OP_ENUM(name) name, name##_full,
+  CPU_THREADED_INTERPRETER_OPS(CPU_THREADED_INTERPRETER_OP_ENUM)
+#undef CPU_THREADED_INTERPRETER_OP_ENUM
+  end,
+  count
+};
+
+struct ThreadedInstruction
+{
+  ThreadedOp op;
+  Reg rs;
+  Reg rt;
+  Reg rd;
+  u32 imm; // extended immediate, shift amount, or branch offset in bytes
+  Instruction instruction;
+  u32 pc;
+  bool is_branch_delay_slot;
+
+  ALWAYS_INLINE bool NeedsFullState() const { return (static_cast<u8>(op) & 1u) != 0; }
+};
+
+/// Picks the handler for an instruction, and extracts its operands. Instructions which can trap, access memory, or
+/// have a load delay always use the full state variant, others only when needs_full_state is set.
+ThreadedInstruction DecodeThreadedInstruction(const Instruction& instruction, u32 pc, bool is_branch_delay_slot,
+                                              bool needs_full_state);
+
 struct Registers
 {
   union
@@ -13,7 +13,7 @@
 #include <imgui.h>
 Log_SetChannel(GPU);
 
-const GPU::GP0CommandHandlerTable GPU::s_GP0_command_handler_table = GPU::GenerateGP0CommandHandlerTable();
+const GPU::GP0CommandTable GPU::s_GP0_command_table = GPU::GenerateGP0CommandTable();
 
 GPU::GPU() = default;
 
@@ -851,6 +851,10 @@ u32 GPU::ReadGPUREAD()
   if (m_blitter_state != BlitterState::ReadingVRAM)
     return m_GPUREAD_latch;
 
+  // the readback was started when the command executed, wait for it before the first word is read
+  if (m_vram_transfer.col == 0 && m_vram_transfer.row == 0)
+    CompleteReadVRAM();
+
   // Read two pixels out of VRAM and combine them. Zero fill odd pixel counts.
   u32 value = 0;
   for (u32 i = 0; i < 2; i++)
@@ -1104,6 +1108,13 @@ void GPU::UpdateDisplay() {}
 
 void GPU::ReadVRAM(u32 x, u32 y, u32 width, u32 height) {}
 
+void GPU::BeginReadVRAM(u32 x, u32 y, u32 width, u32 height)
+{
+  ReadVRAM(x, y, width, height);
+}
+
+void GPU::CompleteReadVRAM() {}
+
 void GPU::FillVRAM(u32 x, u32 y, u32 width, u32 height, u32 color)
 {
   const u16 color16 = RGBA8888ToRGBA5551(color);
@@ -1259,7 +1270,7 @@ void GPU::CopyVRAM(u32 src_x, u32 src_y, u32 dst_x, u32 dst_y, u32 width, u32 he
   }
 }
 
-void GPU::DispatchRenderCommand() {}
+void GPU::DispatchRenderCommand(const u32* words) {}
 
 void GPU::FlushRender() {}
 
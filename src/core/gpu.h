@@ -99,7 +99,8 @@ public:
     DOT_TIMER_INDEX = 0,
     HBLANK_TIMER_INDEX = 1,
     MAX_RESOLUTION_SCALE = 16,
-    DITHER_MATRIX_SIZE = 4
+    DITHER_MATRIX_SIZE = 4,
+    MAX_GP0_COMMAND_WORDS = 12
   };
 
   enum : u16
@@ -404,15 +405,23 @@ protected:
 
   void WriteGP1(u32 value);
   void EndCommand();
+  const u32* GetCommandWords(u32 count);
   void ExecuteCommands();
   void HandleGetGPUInfoCommand(u32 value);
 
   // Rendering in the backend
   virtual void ReadVRAM(u32 x, u32 y, u32 width, u32 height);
+
+  /// Starts reading an area of VRAM back to m_vram_ptr without waiting for it. The data is only valid after
+  /// CompleteReadVRAM() is called. Backends which can't read asynchronously read immediately.
+  virtual void BeginReadVRAM(u32 x, u32 y, u32 width, u32 height);
+  virtual void CompleteReadVRAM();
+
   virtual void FillVRAM(u32 x, u32 y, u32 width, u32 height, u32 color);
   virtual void UpdateVRAM(u32 x, u32 y, u32 width, u32 height, const void* data);
   virtual void CopyVRAM(u32 src_x, u32 src_y, u32 dst_x, u32 dst_y, u32 width, u32 height);
-  virtual void DispatchRenderCommand();
+  /// words points to the vertex data following the command word, in the FIFO or the poly-line buffer.
+  virtual void DispatchRenderCommand(const u32* words);
   virtual void FlushRender();
   virtual void UpdateDisplay();
   virtual void DrawRendererStats(bool is_idle_frame);
@@ -709,6 +718,7 @@ protected:
   } m_vram_transfer = {};
 
   HeapFIFOQueue<u32, MAX_FIFO_SIZE> m_fifo;
+  std::array<u32, MAX_GP0_COMMAND_WORDS> m_command_words = {};
   std::vector<u32> m_blit_buffer;
   u32 m_blit_remaining_words;
   RenderCommand m_render_command{};
@@ -729,31 +739,39 @@ protected:
   Stats m_last_stats = {};
 
 private:
-  using GP0CommandHandler = bool (GPU::*)();
-  using GP0CommandHandlerTable = std::array<GP0CommandHandler, 256>;
-  static GP0CommandHandlerTable GenerateGP0CommandHandlerTable();
-
-  // Rendering commands, returns false if not enough data is provided
-  bool HandleUnknownGP0Command();
-  bool HandleNOPCommand();
-  bool HandleClearCacheCommand();
-  bool HandleInterruptRequestCommand();
-  bool HandleSetDrawModeCommand();
-  bool HandleSetTextureWindowCommand();
-  bool HandleSetDrawingAreaTopLeftCommand();
-  bool HandleSetDrawingAreaBottomRightCommand();
-  bool HandleSetDrawingOffsetCommand();
-  bool HandleSetMaskBitCommand();
-  bool HandleRenderPolygonCommand();
-  bool HandleRenderRectangleCommand();
-  bool HandleRenderLineCommand();
-  bool HandleRenderPolyLineCommand();
-  bool HandleFillRectangleCommand();
-  bool HandleCopyRectangleCPUToVRAMCommand();
-  bool HandleCopyRectangleVRAMToCPUCommand();
-  bool HandleCopyRectangleVRAMToVRAMCommand();
-
-  static const GP0CommandHandlerTable s_GP0_command_handler_table;
+  using GP0CommandHandler = void (GPU::*)();
+  struct GP0Command
+  {
+    GP0CommandHandler handler;
+
+    /// Number of words which must be in the FIFO before the handler is called, including the command word. Data
+    /// for CPU->VRAM copies and the vertices of poly-lines past the first are consumed later by the blitter.
+    u8 num_words;
+  };
+  using GP0CommandTable = std::array<GP0Command, 256>;
+  static GP0CommandTable GenerateGP0CommandTable();
+
+  // Rendering commands, only called once the whole command is in the FIFO
+  void HandleUnknownGP0Command();
+  void HandleNOPCommand();
+  void HandleClearCacheCommand();
+  void HandleInterruptRequestCommand();
+  void HandleSetDrawModeCommand();
+  void HandleSetTextureWindowCommand();
+  void HandleSetDrawingAreaTopLeftCommand();
+  void HandleSetDrawingAreaBottomRightCommand();
+  void HandleSetDrawingOffsetCommand();
+  void HandleSetMaskBitCommand();
+  void HandleRenderPolygonCommand();
+  void HandleRenderRectangleCommand();
+  void HandleRenderLineCommand();
+  void HandleRenderPolyLineCommand();
+  void HandleFillRectangleCommand();
+  void HandleCopyRectangleCPUToVRAMCommand();
+  void HandleCopyRectangleVRAMToCPUCommand();
+  void HandleCopyRectangleVRAMToVRAMCommand();
+
+  static const GP0CommandTable s_GP0_command_table;
 };
 
 IMPLEMENT_ENUM_CLASS_BITWISE_OPERATORS(GPU::TextureMode);
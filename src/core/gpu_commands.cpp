@@ -6,13 +6,6 @@
 #include "system.h"
 Log_SetChannel(GPU);
 
-#define CHECK_COMMAND_SIZE(num_words)                                                                                  \
-  if (m_fifo.GetSize() < num_words)                                                                                    \
-  {                                                                                                                    \
-    m_command_total_words = num_words;                                                                                 \
-    return false;                                                                                                      \
-  }
-
 static u32 s_cpu_to_vram_dump_id = 1;
 static u32 s_vram_to_cpu_dump_id = 1;
 
@@ -33,11 +26,15 @@ void GPU::ExecuteCommands()
       {
         case BlitterState::Idle:
         {
-          const u32 command = m_fifo.Peek(0) >> 24;
-          if ((this->*s_GP0_command_handler_table[command])())
-            continue;
-          else
+          const GP0Command& command = s_GP0_command_table[m_fifo.Peek(0) >> 24];
+          if (m_fifo.GetSize() < command.num_words)
+          {
+            m_command_total_words = command.num_words;
             goto batch_done;
+          }
+
+          (this->*command.handler)();
+          continue;
         }
 
         case BlitterState::WritingVRAM:
@@ -91,7 +88,7 @@ void GPU::ExecuteCommands()
             // drop terminator
             m_fifo.RemoveOne();
             Log_DebugPrintf("Drawing poly-line with %u vertices", GetPolyLineVertexCount());
-            DispatchRenderCommand();
+            DispatchRenderCommand(m_blit_buffer.data());
             m_blit_buffer.clear();
             EndCommand();
             continue;
@@ -118,57 +115,86 @@ void GPU::EndCommand()
   m_command_total_words = 0;
 }
 
-GPU::GP0CommandHandlerTable GPU::GenerateGP0CommandHandlerTable()
+const u32* GPU::GetCommandWords(u32 count)
 {
-  GP0CommandHandlerTable table = {};
+  DebugAssert(count <= MAX_GP0_COMMAND_WORDS && m_fifo.GetSize() >= count);
+
+  // most commands are contiguous in the FIFO, so they can be decoded in place
+  if (m_fifo.GetContiguousSize() >= count)
+    return m_fifo.GetReadPointer();
+
+  for (u32 i = 0; i < count; i++)
+    m_command_words[i] = m_fifo.Peek(i);
+
+  return m_command_words.data();
+}
+
+GPU::GP0CommandTable GPU::GenerateGP0CommandTable()
+{
+  GP0CommandTable table = {};
   for (u32 i = 0; i < static_cast<u32>(table.size()); i++)
-    table[i] = &GPU::HandleUnknownGP0Command;
-  table[0x00] = &GPU::HandleNOPCommand;
-  table[0x01] = &GPU::HandleClearCacheCommand;
-  table[0x02] = &GPU::HandleFillRectangleCommand;
-  table[0x03] = &GPU::HandleNOPCommand;
+    table[i] = {&GPU::HandleUnknownGP0Command, 1};
+  table[0x00] = {&GPU::HandleNOPCommand, 1};
+  table[0x01] = {&GPU::HandleClearCacheCommand, 1};
+  table[0x02] = {&GPU::HandleFillRectangleCommand, 3};
+  table[0x03] = {&GPU::HandleNOPCommand, 1};
   for (u32 i = 0x04; i <= 0x1E; i++)
-    table[i] = &GPU::HandleNOPCommand;
-  table[0x1F] = &GPU::HandleInterruptRequestCommand;
+    table[i] = {&GPU::HandleNOPCommand, 1};
+  table[0x1F] = {&GPU::HandleInterruptRequestCommand, 1};
   for (u32 i = 0x20; i <= 0x7F; i++)
   {
     const RenderCommand rc{i << 24};
     switch (rc.primitive)
     {
       case Primitive::Polygon:
-        table[i] = &GPU::HandleRenderPolygonCommand;
-        break;
+      {
+        const u32 words_per_vertex = 1 + BoolToUInt32(rc.texture_enable) + BoolToUInt32(rc.shading_enable);
+        const u32 num_vertices = rc.quad_polygon ? 4 : 3;
+        table[i] = {&GPU::HandleRenderPolygonCommand,
+                    static_cast<u8>(words_per_vertex * num_vertices + BoolToUInt32(!rc.shading_enable))};
+      }
+      break;
       case Primitive::Line:
-        table[i] = rc.polyline ? &GPU::HandleRenderPolyLineCommand : &GPU::HandleRenderLineCommand;
-        break;
+      {
+        // poly-lines only need the first vertex up front, the rest goes through the blit buffer
+        if (rc.polyline)
+          table[i] = {&GPU::HandleRenderPolyLineCommand, static_cast<u8>(rc.shading_enable ? 3 : 4)};
+        else
+          table[i] = {&GPU::HandleRenderLineCommand, static_cast<u8>(rc.shading_enable ? 4 : 3)};
+      }
+      break;
       case Primitive::Rectangle:
-        table[i] = &GPU::HandleRenderRectangleCommand;
-        break;
+      {
+        table[i] = {&GPU::HandleRenderRectangleCommand,
+                    static_cast<u8>(2 + BoolToUInt32(rc.texture_enable) +
+                                    BoolToUInt32(rc.rectangle_size == DrawRectangleSize::Variable))};
+      }
+      break;
       default:
-        table[i] = &GPU::HandleUnknownGP0Command;
+        table[i] = {&GPU::HandleUnknownGP0Command, 1};
         break;
     }
   }
-  table[0xE0] = &GPU::HandleNOPCommand;
-  table[0xE1] = &GPU::HandleSetDrawModeCommand;
-  table[0xE2] = &GPU::HandleSetTextureWindowCommand;
-  table[0xE3] = &GPU::HandleSetDrawingAreaTopLeftCommand;
-  table[0xE4] = &GPU::HandleSetDrawingAreaBottomRightCommand;
-  table[0xE5] = &GPU::HandleSetDrawingOffsetCommand;
-  table[0xE6] = &GPU::HandleSetMaskBitCommand;
+  table[0xE0] = {&GPU::HandleNOPCommand, 1};
+  table[0xE1] = {&GPU::HandleSetDrawModeCommand, 1};
+  table[0xE2] = {&GPU::HandleSetTextureWindowCommand, 1};
+  table[0xE3] = {&GPU::HandleSetDrawingAreaTopLeftCommand, 1};
+  table[0xE4] = {&GPU::HandleSetDrawingAreaBottomRightCommand, 1};
+  table[0xE5] = {&GPU::HandleSetDrawingOffsetCommand, 1};
+  table[0xE6] = {&GPU::HandleSetMaskBitCommand, 1};
   for (u32 i = 0xE7; i <= 0xEF; i++)
-    table[i] = &GPU::HandleNOPCommand;
+    table[i] = {&GPU::HandleNOPCommand, 1};
   for (u32 i = 0x80; i <= 0x9F; i++)
-    table[i] = &GPU::HandleCopyRectangleVRAMToVRAMCommand;
+    table[i] = {&GPU::HandleCopyRectangleVRAMToVRAMCommand, 4};
   for (u32 i = 0xA0; i <= 0xBF; i++)
-    table[i] = &GPU::HandleCopyRectangleCPUToVRAMCommand;
+    table[i] = {&GPU::HandleCopyRectangleCPUToVRAMCommand, 3};
   for (u32 i = 0xC0; i <= 0xDF; i++)
-    table[i] = &GPU::HandleCopyRectangleVRAMToCPUCommand;
+    table[i] = {&GPU::HandleCopyRectangleVRAMToCPUCommand, 3};
 
   return table;
 }
 
-bool GPU::HandleUnknownGP0Command()
+void GPU::HandleUnknownGP0Command()
 {
   const u32 command = m_fifo.Peek() >> 24;
   Log_ErrorPrintf("Unimplemented GP0 command 0x%02X", command);
@@ -180,26 +206,23 @@ bool GPU::HandleUnknownGP0Command()
 
   m_fifo.RemoveOne();
   EndCommand();
-  return true;
 }
 
-bool GPU::HandleNOPCommand()
+void GPU::HandleNOPCommand()
 {
   m_fifo.RemoveOne();
   EndCommand();
-  return true;
 }
 
-bool GPU::HandleClearCacheCommand()
+void GPU::HandleClearCacheCommand()
 {
   Log_DebugPrintf("GP0 clear cache");
   m_fifo.RemoveOne();
   AddCommandTicks(1);
   EndCommand();
-  return true;
 }
 
-bool GPU::HandleInterruptRequestCommand()
+void GPU::HandleInterruptRequestCommand()
 {
   Log_WarningPrintf("GP0 interrupt request");
   if (!m_GPUSTAT.interrupt_request)
@@ -211,20 +234,18 @@ bool GPU::HandleInterruptRequestCommand()
   m_fifo.RemoveOne();
   AddCommandTicks(1);
   EndCommand();
-  return true;
 }
 
-bool GPU::HandleSetDrawModeCommand()
+void GPU::HandleSetDrawModeCommand()
 {
   const u32 param = m_fifo.Pop() & 0x00FFFFFFu;
   Log_DebugPrintf("Set draw mode %08X", param);
   SetDrawMode(Truncate16(param));
   AddCommandTicks(1);
   EndCommand();
-  return true;
 }
 
-bool GPU::HandleSetTextureWindowCommand()
+void GPU::HandleSetTextureWindowCommand()
 {
   const u32 param = m_fifo.Pop() & 0x00FFFFFFu;
   SetTextureWindow(param);
@@ -234,10 +255,9 @@ bool GPU::HandleSetTextureWindowCommand()
 
   AddCommandTicks(1);
   EndCommand();
-  return true;
 }
 
-bool GPU::HandleSetDrawingAreaTopLeftCommand()
+void GPU::HandleSetDrawingAreaTopLeftCommand()
 {
   const u32 param = m_fifo.Pop() & 0x00FFFFFFu;
   const u32 left = param & VRAM_WIDTH_MASK;
@@ -254,10 +274,9 @@ bool GPU::HandleSetDrawingAreaTopLeftCommand()
 
   AddCommandTicks(1);
   EndCommand();
-  return true;
 }
 
-bool GPU::HandleSetDrawingAreaBottomRightCommand()
+void GPU::HandleSetDrawingAreaBottomRightCommand()
 {
   const u32 param = m_fifo.Pop() & 0x00FFFFFFu;
 
@@ -275,10 +294,9 @@ bool GPU::HandleSetDrawingAreaBottomRightCommand()
 
   AddCommandTicks(1);
   EndCommand();
-  return true;
 }
 
-bool GPU::HandleSetDrawingOffsetCommand()
+void GPU::HandleSetDrawingOffsetCommand()
 {
   const u32 param = m_fifo.Pop() & 0x00FFFFFFu;
   const s32 x = SignExtendN<11, s32>(param & 0x7FFu);
@@ -294,10 +312,9 @@ bool GPU::HandleSetDrawingOffsetCommand()
 
   AddCommandTicks(1);
   EndCommand();
-  return true;
 }
 
-bool GPU::HandleSetMaskBitCommand()
+void GPU::HandleSetMaskBitCommand()
 {
   const u32 param = m_fifo.Pop() & 0x00FFFFFFu;
 
@@ -313,66 +330,60 @@ bool GPU::HandleSetMaskBitCommand()
 
   AddCommandTicks(1);
   EndCommand();
-  return true;
 }
 
-bool GPU::HandleRenderPolygonCommand()
+void GPU::HandleRenderPolygonCommand()
 {
   const RenderCommand rc{m_fifo.Peek(0)};
-
-  // shaded vertices use the colour from the first word for the first vertex
-  const u32 words_per_vertex = 1 + BoolToUInt32(rc.texture_enable) + BoolToUInt32(rc.shading_enable);
   const u32 num_vertices = rc.quad_polygon ? 4 : 3;
-  const u32 total_words = words_per_vertex * num_vertices + BoolToUInt32(!rc.shading_enable);
-  CHECK_COMMAND_SIZE(total_words);
+  const u32 total_words = s_GP0_command_table[rc.bits >> 24].num_words;
 
   if (IsInterlacedRenderingEnabled() && IsCRTCScanlinePending())
     SynchronizeCRTC();
 
+  const u32* words = GetCommandWords(total_words);
+
   // setup time
   static constexpr u16 s_setup_time[2][2][2] = {{{46, 226}, {334, 496}}, {{82, 262}, {370, 532}}};
   const TickCount setup_ticks = static_cast<TickCount>(ZeroExtend32(
     s_setup_time[BoolToUInt8(rc.quad_polygon)][BoolToUInt8(rc.shading_enable)][BoolToUInt8(rc.texture_enable)]));
   AddCommandTicks(setup_ticks);
 
-  Log_TracePrintf("Render %s %s %s %s polygon (%u verts, %u words per vert), %d setup ticks",
+  Log_TracePrintf("Render %s %s %s %s polygon (%u verts, %u words), %d setup ticks",
                   rc.quad_polygon ? "four-point" : "three-point",
                   rc.transparency_enable ? "semi-transparent" : "opaque",
                   rc.texture_enable ? "textured" : "non-textured", rc.shading_enable ? "shaded" : "monochrome",
-                  ZeroExtend32(num_vertices), ZeroExtend32(words_per_vertex), setup_ticks);
+                  ZeroExtend32(num_vertices), total_words, setup_ticks);
 
   // set draw state up
   if (rc.texture_enable)
   {
-    const u16 texpage_attribute = Truncate16((rc.shading_enable ? m_fifo.Peek(5) : m_fifo.Peek(4)) >> 16);
+    const u16 texpage_attribute = Truncate16((rc.shading_enable ? words[5] : words[4]) >> 16);
     SetDrawMode((texpage_attribute & DrawMode::Reg::POLYGON_TEXPAGE_MASK) |
                 (m_draw_mode.mode_reg.bits & ~DrawMode::Reg::POLYGON_TEXPAGE_MASK));
-    SetTexturePalette(Truncate16(m_fifo.Peek(2) >> 16));
+    SetTexturePalette(Truncate16(words[2] >> 16));
   }
 
   m_stats.num_vertices += num_vertices;
   m_stats.num_polygons++;
   m_render_command.bits = rc.bits;
-  m_fifo.RemoveOne();
 
-  DispatchRenderCommand();
+  DispatchRenderCommand(words + 1);
+  m_fifo.Remove(total_words);
   EndCommand();
-  return true;
 }
 
-bool GPU::HandleRenderRectangleCommand()
+void GPU::HandleRenderRectangleCommand()
 {
   const RenderCommand rc{m_fifo.Peek(0)};
-  const u32 total_words =
-    2 + BoolToUInt32(rc.texture_enable) + BoolToUInt32(rc.rectangle_size == DrawRectangleSize::Variable);
-
-  CHECK_COMMAND_SIZE(total_words);
+  const u32 total_words = s_GP0_command_table[rc.bits >> 24].num_words;
 
   if (IsInterlacedRenderingEnabled() && IsCRTCScanlinePending())
     SynchronizeCRTC();
 
+  const u32* words = GetCommandWords(total_words);
   if (rc.texture_enable)
-    SetTexturePalette(Truncate16(m_fifo.Peek(2) >> 16));
+    SetTexturePalette(Truncate16(words[2] >> 16));
 
   const TickCount setup_ticks = 16;
   AddCommandTicks(setup_ticks);
@@ -385,41 +396,39 @@ bool GPU::HandleRenderRectangleCommand()
   m_stats.num_vertices++;
   m_stats.num_polygons++;
   m_render_command.bits = rc.bits;
-  m_fifo.RemoveOne();
 
-  DispatchRenderCommand();
+  DispatchRenderCommand(words + 1);
+  m_fifo.Remove(total_words);
   EndCommand();
-  return true;
 }
 
-bool GPU::HandleRenderLineCommand()
+void GPU::HandleRenderLineCommand()
 {
   const RenderCommand rc{m_fifo.Peek(0)};
-  const u32 total_words = rc.shading_enable ? 4 : 3;
-  CHECK_COMMAND_SIZE(total_words);
+  const u32 total_words = s_GP0_command_table[rc.bits >> 24].num_words;
 
   if (IsInterlacedRenderingEnabled() && IsCRTCScanlinePending())
     SynchronizeCRTC();
 
+  const u32* words = GetCommandWords(total_words);
+
   Log_TracePrintf("Render %s %s line (%u total words)", rc.transparency_enable ? "semi-transparent" : "opaque",
                   rc.shading_enable ? "shaded" : "monochrome", total_words);
 
   m_stats.num_vertices += 2;
   m_stats.num_polygons++;
   m_render_command.bits = rc.bits;
-  m_fifo.RemoveOne();
 
-  DispatchRenderCommand();
+  DispatchRenderCommand(words + 1);
+  m_fifo.Remove(total_words);
   EndCommand();
-  return true;
 }
 
-bool GPU::HandleRenderPolyLineCommand()
+void GPU::HandleRenderPolyLineCommand()
 {
   // always read the first two vertices, we test for the terminator after that
   const RenderCommand rc{m_fifo.Peek(0)};
-  const u32 min_words = rc.shading_enable ? 3 : 4;
-  CHECK_COMMAND_SIZE(min_words);
+  const u32 min_words = s_GP0_command_table[rc.bits >> 24].num_words;
 
   if (IsInterlacedRenderingEnabled() && IsCRTCScanlinePending())
     SynchronizeCRTC();
@@ -440,13 +449,10 @@ bool GPU::HandleRenderPolyLineCommand()
   // polyline goes via a different path through the blit buffer
   m_blitter_state = BlitterState::DrawingPolyLine;
   m_command_total_words = 0;
-  return true;
 }
 
-bool GPU::HandleFillRectangleCommand()
+void GPU::HandleFillRectangleCommand()
 {
-  CHECK_COMMAND_SIZE(3);
-
   if (IsInterlacedRenderingEnabled() && IsCRTCScanlinePending())
     SynchronizeCRTC();
 
@@ -464,12 +470,10 @@ bool GPU::HandleFillRectangleCommand()
   m_stats.num_vram_fills++;
   AddCommandTicks(46 + ((width / 8) + 9) * height);
   EndCommand();
-  return true;
 }
 
-bool GPU::HandleCopyRectangleCPUToVRAMCommand()
+void GPU::HandleCopyRectangleCPUToVRAMCommand()
 {
-  CHECK_COMMAND_SIZE(3);
   m_fifo.RemoveOne();
 
   const u32 dst_x = m_fifo.Peek() & VRAM_COORD_MASK;
@@ -491,7 +495,6 @@ bool GPU::HandleCopyRectangleCPUToVRAMCommand()
   m_vram_transfer.y = Truncate16(dst_y);
   m_vram_transfer.width = Truncate16(copy_width);
   m_vram_transfer.height = Truncate16(copy_height);
-  return true;
 }
 
 void GPU::FinishVRAMWrite()
@@ -515,9 +518,8 @@ void GPU::FinishVRAMWrite()
   m_stats.num_vram_writes++;
 }
 
-bool GPU::HandleCopyRectangleVRAMToCPUCommand()
+void GPU::HandleCopyRectangleVRAMToCPUCommand()
 {
-  CHECK_COMMAND_SIZE(3);
   m_fifo.RemoveOne();
 
   m_vram_transfer.x = Truncate16(m_fifo.Peek() & VRAM_COORD_MASK);
@@ -532,11 +534,12 @@ bool GPU::HandleCopyRectangleVRAMToCPUCommand()
   // all rendering should be done first...
   FlushRender();
 
-  // ensure VRAM shadow is up to date
-  ReadVRAM(m_vram_transfer.x, m_vram_transfer.y, m_vram_transfer.width, m_vram_transfer.height);
+  // start bringing the VRAM shadow up to date, the CPU won't need it until it reads GPUREAD
+  BeginReadVRAM(m_vram_transfer.x, m_vram_transfer.y, m_vram_transfer.width, m_vram_transfer.height);
 
   if (m_system->GetSettings().debugging.dump_vram_to_cpu_copies)
   {
+    CompleteReadVRAM();
     DumpVRAMToFile(StringUtil::StdStringFromFormat("vram_to_cpu_copy_%u.png", s_vram_to_cpu_dump_id++).c_str(),
                    m_vram_transfer.width, m_vram_transfer.height, sizeof(u16) * VRAM_WIDTH,
                    &m_vram_ptr[m_vram_transfer.y * VRAM_WIDTH + m_vram_transfer.x], true);
@@ -546,12 +549,10 @@ bool GPU::HandleCopyRectangleVRAMToCPUCommand()
   m_stats.num_vram_reads++;
   m_blitter_state = BlitterState::ReadingVRAM;
   m_command_total_words = 0;
-  return true;
 }
 
-bool GPU::HandleCopyRectangleVRAMToVRAMCommand()
+void GPU::HandleCopyRectangleVRAMToVRAMCommand()
 {
-  CHECK_COMMAND_SIZE(4);
   m_fifo.RemoveOne();
 
   const u32 src_x = m_fifo.Peek() & VRAM_COORD_MASK;
@@ -569,5 +570,4 @@ bool GPU::HandleCopyRectangleVRAMToVRAMCommand()
   m_stats.num_vram_copies++;
   AddCommandTicks(width * height * 2);
   EndCommand();
-  return true;
 }
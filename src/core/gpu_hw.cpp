@@ -1,5 +1,6 @@
 #include "gpu_hw.h"
 #include "common/assert.h"
+#include "common/bitutils.h"
 #include "common/log.h"
 #include "common/state_wrapper.h"
 #include "settings.h"
@@ -11,6 +12,7 @@ Log_SetChannel(GPU_HW);
 GPU_HW::GPU_HW() : GPU()
 {
   m_vram_ptr = m_vram_shadow.data();
+  m_vram_shadow_dirty_tiles.fill(UINT32_C(0xFFFFFFFF));
 }
 
 GPU_HW::~GPU_HW() = default;
@@ -32,6 +34,7 @@ bool GPU_HW::Initialize(HostDisplay* host_display, System* system, DMA* dma, Int
   m_true_color = settings.gpu_true_color;
   m_scaled_dithering = settings.gpu_scaled_dithering;
   m_texture_filtering = settings.gpu_texture_filtering;
+  m_uber_shaders = settings.gpu_uber_shaders;
   if (m_resolution_scale < 1 || m_resolution_scale > m_max_resolution_scale)
   {
     m_system->GetHostInterface()->AddFormattedOSDMessage(5.0f, "Invalid resolution scale %ux specified. Maximum is %u.",
@@ -45,6 +48,9 @@ bool GPU_HW::Initialize(HostDisplay* host_display, System* system, DMA* dma, Int
 
 void GPU_HW::Reset()
 {
+  // don't let an old readback land in the shadow after it's cleared
+  CompleteReadVRAM();
+
   GPU::Reset();
 
   m_batch_current_vertex_ptr = m_batch_start_vertex_ptr;
@@ -61,6 +67,8 @@ void GPU_HW::Reset()
 
 bool GPU_HW::DoState(StateWrapper& sw)
 {
+  CompleteReadVRAM();
+
   if (!GPU::DoState(sw))
     return false;
 
@@ -77,6 +85,9 @@ bool GPU_HW::DoState(StateWrapper& sw)
 
 void GPU_HW::UpdateSettings()
 {
+  // the readback textures may be recreated
+  CompleteReadVRAM();
+
   GPU::UpdateSettings();
 
   const Settings& settings = m_system->GetSettings();
@@ -84,6 +95,7 @@ void GPU_HW::UpdateSettings()
   m_true_color = settings.gpu_true_color;
   m_scaled_dithering = settings.gpu_scaled_dithering;
   m_texture_filtering = settings.gpu_texture_filtering;
+  m_uber_shaders = settings.gpu_uber_shaders;
   PrintSettingsToLog();
 }
 
@@ -94,13 +106,56 @@ void GPU_HW::PrintSettingsToLog()
   Log_InfoPrintf("Dithering: %s%s", m_true_color ? "Disabled" : "Enabled",
                  (!m_true_color && m_scaled_dithering) ? " (Scaled)" : "");
   Log_InfoPrintf("Texture Filtering: %s", m_texture_filtering ? "Enabled" : "Disabled");
+  Log_InfoPrintf("Uber Shaders: %s", m_uber_shaders ? "Enabled" : "Disabled");
   Log_InfoPrintf("Dual-source blending: %s", m_supports_dual_source_blend ? "Supported" : "Not supported");
 }
 
-void GPU_HW::UpdateVRAMReadTexture()
+void GPU_HW::UpdateVRAMReadTexturePages(u32 page_mask)
 {
-  m_renderer_stats.num_vram_read_texture_updates++;
-  ClearVRAMDirtyRectangle();
+  page_mask &= m_vram_read_texture_dirty_pages;
+  if (page_mask == 0)
+    return;
+
+  // Copy a single span per row of pages, which also picks up any dirty pages in between the requested ones. Only the
+  // part of each span inside the dirty rectangle can differ from the read texture.
+  std::array<Common::Rectangle<u32>, VRAM_READ_PAGE_ROWS> rects;
+  for (u32 row = 0; row < VRAM_READ_PAGE_ROWS; row++)
+  {
+    const u32 columns = (page_mask >> (row * VRAM_READ_PAGE_COLUMNS)) & ((UINT32_C(1) << VRAM_READ_PAGE_COLUMNS) - 1);
+    if (columns == 0)
+      continue;
+
+    const u32 first_column = CountTrailingZeros(columns);
+    const u32 last_column = 31 - CountLeadingZeros(columns);
+    m_vram_read_texture_dirty_pages &=
+      ~(GetVRAMReadPageColumnMask(first_column * VRAM_READ_PAGE_WIDTH, (last_column + 1) * VRAM_READ_PAGE_WIDTH)
+        << (row * VRAM_READ_PAGE_COLUMNS));
+
+    rects[row] = Common::Rectangle<u32>(first_column * VRAM_READ_PAGE_WIDTH, row * VRAM_READ_PAGE_HEIGHT,
+                                        (last_column + 1) * VRAM_READ_PAGE_WIDTH, (row + 1) * VRAM_READ_PAGE_HEIGHT)
+                   .Clamped(m_vram_dirty_rect.left, m_vram_dirty_rect.top, m_vram_dirty_rect.right,
+                            m_vram_dirty_rect.bottom);
+  }
+
+  // Pages which are vertically adjacent can be copied together.
+  if (rects[0].HasExtents() && rects[1].HasExtents() && rects[0].left == rects[1].left &&
+      rects[0].right == rects[1].right && rects[0].bottom == rects[1].top)
+  {
+    rects[0].Include(rects[1]);
+    rects[1].SetInvalid();
+  }
+
+  for (const Common::Rectangle<u32>& rect : rects)
+  {
+    if (!rect.HasExtents())
+      continue;
+
+    UpdateVRAMReadTexture(rect);
+    m_renderer_stats.num_vram_read_texture_updates++;
+  }
+
+  if (m_vram_read_texture_dirty_pages == 0)
+    ClearVRAMDirtyRectangle();
 }
 
 void GPU_HW::HandleFlippedQuadTextureCoordinates(BatchVertex* vertices)
@@ -186,7 +241,7 @@ void GPU_HW::HandleFlippedQuadTextureCoordinates(BatchVertex* vertices)
   }
 }
 
-void GPU_HW::LoadVertices()
+void GPU_HW::LoadVertices(const u32* words)
 {
   const RenderCommand rc{m_render_command.bits};
   const u32 texpage = ZeroExtend32(m_draw_mode.mode_reg.bits) | (ZeroExtend32(m_draw_mode.palette_reg) << 16);
@@ -208,9 +263,9 @@ void GPU_HW::LoadVertices()
       std::array<BatchVertex, 4> vertices;
       for (u32 i = 0; i < num_vertices; i++)
       {
-        const u32 color = (shaded && i > 0) ? (m_fifo.Pop() & UINT32_C(0x00FFFFFF)) : first_color;
-        const VertexPosition vp{m_fifo.Pop()};
-        const u16 packed_texcoord = textured ? Truncate16(m_fifo.Pop()) : 0;
+        const u32 color = (shaded && i > 0) ? (*(words++) & UINT32_C(0x00FFFFFF)) : first_color;
+        const VertexPosition vp{*(words++)};
+        const u16 packed_texcoord = textured ? Truncate16(*(words++)) : 0;
 
         vertices[i].Set(m_drawing_offset.x + vp.x, m_drawing_offset.y + vp.y, m_current_depth, color, texpage,
                         packed_texcoord);
@@ -245,7 +300,7 @@ void GPU_HW::LoadVertices()
         const u32 clip_bottom =
           static_cast<u32>(std::clamp<s32>(max_y, m_drawing_area.top, m_drawing_area.bottom)) + 1u;
 
-        m_vram_dirty_rect.Include(clip_left, clip_right, clip_top, clip_bottom);
+        IncludeDrawnVRAMRectangle(clip_left, clip_right, clip_top, clip_bottom);
         AddDrawTriangleTicks(clip_right - clip_left, clip_bottom - clip_top, rc.shading_enable, rc.texture_enable,
                              rc.transparency_enable);
 
@@ -276,7 +331,7 @@ void GPU_HW::LoadVertices()
           const u32 clip_bottom =
             static_cast<u32>(std::clamp<s32>(max_y_123, m_drawing_area.top, m_drawing_area.bottom)) + 1u;
 
-          m_vram_dirty_rect.Include(clip_left, clip_right, clip_top, clip_bottom);
+          IncludeDrawnVRAMRectangle(clip_left, clip_right, clip_top, clip_bottom);
           AddDrawTriangleTicks(clip_right - clip_left, clip_bottom - clip_top, rc.shading_enable, rc.texture_enable,
                                rc.transparency_enable);
 
@@ -291,11 +346,11 @@ void GPU_HW::LoadVertices()
     case Primitive::Rectangle:
     {
       const u32 color = rc.color_for_first_vertex;
-      const VertexPosition vp{m_fifo.Pop()};
+      const VertexPosition vp{*(words++)};
       const s32 pos_x = TruncateVertexPosition(m_drawing_offset.x + vp.x);
       const s32 pos_y = TruncateVertexPosition(m_drawing_offset.y + vp.y);
 
-      const auto [texcoord_x, texcoord_y] = UnpackTexcoord(rc.texture_enable ? Truncate16(m_fifo.Pop()) : 0);
+      const auto [texcoord_x, texcoord_y] = UnpackTexcoord(rc.texture_enable ? Truncate16(*(words++)) : 0);
       u16 orig_tex_left = ZeroExtend16(texcoord_x);
       u16 orig_tex_top = ZeroExtend16(texcoord_y);
       s32 rectangle_width;
@@ -316,7 +371,7 @@ void GPU_HW::LoadVertices()
           break;
         default:
         {
-          const u32 width_and_height = m_fifo.Pop();
+          const u32 width_and_height = *(words++);
           rectangle_width = static_cast<s32>(width_and_height & VRAM_WIDTH_MASK);
           rectangle_height = static_cast<s32>((width_and_height >> 16) & VRAM_HEIGHT_MASK);
 
@@ -376,7 +431,7 @@ void GPU_HW::LoadVertices()
       const u32 clip_bottom =
         static_cast<u32>(std::clamp<s32>(pos_y + rectangle_height, m_drawing_area.top, m_drawing_area.bottom)) + 1u;
 
-      m_vram_dirty_rect.Include(clip_left, clip_right, clip_top, clip_bottom);
+      IncludeDrawnVRAMRectangle(clip_left, clip_right, clip_top, clip_bottom);
       AddDrawRectangleTicks(clip_right - clip_left, clip_bottom - clip_top, rc.texture_enable, rc.transparency_enable);
     }
     break;
@@ -392,15 +447,15 @@ void GPU_HW::LoadVertices()
         if (rc.shading_enable)
         {
           color0 = rc.color_for_first_vertex;
-          pos0.bits = m_fifo.Pop();
-          color1 = m_fifo.Pop() & UINT32_C(0x00FFFFFF);
-          pos1.bits = m_fifo.Pop();
+          pos0.bits = *(words++);
+          color1 = *(words++) & UINT32_C(0x00FFFFFF);
+          pos1.bits = *(words++);
         }
         else
         {
           color0 = color1 = rc.color_for_first_vertex;
-          pos0.bits = m_fifo.Pop();
-          pos1.bits = m_fifo.Pop();
+          pos0.bits = *(words++);
+          pos1.bits = *(words++);
         }
 
         if (!IsDrawingAreaIsValid())
@@ -430,7 +485,7 @@ void GPU_HW::LoadVertices()
         const u32 clip_bottom =
           static_cast<u32>(std::clamp<s32>(max_y, m_drawing_area.top, m_drawing_area.bottom)) + 1u;
 
-        m_vram_dirty_rect.Include(clip_left, clip_right, clip_top, clip_bottom);
+        IncludeDrawnVRAMRectangle(clip_left, clip_right, clip_top, clip_bottom);
         AddDrawLineTicks(clip_right - clip_left, clip_bottom - clip_top, rc.shading_enable);
       }
       else
@@ -446,11 +501,10 @@ void GPU_HW::LoadVertices()
         const bool shaded = rc.shading_enable;
 
         BatchVertex last_vertex;
-        u32 buffer_pos = 0;
         for (u32 i = 0; i < num_vertices; i++)
         {
-          const u32 color = (shaded && i > 0) ? (m_blit_buffer[buffer_pos++] & UINT32_C(0x00FFFFFF)) : first_color;
-          const VertexPosition vp{m_blit_buffer[buffer_pos++]};
+          const u32 color = (shaded && i > 0) ? (*(words++) & UINT32_C(0x00FFFFFF)) : first_color;
+          const VertexPosition vp{*(words++)};
 
           BatchVertex vertex;
           vertex.Set(m_drawing_offset.x + vp.x, m_drawing_offset.y + vp.y, m_current_depth, color, 0, 0);
@@ -479,7 +533,7 @@ void GPU_HW::LoadVertices()
               const u32 clip_bottom =
                 static_cast<u32>(std::clamp<s32>(max_y, m_drawing_area.top, m_drawing_area.bottom)) + 1u;
 
-              m_vram_dirty_rect.Include(clip_left, clip_right, clip_top, clip_bottom);
+              IncludeDrawnVRAMRectangle(clip_left, clip_right, clip_top, clip_bottom);
               AddDrawLineTicks(clip_right - clip_left, clip_bottom - clip_top, rc.shading_enable);
             }
           }
@@ -570,6 +624,8 @@ GPU_HW::BatchPrimitive GPU_HW::GetPrimitiveForCommand(RenderCommand rc)
 void GPU_HW::IncludeVRAMDityRectangle(const Common::Rectangle<u32>& rect)
 {
   m_vram_dirty_rect.Include(rect);
+  m_vram_read_texture_dirty_pages |= GetVRAMReadPageMask(rect);
+  SetVRAMShadowDirty(rect.left, rect.right, rect.top, rect.bottom);
 
   // the vram area can include the texture page, but the game can leave it as-is. in this case, set it as dirty so the
   // shadow texture is updated
@@ -637,6 +693,77 @@ void GPU_HW::ResetBatchVertexDepth()
   m_current_depth = 1;
 }
 
+Common::Rectangle<u32> GPU_HW::GetVRAMDownloadRectangle(const Common::Rectangle<u32>& bounds)
+{
+  const u32 column_mask = GetVRAMShadowTileColumnMask(bounds.left, bounds.right);
+  const u32 first_row = bounds.top / VRAM_SHADOW_TILE_HEIGHT;
+  const u32 last_row = (bounds.bottom - 1) / VRAM_SHADOW_TILE_HEIGHT;
+
+  Common::Rectangle<u32> rect;
+  for (u32 row = first_row; row <= last_row; row++)
+  {
+    const u32 dirty_columns = m_vram_shadow_dirty_tiles[row] & column_mask;
+    if (dirty_columns == 0)
+      continue;
+
+    rect.Include(CountTrailingZeros(dirty_columns) * VRAM_SHADOW_TILE_WIDTH,
+                 (32 - CountLeadingZeros(dirty_columns)) * VRAM_SHADOW_TILE_WIDTH, row * VRAM_SHADOW_TILE_HEIGHT,
+                 (row + 1) * VRAM_SHADOW_TILE_HEIGHT);
+  }
+  if (!rect.Valid())
+    return rect;
+
+  // Pixels are encoded in pairs, so keep the area aligned to avoid writing outside it.
+  rect.Clamp(bounds.left, bounds.top, bounds.right, bounds.bottom);
+  rect.left &= ~1u;
+  rect.right = (rect.right + 1) & ~1u;
+
+  // Tiles which are only partially covered still have stale pixels outside the downloaded area.
+  const u32 first_full_column = (rect.left + VRAM_SHADOW_TILE_WIDTH - 1) / VRAM_SHADOW_TILE_WIDTH;
+  const u32 end_full_column = rect.right / VRAM_SHADOW_TILE_WIDTH;
+  const u32 first_full_row = (rect.top + VRAM_SHADOW_TILE_HEIGHT - 1) / VRAM_SHADOW_TILE_HEIGHT;
+  const u32 end_full_row = rect.bottom / VRAM_SHADOW_TILE_HEIGHT;
+  if (first_full_column < end_full_column)
+  {
+    const u32 clean_mask = GetVRAMShadowTileColumnMask(first_full_column * VRAM_SHADOW_TILE_WIDTH,
+                                                       end_full_column * VRAM_SHADOW_TILE_WIDTH);
+    for (u32 row = first_full_row; row < end_full_row; row++)
+      m_vram_shadow_dirty_tiles[row] &= ~clean_mask;
+  }
+
+  return rect;
+}
+
+void GPU_HW::ReadVRAM(u32 x, u32 y, u32 width, u32 height)
+{
+  BeginReadVRAM(x, y, width, height);
+  CompleteReadVRAM();
+}
+
+void GPU_HW::BeginReadVRAM(u32 x, u32 y, u32 width, u32 height)
+{
+  // Only one readback is in flight at a time.
+  CompleteReadVRAM();
+
+  const Common::Rectangle<u32> rect = GetVRAMDownloadRectangle(GetVRAMTransferBounds(x, y, width, height));
+  if (!rect.Valid())
+    return;
+
+  StartVRAMDownload(rect);
+  m_vram_download_rect = rect;
+  m_renderer_stats.num_vram_readbacks++;
+  m_renderer_stats.num_vram_readback_pixels += rect.GetWidth() * rect.GetHeight();
+}
+
+void GPU_HW::CompleteReadVRAM()
+{
+  if (!m_vram_download_rect.Valid())
+    return;
+
+  FinishVRAMDownload(m_vram_download_rect);
+  m_vram_download_rect.SetInvalid();
+}
+
 void GPU_HW::FillVRAM(u32 x, u32 y, u32 width, u32 height, u32 color)
 {
   IncludeVRAMDityRectangle(
@@ -667,7 +794,7 @@ void GPU_HW::CopyVRAM(u32 src_x, u32 src_y, u32 dst_x, u32 dst_y, u32 width, u32
   }
 }
 
-void GPU_HW::DispatchRenderCommand()
+void GPU_HW::DispatchRenderCommand(const u32* words)
 {
   const RenderCommand rc{m_render_command.bits};
 
@@ -678,15 +805,17 @@ void GPU_HW::DispatchRenderCommand()
     if (m_draw_mode.IsTexturePageChanged())
     {
       m_draw_mode.ClearTexturePageChangedFlag();
-      if (m_vram_dirty_rect.Valid() &&
-          (m_draw_mode.GetTexturePageRectangle().Intersects(m_vram_dirty_rect) ||
-           (m_draw_mode.IsUsingPalette() && m_draw_mode.GetTexturePaletteRectangle().Intersects(m_vram_dirty_rect))))
+      u32 page_mask = GetVRAMReadPageMask(m_draw_mode.GetTexturePageRectangle());
+      if (m_draw_mode.IsUsingPalette())
+        page_mask |= GetVRAMReadPageMask(m_draw_mode.GetTexturePaletteRectangle());
+
+      if (page_mask & m_vram_read_texture_dirty_pages)
       {
         // Log_DevPrintf("Invalidating VRAM read cache due to drawing area overlap");
         if (!IsFlushed())
           FlushRender();
 
-        UpdateVRAMReadTexture();
+        UpdateVRAMReadTexturePages(page_mask);
       }
     }
 
@@ -747,6 +876,9 @@ void GPU_HW::DispatchRenderCommand()
   m_batch.transparency_mode = transparency_mode;
   m_batch.dithering = dithering_enable;
 
+  if (m_using_uber_shaders)
+    UpdateBatchUBOShaderState();
+
   if (m_draw_mode.IsTextureWindowChanged())
   {
     m_draw_mode.ClearTextureWindowChangedFlag();
@@ -758,7 +890,34 @@ void GPU_HW::DispatchRenderCommand()
     m_batch_ubo_dirty = true;
   }
 
-  LoadVertices();
+  LoadVertices(words);
+}
+
+void GPU_HW::SetUsingUberShaders(bool enabled)
+{
+  m_using_uber_shaders = enabled;
+  if (enabled)
+  {
+    UpdateBatchUBOShaderState();
+    m_batch_ubo_dirty = true;
+  }
+}
+
+void GPU_HW::UpdateBatchUBOShaderState()
+{
+  const u32 texture_mode = static_cast<u32>(m_batch.texture_mode);
+  const u32 dithering = BoolToUInt32(m_batch.dithering);
+  const u32 interlacing = BoolToUInt32(m_batch.interlacing);
+  if (m_batch_ubo_data.u_texture_mode == texture_mode && m_batch_ubo_data.u_dithering == dithering &&
+      m_batch_ubo_data.u_interlacing == interlacing)
+  {
+    return;
+  }
+
+  m_batch_ubo_data.u_texture_mode = texture_mode;
+  m_batch_ubo_data.u_dithering = dithering;
+  m_batch_ubo_data.u_interlacing = interlacing;
+  m_batch_ubo_dirty = true;
 }
 
 void GPU_HW::FlushRender()
@@ -827,6 +986,11 @@ void GPU_HW::DrawRendererStats(bool is_idle_frame)
     ImGui::Text("%u", stats.num_uniform_buffer_updates);
     ImGui::NextColumn();
 
+    ImGui::TextUnformatted("VRAM Readbacks:");
+    ImGui::NextColumn();
+    ImGui::Text("%u (%u pixels)", stats.num_vram_readbacks, stats.num_vram_readback_pixels);
+    ImGui::NextColumn();
+
     ImGui::Columns(1);
   }
 }
@@ -2,6 +2,7 @@
 #include "common/heap_array.h"
 #include "gpu.h"
 #include "host_display.h"
+#include <algorithm>
 #include <sstream>
 #include <string>
 #include <tuple>
@@ -115,6 +116,11 @@ protected:
     float u_dst_alpha_factor;
     u32 u_interlaced_displayed_field;
     u32 u_set_mask_while_drawing;
+
+    // Only read by the uber shaders, the specialised shaders have this state compiled in.
+    u32 u_texture_mode;
+    u32 u_dithering;
+    u32 u_interlacing;
   };
 
   struct VRAMFillUBOData
@@ -151,6 +157,19 @@ protected:
     u32 num_batches;
     u32 num_vram_read_texture_updates;
     u32 num_uniform_buffer_updates;
+    u32 num_vram_readbacks;
+    u32 num_vram_readback_pixels;
+  };
+
+  enum : u32
+  {
+    VRAM_SHADOW_TILE_WIDTH = 32,
+    VRAM_SHADOW_TILE_HEIGHT = 16,
+    VRAM_SHADOW_TILE_ROWS = VRAM_HEIGHT / VRAM_SHADOW_TILE_HEIGHT,
+    VRAM_READ_PAGE_WIDTH = 64,
+    VRAM_READ_PAGE_HEIGHT = 256,
+    VRAM_READ_PAGE_COLUMNS = VRAM_WIDTH / VRAM_READ_PAGE_WIDTH,
+    VRAM_READ_PAGE_ROWS = VRAM_HEIGHT / VRAM_READ_PAGE_HEIGHT
   };
 
   static constexpr std::tuple<float, float, float, float> RGBA8ToFloat(u32 rgba)
@@ -161,8 +180,15 @@ protected:
                            static_cast<float>(rgba >> 24) * (1.0f / 255.0f));
   }
 
-  virtual void UpdateVRAMReadTexture();
+  /// Copies an area of VRAM to the read texture which is sampled by textured draws.
+  virtual void UpdateVRAMReadTexture(const Common::Rectangle<u32>& rect) = 0;
   virtual void UpdateDepthBufferFromMaskBit() = 0;
+
+  /// Encodes an area of VRAM and starts copying it to the CPU, without waiting for the copy to complete.
+  virtual void StartVRAMDownload(const Common::Rectangle<u32>& rect) = 0;
+
+  /// Waits for the copy started by StartVRAMDownload() and writes it to the VRAM shadow.
+  virtual void FinishVRAMDownload(const Common::Rectangle<u32>& rect) = 0;
   virtual void SetScissorFromDrawingArea() = 0;
   virtual void MapBatchVertexPointer(u32 required_vertices) = 0;
   virtual void UnmapBatchVertexPointer(u32 used_vertices) = 0;
@@ -172,11 +198,79 @@ protected:
   void SetFullVRAMDirtyRectangle()
   {
     m_vram_dirty_rect.Set(0, 0, VRAM_WIDTH, VRAM_HEIGHT);
+    m_vram_read_texture_dirty_pages = UINT32_C(0xFFFFFFFF);
+    m_vram_shadow_dirty_tiles.fill(UINT32_C(0xFFFFFFFF));
     m_draw_mode.SetTexturePageChanged();
   }
   void ClearVRAMDirtyRectangle() { m_vram_dirty_rect.SetInvalid(); }
   void IncludeVRAMDityRectangle(const Common::Rectangle<u32>& rect);
 
+  /// Returns a mask of the read texture page columns which overlap the range [left, right).
+  static constexpr u32 GetVRAMReadPageColumnMask(u32 left, u32 right)
+  {
+    return (UINT32_C(0xFFFF) >> (VRAM_READ_PAGE_COLUMNS - 1 - ((right - 1) / VRAM_READ_PAGE_WIDTH))) &
+           (UINT32_C(0xFFFF) << (left / VRAM_READ_PAGE_WIDTH));
+  }
+
+  /// Returns a mask of the read texture pages which overlap an area, with one bit per page, and the second row of pages
+  /// in the upper half. Areas which extend past the right edge of VRAM wrap around, as texture pages do.
+  static constexpr u32 GetVRAMReadPageMask(u32 left, u32 right, u32 top, u32 bottom)
+  {
+    if (left >= right || top >= bottom)
+      return 0;
+
+    const u32 columns =
+      (right > VRAM_WIDTH) ?
+        (GetVRAMReadPageColumnMask(left, VRAM_WIDTH) |
+         GetVRAMReadPageColumnMask(0, std::min<u32>(right - VRAM_WIDTH, VRAM_WIDTH))) :
+        GetVRAMReadPageColumnMask(left, right);
+    return ((top < VRAM_READ_PAGE_HEIGHT) ? columns : 0) |
+           ((bottom > VRAM_READ_PAGE_HEIGHT) ? (columns << VRAM_READ_PAGE_COLUMNS) : 0);
+  }
+  static constexpr u32 GetVRAMReadPageMask(const Common::Rectangle<u32>& rect)
+  {
+    return GetVRAMReadPageMask(rect.left, rect.right, rect.top, rect.bottom);
+  }
+
+  /// Brings the read texture up to date for the specified pages, if any of them have been modified.
+  void UpdateVRAMReadTexturePages(u32 page_mask);
+
+  /// Returns a mask of the shadow tile columns which overlap the range [left, right).
+  static constexpr u32 GetVRAMShadowTileColumnMask(u32 left, u32 right)
+  {
+    return (UINT32_C(0xFFFFFFFF) >> (31 - ((right - 1) / VRAM_SHADOW_TILE_WIDTH))) &
+           (UINT32_C(0xFFFFFFFF) << (left / VRAM_SHADOW_TILE_WIDTH));
+  }
+
+  /// Flags an area of VRAM which has been modified on the GPU, so it is downloaded by the next readback.
+  ALWAYS_INLINE void SetVRAMShadowDirty(u32 left, u32 right, u32 top, u32 bottom)
+  {
+    if (left >= right || top >= bottom)
+      return;
+
+    const u32 column_mask = GetVRAMShadowTileColumnMask(left, right);
+    const u32 last_row = (bottom - 1) / VRAM_SHADOW_TILE_HEIGHT;
+    for (u32 row = top / VRAM_SHADOW_TILE_HEIGHT; row <= last_row; row++)
+      m_vram_shadow_dirty_tiles[row] |= column_mask;
+  }
+
+  /// Includes an area which has been drawn to in both the read texture and VRAM shadow dirty areas.
+  ALWAYS_INLINE void IncludeDrawnVRAMRectangle(u32 left, u32 right, u32 top, u32 bottom)
+  {
+    m_vram_dirty_rect.Include(left, right, top, bottom);
+    m_vram_read_texture_dirty_pages |= GetVRAMReadPageMask(left, right, top, bottom);
+    SetVRAMShadowDirty(left, right, top, bottom);
+  }
+
+  /// Returns the part of the specified area which differs from the VRAM shadow and must be downloaded, and flags the
+  /// tiles it covers as clean. The rectangle is invalid if the shadow is already up to date.
+  Common::Rectangle<u32> GetVRAMDownloadRectangle(const Common::Rectangle<u32>& bounds);
+
+  /// Switches batches between the uber shaders, which read the texture mode, dithering and interlacing state from the
+  /// uniform buffer, and the specialised shaders which have it compiled in.
+  void SetUsingUberShaders(bool enabled);
+  void UpdateBatchUBOShaderState();
+
   bool IsFlushed() const { return m_batch_current_vertex_ptr == m_batch_start_vertex_ptr; }
 
   u32 GetBatchVertexSpace() const { return static_cast<u32>(m_batch_end_vertex_ptr - m_batch_current_vertex_ptr); }
@@ -205,10 +299,13 @@ protected:
     }
   }
 
+  void ReadVRAM(u32 x, u32 y, u32 width, u32 height) override;
+  void BeginReadVRAM(u32 x, u32 y, u32 width, u32 height) override;
+  void CompleteReadVRAM() override;
   void FillVRAM(u32 x, u32 y, u32 width, u32 height, u32 color) override;
   void UpdateVRAM(u32 x, u32 y, u32 width, u32 height, const void* data) override;
   void CopyVRAM(u32 src_x, u32 src_y, u32 dst_x, u32 dst_y, u32 width, u32 height) override;
-  void DispatchRenderCommand() override;
+  void DispatchRenderCommand(const u32* words) override;
   void FlushRender() override;
   void DrawRendererStats(bool is_idle_frame) override;
 
@@ -245,6 +342,8 @@ protected:
   bool m_true_color = true;
   bool m_scaled_dithering = false;
   bool m_texture_filtering = false;
+  bool m_uber_shaders = false;
+  bool m_using_uber_shaders = false;
   bool m_supports_dual_source_blend = false;
 
   BatchConfig m_batch = {};
@@ -253,6 +352,17 @@ protected:
   // Bounding box of VRAM area that the GPU has drawn into.
   Common::Rectangle<u32> m_vram_dirty_rect;
 
+  // 64x256 pages of the VRAM read texture which are out of date, one bit per page. Only the pages which a draw or copy
+  // samples from are refreshed, so the dirty rectangle above may cover pages which are already up to date.
+  u32 m_vram_read_texture_dirty_pages = 0;
+
+  // Tiles of VRAM which have been modified on the GPU since they were last downloaded to the shadow, one bit per
+  // column. Tiles start dirty, as the shadow is only written by readbacks.
+  std::array<u32, VRAM_SHADOW_TILE_ROWS> m_vram_shadow_dirty_tiles;
+
+  // Area of the readback which is still in flight, if any.
+  Common::Rectangle<u32> m_vram_download_rect;
+
   // Statistics
   RendererStats m_renderer_stats = {};
   RendererStats m_last_renderer_stats = {};
@@ -269,7 +379,7 @@ private:
 
   static BatchPrimitive GetPrimitiveForCommand(RenderCommand rc);
 
-  void LoadVertices();
+  void LoadVertices(const u32* words);
 
   ALWAYS_INLINE void AddVertex(const BatchVertex& v)
   {
@@ -634,37 +634,40 @@ void GPU_HW_D3D11::UpdateDisplay()
   }
 }
 
-void GPU_HW_D3D11::ReadVRAM(u32 x, u32 y, u32 width, u32 height)
+void GPU_HW_D3D11::StartVRAMDownload(const Common::Rectangle<u32>& rect)
 {
-  // Get bounds with wrap-around handled.
-  const Common::Rectangle<u32> copy_rect = GetVRAMTransferBounds(x, y, width, height);
-  const u32 encoded_width = (copy_rect.GetWidth() + 1) / 2;
-  const u32 encoded_height = copy_rect.GetHeight();
+  const u32 encoded_width = rect.GetWidth() / 2;
+  const u32 encoded_height = rect.GetHeight();
 
   // Encode the 24-bit texture as 16-bit.
-  const u32 uniforms[4] = {copy_rect.left, copy_rect.top, copy_rect.GetWidth(), copy_rect.GetHeight()};
+  const u32 uniforms[4] = {rect.left, rect.top, rect.GetWidth(), rect.GetHeight()};
   m_context->OMSetRenderTargets(1, m_vram_encoding_texture.GetD3DRTVArray(), nullptr);
   m_context->OMSetDepthStencilState(m_depth_disabled_state.Get(), 0);
   m_context->PSSetShaderResources(0, 1, m_vram_texture.GetD3DSRVArray());
   SetViewportAndScissor(0, 0, encoded_width, encoded_height);
   DrawUtilityShader(m_vram_read_pixel_shader.Get(), uniforms, sizeof(uniforms));
 
-  // Stage the readback.
+  // Stage the readback. The copy only has to be done by the time the staging texture is mapped.
   m_vram_readback_texture.CopyFromTexture(m_context.Get(), m_vram_encoding_texture.GetD3DTexture(), 0, 0, 0, 0, 0,
                                           encoded_width, encoded_height);
-  // And copy it into our shadow buffer.
+  m_context->Flush();
+
+  RestoreGraphicsAPIState();
+}
+
+void GPU_HW_D3D11::FinishVRAMDownload(const Common::Rectangle<u32>& rect)
+{
+  // Copy it into our shadow buffer (will stall if the GPU hasn't finished).
   if (m_vram_readback_texture.Map(m_context.Get(), false))
   {
-    m_vram_readback_texture.ReadPixels(0, 0, encoded_width * 2, encoded_height, VRAM_WIDTH,
-                                       &m_vram_shadow[copy_rect.top * VRAM_WIDTH + copy_rect.left]);
+    m_vram_readback_texture.ReadPixels(0, 0, rect.GetWidth(), rect.GetHeight(), VRAM_WIDTH,
+                                       &m_vram_shadow[rect.top * VRAM_WIDTH + rect.left]);
     m_vram_readback_texture.Unmap(m_context.Get());
   }
   else
   {
     Log_ErrorPrintf("Failed to map VRAM readback texture");
   }
-
-  RestoreGraphicsAPIState();
 }
 
 void GPU_HW_D3D11::FillVRAM(u32 x, u32 y, u32 width, u32 height, u32 color)
@@ -750,8 +753,7 @@ void GPU_HW_D3D11::CopyVRAM(u32 src_x, u32 src_y, u32 dst_x, u32 dst_y, u32 widt
   {
     const Common::Rectangle<u32> src_bounds = GetVRAMTransferBounds(src_x, src_y, width, height);
     const Common::Rectangle<u32> dst_bounds = GetVRAMTransferBounds(dst_x, dst_y, width, height);
-    if (m_vram_dirty_rect.Intersects(src_bounds))
-      UpdateVRAMReadTexture();
+    UpdateVRAMReadTexturePages(GetVRAMReadPageMask(src_bounds));
     IncludeVRAMDityRectangle(dst_bounds);
 
     const VRAMCopyUBOData uniforms = {src_x * m_resolution_scale,
@@ -783,8 +785,8 @@ void GPU_HW_D3D11::CopyVRAM(u32 src_x, u32 src_y, u32 dst_x, u32 dst_y, u32 widt
   // We can't CopySubresourceRegion to the same resource. So use the shadow texture if we can, but that may need to be
   // updated first. Copying to the same resource seemed to work on Windows 10, but breaks on Windows 7. But, it's
   // against the API spec, so better to be safe than sorry.
-  if (m_vram_dirty_rect.Intersects(Common::Rectangle<u32>::FromExtents(src_x, src_y, width, height)))
-    UpdateVRAMReadTexture();
+  UpdateVRAMReadTexturePages(
+    GetVRAMReadPageMask(Common::Rectangle<u32>::FromExtents(src_x, src_y, width, height)));
 
   GPU_HW::CopyVRAM(src_x, src_y, dst_x, dst_y, width, height);
 
@@ -799,14 +801,12 @@ void GPU_HW_D3D11::CopyVRAM(u32 src_x, u32 src_y, u32 dst_x, u32 dst_y, u32 widt
   m_context->CopySubresourceRegion(m_vram_texture, 0, dst_x, dst_y, 0, m_vram_read_texture, 0, &src_box);
 }
 
-void GPU_HW_D3D11::UpdateVRAMReadTexture()
+void GPU_HW_D3D11::UpdateVRAMReadTexture(const Common::Rectangle<u32>& rect)
 {
-  const auto scaled_rect = m_vram_dirty_rect * m_resolution_scale;
+  const auto scaled_rect = rect * m_resolution_scale;
   const CD3D11_BOX src_box(scaled_rect.left, scaled_rect.top, 0, scaled_rect.right, scaled_rect.bottom, 1);
   m_context->CopySubresourceRegion(m_vram_read_texture, 0, scaled_rect.left, scaled_rect.top, 0, m_vram_texture, 0,
                                    &src_box);
-
-  GPU_HW::UpdateVRAMReadTexture();
 }
 
 void GPU_HW_D3D11::UpdateDepthBufferFromMaskBit()
@@ -29,12 +29,13 @@ public:
 
 protected:
   void UpdateDisplay() override;
-  void ReadVRAM(u32 x, u32 y, u32 width, u32 height) override;
   void FillVRAM(u32 x, u32 y, u32 width, u32 height, u32 color) override;
   void UpdateVRAM(u32 x, u32 y, u32 width, u32 height, const void* data) override;
   void CopyVRAM(u32 src_x, u32 src_y, u32 dst_x, u32 dst_y, u32 width, u32 height) override;
-  void UpdateVRAMReadTexture() override;
+  void UpdateVRAMReadTexture(const Common::Rectangle<u32>& rect) override;
   void UpdateDepthBufferFromMaskBit() override;
+  void StartVRAMDownload(const Common::Rectangle<u32>& rect) override;
+  void FinishVRAMDownload(const Common::Rectangle<u32>& rect) override;
   void SetScissorFromDrawingArea() override;
   void MapBatchVertexPointer(u32 required_vertices) override;
   void UnmapBatchVertexPointer(u32 used_vertices) override;
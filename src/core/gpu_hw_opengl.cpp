@@ -1,6 +1,7 @@
 #include "gpu_hw_opengl.h"
 #include "common/assert.h"
 #include "common/log.h"
+#include "common/timer.h"
 #include "gpu_hw_shadergen.h"
 #include "host_display.h"
 #include "system.h"
@@ -19,6 +20,10 @@ GPU_HW_OpenGL::~GPU_HW_OpenGL()
     glDeleteVertexArrays(1, &m_attributeless_vao_id);
   if (m_texture_buffer_r16ui_texture != 0)
     glDeleteTextures(1, &m_texture_buffer_r16ui_texture);
+  if (m_vram_readback_fence)
+    glDeleteSync(m_vram_readback_fence);
+  if (m_vram_readback_pbo_id != 0)
+    glDeleteBuffers(1, &m_vram_readback_pbo_id);
 
   if (m_host_display)
   {
@@ -68,6 +73,12 @@ bool GPU_HW_OpenGL::Initialize(HostDisplay* host_display, System* system, DMA* d
     return false;
   }
 
+  if (m_use_pbo_for_vram_readbacks && !CreateReadbackBuffer())
+  {
+    Log_WarningPrintf("Failed to create VRAM readback buffer, readbacks will be synchronous.");
+    m_use_pbo_for_vram_readbacks = false;
+  }
+
   if (!CompilePrograms())
   {
     Log_ErrorPrintf("Failed to compile programs");
@@ -200,6 +211,10 @@ void GPU_HW_OpenGL::SetCapabilities(HostDisplay* host_display)
   if (!m_supports_dual_source_blend)
     Log_WarningPrintf("Dual-source blending is not supported, this may break some mask effects.");
 
+  m_use_pbo_for_vram_readbacks = (GLAD_GL_VERSION_3_2 || GLAD_GL_ARB_sync || GLAD_GL_ES_VERSION_3_0);
+  if (!m_use_pbo_for_vram_readbacks)
+    Log_WarningPrintf("Sync objects are not supported, VRAM readbacks will stall.");
+
   m_supports_geometry_shaders = GLAD_GL_VERSION_3_2 || GLAD_GL_ARB_geometry_shader4 || GLAD_GL_ES_VERSION_3_2;
   if (!m_supports_geometry_shaders)
   {
@@ -330,6 +345,16 @@ bool GPU_HW_OpenGL::CreateTextureBuffer()
   return true;
 }
 
+bool GPU_HW_OpenGL::CreateReadbackBuffer()
+{
+  // Encoded VRAM is half the width in RGBA8, which works out to the same size as the 16-bit VRAM.
+  glGenBuffers(1, &m_vram_readback_pbo_id);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, m_vram_readback_pbo_id);
+  glBufferData(GL_PIXEL_PACK_BUFFER, VRAM_WIDTH * VRAM_HEIGHT * sizeof(u16), nullptr, GL_STREAM_READ);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  return (glGetError() == GL_NO_ERROR);
+}
+
 bool GPU_HW_OpenGL::CompilePrograms()
 {
   const bool use_binding_layout = GPU_HW_ShaderGen::UseGLSLBindingLayout();
@@ -338,77 +363,25 @@ bool GPU_HW_OpenGL::CompilePrograms()
 
   m_system->GetHostInterface()->DisplayLoadingScreen("Compiling Shaders...");
 
-  for (u32 render_mode = 0; render_mode < 4; render_mode++)
+  if (m_uber_shaders)
   {
-    for (u32 texture_mode = 0; texture_mode < 9; texture_mode++)
-    {
-      for (u8 dithering = 0; dithering < 2; dithering++)
-      {
-        for (u8 interlacing = 0; interlacing < 2; interlacing++)
-        {
-          const bool textured = (static_cast<TextureMode>(texture_mode) != TextureMode::Disabled);
-          const std::string batch_vs = shadergen.GenerateBatchVertexShader(textured);
-          const std::string fs = shadergen.GenerateBatchFragmentShader(
-            static_cast<BatchRenderMode>(render_mode), static_cast<TextureMode>(texture_mode),
-            ConvertToBoolUnchecked(dithering), ConvertToBoolUnchecked(interlacing));
-
-          const auto link_callback = [this, textured, use_binding_layout](GL::Program& prog) {
-            if (!use_binding_layout)
-            {
-              prog.BindAttribute(0, "a_pos");
-              prog.BindAttribute(1, "a_col0");
-              if (textured)
-              {
-                prog.BindAttribute(2, "a_texcoord");
-                prog.BindAttribute(3, "a_texpage");
-              }
-
-              if (!IsGLES() || m_supports_dual_source_blend)
-              {
-                if (m_supports_dual_source_blend)
-                {
-                  prog.BindFragDataIndexed(0, "o_col0");
-                  prog.BindFragDataIndexed(1, "o_col1");
-                }
-                else
-                {
-                  prog.BindFragData(0, "o_col0");
-                }
-              }
-            }
-          };
-
-          std::optional<GL::Program> prog = m_shader_cache.GetProgram(batch_vs, {}, fs, link_callback);
-          if (!prog)
-            return false;
-
-          if (!use_binding_layout)
-          {
-            prog->BindUniformBlock("UBOBlock", 1);
-            if (textured)
-            {
-              prog->Bind();
-              prog->Uniform1i("samp0", 0);
-            }
-          }
-
-          m_render_programs[render_mode][texture_mode][dithering][interlacing] = std::move(*prog);
-
-          if (!textured && m_supports_geometry_shaders)
-          {
-            const std::string line_expand_gs = shadergen.GenerateBatchLineExpandGeometryShader();
-
-            prog = m_shader_cache.GetProgram(batch_vs, line_expand_gs, fs, link_callback);
-            if (!prog)
-              return false;
+    // Draw with the uber shaders, and compile the specialised programs a few at a time on later frames.
+    if (!CompileUberBatchPrograms(shadergen))
+      return false;
 
-            if (!use_binding_layout)
-              prog->BindUniformBlock("UBOBlock", 1);
-            m_line_render_programs[render_mode][dithering][interlacing] = std::move(*prog);
-          }
-        }
-      }
+    m_next_batch_program = 0;
+    SetUsingUberShaders(true);
+  }
+  else
+  {
+    for (u32 index = 0; index < NUM_BATCH_PROGRAMS; index++)
+    {
+      if (!CompileBatchProgram(shadergen, index))
+        return false;
     }
+
+    m_next_batch_program = NUM_BATCH_PROGRAMS;
+    SetUsingUberShaders(false);
   }
 
   for (u8 depth_24bit = 0; depth_24bit < 2; depth_24bit++)
@@ -517,15 +490,166 @@ bool GPU_HW_OpenGL::CompilePrograms()
   return true;
 }
 
+std::optional<GL::Program> GPU_HW_OpenGL::LinkBatchProgram(const std::string& vs, const std::string& gs,
+                                                            const std::string& fs, bool textured)
+{
+  const bool use_binding_layout = GPU_HW_ShaderGen::UseGLSLBindingLayout();
+  std::optional<GL::Program> prog =
+    m_shader_cache.GetProgram(vs, gs, fs, [this, textured, use_binding_layout](GL::Program& prog) {
+      if (!use_binding_layout)
+      {
+        prog.BindAttribute(0, "a_pos");
+        prog.BindAttribute(1, "a_col0");
+        if (textured)
+        {
+          prog.BindAttribute(2, "a_texcoord");
+          prog.BindAttribute(3, "a_texpage");
+        }
+
+        if (!IsGLES() || m_supports_dual_source_blend)
+        {
+          if (m_supports_dual_source_blend)
+          {
+            prog.BindFragDataIndexed(0, "o_col0");
+            prog.BindFragDataIndexed(1, "o_col1");
+          }
+          else
+          {
+            prog.BindFragData(0, "o_col0");
+          }
+        }
+      }
+    });
+  if (!prog)
+    return std::nullopt;
+
+  if (!use_binding_layout)
+  {
+    prog->BindUniformBlock("UBOBlock", 1);
+    if (textured)
+    {
+      prog->Bind();
+      prog->Uniform1i("samp0", 0);
+    }
+  }
+
+  return prog;
+}
+
+bool GPU_HW_OpenGL::CompileBatchProgram(GPU_HW_ShaderGen& shadergen, u32 index)
+{
+  // index - [render_mode][texture_mode][dithering][interlacing]
+  const u8 interlacing = Truncate8(index % 2);
+  const u8 dithering = Truncate8((index / 2) % 2);
+  const u8 texture_mode = Truncate8((index / 4) % 9);
+  const u8 render_mode = Truncate8(index / 36);
+
+  const bool textured = (static_cast<TextureMode>(texture_mode) != TextureMode::Disabled);
+  const std::string batch_vs = shadergen.GenerateBatchVertexShader(textured);
+  const std::string fs = shadergen.GenerateBatchFragmentShader(
+    static_cast<BatchRenderMode>(render_mode), static_cast<TextureMode>(texture_mode),
+    ConvertToBoolUnchecked(dithering), ConvertToBoolUnchecked(interlacing));
+
+  std::optional<GL::Program> prog = LinkBatchProgram(batch_vs, {}, fs, textured);
+  if (!prog)
+    return false;
+
+  m_render_programs[render_mode][texture_mode][dithering][interlacing] = std::move(*prog);
+
+  if (!textured && m_supports_geometry_shaders)
+  {
+    const std::string line_expand_gs = shadergen.GenerateBatchLineExpandGeometryShader();
+    prog = LinkBatchProgram(batch_vs, line_expand_gs, fs, false);
+    if (!prog)
+      return false;
+
+    m_line_render_programs[render_mode][dithering][interlacing] = std::move(*prog);
+  }
+
+  return true;
+}
+
+bool GPU_HW_OpenGL::CompileUberBatchPrograms(GPU_HW_ShaderGen& shadergen)
+{
+  for (u8 render_mode = 0; render_mode < 4; render_mode++)
+  {
+    for (u8 textured = 0; textured < 2; textured++)
+    {
+      const std::string batch_vs = shadergen.GenerateBatchVertexShader(ConvertToBoolUnchecked(textured));
+      const std::string fs = shadergen.GenerateBatchUberFragmentShader(static_cast<BatchRenderMode>(render_mode),
+                                                                        ConvertToBoolUnchecked(textured));
+
+      std::optional<GL::Program> prog = LinkBatchProgram(batch_vs, {}, fs, ConvertToBoolUnchecked(textured));
+      if (!prog)
+        return false;
+
+      m_uber_render_programs[render_mode][textured] = std::move(*prog);
+
+      if (!textured && m_supports_geometry_shaders)
+      {
+        const std::string line_expand_gs = shadergen.GenerateBatchLineExpandGeometryShader();
+        prog = LinkBatchProgram(batch_vs, line_expand_gs, fs, false);
+        if (!prog)
+          return false;
+
+        m_uber_line_render_programs[render_mode] = std::move(*prog);
+      }
+    }
+  }
+
+  return true;
+}
+
+void GPU_HW_OpenGL::CompilePendingBatchPrograms()
+{
+  // Keep the per-frame cost low enough to not cause a visible stall.
+  static constexpr double COMPILE_TIME_BUDGET_MS = 4.0;
+
+  GPU_HW_ShaderGen shadergen(m_host_display->GetRenderAPI(), m_resolution_scale, m_true_color, m_scaled_dithering,
+                             m_texture_filtering, m_supports_dual_source_blend);
+
+  Common::Timer timer;
+  while (m_next_batch_program < NUM_BATCH_PROGRAMS && timer.GetTimeMilliseconds() < COMPILE_TIME_BUDGET_MS)
+  {
+    if (!CompileBatchProgram(shadergen, m_next_batch_program))
+    {
+      Log_ErrorPrintf("Failed to compile batch program %u, continuing with uber shaders.", m_next_batch_program);
+      m_next_batch_program = NUM_BATCH_PROGRAMS;
+      return;
+    }
+
+    m_next_batch_program++;
+    if (m_next_batch_program == NUM_BATCH_PROGRAMS)
+    {
+      Log_InfoPrintf("Batch programs compiled, switching from uber shaders.");
+      SetUsingUberShaders(false);
+    }
+  }
+}
+
 void GPU_HW_OpenGL::DrawBatchVertices(BatchRenderMode render_mode, u32 base_vertex, u32 num_vertices)
 {
-  const GL::Program& prog =
-    ((m_batch.primitive < BatchPrimitive::Triangles && m_supports_geometry_shaders && m_resolution_scale > 1) ?
-       m_line_render_programs[static_cast<u8>(render_mode)][BoolToUInt8(m_batch.dithering)]
-                             [BoolToUInt8(m_batch.interlacing)] :
-       m_render_programs[static_cast<u8>(render_mode)][static_cast<u8>(m_batch.texture_mode)]
-                        [BoolToUInt8(m_batch.dithering)][BoolToUInt8(m_batch.interlacing)]);
-  prog.Bind();
+  const bool expand_lines =
+    (m_batch.primitive < BatchPrimitive::Triangles && m_supports_geometry_shaders && m_resolution_scale > 1);
+  if (m_using_uber_shaders)
+  {
+    // Lines are never textured, so they can use the smaller shader.
+    const GL::Program& prog =
+      (expand_lines ?
+         m_uber_line_render_programs[static_cast<u8>(render_mode)] :
+         m_uber_render_programs[static_cast<u8>(render_mode)][BoolToUInt8(m_batch.primitive >=
+                                                                          BatchPrimitive::Triangles)]);
+    prog.Bind();
+  }
+  else
+  {
+    const GL::Program& prog =
+      (expand_lines ? m_line_render_programs[static_cast<u8>(render_mode)][BoolToUInt8(m_batch.dithering)]
+                                            [BoolToUInt8(m_batch.interlacing)] :
+                      m_render_programs[static_cast<u8>(render_mode)][static_cast<u8>(m_batch.texture_mode)]
+                                       [BoolToUInt8(m_batch.dithering)][BoolToUInt8(m_batch.interlacing)]);
+    prog.Bind();
+  }
 
   if (m_batch.texture_mode != TextureMode::Disabled)
     m_vram_read_texture.Bind();
@@ -578,6 +702,9 @@ void GPU_HW_OpenGL::UpdateDisplay()
 {
   GPU_HW::UpdateDisplay();
 
+  if (m_using_uber_shaders && m_next_batch_program < NUM_BATCH_PROGRAMS)
+    CompilePendingBatchPrograms();
+
   if (m_system->GetSettings().debugging.show_vram)
   {
     m_host_display->SetDisplayTexture(reinterpret_cast<void*>(static_cast<uintptr_t>(m_vram_texture.GetGLId())),
@@ -657,16 +784,13 @@ void GPU_HW_OpenGL::UpdateDisplay()
   }
 }
 
-void GPU_HW_OpenGL::ReadVRAM(u32 x, u32 y, u32 width, u32 height)
+void GPU_HW_OpenGL::StartVRAMDownload(const Common::Rectangle<u32>& rect)
 {
-  // Get bounds with wrap-around handled.
-  const Common::Rectangle<u32> copy_rect = GetVRAMTransferBounds(x, y, width, height);
-  const u32 encoded_width = (copy_rect.GetWidth() + 1) / 2;
-  const u32 encoded_height = copy_rect.GetHeight();
+  const u32 encoded_width = rect.GetWidth() / 2;
+  const u32 encoded_height = rect.GetHeight();
 
   // Encode the 24-bit texture as 16-bit.
-  const u32 uniforms[4] = {copy_rect.left, VRAM_HEIGHT - copy_rect.top - copy_rect.GetHeight(), copy_rect.GetWidth(),
-                           copy_rect.GetHeight()};
+  const u32 uniforms[4] = {rect.left, VRAM_HEIGHT - rect.top - rect.GetHeight(), rect.GetWidth(), rect.GetHeight()};
   m_vram_encoding_texture.BindFramebuffer(GL_DRAW_FRAMEBUFFER);
   m_vram_texture.Bind();
   m_vram_read_program.Bind();
@@ -679,15 +803,60 @@ void GPU_HW_OpenGL::ReadVRAM(u32 x, u32 y, u32 width, u32 height)
 
   // Readback encoded texture.
   m_vram_encoding_texture.BindFramebuffer(GL_READ_FRAMEBUFFER);
-  glPixelStorei(GL_PACK_ALIGNMENT, 2);
-  glPixelStorei(GL_PACK_ROW_LENGTH, VRAM_WIDTH / 2);
-  glReadPixels(0, 0, encoded_width, encoded_height, GL_RGBA, GL_UNSIGNED_BYTE,
-               &m_vram_shadow[copy_rect.top * VRAM_WIDTH + copy_rect.left]);
-  glPixelStorei(GL_PACK_ALIGNMENT, 4);
-  glPixelStorei(GL_PACK_ROW_LENGTH, 0);
+  if (m_use_pbo_for_vram_readbacks)
+  {
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, m_vram_readback_pbo_id);
+    glReadPixels(0, 0, encoded_width, encoded_height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    // Kick the GPU so the copy is hopefully done by the time the CPU wants it.
+    m_vram_readback_fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    glFlush();
+  }
+  else
+  {
+    glPixelStorei(GL_PACK_ALIGNMENT, 2);
+    glPixelStorei(GL_PACK_ROW_LENGTH, VRAM_WIDTH / 2);
+    glReadPixels(0, 0, encoded_width, encoded_height, GL_RGBA, GL_UNSIGNED_BYTE,
+                 &m_vram_shadow[rect.top * VRAM_WIDTH + rect.left]);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glPixelStorei(GL_PACK_ROW_LENGTH, 0);
+  }
+
   RestoreGraphicsAPIState();
 }
 
+void GPU_HW_OpenGL::FinishVRAMDownload(const Common::Rectangle<u32>& rect)
+{
+  if (!m_vram_readback_fence)
+    return;
+
+  while (glClientWaitSync(m_vram_readback_fence, GL_SYNC_FLUSH_COMMANDS_BIT, UINT64_C(1000000000)) ==
+         GL_TIMEOUT_EXPIRED)
+  {
+  }
+  glDeleteSync(m_vram_readback_fence);
+  m_vram_readback_fence = nullptr;
+
+  const u32 row_size = rect.GetWidth() * sizeof(u16);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, m_vram_readback_pbo_id);
+  const u8* map_ptr =
+    static_cast<const u8*>(glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, row_size * rect.GetHeight(), GL_MAP_READ_BIT));
+  if (map_ptr)
+  {
+    for (u32 row = 0; row < rect.GetHeight(); row++)
+      std::memcpy(&m_vram_shadow[(rect.top + row) * VRAM_WIDTH + rect.left], map_ptr + row * row_size, row_size);
+
+    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+  }
+  else
+  {
+    Log_ErrorPrintf("Failed to map VRAM readback buffer");
+  }
+
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
 void GPU_HW_OpenGL::FillVRAM(u32 x, u32 y, u32 width, u32 height, u32 color)
 {
   if ((x + width) > VRAM_WIDTH || (y + height) > VRAM_HEIGHT)
@@ -864,8 +1033,7 @@ void GPU_HW_OpenGL::CopyVRAM(u32 src_x, u32 src_y, u32 dst_x, u32 dst_y, u32 wid
   {
     const Common::Rectangle<u32> src_bounds = GetVRAMTransferBounds(src_x, src_y, width, height);
     const Common::Rectangle<u32> dst_bounds = GetVRAMTransferBounds(dst_x, dst_y, width, height);
-    if (m_vram_dirty_rect.Intersects(src_bounds))
-      UpdateVRAMReadTexture();
+    UpdateVRAMReadTexturePages(GetVRAMReadPageMask(src_bounds));
     IncludeVRAMDityRectangle(dst_bounds);
 
     VRAMCopyUBOData uniforms = {src_x * m_resolution_scale,
@@ -935,9 +1103,9 @@ void GPU_HW_OpenGL::CopyVRAM(u32 src_x, u32 src_y, u32 dst_x, u32 dst_y, u32 wid
   }
 }
 
-void GPU_HW_OpenGL::UpdateVRAMReadTexture()
+void GPU_HW_OpenGL::UpdateVRAMReadTexture(const Common::Rectangle<u32>& rect)
 {
-  const auto scaled_rect = m_vram_dirty_rect * m_resolution_scale;
+  const auto scaled_rect = rect * m_resolution_scale;
   const u32 width = scaled_rect.GetWidth();
   const u32 height = scaled_rect.GetHeight();
   const u32 x = scaled_rect.left;
@@ -962,8 +1130,6 @@ void GPU_HW_OpenGL::UpdateVRAMReadTexture()
     glEnable(GL_SCISSOR_TEST);
     glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_vram_fbo_id);
   }
-
-  GPU_HW::UpdateVRAMReadTexture();
 }
 
 void GPU_HW_OpenGL::UpdateDepthBufferFromMaskBit()
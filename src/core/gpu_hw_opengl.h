@@ -7,8 +7,12 @@
 #include "gpu_hw.h"
 #include <array>
 #include <memory>
+#include <optional>
+#include <string>
 #include <tuple>
 
+class GPU_HW_ShaderGen;
+
 class GPU_HW_OpenGL : public GPU_HW
 {
 public:
@@ -25,12 +29,13 @@ public:
 
 protected:
   void UpdateDisplay() override;
-  void ReadVRAM(u32 x, u32 y, u32 width, u32 height) override;
   void FillVRAM(u32 x, u32 y, u32 width, u32 height, u32 color) override;
   void UpdateVRAM(u32 x, u32 y, u32 width, u32 height, const void* data) override;
   void CopyVRAM(u32 src_x, u32 src_y, u32 dst_x, u32 dst_y, u32 width, u32 height) override;
-  void UpdateVRAMReadTexture() override;
+  void UpdateVRAMReadTexture(const Common::Rectangle<u32>& rect) override;
   void UpdateDepthBufferFromMaskBit() override;
+  void StartVRAMDownload(const Common::Rectangle<u32>& rect) override;
+  void FinishVRAMDownload(const Common::Rectangle<u32>& rect) override;
   void SetScissorFromDrawingArea() override;
   void MapBatchVertexPointer(u32 required_vertices) override;
   void UnmapBatchVertexPointer(u32 used_vertices) override;
@@ -38,6 +43,9 @@ protected:
   void DrawBatchVertices(BatchRenderMode render_mode, u32 base_vertex, u32 num_vertices) override;
 
 private:
+  // [render_mode][texture_mode][dithering][interlacing]
+  static constexpr u32 NUM_BATCH_PROGRAMS = 4 * 9 * 2 * 2;
+
   struct GLStats
   {
     u32 num_batches;
@@ -59,9 +67,19 @@ private:
   bool CreateVertexBuffer();
   bool CreateUniformBuffer();
   bool CreateTextureBuffer();
+  bool CreateReadbackBuffer();
 
   bool CompilePrograms();
 
+  std::optional<GL::Program> LinkBatchProgram(const std::string& vs, const std::string& gs, const std::string& fs,
+                                              bool textured);
+  bool CompileBatchProgram(GPU_HW_ShaderGen& shadergen, u32 index);
+  bool CompileUberBatchPrograms(GPU_HW_ShaderGen& shadergen);
+
+  /// Compiles specialised batch programs until the per-frame time budget runs out, then switches from the uber
+  /// programs once all of them are available.
+  void CompilePendingBatchPrograms();
+
   GL::ShaderCache m_shader_cache;
 
   // downsample texture - used for readbacks at >1xIR.
@@ -81,11 +99,20 @@ private:
   std::unique_ptr<GL::StreamBuffer> m_texture_stream_buffer;
   GLuint m_texture_buffer_r16ui_texture = 0;
 
+  // readbacks go through a pixel pack buffer, so the CPU only waits when it needs the data
+  GLuint m_vram_readback_pbo_id = 0;
+  GLsync m_vram_readback_fence = nullptr;
+
+  // next specialised batch program to compile while the uber programs are in use
+  u32 m_next_batch_program = NUM_BATCH_PROGRAMS;
+
   std::array<std::array<std::array<std::array<GL::Program, 2>, 2>, 9>, 4>
     m_render_programs; // [render_mode][texture_mode][dithering][interlacing]
   std::array<std::array<std::array<GL::Program, 2>, 2>, 4>
-    m_line_render_programs;                                     // [render_mode][dithering][interlacing]
-  std::array<std::array<GL::Program, 3>, 2> m_display_programs; // [depth_24][interlaced]
+    m_line_render_programs;                                         // [render_mode][dithering][interlacing]
+  std::array<std::array<GL::Program, 2>, 4> m_uber_render_programs; // [render_mode][textured]
+  std::array<GL::Program, 4> m_uber_line_render_programs;           // [render_mode]
+  std::array<std::array<GL::Program, 3>, 2> m_display_programs;     // [depth_24][interlaced]
   GL::Program m_vram_interlaced_fill_program;
   GL::Program m_vram_read_program;
   GL::Program m_vram_write_program;
@@ -98,4 +125,5 @@ private:
   bool m_supports_texture_buffer = false;
   bool m_supports_geometry_shaders = false;
   bool m_use_ssbo_for_vram_writes = false;
+  bool m_use_pbo_for_vram_readbacks = false;
 };
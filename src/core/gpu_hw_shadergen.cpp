@@ -498,7 +498,8 @@ void GPU_HW_ShaderGen::WriteBatchUniformBuffer(std::stringstream& ss)
   DeclareUniformBuffer(ss,
                        {"uint2 u_texture_window_mask", "uint2 u_texture_window_offset", "float u_src_alpha_factor",
                         "float u_dst_alpha_factor", "uint u_interlaced_displayed_field",
-                        "bool u_set_mask_while_drawing"},
+                        "bool u_set_mask_while_drawing", "uint u_texture_mode", "bool u_dithering",
+                        "bool u_interlacing"},
                        false);
 }
 
@@ -570,37 +571,8 @@ std::string GPU_HW_ShaderGen::GenerateBatchVertexShader(bool textured)
   return ss.str();
 }
 
-std::string GPU_HW_ShaderGen::GenerateBatchFragmentShader(GPU_HW::BatchRenderMode transparency,
-                                                          GPU::TextureMode texture_mode, bool dithering,
-                                                          bool interlacing)
+void GPU_HW_ShaderGen::WriteBatchFragmentFunctions(std::stringstream& ss)
 {
-  const GPU::TextureMode actual_texture_mode = texture_mode & ~GPU::TextureMode::RawTextureBit;
-  const bool raw_texture = (texture_mode & GPU::TextureMode::RawTextureBit) == GPU::TextureMode::RawTextureBit;
-  const bool textured = (texture_mode != GPU::TextureMode::Disabled);
-  const bool use_dual_source =
-    m_supports_dual_source_blend && ((transparency != GPU_HW::BatchRenderMode::TransparencyDisabled &&
-                                      transparency != GPU_HW::BatchRenderMode::OnlyOpaque) ||
-                                     m_texture_filering);
-
-  std::stringstream ss;
-  WriteHeader(ss);
-  DefineMacro(ss, "TRANSPARENCY", transparency != GPU_HW::BatchRenderMode::TransparencyDisabled);
-  DefineMacro(ss, "TRANSPARENCY_ONLY_OPAQUE", transparency == GPU_HW::BatchRenderMode::OnlyOpaque);
-  DefineMacro(ss, "TRANSPARENCY_ONLY_TRANSPARENCY", transparency == GPU_HW::BatchRenderMode::OnlyTransparent);
-  DefineMacro(ss, "TEXTURED", textured);
-  DefineMacro(ss, "PALETTE",
-              actual_texture_mode == GPU::TextureMode::Palette4Bit ||
-                actual_texture_mode == GPU::TextureMode::Palette8Bit);
-  DefineMacro(ss, "PALETTE_4_BIT", actual_texture_mode == GPU::TextureMode::Palette4Bit);
-  DefineMacro(ss, "PALETTE_8_BIT", actual_texture_mode == GPU::TextureMode::Palette8Bit);
-  DefineMacro(ss, "RAW_TEXTURE", raw_texture);
-  DefineMacro(ss, "DITHERING", dithering);
-  DefineMacro(ss, "DITHERING_SCALED", m_scaled_dithering);
-  DefineMacro(ss, "INTERLACING", interlacing);
-  DefineMacro(ss, "TRUE_COLOR", m_true_color);
-  DefineMacro(ss, "TEXTURE_FILTERING", m_texture_filering);
-  DefineMacro(ss, "USE_DUAL_SOURCE", use_dual_source);
-
   WriteCommonFunctions(ss);
   WriteBatchUniformBuffer(ss);
   DeclareTexture(ss, "samp0", 0);
@@ -660,7 +632,113 @@ uint2 FloatToIntegerCoords(float2 coords)
   // Floor them otherwise, as it currently breaks when upscaling as the vertex offset is not applied.
   return uint2((RESOLUTION_SCALE == 1u) ? roundEven(coords) : floor(coords));
 }
+#endif
+)";
+}
+
+void GPU_HW_ShaderGen::WriteBatchFragmentOutput(std::stringstream& ss)
+{
+  ss << R"(
+  // Premultiply alpha so we don't need to use a colour output for it.
+  float premultiply_alpha = ialpha;
+  #if TRANSPARENCY
+    premultiply_alpha = ialpha * (semitransparent ? u_src_alpha_factor : 1.0);
+  #endif
+
+  float3 color;
+  #if !TRUE_COLOR
+    // We want to apply the alpha before the truncation to 16-bit, otherwise we'll be passing a 32-bit precision color
+    // into the blend unit, which can cause a small amount of error to accumulate.
+    color = floor(float3(icolor) * premultiply_alpha) / float3(31.0, 31.0, 31.0);
+  #else
+    // True color is actually simpler here since we want to preserve the precision.
+    color = (float3(icolor) * premultiply_alpha) / float3(255.0, 255.0, 255.0);
+  #endif
+
+  #if TRANSPARENCY
+    // Apply semitransparency. If not a semitransparent texel, destination alpha is ignored.
+    if (semitransparent)
+    {
+      #if TRANSPARENCY_ONLY_OPAQUE
+        discard;
+      #endif
+
+      #if USE_DUAL_SOURCE
+        o_col0 = float4(color, oalpha);
+        o_col1 = float4(0.0, 0.0, 0.0, u_dst_alpha_factor / ialpha);
+      #else
+        o_col0 = float4(color, u_dst_alpha_factor / ialpha);
+      #endif
+
+      o_depth = oalpha * v_pos.z;
+    }
+    else
+    {
+      #if TRANSPARENCY_ONLY_TRANSPARENCY
+        discard;
+      #endif
+
+      #if TRANSPARENCY_ONLY_OPAQUE
+        // We don't output the second color here because it's not used.
+        o_col0 = float4(color, oalpha);
+      #elif USE_DUAL_SOURCE
+        o_col0 = float4(color, oalpha);
+        o_col1 = float4(0.0, 0.0, 0.0, 1.0 - ialpha);
+      #else
+        o_col0 = float4(color, 1.0 - ialpha);
+      #endif
+
+      o_depth = oalpha * v_pos.z;
+    }
+  #else
+    // Non-transparency won't enable blending so we can write the mask here regardless.
+    o_col0 = float4(color, oalpha);
+
+    #if USE_DUAL_SOURCE
+      o_col1 = float4(0.0, 0.0, 0.0, 1.0 - ialpha);
+    #endif
+
+    o_depth = oalpha * v_pos.z;
+  #endif
+}
+)";
+}
+
+std::string GPU_HW_ShaderGen::GenerateBatchFragmentShader(GPU_HW::BatchRenderMode transparency,
+                                                          GPU::TextureMode texture_mode, bool dithering,
+                                                          bool interlacing)
+{
+  const GPU::TextureMode actual_texture_mode = texture_mode & ~GPU::TextureMode::RawTextureBit;
+  const bool raw_texture = (texture_mode & GPU::TextureMode::RawTextureBit) == GPU::TextureMode::RawTextureBit;
+  const bool textured = (texture_mode != GPU::TextureMode::Disabled);
+  const bool use_dual_source =
+    m_supports_dual_source_blend && ((transparency != GPU_HW::BatchRenderMode::TransparencyDisabled &&
+                                      transparency != GPU_HW::BatchRenderMode::OnlyOpaque) ||
+                                     m_texture_filering);
 
+  std::stringstream ss;
+  WriteHeader(ss);
+  DefineMacro(ss, "TRANSPARENCY", transparency != GPU_HW::BatchRenderMode::TransparencyDisabled);
+  DefineMacro(ss, "TRANSPARENCY_ONLY_OPAQUE", transparency == GPU_HW::BatchRenderMode::OnlyOpaque);
+  DefineMacro(ss, "TRANSPARENCY_ONLY_TRANSPARENCY", transparency == GPU_HW::BatchRenderMode::OnlyTransparent);
+  DefineMacro(ss, "TEXTURED", textured);
+  DefineMacro(ss, "PALETTE",
+              actual_texture_mode == GPU::TextureMode::Palette4Bit ||
+                actual_texture_mode == GPU::TextureMode::Palette8Bit);
+  DefineMacro(ss, "PALETTE_4_BIT", actual_texture_mode == GPU::TextureMode::Palette4Bit);
+  DefineMacro(ss, "PALETTE_8_BIT", actual_texture_mode == GPU::TextureMode::Palette8Bit);
+  DefineMacro(ss, "RAW_TEXTURE", raw_texture);
+  DefineMacro(ss, "DITHERING", dithering);
+  DefineMacro(ss, "DITHERING_SCALED", m_scaled_dithering);
+  DefineMacro(ss, "INTERLACING", interlacing);
+  DefineMacro(ss, "TRUE_COLOR", m_true_color);
+  DefineMacro(ss, "TEXTURE_FILTERING", m_texture_filering);
+  DefineMacro(ss, "USE_DUAL_SOURCE", use_dual_source);
+
+  WriteBatchFragmentFunctions(ss);
+
+  ss << R"(
+#if TEXTURED
 float4 SampleFromVRAM(uint4 texpage, float2 coords)
 {
   #if PALETTE
@@ -815,71 +893,197 @@ float4 SampleFromVRAM(uint4 texpage, float2 coords)
     // However, the mask bit is cleared if set mask bit is false.
     oalpha = float(u_set_mask_while_drawing);
   #endif
+)";
 
-  // Premultiply alpha so we don't need to use a colour output for it.
-  float premultiply_alpha = ialpha;
-  #if TRANSPARENCY
-    premultiply_alpha = ialpha * (semitransparent ? u_src_alpha_factor : 1.0);
-  #endif
+  WriteBatchFragmentOutput(ss);
 
-  float3 color;
-  #if !TRUE_COLOR
-    // We want to apply the alpha before the truncation to 16-bit, otherwise we'll be passing a 32-bit precision color
-    // into the blend unit, which can cause a small amount of error to accumulate.
-    color = floor(float3(icolor) * premultiply_alpha) / float3(31.0, 31.0, 31.0);
-  #else
-    // True color is actually simpler here since we want to preserve the precision.
-    color = (float3(icolor) * premultiply_alpha) / float3(255.0, 255.0, 255.0);
-  #endif
+  return ss.str();
+}
 
-  #if TRANSPARENCY
-    // Apply semitransparency. If not a semitransparent texel, destination alpha is ignored.
-    if (semitransparent)
-    {
-      #if TRANSPARENCY_ONLY_OPAQUE
-        discard;
-      #endif
+std::string GPU_HW_ShaderGen::GenerateBatchUberFragmentShader(GPU_HW::BatchRenderMode transparency, bool textured)
+{
+  const bool use_dual_source =
+    m_supports_dual_source_blend && ((transparency != GPU_HW::BatchRenderMode::TransparencyDisabled &&
+                                      transparency != GPU_HW::BatchRenderMode::OnlyOpaque) ||
+                                     m_texture_filering);
 
-      #if USE_DUAL_SOURCE
-        o_col0 = float4(color, oalpha);
-        o_col1 = float4(0.0, 0.0, 0.0, u_dst_alpha_factor / ialpha);
-      #else
-        o_col0 = float4(color, u_dst_alpha_factor / ialpha);
-      #endif
+  std::stringstream ss;
+  WriteHeader(ss);
+  DefineMacro(ss, "TRANSPARENCY", transparency != GPU_HW::BatchRenderMode::TransparencyDisabled);
+  DefineMacro(ss, "TRANSPARENCY_ONLY_OPAQUE", transparency == GPU_HW::BatchRenderMode::OnlyOpaque);
+  DefineMacro(ss, "TRANSPARENCY_ONLY_TRANSPARENCY", transparency == GPU_HW::BatchRenderMode::OnlyTransparent);
+  DefineMacro(ss, "TEXTURED", textured);
+  DefineMacro(ss, "DITHERING_SCALED", m_scaled_dithering);
+  DefineMacro(ss, "TRUE_COLOR", m_true_color);
+  DefineMacro(ss, "TEXTURE_FILTERING", m_texture_filering);
+  DefineMacro(ss, "USE_DUAL_SOURCE", use_dual_source);
 
-      o_depth = oalpha * v_pos.z;
-    }
+  WriteBatchFragmentFunctions(ss);
+
+  ss << "CONSTANT uint TEXTURE_MODE_PALETTE_4_BIT = " << static_cast<u32>(GPU::TextureMode::Palette4Bit) << "u;\n";
+  ss << "CONSTANT uint TEXTURE_MODE_PALETTE_8_BIT = " << static_cast<u32>(GPU::TextureMode::Palette8Bit) << "u;\n";
+  ss << "CONSTANT uint TEXTURE_MODE_RAW_TEXTURE_BIT = " << static_cast<u32>(GPU::TextureMode::RawTextureBit)
+     << "u;\n";
+  ss << "CONSTANT uint TEXTURE_MODE_DISABLED = " << static_cast<u32>(GPU::TextureMode::Disabled) << "u;\n";
+
+  ss << R"(
+#if TEXTURED
+float4 SampleFromVRAM(uint4 texpage, float2 coords)
+{
+  uint palette_mode = u_texture_mode & 3u;
+  if (palette_mode == TEXTURE_MODE_PALETTE_4_BIT || palette_mode == TEXTURE_MODE_PALETTE_8_BIT)
+  {
+    #if !TEXTURE_FILTERING
+      coords /= float2(RESOLUTION_SCALE, RESOLUTION_SCALE);
+    #endif
+    uint2 icoord = ApplyTextureWindow(FloatToIntegerCoords(coords));
+
+    bool palette_4_bit = (palette_mode == TEXTURE_MODE_PALETTE_4_BIT);
+    uint2 index_coord = uint2(icoord.x / (palette_4_bit ? 4u : 2u), icoord.y);
+
+    // fixup coords
+    uint2 vicoord = uint2(texpage.x + index_coord.x * RESOLUTION_SCALE, fixYCoord(texpage.y + index_coord.y * RESOLUTION_SCALE));
+
+    // load colour/palette
+    float4 texel = LOAD_TEXTURE(samp0, int2(vicoord), 0);
+    uint vram_value = RGBA8ToRGBA5551(texel);
+
+    // apply palette
+    uint palette_index;
+    if (palette_4_bit)
+      palette_index = (vram_value >> ((icoord.x & 3u) * 4u)) & 0x0Fu;
     else
-    {
-      #if TRANSPARENCY_ONLY_TRANSPARENCY
+      palette_index = (vram_value >> ((icoord.x & 1u) * 8u)) & 0xFFu;
+
+    // sample palette
+    uint2 palette_icoord = uint2(texpage.z + (palette_index * RESOLUTION_SCALE), fixYCoord(texpage.w));
+    return LOAD_TEXTURE(samp0, int2(palette_icoord), 0);
+  }
+  else
+  {
+    // Direct texturing. Render-to-texture effects. Use upscaled coordinates.
+    uint2 icoord = ApplyUpscaledTextureWindow(FloatToIntegerCoords(coords));
+    uint2 direct_icoord = uint2(texpage.x + icoord.x, fixYCoord(texpage.y + icoord.y));
+    return LOAD_TEXTURE(samp0, int2(direct_icoord), 0);
+  }
+}
+#endif
+)";
+
+  if (textured)
+  {
+    DeclareFragmentEntryPoint(ss, 1, 1, {{"nointerpolation", "uint4 v_texpage"}}, true, use_dual_source ? 2 : 1, true);
+  }
+  else
+  {
+    DeclareFragmentEntryPoint(ss, 1, 0, {}, true, use_dual_source ? 2 : 1, true);
+  }
+
+  ss << R"(
+{
+  uint3 vertcol = uint3(v_col0.rgb * float3(255.0, 255.0, 255.0));
+
+  bool semitransparent;
+  uint3 icolor;
+  float ialpha;
+  float oalpha;
+
+  if (u_interlacing && (fixYCoord(uint(v_pos.y)) & 1u) == u_interlaced_displayed_field)
+    discard;
+
+  #if TEXTURED
+  if (u_texture_mode != TEXTURE_MODE_DISABLED)
+  {
+    #if TEXTURE_FILTERING
+      // Compute the coordinates of the four texels we will be interpolating between.
+      float2 downscaled_coords = v_tex0;
+      if ((u_texture_mode & 3u) == TEXTURE_MODE_PALETTE_4_BIT || (u_texture_mode & 3u) == TEXTURE_MODE_PALETTE_8_BIT)
+        downscaled_coords /= float2(RESOLUTION_SCALE, RESOLUTION_SCALE);
+
+      float2 texel_top_left = frac(downscaled_coords) - float2(0.5, 0.5);
+      float2 texel_offset = sign(texel_top_left);
+      float4 fcoords = max(downscaled_coords.xyxy + float4(0.0, 0.0, texel_offset.x, texel_offset.y),
+                           float4(0.0, 0.0, 0.0, 0.0));
+
+      // Load four texels.
+      float4 s00 = SampleFromVRAM(v_texpage, fcoords.xy);
+      float4 s10 = SampleFromVRAM(v_texpage, fcoords.zy);
+      float4 s01 = SampleFromVRAM(v_texpage, fcoords.xw);
+      float4 s11 = SampleFromVRAM(v_texpage, fcoords.zw);
+
+      // Compute alpha from how many texels aren't pixel color 0000h.
+      float a00 = float(VECTOR_NEQ(s00, TRANSPARENT_PIXEL_COLOR));
+      float a10 = float(VECTOR_NEQ(s10, TRANSPARENT_PIXEL_COLOR));
+      float a01 = float(VECTOR_NEQ(s01, TRANSPARENT_PIXEL_COLOR));
+      float a11 = float(VECTOR_NEQ(s11, TRANSPARENT_PIXEL_COLOR));
+
+      // Bilinearly interpolate.
+      float2 weights = abs(texel_top_left);
+      float4 texcol = lerp(lerp(s00, s10, weights.x), lerp(s01, s11, weights.x), weights.y);
+      ialpha = lerp(lerp(a00, a10, weights.x), lerp(a01, a11, weights.x), weights.y);
+      if (ialpha < 0.5)
         discard;
-      #endif
 
-      #if TRANSPARENCY_ONLY_OPAQUE
-        // We don't output the second color here because it's not used.
-        o_col0 = float4(color, oalpha);
-      #elif USE_DUAL_SOURCE
-        o_col0 = float4(color, oalpha);
-        o_col1 = float4(0.0, 0.0, 0.0, 1.0 - ialpha);
-      #else
-        o_col0 = float4(color, 1.0 - ialpha);
-      #endif
+      texcol.rgb /= float3(ialpha, ialpha, ialpha);
+      semitransparent = (texcol.a != 0.0);
+    #else
+      float4 texcol = SampleFromVRAM(v_texpage, v_tex0);
+      if (VECTOR_EQ(texcol, TRANSPARENT_PIXEL_COLOR))
+        discard;
 
-      o_depth = oalpha * v_pos.z;
-    }
-  #else
-    // Non-transparency won't enable blending so we can write the mask here regardless.
-    o_col0 = float4(color, oalpha);
+      semitransparent = (texcol.a != 0.0);
+      ialpha = 1.0;
+    #endif
 
-    #if USE_DUAL_SOURCE
-      o_col1 = float4(0.0, 0.0, 0.0, 1.0 - ialpha);
+    // If not using true color, truncate the framebuffer colors to 5-bit.
+    bool raw_texture = ((u_texture_mode & TEXTURE_MODE_RAW_TEXTURE_BIT) != 0u);
+    #if !TRUE_COLOR
+      icolor = uint3(texcol.rgb * float3(255.0, 255.0, 255.0)) >> 3;
+      if (!raw_texture)
+      {
+        icolor = (icolor * vertcol) >> 4;
+        if (u_dithering)
+          icolor = ApplyDithering(uint2(v_pos.xy), icolor);
+        else
+          icolor = min(icolor >> 3, uint3(31u, 31u, 31u));
+      }
+    #else
+      icolor = uint3(texcol.rgb * float3(255.0, 255.0, 255.0));
+      if (!raw_texture)
+      {
+        icolor = (icolor * vertcol) >> 7;
+        if (u_dithering)
+          icolor = ApplyDithering(uint2(v_pos.xy), icolor);
+        else
+          icolor = min(icolor, uint3(255u, 255u, 255u));
+      }
     #endif
 
-    o_depth = oalpha * v_pos.z;
+    // Compute output alpha (mask bit)
+    oalpha = float(u_set_mask_while_drawing ? 1 : int(semitransparent));
+  }
+  else
   #endif
-}
+  {
+    // All pixels are semitransparent for untextured polygons.
+    semitransparent = true;
+    icolor = vertcol;
+    ialpha = 1.0;
+
+    if (u_dithering)
+      icolor = ApplyDithering(uint2(v_pos.xy), icolor);
+    #if !TRUE_COLOR
+    else
+      icolor >>= 3;
+    #endif
+
+    // However, the mask bit is cleared if set mask bit is false.
+    oalpha = float(u_set_mask_while_drawing);
+  }
 )";
 
+  WriteBatchFragmentOutput(ss);
+
   return ss.str();
 }
 
@@ -16,6 +16,7 @@ public:
   std::string GenerateBatchVertexShader(bool textured);
   std::string GenerateBatchFragmentShader(GPU_HW::BatchRenderMode transparency, GPU::TextureMode texture_mode,
                                           bool dithering, bool interlacing);
+  std::string GenerateBatchUberFragmentShader(GPU_HW::BatchRenderMode transparency, bool textured);
   std::string GenerateBatchLineExpandGeometryShader();
   std::string GenerateScreenQuadVertexShader();
   std::string GenerateFillFragmentShader();
@@ -46,6 +47,8 @@ private:
 
   void WriteCommonFunctions(std::stringstream& ss);
   void WriteBatchUniformBuffer(std::stringstream& ss);
+  void WriteBatchFragmentFunctions(std::stringstream& ss);
+  void WriteBatchFragmentOutput(std::stringstream& ss);
 
   HostDisplay::RenderAPI m_render_api;
   u32 m_resolution_scale;
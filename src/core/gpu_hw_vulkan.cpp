@@ -124,6 +124,9 @@ void GPU_HW_Vulkan::RestoreGraphicsAPIState()
 
 void GPU_HW_Vulkan::UpdateSettings()
 {
+  // The pipeline compile thread reads the settings and render pass, so it has to finish before they change.
+  StopBatchPipelineCompile();
+
   GPU_HW::UpdateSettings();
 
   // Everything should be finished executing before recreating resources.
@@ -566,159 +569,35 @@ bool GPU_HW_Vulkan::CreateTextureBuffer()
 
 bool GPU_HW_Vulkan::CompilePipelines()
 {
-  static constexpr std::array<VkPrimitiveTopology, 2> primitive_mapping = {
-    {VK_PRIMITIVE_TOPOLOGY_LINE_LIST, VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST}};
-  static constexpr std::array<VkPolygonMode, 2> polygon_mode_mapping = {{VK_POLYGON_MODE_LINE, VK_POLYGON_MODE_FILL}};
-
   VkDevice device = g_vulkan_context->GetDevice();
   VkPipelineCache pipeline_cache = g_vulkan_shader_cache->GetPipelineCache();
 
   GPU_HW_ShaderGen shadergen(m_host_display->GetRenderAPI(), m_resolution_scale, m_true_color, m_scaled_dithering,
                              m_texture_filtering, m_supports_dual_source_blend);
 
-  // vertex shaders - [textured]
-  // fragment shaders - [render_mode][texture_mode][dithering][interlacing]
-  DimensionalArray<VkShaderModule, 2> batch_vertex_shaders{};
-  DimensionalArray<VkShaderModule, 2, 2, 9, 4> batch_fragment_shaders{};
-  VkShaderModule batch_line_geometry_shader = VK_NULL_HANDLE;
-  Common::ScopeGuard batch_shader_guard(
-    [&batch_vertex_shaders, &batch_fragment_shaders, &batch_line_geometry_shader]() {
-      batch_vertex_shaders.enumerate(Vulkan::Util::SafeDestroyShaderModule);
-      batch_fragment_shaders.enumerate(Vulkan::Util::SafeDestroyShaderModule);
-      Vulkan::Util::SafeDestroyShaderModule(batch_line_geometry_shader);
-    });
-
-  for (u8 textured = 0; textured < 2; textured++)
+  if (m_uber_shaders)
   {
-    const std::string vs = shadergen.GenerateBatchVertexShader(ConvertToBoolUnchecked(textured));
-    VkShaderModule shader = g_vulkan_shader_cache->GetVertexShader(vs);
-    if (shader == VK_NULL_HANDLE)
+    // Draw with the uber shaders until the specialised pipelines have been compiled in the background.
+    if (!CompileUberBatchPipelines(shadergen, pipeline_cache))
       return false;
 
-    batch_vertex_shaders[textured] = shader;
-  }
-
-  for (u8 render_mode = 0; render_mode < 4; render_mode++)
-  {
-    for (u8 texture_mode = 0; texture_mode < 9; texture_mode++)
-    {
-      for (u8 dithering = 0; dithering < 2; dithering++)
-      {
-        for (u8 interlacing = 0; interlacing < 2; interlacing++)
-        {
-          const std::string fs = shadergen.GenerateBatchFragmentShader(
-            static_cast<BatchRenderMode>(render_mode), static_cast<TextureMode>(texture_mode),
-            ConvertToBoolUnchecked(dithering), ConvertToBoolUnchecked(interlacing));
-
-          VkShaderModule shader = g_vulkan_shader_cache->GetFragmentShader(fs);
-          if (shader == VK_NULL_HANDLE)
-            return false;
-
-          batch_fragment_shaders[render_mode][texture_mode][dithering][interlacing] = shader;
-        }
-      }
-    }
-  }
-
-  if (m_resolution_scale > 1)
-  {
-    if (g_vulkan_context->GetDeviceFeatures().geometryShader)
-    {
-      const std::string gs = shadergen.GenerateBatchLineExpandGeometryShader();
-      batch_line_geometry_shader = g_vulkan_shader_cache->GetGeometryShader(gs);
-      if (batch_line_geometry_shader == VK_NULL_HANDLE)
-        return false;
-    }
-    else
-    {
-      Log_WarningPrintf("Upscaling requested but geometry shaders are unsupported, line rendering will be incorrect.");
-    }
+    SetUsingUberShaders(true);
+    m_batch_pipeline_compile_done.store(false, std::memory_order_relaxed);
+    m_batch_pipeline_thread = std::thread([this, pipeline_cache]() {
+      GPU_HW_ShaderGen thread_shadergen(m_host_display->GetRenderAPI(), m_resolution_scale, m_true_color,
+                                        m_scaled_dithering, m_texture_filtering, m_supports_dual_source_blend);
+      m_pending_batch_pipelines_valid =
+        CompileBatchPipelines(thread_shadergen, pipeline_cache, m_pending_batch_pipelines);
+      m_batch_pipeline_compile_done.store(true, std::memory_order_release);
+    });
   }
-
-  Vulkan::GraphicsPipelineBuilder gpbuilder;
-
-  // [primitive][depth_test][render_mode][texture_mode][transparency_mode][dithering][interlacing]
-  for (u8 primitive = 0; primitive < 2; primitive++)
+  else
   {
-    for (u8 depth_test = 0; depth_test < 2; depth_test++)
-    {
-      for (u8 render_mode = 0; render_mode < 4; render_mode++)
-      {
-        for (u8 transparency_mode = 0; transparency_mode < 5; transparency_mode++)
-        {
-          for (u8 texture_mode = 0; texture_mode < 9; texture_mode++)
-          {
-            for (u8 dithering = 0; dithering < 2; dithering++)
-            {
-              for (u8 interlacing = 0; interlacing < 2; interlacing++)
-              {
-                const bool textured = (static_cast<TextureMode>(texture_mode) != TextureMode::Disabled);
-
-                gpbuilder.SetPipelineLayout(m_batch_pipeline_layout);
-                gpbuilder.SetRenderPass(m_vram_render_pass, 0);
-
-                gpbuilder.AddVertexBuffer(0, sizeof(BatchVertex), VK_VERTEX_INPUT_RATE_VERTEX);
-                gpbuilder.AddVertexAttribute(0, 0, VK_FORMAT_R32G32B32_SINT, offsetof(BatchVertex, x));
-                gpbuilder.AddVertexAttribute(1, 0, VK_FORMAT_R8G8B8A8_UNORM, offsetof(BatchVertex, color));
-                if (textured)
-                {
-                  gpbuilder.AddVertexAttribute(2, 0, VK_FORMAT_R32_UINT, offsetof(BatchVertex, u));
-                  gpbuilder.AddVertexAttribute(3, 0, VK_FORMAT_R32_UINT, offsetof(BatchVertex, texpage));
-                }
-
-                gpbuilder.SetPrimitiveTopology(primitive_mapping[primitive]);
-                gpbuilder.SetVertexShader(batch_vertex_shaders[BoolToUInt8(textured)]);
-                gpbuilder.SetFragmentShader(batch_fragment_shaders[render_mode][texture_mode][dithering][interlacing]);
-                if (static_cast<BatchPrimitive>(primitive) == BatchPrimitive::Lines &&
-                    batch_line_geometry_shader != VK_NULL_HANDLE)
-                {
-                  gpbuilder.SetGeometryShader(batch_line_geometry_shader);
-                  gpbuilder.SetRasterizationState(polygon_mode_mapping[static_cast<u8>(BatchPrimitive::Triangles)],
-                                                  VK_CULL_MODE_NONE, VK_FRONT_FACE_CLOCKWISE);
-                }
-                else
-                {
-                  gpbuilder.SetRasterizationState(polygon_mode_mapping[primitive], VK_CULL_MODE_NONE,
-                                                  VK_FRONT_FACE_CLOCKWISE);
-                }
-
-                gpbuilder.SetDepthState(true, true,
-                                        (depth_test != 0) ? VK_COMPARE_OP_GREATER_OR_EQUAL : VK_COMPARE_OP_ALWAYS);
-
-                gpbuilder.SetNoBlendingState();
-
-                if ((static_cast<TransparencyMode>(transparency_mode) != TransparencyMode::Disabled &&
-                     (static_cast<BatchRenderMode>(render_mode) != BatchRenderMode::TransparencyDisabled &&
-                      static_cast<BatchRenderMode>(render_mode) != BatchRenderMode::OnlyOpaque)) ||
-                    m_texture_filtering)
-                {
-                  gpbuilder.SetBlendAttachment(
-                    0, true, VK_BLEND_FACTOR_ONE,
-                    m_supports_dual_source_blend ? VK_BLEND_FACTOR_SRC1_ALPHA : VK_BLEND_FACTOR_SRC_ALPHA,
-                    (static_cast<TransparencyMode>(transparency_mode) == TransparencyMode::BackgroundMinusForeground) ?
-                      VK_BLEND_OP_REVERSE_SUBTRACT :
-                      VK_BLEND_OP_ADD,
-                    VK_BLEND_FACTOR_ONE, VK_BLEND_FACTOR_ZERO, VK_BLEND_OP_ADD);
-                }
-
-                gpbuilder.SetDynamicViewportAndScissorState();
-
-                VkPipeline pipeline = gpbuilder.Create(device, pipeline_cache);
-                if (pipeline == VK_NULL_HANDLE)
-                  return false;
-
-                m_batch_pipelines[primitive][depth_test][render_mode][texture_mode][transparency_mode][dithering]
-                                 [interlacing] = pipeline;
-              }
-            }
-          }
-        }
-      }
-    }
+    SetUsingUberShaders(false);
+    if (!CompileBatchPipelines(shadergen, pipeline_cache, m_batch_pipelines))
+      return false;
   }
 
-  batch_shader_guard.Exit();
-
   VkShaderModule fullscreen_quad_vertex_shader =
     g_vulkan_shader_cache->GetVertexShader(shadergen.GenerateScreenQuadVertexShader());
   if (fullscreen_quad_vertex_shader == VK_NULL_HANDLE)
@@ -729,6 +608,7 @@ bool GPU_HW_Vulkan::CompilePipelines()
   });
 
   // common state
+  Vulkan::GraphicsPipelineBuilder gpbuilder;
   gpbuilder.SetRenderPass(m_vram_render_pass, 0);
   gpbuilder.SetPrimitiveTopology(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST);
   gpbuilder.SetNoCullRasterizationState();
@@ -881,9 +761,270 @@ bool GPU_HW_Vulkan::CompilePipelines()
   return true;
 }
 
+bool GPU_HW_Vulkan::CompileBatchVertexShaders(GPU_HW_ShaderGen& shadergen,
+                                              DimensionalArray<VkShaderModule, 2>& vertex_shaders,
+                                              VkShaderModule* line_geometry_shader)
+{
+  for (u8 textured = 0; textured < 2; textured++)
+  {
+    const std::string vs = shadergen.GenerateBatchVertexShader(ConvertToBoolUnchecked(textured));
+    VkShaderModule shader = g_vulkan_shader_cache->GetVertexShader(vs);
+    if (shader == VK_NULL_HANDLE)
+      return false;
+
+    vertex_shaders[textured] = shader;
+  }
+
+  if (m_resolution_scale > 1)
+  {
+    if (g_vulkan_context->GetDeviceFeatures().geometryShader)
+    {
+      const std::string gs = shadergen.GenerateBatchLineExpandGeometryShader();
+      *line_geometry_shader = g_vulkan_shader_cache->GetGeometryShader(gs);
+      if (*line_geometry_shader == VK_NULL_HANDLE)
+        return false;
+    }
+    else
+    {
+      Log_WarningPrintf("Upscaling requested but geometry shaders are unsupported, line rendering will be incorrect.");
+    }
+  }
+
+  return true;
+}
+
+VkPipeline GPU_HW_Vulkan::CreateBatchPipeline(VkPipelineCache pipeline_cache, u8 primitive, u8 depth_test,
+                                              u8 render_mode, u8 transparency_mode, bool textured,
+                                              VkShaderModule vertex_shader, VkShaderModule line_geometry_shader,
+                                              VkShaderModule fragment_shader)
+{
+  static constexpr std::array<VkPrimitiveTopology, 2> primitive_mapping = {
+    {VK_PRIMITIVE_TOPOLOGY_LINE_LIST, VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST}};
+  static constexpr std::array<VkPolygonMode, 2> polygon_mode_mapping = {{VK_POLYGON_MODE_LINE, VK_POLYGON_MODE_FILL}};
+
+  Vulkan::GraphicsPipelineBuilder gpbuilder;
+  gpbuilder.SetPipelineLayout(m_batch_pipeline_layout);
+  gpbuilder.SetRenderPass(m_vram_render_pass, 0);
+
+  gpbuilder.AddVertexBuffer(0, sizeof(BatchVertex), VK_VERTEX_INPUT_RATE_VERTEX);
+  gpbuilder.AddVertexAttribute(0, 0, VK_FORMAT_R32G32B32_SINT, offsetof(BatchVertex, x));
+  gpbuilder.AddVertexAttribute(1, 0, VK_FORMAT_R8G8B8A8_UNORM, offsetof(BatchVertex, color));
+  if (textured)
+  {
+    gpbuilder.AddVertexAttribute(2, 0, VK_FORMAT_R32_UINT, offsetof(BatchVertex, u));
+    gpbuilder.AddVertexAttribute(3, 0, VK_FORMAT_R32_UINT, offsetof(BatchVertex, texpage));
+  }
+
+  gpbuilder.SetPrimitiveTopology(primitive_mapping[primitive]);
+  gpbuilder.SetVertexShader(vertex_shader);
+  gpbuilder.SetFragmentShader(fragment_shader);
+  if (static_cast<BatchPrimitive>(primitive) == BatchPrimitive::Lines && line_geometry_shader != VK_NULL_HANDLE)
+  {
+    gpbuilder.SetGeometryShader(line_geometry_shader);
+    gpbuilder.SetRasterizationState(polygon_mode_mapping[static_cast<u8>(BatchPrimitive::Triangles)],
+                                    VK_CULL_MODE_NONE, VK_FRONT_FACE_CLOCKWISE);
+  }
+  else
+  {
+    gpbuilder.SetRasterizationState(polygon_mode_mapping[primitive], VK_CULL_MODE_NONE, VK_FRONT_FACE_CLOCKWISE);
+  }
+
+  gpbuilder.SetDepthState(true, true, (depth_test != 0) ? VK_COMPARE_OP_GREATER_OR_EQUAL : VK_COMPARE_OP_ALWAYS);
+
+  gpbuilder.SetNoBlendingState();
+
+  if ((static_cast<TransparencyMode>(transparency_mode) != TransparencyMode::Disabled &&
+       (static_cast<BatchRenderMode>(render_mode) != BatchRenderMode::TransparencyDisabled &&
+        static_cast<BatchRenderMode>(render_mode) != BatchRenderMode::OnlyOpaque)) ||
+      m_texture_filtering)
+  {
+    gpbuilder.SetBlendAttachment(
+      0, true, VK_BLEND_FACTOR_ONE, m_supports_dual_source_blend ? VK_BLEND_FACTOR_SRC1_ALPHA : VK_BLEND_FACTOR_SRC_ALPHA,
+      (static_cast<TransparencyMode>(transparency_mode) == TransparencyMode::BackgroundMinusForeground) ?
+        VK_BLEND_OP_REVERSE_SUBTRACT :
+        VK_BLEND_OP_ADD,
+      VK_BLEND_FACTOR_ONE, VK_BLEND_FACTOR_ZERO, VK_BLEND_OP_ADD);
+  }
+
+  gpbuilder.SetDynamicViewportAndScissorState();
+
+  return gpbuilder.Create(g_vulkan_context->GetDevice(), pipeline_cache);
+}
+
+bool GPU_HW_Vulkan::CompileBatchPipelines(GPU_HW_ShaderGen& shadergen, VkPipelineCache pipeline_cache,
+                                          BatchPipelineArray& pipelines)
+{
+  // vertex shaders - [textured]
+  // fragment shaders - [render_mode][texture_mode][dithering][interlacing]
+  DimensionalArray<VkShaderModule, 2> batch_vertex_shaders{};
+  DimensionalArray<VkShaderModule, 2, 2, 9, 4> batch_fragment_shaders{};
+  VkShaderModule batch_line_geometry_shader = VK_NULL_HANDLE;
+  Common::ScopeGuard batch_shader_guard(
+    [&batch_vertex_shaders, &batch_fragment_shaders, &batch_line_geometry_shader]() {
+      batch_vertex_shaders.enumerate(Vulkan::Util::SafeDestroyShaderModule);
+      batch_fragment_shaders.enumerate(Vulkan::Util::SafeDestroyShaderModule);
+      Vulkan::Util::SafeDestroyShaderModule(batch_line_geometry_shader);
+    });
+
+  if (!CompileBatchVertexShaders(shadergen, batch_vertex_shaders, &batch_line_geometry_shader))
+    return false;
+
+  for (u8 render_mode = 0; render_mode < 4; render_mode++)
+  {
+    for (u8 texture_mode = 0; texture_mode < 9; texture_mode++)
+    {
+      for (u8 dithering = 0; dithering < 2; dithering++)
+      {
+        for (u8 interlacing = 0; interlacing < 2; interlacing++)
+        {
+          if (m_batch_pipeline_compile_cancelled.load(std::memory_order_relaxed))
+            return false;
+
+          const std::string fs = shadergen.GenerateBatchFragmentShader(
+            static_cast<BatchRenderMode>(render_mode), static_cast<TextureMode>(texture_mode),
+            ConvertToBoolUnchecked(dithering), ConvertToBoolUnchecked(interlacing));
+
+          VkShaderModule shader = g_vulkan_shader_cache->GetFragmentShader(fs);
+          if (shader == VK_NULL_HANDLE)
+            return false;
+
+          batch_fragment_shaders[render_mode][texture_mode][dithering][interlacing] = shader;
+        }
+      }
+    }
+  }
+
+  // [primitive][depth_test][render_mode][texture_mode][transparency_mode][dithering][interlacing]
+  for (u8 primitive = 0; primitive < 2; primitive++)
+  {
+    for (u8 depth_test = 0; depth_test < 2; depth_test++)
+    {
+      for (u8 render_mode = 0; render_mode < 4; render_mode++)
+      {
+        for (u8 transparency_mode = 0; transparency_mode < 5; transparency_mode++)
+        {
+          if (m_batch_pipeline_compile_cancelled.load(std::memory_order_relaxed))
+            return false;
+
+          for (u8 texture_mode = 0; texture_mode < 9; texture_mode++)
+          {
+            for (u8 dithering = 0; dithering < 2; dithering++)
+            {
+              for (u8 interlacing = 0; interlacing < 2; interlacing++)
+              {
+                const bool textured = (static_cast<TextureMode>(texture_mode) != TextureMode::Disabled);
+                VkPipeline pipeline = CreateBatchPipeline(
+                  pipeline_cache, primitive, depth_test, render_mode, transparency_mode, textured,
+                  batch_vertex_shaders[BoolToUInt8(textured)], batch_line_geometry_shader,
+                  batch_fragment_shaders[render_mode][texture_mode][dithering][interlacing]);
+                if (pipeline == VK_NULL_HANDLE)
+                  return false;
+
+                pipelines[primitive][depth_test][render_mode][texture_mode][transparency_mode][dithering]
+                         [interlacing] = pipeline;
+              }
+            }
+          }
+        }
+      }
+    }
+  }
+
+  return true;
+}
+
+bool GPU_HW_Vulkan::CompileUberBatchPipelines(GPU_HW_ShaderGen& shadergen, VkPipelineCache pipeline_cache)
+{
+  // vertex shaders - [textured]
+  // fragment shaders - [render_mode][textured]
+  DimensionalArray<VkShaderModule, 2> batch_vertex_shaders{};
+  DimensionalArray<VkShaderModule, 2, 4> batch_fragment_shaders{};
+  VkShaderModule batch_line_geometry_shader = VK_NULL_HANDLE;
+  Common::ScopeGuard batch_shader_guard(
+    [&batch_vertex_shaders, &batch_fragment_shaders, &batch_line_geometry_shader]() {
+      batch_vertex_shaders.enumerate(Vulkan::Util::SafeDestroyShaderModule);
+      batch_fragment_shaders.enumerate(Vulkan::Util::SafeDestroyShaderModule);
+      Vulkan::Util::SafeDestroyShaderModule(batch_line_geometry_shader);
+    });
+
+  if (!CompileBatchVertexShaders(shadergen, batch_vertex_shaders, &batch_line_geometry_shader))
+    return false;
+
+  for (u8 render_mode = 0; render_mode < 4; render_mode++)
+  {
+    for (u8 textured = 0; textured < 2; textured++)
+    {
+      const std::string fs = shadergen.GenerateBatchUberFragmentShader(static_cast<BatchRenderMode>(render_mode),
+                                                                        ConvertToBoolUnchecked(textured));
+      VkShaderModule shader = g_vulkan_shader_cache->GetFragmentShader(fs);
+      if (shader == VK_NULL_HANDLE)
+        return false;
+
+      batch_fragment_shaders[render_mode][textured] = shader;
+    }
+  }
+
+  // Lines are never textured, so they can use the smaller shader.
+  for (u8 primitive = 0; primitive < 2; primitive++)
+  {
+    const u8 textured = BoolToUInt8(static_cast<BatchPrimitive>(primitive) != BatchPrimitive::Lines);
+    for (u8 depth_test = 0; depth_test < 2; depth_test++)
+    {
+      for (u8 render_mode = 0; render_mode < 4; render_mode++)
+      {
+        for (u8 transparency_mode = 0; transparency_mode < 5; transparency_mode++)
+        {
+          VkPipeline pipeline = CreateBatchPipeline(pipeline_cache, primitive, depth_test, render_mode,
+                                                    transparency_mode, ConvertToBoolUnchecked(textured),
+                                                    batch_vertex_shaders[textured], batch_line_geometry_shader,
+                                                    batch_fragment_shaders[render_mode][textured]);
+          if (pipeline == VK_NULL_HANDLE)
+            return false;
+
+          m_batch_uber_pipelines[primitive][depth_test][render_mode][transparency_mode] = pipeline;
+        }
+      }
+    }
+  }
+
+  return true;
+}
+
+void GPU_HW_Vulkan::StopBatchPipelineCompile()
+{
+  if (!m_batch_pipeline_thread.joinable())
+    return;
+
+  m_batch_pipeline_compile_cancelled.store(true, std::memory_order_relaxed);
+  m_batch_pipeline_thread.join();
+  m_batch_pipeline_compile_cancelled.store(false, std::memory_order_relaxed);
+  m_pending_batch_pipelines.enumerate(Vulkan::Util::SafeDestroyPipeline);
+}
+
+void GPU_HW_Vulkan::CheckBatchPipelineCompile()
+{
+  if (!m_batch_pipeline_thread.joinable() || !m_batch_pipeline_compile_done.load(std::memory_order_acquire))
+    return;
+
+  m_batch_pipeline_thread.join();
+  if (!m_pending_batch_pipelines_valid)
+  {
+    Log_ErrorPrintf("Failed to compile batch pipelines, continuing with uber shaders.");
+    m_pending_batch_pipelines.enumerate(Vulkan::Util::SafeDestroyPipeline);
+    return;
+  }
+
+  Log_InfoPrintf("Batch pipelines compiled, switching from uber shaders.");
+  m_batch_pipelines = m_pending_batch_pipelines;
+  m_pending_batch_pipelines = {};
+  SetUsingUberShaders(false);
+}
+
 void GPU_HW_Vulkan::DestroyPipelines()
 {
+  StopBatchPipelineCompile();
   m_batch_pipelines.enumerate(Vulkan::Util::SafeDestroyPipeline);
+  m_batch_uber_pipelines.enumerate(Vulkan::Util::SafeDestroyPipeline);
 
   for (VkPipeline& p : m_vram_fill_pipelines)
     Vulkan::Util::SafeDestroyPipeline(p);
@@ -906,11 +1047,21 @@ void GPU_HW_Vulkan::DrawBatchVertices(BatchRenderMode render_mode, u32 base_vert
 
   VkCommandBuffer cmdbuf = g_vulkan_context->GetCurrentCommandBuffer();
 
-  // [primitive][depth_test][render_mode][texture_mode][transparency_mode][dithering][interlacing]
-  VkPipeline pipeline =
-    m_batch_pipelines[static_cast<u8>(m_batch.primitive)][BoolToUInt8(m_batch.check_mask_before_draw)][static_cast<u8>(
-      render_mode)][static_cast<u8>(m_batch.texture_mode)][static_cast<u8>(m_batch.transparency_mode)]
-                     [BoolToUInt8(m_batch.dithering)][BoolToUInt8(m_batch.interlacing)];
+  VkPipeline pipeline;
+  if (m_using_uber_shaders)
+  {
+    // [primitive][depth_test][render_mode][transparency_mode]
+    pipeline = m_batch_uber_pipelines[static_cast<u8>(m_batch.primitive)][BoolToUInt8(
+      m_batch.check_mask_before_draw)][static_cast<u8>(render_mode)][static_cast<u8>(m_batch.transparency_mode)];
+  }
+  else
+  {
+    // [primitive][depth_test][render_mode][texture_mode][transparency_mode][dithering][interlacing]
+    pipeline =
+      m_batch_pipelines[static_cast<u8>(m_batch.primitive)][BoolToUInt8(m_batch.check_mask_before_draw)][static_cast<u8>(
+        render_mode)][static_cast<u8>(m_batch.texture_mode)][static_cast<u8>(m_batch.transparency_mode)]
+                       [BoolToUInt8(m_batch.dithering)][BoolToUInt8(m_batch.interlacing)];
+  }
 
   vkCmdBindPipeline(cmdbuf, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
   vkCmdDraw(cmdbuf, num_vertices, 1, base_vertex, 0);
@@ -927,6 +1078,7 @@ void GPU_HW_Vulkan::SetScissorFromDrawingArea()
 void GPU_HW_Vulkan::UpdateDisplay()
 {
   GPU_HW::UpdateDisplay();
+  CheckBatchPipelineCompile();
 
   if (m_system->GetSettings().debugging.show_vram)
   {
@@ -1003,12 +1155,10 @@ void GPU_HW_Vulkan::UpdateDisplay()
   }
 }
 
-void GPU_HW_Vulkan::ReadVRAM(u32 x, u32 y, u32 width, u32 height)
+void GPU_HW_Vulkan::StartVRAMDownload(const Common::Rectangle<u32>& rect)
 {
-  // Get bounds with wrap-around handled.
-  const Common::Rectangle<u32> copy_rect = GetVRAMTransferBounds(x, y, width, height);
-  const u32 encoded_width = (copy_rect.GetWidth() + 1) / 2;
-  const u32 encoded_height = copy_rect.GetHeight();
+  const u32 encoded_width = rect.GetWidth() / 2;
+  const u32 encoded_height = rect.GetHeight();
 
   EndRenderPass();
 
@@ -1019,7 +1169,7 @@ void GPU_HW_Vulkan::ReadVRAM(u32 x, u32 y, u32 width, u32 height)
   BeginRenderPass(m_vram_readback_render_pass, m_vram_readback_framebuffer, 0, 0, encoded_width, encoded_height);
 
   // Encode the 24-bit texture as 16-bit.
-  const u32 uniforms[4] = {copy_rect.left, copy_rect.top, copy_rect.GetWidth(), copy_rect.GetHeight()};
+  const u32 uniforms[4] = {rect.left, rect.top, rect.GetWidth(), rect.GetHeight()};
   vkCmdBindPipeline(cmdbuf, VK_PIPELINE_BIND_POINT_GRAPHICS, m_vram_readback_pipeline);
   vkCmdPushConstants(cmdbuf, m_single_sampler_pipeline_layout, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(uniforms),
                      uniforms);
@@ -1033,16 +1183,19 @@ void GPU_HW_Vulkan::ReadVRAM(u32 x, u32 y, u32 width, u32 height)
   m_vram_readback_texture.TransitionToLayout(cmdbuf, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
   m_vram_texture.TransitionToLayout(cmdbuf, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
 
-  // Stage the readback.
+  // Stage the readback, and submit it so the GPU can get on with it while the CPU keeps running.
   m_vram_readback_staging_texture.CopyFromTexture(m_vram_readback_texture, 0, 0, 0, 0, 0, 0, encoded_width,
                                                   encoded_height);
+  g_vulkan_context->ExecuteCommandBuffer(false);
+  RestoreGraphicsAPIState();
+}
 
-  // And copy it into our shadow buffer (will execute command buffer and stall).
-  m_vram_readback_staging_texture.ReadTexels(0, 0, encoded_width, encoded_height,
-                                             &m_vram_shadow[copy_rect.top * VRAM_WIDTH + copy_rect.left],
+void GPU_HW_Vulkan::FinishVRAMDownload(const Common::Rectangle<u32>& rect)
+{
+  // Copy it into our shadow buffer (will wait for the command buffer's fence).
+  m_vram_readback_staging_texture.ReadTexels(0, 0, rect.GetWidth() / 2, rect.GetHeight(),
+                                             &m_vram_shadow[rect.top * VRAM_WIDTH + rect.left],
                                              VRAM_WIDTH * sizeof(u16));
-
-  RestoreGraphicsAPIState();
 }
 
 void GPU_HW_Vulkan::FillVRAM(u32 x, u32 y, u32 width, u32 height, u32 color)
@@ -1142,8 +1295,7 @@ void GPU_HW_Vulkan::CopyVRAM(u32 src_x, u32 src_y, u32 dst_x, u32 dst_y, u32 wid
   {
     const Common::Rectangle<u32> src_bounds = GetVRAMTransferBounds(src_x, src_y, width, height);
     const Common::Rectangle<u32> dst_bounds = GetVRAMTransferBounds(dst_x, dst_y, width, height);
-    if (m_vram_dirty_rect.Intersects(src_bounds))
-      UpdateVRAMReadTexture();
+    UpdateVRAMReadTexturePages(GetVRAMReadPageMask(src_bounds));
     IncludeVRAMDityRectangle(dst_bounds);
 
     const VRAMCopyUBOData uniforms(GetVRAMCopyUBOData(src_x, src_y, dst_x, dst_y, width, height));
@@ -1195,7 +1347,7 @@ void GPU_HW_Vulkan::CopyVRAM(u32 src_x, u32 src_y, u32 dst_x, u32 dst_y, u32 wid
   m_vram_texture.TransitionToLayout(cmdbuf, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
 }
 
-void GPU_HW_Vulkan::UpdateVRAMReadTexture()
+void GPU_HW_Vulkan::UpdateVRAMReadTexture(const Common::Rectangle<u32>& rect)
 {
   EndRenderPass();
 
@@ -1203,7 +1355,7 @@ void GPU_HW_Vulkan::UpdateVRAMReadTexture()
   m_vram_texture.TransitionToLayout(cmdbuf, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
   m_vram_read_texture.TransitionToLayout(cmdbuf, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
 
-  const auto scaled_rect = m_vram_dirty_rect * m_resolution_scale;
+  const auto scaled_rect = rect * m_resolution_scale;
   const VkImageCopy copy{{VK_IMAGE_ASPECT_COLOR_BIT, 0u, 0u, 1u},
                          {static_cast<s32>(scaled_rect.left), static_cast<s32>(scaled_rect.top), 0},
                          {VK_IMAGE_ASPECT_COLOR_BIT, 0u, 0u, 1u},
@@ -1215,8 +1367,6 @@ void GPU_HW_Vulkan::UpdateVRAMReadTexture()
 
   m_vram_read_texture.TransitionToLayout(cmdbuf, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
   m_vram_texture.TransitionToLayout(cmdbuf, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
-
-  GPU_HW::UpdateVRAMReadTexture();
 }
 
 void GPU_HW_Vulkan::UpdateDepthBufferFromMaskBit()
@@ -5,9 +5,13 @@
 #include "common/vulkan/texture.h"
 #include "gpu_hw.h"
 #include <array>
+#include <atomic>
 #include <memory>
+#include <thread>
 #include <tuple>
 
+class GPU_HW_ShaderGen;
+
 class GPU_HW_Vulkan : public GPU_HW
 {
 public:
@@ -24,12 +28,13 @@ public:
 
 protected:
   void UpdateDisplay() override;
-  void ReadVRAM(u32 x, u32 y, u32 width, u32 height) override;
   void FillVRAM(u32 x, u32 y, u32 width, u32 height, u32 color) override;
   void UpdateVRAM(u32 x, u32 y, u32 width, u32 height, const void* data) override;
   void CopyVRAM(u32 src_x, u32 src_y, u32 dst_x, u32 dst_y, u32 width, u32 height) override;
-  void UpdateVRAMReadTexture() override;
+  void UpdateVRAMReadTexture(const Common::Rectangle<u32>& rect) override;
   void UpdateDepthBufferFromMaskBit() override;
+  void StartVRAMDownload(const Common::Rectangle<u32>& rect) override;
+  void FinishVRAMDownload(const Common::Rectangle<u32>& rect) override;
   void SetScissorFromDrawingArea() override;
   void MapBatchVertexPointer(u32 required_vertices) override;
   void UnmapBatchVertexPointer(u32 used_vertices) override;
@@ -60,9 +65,29 @@ private:
   bool CreateUniformBuffer();
   bool CreateTextureBuffer();
 
+  // [primitive][depth_test][render_mode][texture_mode][transparency_mode][dithering][interlacing]
+  using BatchPipelineArray = DimensionalArray<VkPipeline, 2, 2, 5, 9, 4, 2, 2>;
+
   bool CompilePipelines();
   void DestroyPipelines();
 
+  bool CompileBatchVertexShaders(GPU_HW_ShaderGen& shadergen, DimensionalArray<VkShaderModule, 2>& vertex_shaders,
+                                 VkShaderModule* line_geometry_shader);
+  VkPipeline CreateBatchPipeline(VkPipelineCache pipeline_cache, u8 primitive, u8 depth_test, u8 render_mode,
+                                 u8 transparency_mode, bool textured, VkShaderModule vertex_shader,
+                                 VkShaderModule line_geometry_shader, VkShaderModule fragment_shader);
+
+  /// Compiles every specialised batch pipeline. Safe to call from the pipeline compile thread.
+  bool CompileBatchPipelines(GPU_HW_ShaderGen& shadergen, VkPipelineCache pipeline_cache,
+                             BatchPipelineArray& pipelines);
+  bool CompileUberBatchPipelines(GPU_HW_ShaderGen& shadergen, VkPipelineCache pipeline_cache);
+
+  /// Cancels and waits for the background pipeline compile, if any.
+  void StopBatchPipelineCompile();
+
+  /// Switches from the uber pipelines to the specialised pipelines once the background compile completes.
+  void CheckBatchPipelineCompile();
+
   VkRenderPass m_current_render_pass = VK_NULL_HANDLE;
 
   VkRenderPass m_vram_render_pass = VK_NULL_HANDLE;
@@ -106,8 +131,17 @@ private:
   u32 m_current_uniform_buffer_offset = 0;
   VkBufferView m_texture_stream_buffer_view = VK_NULL_HANDLE;
 
-  // [primitive][depth_test][render_mode][texture_mode][transparency_mode][dithering][interlacing]
-  DimensionalArray<VkPipeline, 2, 2, 5, 9, 4, 2, 2> m_batch_pipelines{};
+  BatchPipelineArray m_batch_pipelines{};
+
+  // [primitive][depth_test][render_mode][transparency_mode]
+  DimensionalArray<VkPipeline, 5, 4, 2, 2> m_batch_uber_pipelines{};
+
+  // Specialised pipelines are written by the compile thread, and only read after it signals completion.
+  BatchPipelineArray m_pending_batch_pipelines{};
+  std::thread m_batch_pipeline_thread;
+  std::atomic_bool m_batch_pipeline_compile_cancelled{false};
+  std::atomic_bool m_batch_pipeline_compile_done{false};
+  bool m_pending_batch_pipelines_valid = false;
 
   // [interlaced]
   std::array<VkPipeline, 2> m_vram_fill_pipelines{};
@@ -1,9 +1,21 @@
 #include "gpu_sw.h"
 #include "common/assert.h"
+#include "common/cpu_detect.h"
 #include "common/log.h"
+#include "common/timer.h"
 #include "host_display.h"
 #include "system.h"
 #include <algorithm>
+#include <cstring>
+#include <new>
+
+#if defined(CPU_X64)
+#include <emmintrin.h>
+#define GPU_SW_SIMD_SSE2 1
+#elif defined(CPU_AARCH64)
+#include <arm_neon.h>
+#define GPU_SW_SIMD_NEON 1
+#endif
 Log_SetChannel(GPU_SW);
 
 GPU_SW::GPU_SW()
@@ -14,6 +26,8 @@ GPU_SW::GPU_SW()
 
 GPU_SW::~GPU_SW()
 {
+  StopThreads();
+
   if (m_host_display)
     m_host_display->ClearDisplayTexture();
 }
@@ -33,6 +47,7 @@ bool GPU_SW::Initialize(HostDisplay* host_display, System* system, DMA* dma, Int
   if (!m_display_texture)
     return false;
 
+  StartThreads(GetDesiredThreadCount());
   return true;
 }
 
@@ -40,7 +55,527 @@ void GPU_SW::Reset()
 {
   GPU::Reset();
 
+  Sync();
   m_vram.fill(0);
+  InvalidateTextureCache(0, 0, VRAM_WIDTH, VRAM_HEIGHT);
+}
+
+void GPU_SW::UpdateSettings()
+{
+  GPU::UpdateSettings();
+
+  const u32 thread_count = GetDesiredThreadCount();
+  if (thread_count != static_cast<u32>(m_threads.size()))
+  {
+    StopThreads();
+    StartThreads(thread_count);
+  }
+}
+
+u32 GPU_SW::GetDesiredThreadCount() const
+{
+  const Settings& settings = m_system->GetSettings();
+  if (!settings.gpu_use_thread)
+    return 0;
+
+  // Leave one hardware thread for the CPU thread by default.
+  u32 count = settings.gpu_thread_count;
+  if (count == 0)
+    count = std::max<u32>(std::thread::hardware_concurrency(), 2) - 1;
+
+  return std::clamp<u32>(count, 1, MAX_THREADS);
+}
+
+void GPU_SW::StartThreads(u32 count)
+{
+  if (count == 0)
+    return;
+
+  Log_InfoPrintf("Starting %u render thread(s)", count);
+  m_thread_shutdown = false;
+  m_thread_dirty_rect.SetInvalid();
+  m_thread_texture_rect.SetInvalid();
+
+  for (u32 i = 0; i < count; i++)
+  {
+    std::unique_ptr<RenderThread> thread = std::make_unique<RenderThread>();
+    for (u32 band = i; band < NUM_BANDS; band += count)
+      thread->band_mask |= static_cast<BandMask>(1) << band;
+
+    m_threads.push_back(std::move(thread));
+  }
+
+  for (const std::unique_ptr<RenderThread>& thread : m_threads)
+    thread->thread = std::thread(&GPU_SW::ThreadEntryPoint, this, thread.get());
+}
+
+void GPU_SW::StopThreads()
+{
+  if (!IsUsingThread())
+    return;
+
+  // The threads execute all queued commands before exiting.
+  {
+    std::unique_lock<std::mutex> lock(m_thread_mutex);
+    m_thread_shutdown = true;
+    for (const std::unique_ptr<RenderThread>& thread : m_threads)
+      thread->wake_cv.notify_one();
+  }
+
+  for (const std::unique_ptr<RenderThread>& thread : m_threads)
+    thread->thread.join();
+
+  m_threads.clear();
+}
+
+void GPU_SW::WakeThread(RenderThread* thread)
+{
+  std::unique_lock<std::mutex> lock(m_thread_mutex);
+  thread->wake_cv.notify_one();
+}
+
+void GPU_SW::ThreadEntryPoint(RenderThread* thread)
+{
+  Common::Timer::Value spin_start_time = 0;
+  for (;;)
+  {
+    u32 size;
+    const SWCommand* cmd = static_cast<const SWCommand*>(thread->queue.BeginRead(&size));
+    if (cmd)
+    {
+      if (cmd->type == SWCommandType::Barrier)
+        WaitForBarrier(thread);
+      else
+        ExecuteCommand(cmd, &thread->texture_cache);
+
+      thread->queue.EndRead();
+      spin_start_time = 0;
+      continue;
+    }
+
+    // Pairs with the fence in Sync(), so either we see the sync request or it sees the empty queue.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (m_thread_sync_pending.load(std::memory_order_relaxed))
+    {
+      std::unique_lock<std::mutex> lock(m_thread_mutex);
+      m_thread_idle_cv.notify_all();
+    }
+
+    // More commands usually follow shortly, so avoid the cost of sleeping and waking up again.
+    const Common::Timer::Value current_time = Common::Timer::GetValue();
+    if (spin_start_time == 0)
+      spin_start_time = current_time;
+    if (Common::Timer::ConvertValueToNanoseconds(current_time - spin_start_time) < THREAD_SPIN_TIME_NS)
+    {
+      std::this_thread::yield();
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(m_thread_mutex);
+    if (m_thread_shutdown)
+      break;
+
+    // Pairs with the fence in EndThreadWrite(), so either we see the new command or it sees us sleeping.
+    thread->sleeping.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    thread->wake_cv.wait(lock, [this, thread]() { return m_thread_shutdown || !thread->queue.IsEmpty(); });
+    thread->sleeping.store(false, std::memory_order_relaxed);
+    spin_start_time = 0;
+  }
+}
+
+void* GPU_SW::BeginThreadWrite(RenderThread* thread, u32 size)
+{
+  DebugAssert(size <= thread->queue.GetMaxRecordSize());
+
+  void* ptr;
+  while (!(ptr = thread->queue.BeginWrite(size)))
+  {
+    WakeThread(thread);
+    std::this_thread::yield();
+  }
+
+  return ptr;
+}
+
+void GPU_SW::EndThreadWrite(RenderThread* thread)
+{
+  thread->queue.EndWrite();
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (thread->sleeping.load(std::memory_order_relaxed))
+    WakeThread(thread);
+}
+
+void GPU_SW::QueueCommand(RenderThread* thread, const SWCommand* cmd, u32 size, BandMask band_mask)
+{
+  SWCommand* queued_cmd = static_cast<SWCommand*>(BeginThreadWrite(thread, size));
+  std::memcpy(queued_cmd, cmd, size);
+  queued_cmd->params.band_mask = band_mask;
+  EndThreadWrite(thread);
+}
+
+void GPU_SW::PushBarrier()
+{
+  SWCommand cmd = {};
+  cmd.type = SWCommandType::Barrier;
+  for (const std::unique_ptr<RenderThread>& thread : m_threads)
+    QueueCommand(thread.get(), &cmd, sizeof(cmd), 0);
+
+  m_thread_dirty_rect.SetInvalid();
+  m_thread_texture_rect.SetInvalid();
+}
+
+void GPU_SW::WaitForBarrier(RenderThread* thread)
+{
+  // Every thread receives the same barriers, so this is the number of barriers the others need to reach. The release
+  // makes this thread's VRAM writes visible to threads which see the new count.
+  const u32 count = thread->barrier_count.load(std::memory_order_relaxed) + 1;
+  thread->barrier_count.store(count, std::memory_order_release);
+
+  for (const std::unique_ptr<RenderThread>& other_thread : m_threads)
+  {
+    while (static_cast<s32>(other_thread->barrier_count.load(std::memory_order_acquire) - count) < 0)
+      std::this_thread::yield();
+  }
+}
+
+void GPU_SW::Sync()
+{
+  m_thread_dirty_rect.SetInvalid();
+  m_thread_texture_rect.SetInvalid();
+
+  const auto AreThreadsIdle = [this]() {
+    return std::all_of(m_threads.begin(), m_threads.end(),
+                       [](const std::unique_ptr<RenderThread>& thread) { return thread->queue.IsEmpty(); });
+  };
+  if (AreThreadsIdle())
+    return;
+
+  std::unique_lock<std::mutex> lock(m_thread_mutex);
+  m_thread_sync_pending.store(true, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  m_thread_idle_cv.wait(lock, AreThreadsIdle);
+  m_thread_sync_pending.store(false, std::memory_order_relaxed);
+}
+
+GPU_SW::BandMask GPU_SW::GetBandMaskForRows(u32 top, u32 bottom)
+{
+  if (top >= bottom)
+    return 0;
+
+  const u32 first_band = top / BAND_HEIGHT;
+  const u32 last_band = (bottom - 1) / BAND_HEIGHT;
+  return (ALL_BANDS << first_band) & (ALL_BANDS >> (NUM_BANDS - 1 - last_band));
+}
+
+GPU_SW::SWCommandParameters GPU_SW::GetCommandParameters() const
+{
+  SWCommandParameters params;
+  params.band_mask = ALL_BANDS;
+  params.mask_and = m_GPUSTAT.GetMaskAND();
+  params.mask_or = m_GPUSTAT.GetMaskOR();
+  params.interlaced_rendering = IsInterlacedRenderingEnabled();
+  params.active_line_lsb = Truncate8(GetActiveLineLSB());
+  return params;
+}
+
+void GPU_SW::FillDrawCommand(SWDrawCommand* cmd, RenderCommand rc, bool dithering_enable) const
+{
+  cmd->rc.bits = rc.bits;
+  cmd->dithering_enable = dithering_enable;
+  cmd->texture_mode = m_draw_mode.GetTextureMode();
+  cmd->transparency_mode = m_draw_mode.GetTransparencyMode();
+  cmd->texture_window_mask_x = m_draw_mode.texture_window_mask_x;
+  cmd->texture_window_mask_y = m_draw_mode.texture_window_mask_y;
+  cmd->texture_window_offset_x = m_draw_mode.texture_window_offset_x;
+  cmd->texture_window_offset_y = m_draw_mode.texture_window_offset_y;
+  cmd->texture_page_x = m_draw_mode.texture_page_x;
+  cmd->texture_page_y = m_draw_mode.texture_page_y;
+  cmd->texture_palette_x = m_draw_mode.texture_palette_x;
+  cmd->texture_palette_y = m_draw_mode.texture_palette_y;
+  cmd->drawing_area = m_drawing_area;
+  cmd->drawing_offset = m_drawing_offset;
+}
+
+template<typename T>
+T* GPU_SW::AllocateCommand(SWCommandType type, u32 size)
+{
+  if (m_command_buffer.size() < size)
+    m_command_buffer.resize(size);
+
+  T* cmd = new (m_command_buffer.data()) T();
+  cmd->type = type;
+  cmd->params = GetCommandParameters();
+  return cmd;
+}
+
+void GPU_SW::PushCommand(SWCommand* cmd, u32 size, const Common::Rectangle<u32>& bounds)
+{
+  if (!IsUsingThread())
+  {
+    ExecuteCommand(cmd, &m_texture_cache);
+    return;
+  }
+
+  if (m_threads.size() == 1)
+  {
+    QueueCommand(m_threads[0].get(), cmd, size, ALL_BANDS);
+    return;
+  }
+
+  // Other threads may still be sampling from the area this command overwrites.
+  if (m_thread_texture_rect.Valid() && m_thread_texture_rect.Intersects(bounds))
+    PushBarrier();
+
+  const BandMask band_mask = GetBandMaskForRows(bounds.top, bounds.bottom);
+  for (const std::unique_ptr<RenderThread>& thread : m_threads)
+  {
+    if (thread->band_mask & band_mask)
+      QueueCommand(thread.get(), cmd, size, thread->band_mask);
+  }
+
+  m_thread_dirty_rect.Include(bounds);
+}
+
+void GPU_SW::PushDrawCommand(SWDrawCommand* cmd, u32 size, const Common::Rectangle<u32>& bounds)
+{
+  if (!cmd->rc.IsTexturingEnabled())
+  {
+    cmd->samples_own_output = false;
+    cmd->texture_generation = 0;
+    InvalidateTextureCache(bounds);
+    PushCommand(cmd, size, bounds);
+    return;
+  }
+
+  // If the primitive samples from its own output, the result depends on the order pixels are drawn in.
+  const Common::Rectangle<u32> texture_page_rect = m_draw_mode.GetTexturePageRectangle();
+  const Common::Rectangle<u32> texture_palette_rect = m_draw_mode.GetTexturePaletteRectangle();
+  const bool using_palette = m_draw_mode.IsUsingPalette();
+  cmd->samples_own_output =
+    texture_page_rect.Intersects(bounds) || (using_palette && texture_palette_rect.Intersects(bounds));
+  cmd->texture_generation = GetTextureGeneration(texture_page_rect);
+  if (using_palette)
+    cmd->texture_generation = std::max(cmd->texture_generation, GetTextureGeneration(texture_palette_rect));
+  InvalidateTextureCache(bounds);
+
+  if (m_threads.size() <= 1)
+  {
+    PushCommand(cmd, size, bounds);
+    return;
+  }
+
+  // Texels can come from rows owned by other threads, so their writes to the texture must be complete. Primitives
+  // which sample from their own output are drawn serially.
+  if (cmd->samples_own_output)
+  {
+    PushExclusiveCommand(cmd, size);
+    return;
+  }
+
+  if (m_thread_dirty_rect.Valid() && (texture_page_rect.Intersects(m_thread_dirty_rect) ||
+                                      (using_palette && texture_palette_rect.Intersects(m_thread_dirty_rect))))
+  {
+    PushBarrier();
+  }
+
+  PushCommand(cmd, size, bounds);
+
+  m_thread_texture_rect.Include(texture_page_rect);
+  if (using_palette)
+    m_thread_texture_rect.Include(texture_palette_rect);
+}
+
+void GPU_SW::PushExclusiveCommand(SWCommand* cmd, u32 size)
+{
+  if (!IsUsingThread())
+  {
+    ExecuteCommand(cmd, &m_texture_cache);
+    return;
+  }
+
+  BeginExclusiveCommand();
+  QueueCommand(m_threads[0].get(), cmd, size, ALL_BANDS);
+  EndExclusiveCommand();
+}
+
+void GPU_SW::BeginExclusiveCommand()
+{
+  if (m_threads.size() > 1)
+    PushBarrier();
+}
+
+void GPU_SW::EndExclusiveCommand()
+{
+  if (m_threads.size() > 1)
+    PushBarrier();
+}
+
+void GPU_SW::InvalidateTextureCache(u32 x, u32 y, u32 width, u32 height)
+{
+  if ((x + width) <= VRAM_WIDTH && (y + height) <= VRAM_HEIGHT)
+    InvalidateTextureCache(Common::Rectangle<u32>::FromExtents(x, y, width, height));
+  else
+    InvalidateTextureCache(Common::Rectangle<u32>(0, 0, VRAM_WIDTH, VRAM_HEIGHT));
+}
+
+void GPU_SW::InvalidateTextureCache(const Common::Rectangle<u32>& rect)
+{
+  if (!rect.HasExtents())
+    return;
+
+  m_texture_write_counter++;
+
+  const u32 left = rect.left / TEXTURE_REGION_WIDTH;
+  const u32 right = std::min<u32>((rect.right - 1) / TEXTURE_REGION_WIDTH, TEXTURE_REGIONS_X - 1);
+  const u32 top = rect.top / TEXTURE_REGION_HEIGHT;
+  const u32 bottom = std::min<u32>((rect.bottom - 1) / TEXTURE_REGION_HEIGHT, TEXTURE_REGIONS_Y - 1);
+  for (u32 region_y = top; region_y <= bottom; region_y++)
+  {
+    for (u32 region_x = left; region_x <= right; region_x++)
+      m_texture_region_generations[region_y * TEXTURE_REGIONS_X + region_x] = m_texture_write_counter;
+  }
+}
+
+u64 GPU_SW::GetTextureGeneration(const Common::Rectangle<u32>& rect) const
+{
+  // Texture pages can extend past the right edge of VRAM, where the coordinates are clamped.
+  const u32 left = std::min<u32>(rect.left / TEXTURE_REGION_WIDTH, TEXTURE_REGIONS_X - 1);
+  const u32 right = std::min<u32>((rect.right - 1) / TEXTURE_REGION_WIDTH, TEXTURE_REGIONS_X - 1);
+  const u32 top = rect.top / TEXTURE_REGION_HEIGHT;
+  const u32 bottom = std::min<u32>((rect.bottom - 1) / TEXTURE_REGION_HEIGHT, TEXTURE_REGIONS_Y - 1);
+
+  u64 generation = 0;
+  for (u32 region_y = top; region_y <= bottom; region_y++)
+  {
+    for (u32 region_x = left; region_x <= right; region_x++)
+      generation = std::max(generation, m_texture_region_generations[region_y * TEXTURE_REGIONS_X + region_x]);
+  }
+
+  return generation;
+}
+
+GPU_SW::TextureCacheEntry* GPU_SW::GetTextureCacheEntry(TextureCache* cache, const SWDrawCommand* cmd)
+{
+  // Direct 16-bit textures don't need decoding, and primitives which overwrite their texture must see the new texels.
+  const RenderCommand rc{cmd->rc.bits};
+  if (!rc.IsTexturingEnabled() || cmd->samples_own_output ||
+      (cmd->texture_mode != TextureMode::Palette4Bit && cmd->texture_mode != TextureMode::Palette8Bit))
+  {
+    return nullptr;
+  }
+
+  TextureCacheEntry* entry = nullptr;
+  for (TextureCacheEntry& it : cache->entries)
+  {
+    if (it.texture_mode == cmd->texture_mode && it.texture_page_x == cmd->texture_page_x &&
+        it.texture_page_y == cmd->texture_page_y && it.texture_palette_x == cmd->texture_palette_x &&
+        it.texture_palette_y == cmd->texture_palette_y)
+    {
+      entry = &it;
+      break;
+    }
+  }
+
+  if (!entry)
+  {
+    entry = &*std::min_element(
+      cache->entries.begin(), cache->entries.end(),
+      [](const TextureCacheEntry& lhs, const TextureCacheEntry& rhs) { return lhs.last_used < rhs.last_used; });
+    entry->texture_mode = cmd->texture_mode;
+    entry->texture_page_x = cmd->texture_page_x;
+    entry->texture_page_y = cmd->texture_page_y;
+    entry->texture_palette_x = cmd->texture_palette_x;
+    entry->texture_palette_y = cmd->texture_palette_y;
+    entry->valid_rows.reset();
+  }
+  else if (entry->generation != cmd->texture_generation)
+  {
+    entry->valid_rows.reset();
+  }
+
+  entry->generation = cmd->texture_generation;
+  entry->last_used = ++cache->use_counter;
+  return entry;
+}
+
+void GPU_SW::DecodeTextureRow(const SWDrawCommand* cmd, TextureCacheEntry* entry, u8 texcoord_y) const
+{
+  u16* row = &entry->texels[ZeroExtend32(texcoord_y) * TEXTURE_PAGE_WIDTH];
+  for (u32 texcoord_x = 0; texcoord_x < TEXTURE_PAGE_WIDTH; texcoord_x++)
+    row[texcoord_x] = ReadTexel(cmd, static_cast<u8>(texcoord_x), texcoord_y);
+
+  entry->valid_rows.set(texcoord_y);
+}
+
+void GPU_SW::ExecuteCommand(const SWCommand* cmd, TextureCache* texture_cache)
+{
+  switch (cmd->type)
+  {
+    case SWCommandType::FillVRAM:
+    {
+      const SWFillVRAMCommand* fcmd = static_cast<const SWFillVRAMCommand*>(cmd);
+      FillVRAMImpl(fcmd->x, fcmd->y, fcmd->width, fcmd->height, fcmd->color, fcmd->params);
+    }
+    break;
+
+    case SWCommandType::UpdateVRAM:
+    {
+      const SWUpdateVRAMCommand* ucmd = static_cast<const SWUpdateVRAMCommand*>(cmd);
+      UpdateVRAMImpl(ucmd->x, ucmd->y, ucmd->width, ucmd->height, ucmd->GetData(), ucmd->params);
+    }
+    break;
+
+    case SWCommandType::CopyVRAM:
+    {
+      const SWCopyVRAMCommand* ccmd = static_cast<const SWCopyVRAMCommand*>(cmd);
+      CopyVRAMImpl(ccmd->src_x, ccmd->src_y, ccmd->dst_x, ccmd->dst_y, ccmd->width, ccmd->height, ccmd->params);
+    }
+    break;
+
+    case SWCommandType::DrawPolygon:
+    {
+      const SWDrawPolygonCommand* pcmd = static_cast<const SWDrawPolygonCommand*>(cmd);
+      const RenderCommand rc{pcmd->rc.bits};
+      const DrawTriangleFunction DrawFunction = GetDrawTriangleFunction(
+        rc.shading_enable, rc.texture_enable, rc.raw_texture_enable, rc.transparency_enable, pcmd->dithering_enable);
+
+      TextureCacheEntry* texture = GetTextureCacheEntry(texture_cache, pcmd);
+      (this->*DrawFunction)(pcmd, texture, &pcmd->vertices[0], &pcmd->vertices[1], &pcmd->vertices[2]);
+      if (pcmd->num_vertices > 3)
+        (this->*DrawFunction)(pcmd, texture, &pcmd->vertices[2], &pcmd->vertices[1], &pcmd->vertices[3]);
+    }
+    break;
+
+    case SWCommandType::DrawRectangle:
+    {
+      const SWDrawRectangleCommand* rcmd = static_cast<const SWDrawRectangleCommand*>(cmd);
+      const RenderCommand rc{rcmd->rc.bits};
+      const DrawRectangleFunction DrawFunction =
+        GetDrawRectangleFunction(rc.texture_enable, rc.raw_texture_enable, rc.transparency_enable);
+
+      (this->*DrawFunction)(rcmd, GetTextureCacheEntry(texture_cache, rcmd), rcmd->x, rcmd->y, rcmd->width,
+                            rcmd->height, rcmd->r, rcmd->g, rcmd->b, rcmd->texcoord_x, rcmd->texcoord_y);
+    }
+    break;
+
+    case SWCommandType::DrawLine:
+    {
+      const SWDrawLineCommand* lcmd = static_cast<const SWDrawLineCommand*>(cmd);
+      const RenderCommand rc{lcmd->rc.bits};
+      const DrawLineFunction DrawFunction =
+        GetDrawLineFunction(rc.shading_enable, rc.transparency_enable, lcmd->dithering_enable);
+
+      const SWVertex* vertices = lcmd->GetVertices();
+      for (u32 i = 1; i < lcmd->num_vertices; i++)
+        (this->*DrawFunction)(lcmd, &vertices[i - 1], &vertices[i]);
+    }
+    break;
+
+    default:
+      UnreachableCode();
+      break;
+  }
 }
 
 void GPU_SW::CopyOut15Bit(u32 src_x, u32 src_y, u32* dst_ptr, u32 dst_stride, u32 width, u32 height, bool interlaced,
@@ -145,6 +680,8 @@ void GPU_SW::CopyOut24Bit(u32 src_x, u32 src_y, u32* dst_ptr, u32 dst_stride, u3
 
 void GPU_SW::UpdateDisplay()
 {
+  Sync();
+
   // fill display texture
   m_display_texture_buffer.resize(VRAM_WIDTH * VRAM_HEIGHT);
 
@@ -210,7 +747,236 @@ void GPU_SW::UpdateDisplay()
   }
 }
 
-void GPU_SW::DispatchRenderCommand()
+void GPU_SW::ReadVRAM(u32 x, u32 y, u32 width, u32 height)
+{
+  Sync();
+}
+
+void GPU_SW::FillVRAM(u32 x, u32 y, u32 width, u32 height, u32 color)
+{
+  // Hardware tests show that fills seem to break on the first two lines when the offset matches the displayed field.
+  if (IsInterlacedRenderingEnabled() && IsCRTCScanlinePending())
+    SynchronizeCRTC();
+
+  SWFillVRAMCommand* cmd = AllocateCommand<SWFillVRAMCommand>(SWCommandType::FillVRAM, sizeof(SWFillVRAMCommand));
+  cmd->x = x;
+  cmd->y = y;
+  cmd->width = width;
+  cmd->height = height;
+  cmd->color = color;
+
+  // Fills wrap around the edges of VRAM.
+  const Common::Rectangle<u32> bounds = ((x + width) <= VRAM_WIDTH && (y + height) <= VRAM_HEIGHT) ?
+                                          Common::Rectangle<u32>::FromExtents(x, y, width, height) :
+                                          Common::Rectangle<u32>(0, 0, VRAM_WIDTH, VRAM_HEIGHT);
+  InvalidateTextureCache(bounds);
+  PushCommand(cmd, sizeof(SWFillVRAMCommand), bounds);
+}
+
+void GPU_SW::UpdateVRAM(u32 x, u32 y, u32 width, u32 height, const void* data)
+{
+  InvalidateTextureCache(x, y, width, height);
+
+  // Without the thread, there's no need to copy the data into a command.
+  if (!IsUsingThread())
+  {
+    UpdateVRAMImpl(x, y, width, height, data, GetCommandParameters());
+    return;
+  }
+
+  // The data is written straight to the queue, rather than building the command and copying it.
+  const u32 data_size = width * height * sizeof(u16);
+  BeginExclusiveCommand();
+
+  RenderThread* thread = m_threads[0].get();
+  SWUpdateVRAMCommand* cmd =
+    new (BeginThreadWrite(thread, sizeof(SWUpdateVRAMCommand) + data_size)) SWUpdateVRAMCommand();
+  cmd->type = SWCommandType::UpdateVRAM;
+  cmd->params = GetCommandParameters();
+  cmd->x = x;
+  cmd->y = y;
+  cmd->width = width;
+  cmd->height = height;
+  std::memcpy(cmd->GetData(), data, data_size);
+  EndThreadWrite(thread);
+
+  EndExclusiveCommand();
+}
+
+void GPU_SW::CopyVRAM(u32 src_x, u32 src_y, u32 dst_x, u32 dst_y, u32 width, u32 height)
+{
+  SWCopyVRAMCommand* cmd = AllocateCommand<SWCopyVRAMCommand>(SWCommandType::CopyVRAM, sizeof(SWCopyVRAMCommand));
+  cmd->src_x = src_x;
+  cmd->src_y = src_y;
+  cmd->dst_x = dst_x;
+  cmd->dst_y = dst_y;
+  cmd->width = width;
+  cmd->height = height;
+  InvalidateTextureCache(dst_x, dst_y, width, height);
+  PushExclusiveCommand(cmd, sizeof(SWCopyVRAMCommand));
+}
+
+void GPU_SW::FillVRAMImpl(u32 x, u32 y, u32 width, u32 height, u32 color, const SWCommandParameters& params)
+{
+  const u16 color16 = RGBA8888ToRGBA5551(color);
+  if ((x + width) <= VRAM_WIDTH && !params.interlaced_rendering)
+  {
+    for (u32 yoffs = 0; yoffs < height; yoffs++)
+    {
+      const u32 row = (y + yoffs) % VRAM_HEIGHT;
+      if (IsRowInBands(params.band_mask, row))
+        std::fill_n(&m_vram[row * VRAM_WIDTH + x], width, color16);
+    }
+  }
+  else if (params.interlaced_rendering)
+  {
+    const u32 active_field = params.active_line_lsb;
+    for (u32 yoffs = 0; yoffs < height; yoffs++)
+    {
+      const u32 row = (y + yoffs) % VRAM_HEIGHT;
+      if ((row & u32(1)) == active_field || !IsRowInBands(params.band_mask, row))
+        continue;
+
+      u16* row_ptr = &m_vram[row * VRAM_WIDTH];
+      for (u32 xoffs = 0; xoffs < width; xoffs++)
+      {
+        const u32 col = (x + xoffs) % VRAM_WIDTH;
+        row_ptr[col] = color16;
+      }
+    }
+  }
+  else
+  {
+    for (u32 yoffs = 0; yoffs < height; yoffs++)
+    {
+      const u32 row = (y + yoffs) % VRAM_HEIGHT;
+      if (!IsRowInBands(params.band_mask, row))
+        continue;
+
+      u16* row_ptr = &m_vram[row * VRAM_WIDTH];
+      for (u32 xoffs = 0; xoffs < width; xoffs++)
+      {
+        const u32 col = (x + xoffs) % VRAM_WIDTH;
+        row_ptr[col] = color16;
+      }
+    }
+  }
+}
+
+void GPU_SW::UpdateVRAMImpl(u32 x, u32 y, u32 width, u32 height, const void* data, const SWCommandParameters& params)
+{
+  DebugAssert(params.band_mask == ALL_BANDS);
+
+  // Fast path when the copy is not oversized.
+  if ((x + width) <= VRAM_WIDTH && (y + height) <= VRAM_HEIGHT && (params.mask_and | params.mask_or) == 0)
+  {
+    const u16* src_ptr = static_cast<const u16*>(data);
+    u16* dst_ptr = &m_vram[y * VRAM_WIDTH + x];
+    for (u32 yoffs = 0; yoffs < height; yoffs++)
+    {
+      std::copy_n(src_ptr, width, dst_ptr);
+      src_ptr += width;
+      dst_ptr += VRAM_WIDTH;
+    }
+  }
+  else
+  {
+    // Slow path when we need to handle wrap-around.
+    const u16* src_ptr = static_cast<const u16*>(data);
+    const u16 mask_and = params.mask_and;
+    const u16 mask_or = params.mask_or;
+
+    for (u32 row = 0; row < height;)
+    {
+      u16* dst_row_ptr = &m_vram[((y + row++) % VRAM_HEIGHT) * VRAM_WIDTH];
+      for (u32 col = 0; col < width;)
+      {
+        // TODO: Handle unaligned reads...
+        u16* pixel_ptr = &dst_row_ptr[(x + col++) % VRAM_WIDTH];
+        if (((*pixel_ptr) & mask_and) == 0)
+          *pixel_ptr = *(src_ptr++) | mask_or;
+      }
+    }
+  }
+}
+
+void GPU_SW::CopyVRAMImpl(u32 src_x, u32 src_y, u32 dst_x, u32 dst_y, u32 width, u32 height,
+                          const SWCommandParameters& params)
+{
+  DebugAssert(params.band_mask == ALL_BANDS);
+
+  // Break up oversized copies. This behavior has not been verified on console.
+  if ((src_x + width) > VRAM_WIDTH || (dst_x + width) > VRAM_WIDTH)
+  {
+    u32 remaining_rows = height;
+    u32 current_src_y = src_y;
+    u32 current_dst_y = dst_y;
+    while (remaining_rows > 0)
+    {
+      const u32 rows_to_copy =
+        std::min<u32>(remaining_rows, std::min<u32>(VRAM_HEIGHT - current_src_y, VRAM_HEIGHT - current_dst_y));
+
+      u32 remaining_columns = width;
+      u32 current_src_x = src_x;
+      u32 current_dst_x = dst_x;
+      while (remaining_columns > 0)
+      {
+        const u32 columns_to_copy =
+          std::min<u32>(remaining_columns, std::min<u32>(VRAM_WIDTH - current_src_x, VRAM_WIDTH - current_dst_x));
+        CopyVRAMImpl(current_src_x, current_src_y, current_dst_x, current_dst_y, columns_to_copy, rows_to_copy,
+                     params);
+        current_src_x = (current_src_x + columns_to_copy) % VRAM_WIDTH;
+        current_dst_x = (current_dst_x + columns_to_copy) % VRAM_WIDTH;
+        remaining_columns -= columns_to_copy;
+      }
+
+      current_src_y = (current_src_y + rows_to_copy) % VRAM_HEIGHT;
+      current_dst_y = (current_dst_y + rows_to_copy) % VRAM_HEIGHT;
+      remaining_rows -= rows_to_copy;
+    }
+
+    return;
+  }
+
+  const u16 mask_and = params.mask_and;
+  const u16 mask_or = params.mask_or;
+
+  // Copy in reverse when src_x < dst_x, this is verified on console.
+  if (src_x < dst_x || ((src_x + width - 1) % VRAM_WIDTH) < ((dst_x + width - 1) % VRAM_WIDTH))
+  {
+    for (u32 row = 0; row < height; row++)
+    {
+      const u16* src_row_ptr = &m_vram[((src_y + row) % VRAM_HEIGHT) * VRAM_WIDTH];
+      u16* dst_row_ptr = &m_vram[((dst_y + row) % VRAM_HEIGHT) * VRAM_WIDTH];
+
+      for (s32 col = static_cast<s32>(width - 1); col >= 0; col--)
+      {
+        const u16 src_pixel = src_row_ptr[(src_x + static_cast<u32>(col)) % VRAM_WIDTH];
+        u16* dst_pixel_ptr = &dst_row_ptr[(dst_x + static_cast<u32>(col)) % VRAM_WIDTH];
+        if ((*dst_pixel_ptr & mask_and) == 0)
+          *dst_pixel_ptr = src_pixel | mask_or;
+      }
+    }
+  }
+  else
+  {
+    for (u32 row = 0; row < height; row++)
+    {
+      const u16* src_row_ptr = &m_vram[((src_y + row) % VRAM_HEIGHT) * VRAM_WIDTH];
+      u16* dst_row_ptr = &m_vram[((dst_y + row) % VRAM_HEIGHT) * VRAM_WIDTH];
+
+      for (u32 col = 0; col < width; col++)
+      {
+        const u16 src_pixel = src_row_ptr[(src_x + col) % VRAM_WIDTH];
+        u16* dst_pixel_ptr = &dst_row_ptr[(dst_x + col) % VRAM_WIDTH];
+        if ((*dst_pixel_ptr & mask_and) == 0)
+          *dst_pixel_ptr = src_pixel | mask_or;
+      }
+    }
+  }
+}
+
+void GPU_SW::DispatchRenderCommand(const u32* words)
 {
   const RenderCommand rc{m_render_command.bits};
   const bool dithering_enable = rc.IsDitheringEnabled() && m_GPUSTAT.dither_enable;
@@ -228,18 +994,18 @@ void GPU_SW::DispatchRenderCommand()
       for (u32 i = 0; i < num_vertices; i++)
       {
         SWVertex& vert = vertices[i];
-        const u32 color_rgb = (shaded && i > 0) ? (m_fifo.Pop() & UINT32_C(0x00FFFFFF)) : first_color;
+        const u32 color_rgb = (shaded && i > 0) ? (*(words++) & UINT32_C(0x00FFFFFF)) : first_color;
         vert.color_r = Truncate8(color_rgb);
         vert.color_g = Truncate8(color_rgb >> 8);
         vert.color_b = Truncate8(color_rgb >> 16);
 
-        const VertexPosition vp{m_fifo.Pop()};
+        const VertexPosition vp{*(words++)};
         vert.x = vp.x;
         vert.y = vp.y;
 
         if (textured)
         {
-          std::tie(vert.texcoord_x, vert.texcoord_y) = UnpackTexcoord(Truncate16(m_fifo.Pop()));
+          std::tie(vert.texcoord_x, vert.texcoord_y) = UnpackTexcoord(Truncate16(*(words++)));
         }
         else
         {
@@ -251,20 +1017,29 @@ void GPU_SW::DispatchRenderCommand()
       if (!IsDrawingAreaIsValid())
         return;
 
-      const DrawTriangleFunction DrawFunction = GetDrawTriangleFunction(
-        rc.shading_enable, rc.texture_enable, rc.raw_texture_enable, rc.transparency_enable, dithering_enable);
-
-      (this->*DrawFunction)(&vertices[0], &vertices[1], &vertices[2]);
+      Common::Rectangle<u32> bounds;
+      AddTriangleTicks(&vertices[0], &vertices[1], &vertices[2], rc, &bounds);
       if (num_vertices > 3)
-        (this->*DrawFunction)(&vertices[2], &vertices[1], &vertices[3]);
+        AddTriangleTicks(&vertices[2], &vertices[1], &vertices[3], rc, &bounds);
+
+      // Both triangles were culled.
+      if (!bounds.Valid())
+        return;
+
+      SWDrawPolygonCommand* cmd =
+        AllocateCommand<SWDrawPolygonCommand>(SWCommandType::DrawPolygon, sizeof(SWDrawPolygonCommand));
+      FillDrawCommand(cmd, rc, dithering_enable);
+      cmd->num_vertices = num_vertices;
+      std::copy_n(vertices.begin(), num_vertices, cmd->vertices.begin());
+      PushDrawCommand(cmd, sizeof(SWDrawPolygonCommand), bounds);
     }
     break;
 
     case Primitive::Rectangle:
     {
       const auto [r, g, b] = UnpackColorRGB24(rc.color_for_first_vertex);
-      const VertexPosition vp{m_fifo.Pop()};
-      const u32 texcoord_and_palette = rc.texture_enable ? m_fifo.Pop() : 0;
+      const VertexPosition vp{*(words++)};
+      const u32 texcoord_and_palette = rc.texture_enable ? *(words++) : 0;
       const auto [texcoord_x, texcoord_y] = UnpackTexcoord(Truncate16(texcoord_and_palette));
 
       s32 width;
@@ -285,7 +1060,7 @@ void GPU_SW::DispatchRenderCommand()
           break;
         default:
         {
-          const u32 width_and_height = m_fifo.Pop();
+          const u32 width_and_height = *(words++);
           width = static_cast<s32>(width_and_height & VRAM_WIDTH_MASK);
           height = static_cast<s32>((width_and_height >> 16) & VRAM_HEIGHT_MASK);
 
@@ -302,10 +1077,21 @@ void GPU_SW::DispatchRenderCommand()
       if (!IsDrawingAreaIsValid())
         return;
 
-      const DrawRectangleFunction DrawFunction =
-        GetDrawRectangleFunction(rc.texture_enable, rc.raw_texture_enable, rc.transparency_enable);
-
-      (this->*DrawFunction)(vp.x, vp.y, width, height, r, g, b, texcoord_x, texcoord_y);
+      AddRectangleTicks(vp.x, vp.y, width, height, rc);
+
+      SWDrawRectangleCommand* cmd =
+        AllocateCommand<SWDrawRectangleCommand>(SWCommandType::DrawRectangle, sizeof(SWDrawRectangleCommand));
+      FillDrawCommand(cmd, rc, dithering_enable);
+      cmd->x = vp.x;
+      cmd->y = vp.y;
+      cmd->width = static_cast<u32>(width);
+      cmd->height = static_cast<u32>(height);
+      cmd->r = r;
+      cmd->g = g;
+      cmd->b = b;
+      cmd->texcoord_x = texcoord_x;
+      cmd->texcoord_y = texcoord_y;
+      PushDrawCommand(cmd, sizeof(SWDrawRectangleCommand), GetRectangleBounds(vp.x, vp.y, width, height));
     }
     break;
 
@@ -313,40 +1099,40 @@ void GPU_SW::DispatchRenderCommand()
     {
       const u32 first_color = rc.color_for_first_vertex;
       const bool shaded = rc.shading_enable;
+      const u32 num_vertices = rc.polyline ? GetPolyLineVertexCount() : 2;
 
-      const DrawLineFunction DrawFunction = GetDrawLineFunction(shaded, rc.transparency_enable, dithering_enable);
+      const u32 cmd_size = sizeof(SWDrawLineCommand) + (sizeof(SWVertex) * num_vertices);
+      SWDrawLineCommand* cmd = AllocateCommand<SWDrawLineCommand>(SWCommandType::DrawLine, cmd_size);
+      FillDrawCommand(cmd, rc, dithering_enable);
+      cmd->num_vertices = num_vertices;
 
-      std::array<SWVertex, 2> vertices = {};
-      u32 buffer_pos = 0;
+      SWVertex* vertices = cmd->GetVertices();
 
       // first vertex
-      SWVertex* p0 = &vertices[0];
-      SWVertex* p1 = &vertices[1];
-      p0->SetPosition(VertexPosition{rc.polyline ? m_blit_buffer[buffer_pos++] : m_fifo.Pop()});
-      p0->SetColorRGB24(first_color);
+      vertices[0] = {};
+      vertices[0].SetPosition(VertexPosition{*(words++)});
+      vertices[0].SetColorRGB24(first_color);
 
       // remaining vertices in line strip
-      const u32 num_vertices = rc.polyline ? GetPolyLineVertexCount() : 2;
       for (u32 i = 1; i < num_vertices; i++)
       {
-        if (rc.polyline)
-        {
-          p1->SetColorRGB24(shaded ? (m_blit_buffer[buffer_pos++] & UINT32_C(0x00FFFFFF)) : first_color);
-          p1->SetPosition(VertexPosition{m_blit_buffer[buffer_pos++]});
-        }
-        else
-        {
-          p1->SetColorRGB24(shaded ? (m_fifo.Pop() & UINT32_C(0x00FFFFFF)) : first_color);
-          p1->SetPosition(VertexPosition{m_fifo.Pop()});
-        }
+        SWVertex& vert = vertices[i];
+        vert = {};
+        vert.SetColorRGB24(shaded ? (*(words++) & UINT32_C(0x00FFFFFF)) : first_color);
+        vert.SetPosition(VertexPosition{*(words++)});
+      }
 
-        // down here because of the FIFO pops
-        if (IsDrawingAreaIsValid())
-          (this->*DrawFunction)(p0, p1);
+      if (!IsDrawingAreaIsValid())
+        return;
 
-        // swap p0/p1 so that the last vertex is used as the first for the next line
-        std::swap(p0, p1);
+      Common::Rectangle<u32> bounds;
+      for (u32 i = 1; i < num_vertices; i++)
+      {
+        AddLineTicks(&vertices[i - 1], &vertices[i], rc);
+        IncludeLineBounds(&vertices[i - 1], &vertices[i], &bounds);
       }
+
+      PushDrawCommand(cmd, cmd_size, bounds);
     }
     break;
 
@@ -403,22 +1189,70 @@ static constexpr u8 Interpolate(u8 v0, u8 v1, u8 v2, s32 w0, s32 w1, s32 w2, s32
   return (vd < 0) ? 0 : ((vd > 0xFF) ? 0xFF : static_cast<u8>(vd));
 }
 
+#define orient2d(ax, ay, bx, by, cx, cy) ((bx - ax) * (cy - ay) - (by - ay) * (cx - ax))
+
+bool GPU_SW::GetClippedTriangleBounds(s32 px0, s32 py0, s32 px1, s32 py1, s32 px2, s32 py2,
+                                      const Common::Rectangle<u32>& drawing_area, s32* min_x, s32* max_x, s32* min_y,
+                                      s32* max_y)
+{
+  // compute bounding box of triangle
+  *min_x = std::min(px0, std::min(px1, px2));
+  *max_x = std::max(px0, std::max(px1, px2));
+  *min_y = std::min(py0, std::min(py1, py2));
+  *max_y = std::max(py0, std::max(py1, py2));
+
+  // reject triangles which cover the whole vram area
+  if (static_cast<u32>(*max_x - *min_x) > MAX_PRIMITIVE_WIDTH ||
+      static_cast<u32>(*max_y - *min_y) > MAX_PRIMITIVE_HEIGHT)
+  {
+    return false;
+  }
+
+  // clip to drawing area
+  *min_x = std::clamp(*min_x, static_cast<s32>(drawing_area.left), static_cast<s32>(drawing_area.right));
+  *max_x = std::clamp(*max_x, static_cast<s32>(drawing_area.left), static_cast<s32>(drawing_area.right));
+  *min_y = std::clamp(*min_y, static_cast<s32>(drawing_area.top), static_cast<s32>(drawing_area.bottom));
+  *max_y = std::clamp(*max_y, static_cast<s32>(drawing_area.top), static_cast<s32>(drawing_area.bottom));
+  return true;
+}
+
+void GPU_SW::AddTriangleTicks(const SWVertex* v0, const SWVertex* v1, const SWVertex* v2, RenderCommand rc,
+                              Common::Rectangle<u32>* bounds)
+{
+  const s32 px0 = v0->x + m_drawing_offset.x;
+  const s32 py0 = v0->y + m_drawing_offset.y;
+  const s32 px1 = v1->x + m_drawing_offset.x;
+  const s32 py1 = v1->y + m_drawing_offset.y;
+  const s32 px2 = v2->x + m_drawing_offset.x;
+  const s32 py2 = v2->y + m_drawing_offset.y;
+  if (orient2d(px0, py0, px1, py1, px2, py2) == 0)
+    return;
+
+  s32 min_x, max_x, min_y, max_y;
+  if (!GetClippedTriangleBounds(px0, py0, px1, py1, px2, py2, m_drawing_area, &min_x, &max_x, &min_y, &max_y))
+    return;
+
+  AddDrawTriangleTicks(max_x - min_x + 1, max_y - min_y + 1, rc.shading_enable, rc.texture_enable,
+                       rc.transparency_enable);
+  bounds->Include(static_cast<u32>(min_x), static_cast<u32>(max_x) + 1, static_cast<u32>(min_y),
+                  static_cast<u32>(max_y) + 1);
+}
+
 template<bool shading_enable, bool texture_enable, bool raw_texture_enable, bool transparency_enable,
          bool dithering_enable>
-void GPU_SW::DrawTriangle(const SWVertex* v0, const SWVertex* v1, const SWVertex* v2)
+void GPU_SW::DrawTriangle(const SWDrawCommand* cmd, TextureCacheEntry* texture, const SWVertex* v0, const SWVertex* v1,
+                          const SWVertex* v2)
 {
-#define orient2d(ax, ay, bx, by, cx, cy) ((bx - ax) * (cy - ay) - (by - ay) * (cx - ax))
-
   // ensure the vertices follow a counter-clockwise order
   if (IsClockwiseWinding(v0, v1, v2))
     std::swap(v1, v2);
 
-  const s32 px0 = v0->x + m_drawing_offset.x;
-  const s32 py0 = v0->y + m_drawing_offset.y;
-  const s32 px1 = v1->x + m_drawing_offset.x;
-  const s32 py1 = v1->y + m_drawing_offset.y;
-  const s32 px2 = v2->x + m_drawing_offset.x;
-  const s32 py2 = v2->y + m_drawing_offset.y;
+  const s32 px0 = v0->x + cmd->drawing_offset.x;
+  const s32 py0 = v0->y + cmd->drawing_offset.y;
+  const s32 px1 = v1->x + cmd->drawing_offset.x;
+  const s32 py1 = v1->y + cmd->drawing_offset.y;
+  const s32 px2 = v2->x + cmd->drawing_offset.x;
+  const s32 py2 = v2->y + cmd->drawing_offset.y;
 
   // Barycentric coordinates at minX/minY corner
   const s32 ws = orient2d(px0, py0, px1, py1, px2, py2);
@@ -426,23 +1260,10 @@ void GPU_SW::DrawTriangle(const SWVertex* v0, const SWVertex* v1, const SWVertex
   if (ws == 0)
     return;
 
-  // compute bounding box of triangle
-  s32 min_x = std::min(px0, std::min(px1, px2));
-  s32 max_x = std::max(px0, std::max(px1, px2));
-  s32 min_y = std::min(py0, std::min(py1, py2));
-  s32 max_y = std::max(py0, std::max(py1, py2));
-
-  // reject triangles which cover the whole vram area
-  if (static_cast<u32>(max_x - min_x) > MAX_PRIMITIVE_WIDTH || static_cast<u32>(max_y - min_y) > MAX_PRIMITIVE_HEIGHT)
+  s32 min_x, max_x, min_y, max_y;
+  if (!GetClippedTriangleBounds(px0, py0, px1, py1, px2, py2, cmd->drawing_area, &min_x, &max_x, &min_y, &max_y))
     return;
 
-  // clip to drawing area
-  min_x = std::clamp(min_x, static_cast<s32>(m_drawing_area.left), static_cast<s32>(m_drawing_area.right));
-  max_x = std::clamp(max_x, static_cast<s32>(m_drawing_area.left), static_cast<s32>(m_drawing_area.right));
-  min_y = std::clamp(min_y, static_cast<s32>(m_drawing_area.top), static_cast<s32>(m_drawing_area.bottom));
-  max_y = std::clamp(max_y, static_cast<s32>(m_drawing_area.top), static_cast<s32>(m_drawing_area.bottom));
-  AddDrawTriangleTicks(max_x - min_x + 1, max_y - min_y + 1, shading_enable, texture_enable, transparency_enable);
-
   // compute per-pixel increments
   const s32 a01 = py0 - py1, b01 = px1 - px0;
   const s32 a12 = py1 - py2, b12 = px2 - px1;
@@ -458,6 +1279,14 @@ void GPU_SW::DrawTriangle(const SWVertex* v0, const SWVertex* v1, const SWVertex
   s32 w1 = orient2d(px2, py2, px0, py0, min_x, min_y);
   s32 w2 = orient2d(px0, py0, px1, py1, min_x, min_y);
 
+  SWSpan span = {};
+  if constexpr (!shading_enable)
+  {
+    std::fill_n(span.r, SPAN_WIDTH, v0->color_r);
+    std::fill_n(span.g, SPAN_WIDTH, v0->color_g);
+    std::fill_n(span.b, SPAN_WIDTH, v0->color_b);
+  }
+
   // *exclusive* of max coordinate in PSX
   for (s32 y = min_y; y <= max_y; y++)
   {
@@ -465,40 +1294,54 @@ void GPU_SW::DrawTriangle(const SWVertex* v0, const SWVertex* v1, const SWVertex
     s32 row_w1 = w1;
     s32 row_w2 = w2;
 
-    for (s32 x = min_x; x <= max_x; x++)
+    w0 += b12;
+    w1 += b20;
+    w2 += b01;
+
+    if (!IsRowInBands(cmd->params.band_mask, static_cast<u32>(y)))
+      continue;
+
+    for (s32 x = min_x; x <= max_x; x += SPAN_WIDTH)
     {
-      if (((row_w0 + w0_bias) | (row_w1 + w1_bias) | (row_w2 + w2_bias)) >= 0)
+      const u32 count = std::min<u32>(static_cast<u32>(max_x - x) + 1, SPAN_WIDTH);
+      u32 pixel_mask = 0;
+      for (u32 i = 0; i < count; i++)
       {
-        const s32 b0 = row_w0;
-        const s32 b1 = row_w1;
-        const s32 b2 = row_w2;
-
-        const u8 r =
-          shading_enable ? Interpolate(v0->color_r, v1->color_r, v2->color_r, b0, b1, b2, ws, half_ws) : v0->color_r;
-        const u8 g =
-          shading_enable ? Interpolate(v0->color_g, v1->color_g, v2->color_g, b0, b1, b2, ws, half_ws) : v0->color_g;
-        const u8 b =
-          shading_enable ? Interpolate(v0->color_b, v1->color_b, v2->color_b, b0, b1, b2, ws, half_ws) : v0->color_b;
-
-        const u8 texcoord_x = Interpolate(v0->texcoord_x, v1->texcoord_x, v2->texcoord_x, b0, b1, b2, ws, half_ws);
-        const u8 texcoord_y = Interpolate(v0->texcoord_y, v1->texcoord_y, v2->texcoord_y, b0, b1, b2, ws, half_ws);
-
-        ShadePixel<texture_enable, raw_texture_enable, transparency_enable, dithering_enable>(
-          static_cast<u32>(x), static_cast<u32>(y), r, g, b, texcoord_x, texcoord_y);
+        if (((row_w0 + w0_bias) | (row_w1 + w1_bias) | (row_w2 + w2_bias)) >= 0)
+        {
+          const s32 b0 = row_w0;
+          const s32 b1 = row_w1;
+          const s32 b2 = row_w2;
+
+          pixel_mask |= 1u << i;
+          if constexpr (shading_enable)
+          {
+            span.r[i] = Interpolate(v0->color_r, v1->color_r, v2->color_r, b0, b1, b2, ws, half_ws);
+            span.g[i] = Interpolate(v0->color_g, v1->color_g, v2->color_g, b0, b1, b2, ws, half_ws);
+            span.b[i] = Interpolate(v0->color_b, v1->color_b, v2->color_b, b0, b1, b2, ws, half_ws);
+          }
+          if constexpr (texture_enable)
+          {
+            span.texcoord_x[i] = Interpolate(v0->texcoord_x, v1->texcoord_x, v2->texcoord_x, b0, b1, b2, ws, half_ws);
+            span.texcoord_y[i] = Interpolate(v0->texcoord_y, v1->texcoord_y, v2->texcoord_y, b0, b1, b2, ws, half_ws);
+          }
+        }
+
+        row_w0 += a12;
+        row_w1 += a20;
+        row_w2 += a01;
       }
 
-      row_w0 += a12;
-      row_w1 += a20;
-      row_w2 += a01;
+      if (pixel_mask != 0)
+      {
+        ShadeSpan<texture_enable, raw_texture_enable, transparency_enable, dithering_enable>(
+          cmd, texture, static_cast<u32>(x), static_cast<u32>(y), count, pixel_mask, span);
+      }
     }
-
-    w0 += b12;
-    w1 += b20;
-    w2 += b01;
   }
+}
 
 #undef orient2d
-}
 
 GPU_SW::DrawTriangleFunction GPU_SW::GetDrawTriangleFunction(bool shading_enable, bool texture_enable,
                                                              bool raw_texture_enable, bool transparency_enable,
@@ -531,43 +1374,79 @@ GPU_SW::DrawTriangleFunction GPU_SW::GetDrawTriangleFunction(bool shading_enable
               [u8(dithering_enable)];
 }
 
-template<bool texture_enable, bool raw_texture_enable, bool transparency_enable>
-void GPU_SW::DrawRectangle(s32 origin_x, s32 origin_y, u32 width, u32 height, u8 r, u8 g, u8 b, u8 origin_texcoord_x,
-                           u8 origin_texcoord_y)
+void GPU_SW::AddRectangleTicks(s32 origin_x, s32 origin_y, u32 width, u32 height, RenderCommand rc)
 {
   const s32 start_x = TruncateVertexPosition(m_drawing_offset.x + origin_x);
   const s32 start_y = TruncateVertexPosition(m_drawing_offset.y + origin_y);
 
-  {
-    const u32 clip_left = static_cast<u32>(std::clamp<s32>(start_x, m_drawing_area.left, m_drawing_area.right));
-    const u32 clip_right =
-      static_cast<u32>(std::clamp<s32>(start_x + static_cast<s32>(width), m_drawing_area.left, m_drawing_area.right)) +
-      1u;
-    const u32 clip_top = static_cast<u32>(std::clamp<s32>(start_y, m_drawing_area.top, m_drawing_area.bottom));
-    const u32 clip_bottom =
-      static_cast<u32>(std::clamp<s32>(start_y + static_cast<s32>(height), m_drawing_area.top, m_drawing_area.bottom)) +
-      1u;
-    AddDrawRectangleTicks(clip_right - clip_left, clip_bottom - clip_top, texture_enable, transparency_enable);
-  }
+  const u32 clip_left = static_cast<u32>(std::clamp<s32>(start_x, m_drawing_area.left, m_drawing_area.right));
+  const u32 clip_right =
+    static_cast<u32>(std::clamp<s32>(start_x + static_cast<s32>(width), m_drawing_area.left, m_drawing_area.right)) +
+    1u;
+  const u32 clip_top = static_cast<u32>(std::clamp<s32>(start_y, m_drawing_area.top, m_drawing_area.bottom));
+  const u32 clip_bottom =
+    static_cast<u32>(std::clamp<s32>(start_y + static_cast<s32>(height), m_drawing_area.top, m_drawing_area.bottom)) +
+    1u;
+  AddDrawRectangleTicks(clip_right - clip_left, clip_bottom - clip_top, rc.texture_enable, rc.transparency_enable);
+}
+
+Common::Rectangle<u32> GPU_SW::GetRectangleBounds(s32 origin_x, s32 origin_y, u32 width, u32 height) const
+{
+  const s32 start_x = TruncateVertexPosition(m_drawing_offset.x + origin_x);
+  const s32 start_y = TruncateVertexPosition(m_drawing_offset.y + origin_y);
+  const s32 left = static_cast<s32>(m_drawing_area.left);
+  const s32 right = static_cast<s32>(m_drawing_area.right) + 1;
+  const s32 top = static_cast<s32>(m_drawing_area.top);
+  const s32 bottom = static_cast<s32>(m_drawing_area.bottom) + 1;
+
+  return Common::Rectangle<u32>(static_cast<u32>(std::clamp<s32>(start_x, left, right)),
+                                static_cast<u32>(std::clamp<s32>(start_y, top, bottom)),
+                                static_cast<u32>(std::clamp<s32>(start_x + static_cast<s32>(width), left, right)),
+                                static_cast<u32>(std::clamp<s32>(start_y + static_cast<s32>(height), top, bottom)));
+}
+
+template<bool texture_enable, bool raw_texture_enable, bool transparency_enable>
+void GPU_SW::DrawRectangle(const SWDrawCommand* cmd, TextureCacheEntry* texture, s32 origin_x, s32 origin_y, u32 width,
+                           u32 height, u8 r, u8 g, u8 b, u8 origin_texcoord_x, u8 origin_texcoord_y)
+{
+  const s32 start_x = TruncateVertexPosition(cmd->drawing_offset.x + origin_x);
+  const s32 start_y = TruncateVertexPosition(cmd->drawing_offset.y + origin_y);
+
+  // rows are the same width, so clip the columns once
+  const s32 left = std::max(start_x, static_cast<s32>(cmd->drawing_area.left));
+  const s32 right = std::min(start_x + static_cast<s32>(width) - 1, static_cast<s32>(cmd->drawing_area.right));
+  if (left > right)
+    return;
+
+  SWSpan span = {};
+  std::fill_n(span.r, SPAN_WIDTH, r);
+  std::fill_n(span.g, SPAN_WIDTH, g);
+  std::fill_n(span.b, SPAN_WIDTH, b);
 
   for (u32 offset_y = 0; offset_y < height; offset_y++)
   {
     const s32 y = start_y + static_cast<s32>(offset_y);
-    if (y < static_cast<s32>(m_drawing_area.top) || y > static_cast<s32>(m_drawing_area.bottom))
+    if (y < static_cast<s32>(cmd->drawing_area.top) || y > static_cast<s32>(cmd->drawing_area.bottom) ||
+        !IsRowInBands(cmd->params.band_mask, static_cast<u32>(y)))
+    {
       continue;
+    }
 
-    const u8 texcoord_y = Truncate8(ZeroExtend32(origin_texcoord_y) + offset_y);
+    if constexpr (texture_enable)
+      std::fill_n(span.texcoord_y, SPAN_WIDTH, Truncate8(ZeroExtend32(origin_texcoord_y) + offset_y));
 
-    for (u32 offset_x = 0; offset_x < width; offset_x++)
+    for (s32 x = left; x <= right; x += SPAN_WIDTH)
     {
-      const s32 x = start_x + static_cast<s32>(offset_x);
-      if (x < static_cast<s32>(m_drawing_area.left) || x > static_cast<s32>(m_drawing_area.right))
-        continue;
-
-      const u8 texcoord_x = Truncate8(ZeroExtend32(origin_texcoord_x) + offset_x);
+      const u32 count = std::min<u32>(static_cast<u32>(right - x) + 1, SPAN_WIDTH);
+      if constexpr (texture_enable)
+      {
+        const u32 offset_x = static_cast<u32>(x - start_x);
+        for (u32 i = 0; i < SPAN_WIDTH; i++)
+          span.texcoord_x[i] = Truncate8(ZeroExtend32(origin_texcoord_x) + offset_x + i);
+      }
 
-      ShadePixel<texture_enable, raw_texture_enable, transparency_enable, false>(
-        static_cast<u32>(x), static_cast<u32>(y), r, g, b, texcoord_x, texcoord_y);
+      ShadeSpan<texture_enable, raw_texture_enable, transparency_enable, false>(
+        cmd, texture, static_cast<u32>(x), static_cast<u32>(y), count, (1u << count) - 1u, span);
     }
   }
 }
@@ -591,56 +1470,67 @@ constexpr GPU_SW::DitherLUT GPU_SW::ComputeDitherLUT()
 
 static constexpr GPU_SW::DitherLUT s_dither_lut = GPU_SW::ComputeDitherLUT();
 
-template<bool texture_enable, bool raw_texture_enable, bool transparency_enable, bool dithering_enable>
-void GPU_SW::ShadePixel(u32 x, u32 y, u8 color_r, u8 color_g, u8 color_b, u8 texcoord_x, u8 texcoord_y)
+ALWAYS_INLINE u16 GPU_SW::ReadTexel(const SWDrawCommand* cmd, u8 texcoord_x, u8 texcoord_y) const
 {
-  VRAMPixel color;
-  bool transparent;
-  if constexpr (texture_enable)
+  switch (cmd->texture_mode)
   {
-    // Apply texture window
-    // TODO: Precompute the second half
-    texcoord_x = (texcoord_x & ~(m_draw_mode.texture_window_mask_x * 8u)) |
-                 ((m_draw_mode.texture_window_offset_x & m_draw_mode.texture_window_mask_x) * 8u);
-    texcoord_y = (texcoord_y & ~(m_draw_mode.texture_window_mask_y * 8u)) |
-                 ((m_draw_mode.texture_window_offset_y & m_draw_mode.texture_window_mask_y) * 8u);
-
-    VRAMPixel texture_color;
-    switch (m_draw_mode.GetTextureMode())
+    case GPU::TextureMode::Palette4Bit:
     {
-      case GPU::TextureMode::Palette4Bit:
-      {
-        const u16 palette_value =
-          GetPixel(std::min<u32>(m_draw_mode.texture_page_x + ZeroExtend32(texcoord_x / 4), VRAM_WIDTH - 1),
-                   std::min<u32>(m_draw_mode.texture_page_y + ZeroExtend32(texcoord_y), VRAM_HEIGHT - 1));
-        const u16 palette_index = (palette_value >> ((texcoord_x % 4) * 4)) & 0x0Fu;
-        texture_color.bits =
-          GetPixel(std::min<u32>(m_draw_mode.texture_palette_x + ZeroExtend32(palette_index), VRAM_WIDTH - 1),
-                   m_draw_mode.texture_palette_y);
-      }
-      break;
+      const u16 palette_value =
+        GetPixel(std::min<u32>(cmd->texture_page_x + ZeroExtend32(texcoord_x / 4), VRAM_WIDTH - 1),
+                 std::min<u32>(cmd->texture_page_y + ZeroExtend32(texcoord_y), VRAM_HEIGHT - 1));
+      const u16 palette_index = (palette_value >> ((texcoord_x % 4) * 4)) & 0x0Fu;
+      return GetPixel(std::min<u32>(cmd->texture_palette_x + ZeroExtend32(palette_index), VRAM_WIDTH - 1),
+                      cmd->texture_palette_y);
+    }
 
-      case GPU::TextureMode::Palette8Bit:
-      {
-        const u16 palette_value =
-          GetPixel(std::min<u32>(m_draw_mode.texture_page_x + ZeroExtend32(texcoord_x / 2), VRAM_WIDTH - 1),
-                   std::min<u32>(m_draw_mode.texture_page_y + ZeroExtend32(texcoord_y), VRAM_HEIGHT - 1));
-        const u16 palette_index = (palette_value >> ((texcoord_x % 2) * 8)) & 0xFFu;
-        texture_color.bits =
-          GetPixel(std::min<u32>(m_draw_mode.texture_palette_x + ZeroExtend32(palette_index), VRAM_WIDTH - 1),
-                   m_draw_mode.texture_palette_y);
-      }
-      break;
+    case GPU::TextureMode::Palette8Bit:
+    {
+      const u16 palette_value =
+        GetPixel(std::min<u32>(cmd->texture_page_x + ZeroExtend32(texcoord_x / 2), VRAM_WIDTH - 1),
+                 std::min<u32>(cmd->texture_page_y + ZeroExtend32(texcoord_y), VRAM_HEIGHT - 1));
+      const u16 palette_index = (palette_value >> ((texcoord_x % 2) * 8)) & 0xFFu;
+      return GetPixel(std::min<u32>(cmd->texture_palette_x + ZeroExtend32(palette_index), VRAM_WIDTH - 1),
+                      cmd->texture_palette_y);
+    }
 
-      default:
-      {
-        texture_color.bits =
-          GetPixel(std::min<u32>(m_draw_mode.texture_page_x + ZeroExtend32(texcoord_x), VRAM_WIDTH - 1),
-                   std::min<u32>(m_draw_mode.texture_page_y + ZeroExtend32(texcoord_y), VRAM_HEIGHT - 1));
-      }
-      break;
+    default:
+    {
+      return GetPixel(std::min<u32>(cmd->texture_page_x + ZeroExtend32(texcoord_x), VRAM_WIDTH - 1),
+                      std::min<u32>(cmd->texture_page_y + ZeroExtend32(texcoord_y), VRAM_HEIGHT - 1));
     }
+  }
+}
+
+ALWAYS_INLINE u16 GPU_SW::SampleTexture(const SWDrawCommand* cmd, TextureCacheEntry* texture, u8 texcoord_x,
+                                        u8 texcoord_y) const
+{
+  // Apply texture window
+  // TODO: Precompute the second half
+  texcoord_x = (texcoord_x & ~(cmd->texture_window_mask_x * 8u)) |
+               ((cmd->texture_window_offset_x & cmd->texture_window_mask_x) * 8u);
+  texcoord_y = (texcoord_y & ~(cmd->texture_window_mask_y * 8u)) |
+               ((cmd->texture_window_offset_y & cmd->texture_window_mask_y) * 8u);
+
+  if (!texture)
+    return ReadTexel(cmd, texcoord_x, texcoord_y);
 
+  if (!texture->valid_rows[texcoord_y])
+    DecodeTextureRow(cmd, texture, texcoord_y);
+
+  return texture->texels[ZeroExtend32(texcoord_y) * TEXTURE_PAGE_WIDTH + ZeroExtend32(texcoord_x)];
+}
+
+template<bool texture_enable, bool raw_texture_enable, bool transparency_enable, bool dithering_enable>
+void GPU_SW::ShadePixel(const SWDrawCommand* cmd, TextureCacheEntry* texture, u32 x, u32 y, u8 color_r, u8 color_g,
+                        u8 color_b, u8 texcoord_x, u8 texcoord_y)
+{
+  VRAMPixel color;
+  bool transparent;
+  if constexpr (texture_enable)
+  {
+    VRAMPixel texture_color;
+    texture_color.bits = SampleTexture(cmd, texture, texcoord_x, texcoord_y);
     if (texture_color.bits == 0)
       return;
 
@@ -687,7 +1577,7 @@ void GPU_SW::ShadePixel(u32 x, u32 y, u8 color_r, u8 color_g, u8 color_b, u8 tex
   color.Set(func(bg_color.r.GetValue(), color.r.GetValue()), func(bg_color.g.GetValue(), color.g.GetValue()),          \
             func(bg_color.b.GetValue(), color.b.GetValue()), color.c.GetValue())
 
-      switch (m_draw_mode.GetTransparencyMode())
+      switch (cmd->transparency_mode)
       {
         case GPU::TransparencyMode::HalfBackgroundPlusHalfForeground:
           BLEND_RGB(BLEND_AVERAGE);
@@ -718,14 +1608,340 @@ void GPU_SW::ShadePixel(u32 x, u32 y, u8 color_r, u8 color_g, u8 color_b, u8 tex
     UNREFERENCED_VARIABLE(transparent);
   }
 
-  const u16 mask_and = m_GPUSTAT.GetMaskAND();
-  if ((bg_color.bits & mask_and) != 0)
+  if ((bg_color.bits & cmd->params.mask_and) != 0)
+    return;
+
+  if (cmd->params.interlaced_rendering && cmd->params.active_line_lsb == (static_cast<u32>(y) & 1u))
     return;
 
-  if (IsInterlacedRenderingEnabled() && GetActiveLineLSB() == (static_cast<u32>(y) & 1u))
+  SetPixel(static_cast<u32>(x), static_cast<u32>(y), color.bits | cmd->params.mask_or);
+}
+
+#if defined(GPU_SW_SIMD_SSE2) || defined(GPU_SW_SIMD_NEON)
+
+namespace {
+
+// Eight 16-bit lanes, one per pixel of a span.
+#if defined(GPU_SW_SIMD_SSE2)
+
+using SpanVector = __m128i;
+
+ALWAYS_INLINE SpanVector SpanLoad(const u16* ptr)
+{
+  return _mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr));
+}
+ALWAYS_INLINE SpanVector SpanLoadBytes(const u8* ptr)
+{
+  return _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(ptr)), _mm_setzero_si128());
+}
+ALWAYS_INLINE void SpanStore(u16* ptr, SpanVector v)
+{
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(ptr), v);
+}
+ALWAYS_INLINE SpanVector SpanSplat(u16 value)
+{
+  return _mm_set1_epi16(static_cast<s16>(value));
+}
+ALWAYS_INLINE SpanVector SpanAnd(SpanVector a, SpanVector b)
+{
+  return _mm_and_si128(a, b);
+}
+ALWAYS_INLINE SpanVector SpanAndNot(SpanVector a, SpanVector b)
+{
+  return _mm_andnot_si128(b, a);
+}
+ALWAYS_INLINE SpanVector SpanOr(SpanVector a, SpanVector b)
+{
+  return _mm_or_si128(a, b);
+}
+ALWAYS_INLINE SpanVector SpanAdd(SpanVector a, SpanVector b)
+{
+  return _mm_add_epi16(a, b);
+}
+ALWAYS_INLINE SpanVector SpanSubSaturate(SpanVector a, SpanVector b)
+{
+  return _mm_subs_epu16(a, b);
+}
+ALWAYS_INLINE SpanVector SpanMul(SpanVector a, SpanVector b)
+{
+  return _mm_mullo_epi16(a, b);
+}
+ALWAYS_INLINE SpanVector SpanMin(SpanVector a, SpanVector b)
+{
+  return _mm_min_epi16(a, b);
+}
+ALWAYS_INLINE SpanVector SpanMax(SpanVector a, SpanVector b)
+{
+  return _mm_max_epi16(a, b);
+}
+ALWAYS_INLINE SpanVector SpanEqual(SpanVector a, SpanVector b)
+{
+  return _mm_cmpeq_epi16(a, b);
+}
+ALWAYS_INLINE SpanVector SpanSelect(SpanVector mask, SpanVector a, SpanVector b)
+{
+  return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+template<int shift>
+ALWAYS_INLINE SpanVector SpanShiftLeft(SpanVector v)
+{
+  return _mm_slli_epi16(v, shift);
+}
+template<int shift>
+ALWAYS_INLINE SpanVector SpanShiftRight(SpanVector v)
+{
+  return _mm_srli_epi16(v, shift);
+}
+template<int shift>
+ALWAYS_INLINE SpanVector SpanShiftRightArithmetic(SpanVector v)
+{
+  return _mm_srai_epi16(v, shift);
+}
+
+#elif defined(GPU_SW_SIMD_NEON)
+
+using SpanVector = uint16x8_t;
+
+ALWAYS_INLINE SpanVector SpanLoad(const u16* ptr)
+{
+  return vld1q_u16(ptr);
+}
+ALWAYS_INLINE SpanVector SpanLoadBytes(const u8* ptr)
+{
+  return vmovl_u8(vld1_u8(ptr));
+}
+ALWAYS_INLINE void SpanStore(u16* ptr, SpanVector v)
+{
+  vst1q_u16(ptr, v);
+}
+ALWAYS_INLINE SpanVector SpanSplat(u16 value)
+{
+  return vdupq_n_u16(value);
+}
+ALWAYS_INLINE SpanVector SpanAnd(SpanVector a, SpanVector b)
+{
+  return vandq_u16(a, b);
+}
+ALWAYS_INLINE SpanVector SpanAndNot(SpanVector a, SpanVector b)
+{
+  return vbicq_u16(a, b);
+}
+ALWAYS_INLINE SpanVector SpanOr(SpanVector a, SpanVector b)
+{
+  return vorrq_u16(a, b);
+}
+ALWAYS_INLINE SpanVector SpanAdd(SpanVector a, SpanVector b)
+{
+  return vaddq_u16(a, b);
+}
+ALWAYS_INLINE SpanVector SpanSubSaturate(SpanVector a, SpanVector b)
+{
+  return vqsubq_u16(a, b);
+}
+ALWAYS_INLINE SpanVector SpanMul(SpanVector a, SpanVector b)
+{
+  return vmulq_u16(a, b);
+}
+ALWAYS_INLINE SpanVector SpanMin(SpanVector a, SpanVector b)
+{
+  return vreinterpretq_u16_s16(vminq_s16(vreinterpretq_s16_u16(a), vreinterpretq_s16_u16(b)));
+}
+ALWAYS_INLINE SpanVector SpanMax(SpanVector a, SpanVector b)
+{
+  return vreinterpretq_u16_s16(vmaxq_s16(vreinterpretq_s16_u16(a), vreinterpretq_s16_u16(b)));
+}
+ALWAYS_INLINE SpanVector SpanEqual(SpanVector a, SpanVector b)
+{
+  return vceqq_u16(a, b);
+}
+ALWAYS_INLINE SpanVector SpanSelect(SpanVector mask, SpanVector a, SpanVector b)
+{
+  return vbslq_u16(mask, a, b);
+}
+template<int shift>
+ALWAYS_INLINE SpanVector SpanShiftLeft(SpanVector v)
+{
+  return vshlq_n_u16(v, shift);
+}
+template<int shift>
+ALWAYS_INLINE SpanVector SpanShiftRight(SpanVector v)
+{
+  return vshrq_n_u16(v, shift);
+}
+template<int shift>
+ALWAYS_INLINE SpanVector SpanShiftRightArithmetic(SpanVector v)
+{
+  return vreinterpretq_u16_s16(vshrq_n_s16(vreinterpretq_s16_u16(v), shift));
+}
+
+#endif
+
+// All bits set in the lanes whose bit is set in mask.
+ALWAYS_INLINE SpanVector SpanExpandMask(u32 mask)
+{
+  alignas(16) static constexpr u16 lane_bits[8] = {0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80};
+  const SpanVector bits = SpanLoad(lane_bits);
+  return SpanEqual(SpanAnd(SpanSplat(static_cast<u16>(mask)), bits), bits);
+}
+
+// Same as the dither LUT, for 8-bit values or modulated texels.
+ALWAYS_INLINE SpanVector SpanDither(SpanVector value, SpanVector dither)
+{
+  return SpanMin(SpanMax(SpanShiftRightArithmetic<3>(SpanAdd(value, dither)), SpanSplat(0)), SpanSplat(0x1F));
+}
+
+ALWAYS_INLINE SpanVector SpanModulate(SpanVector texel_component, SpanVector color, SpanVector dither)
+{
+  return SpanDither(SpanShiftRight<4>(SpanMul(texel_component, color)), dither);
+}
+
+template<int shift>
+ALWAYS_INLINE SpanVector SpanComponent(SpanVector pixel)
+{
+  if constexpr (shift == 0)
+    return SpanAnd(pixel, SpanSplat(0x1F));
+  else
+    return SpanAnd(SpanShiftRight<shift>(pixel), SpanSplat(0x1F));
+}
+
+ALWAYS_INLINE SpanVector SpanPack(SpanVector r, SpanVector g, SpanVector b, SpanVector c)
+{
+  return SpanOr(SpanOr(r, SpanShiftLeft<5>(g)), SpanOr(SpanShiftLeft<10>(b), c));
+}
+
+template<int shift>
+ALWAYS_INLINE SpanVector SpanBlendComponent(GPU::TransparencyMode mode, SpanVector bg, SpanVector fg)
+{
+  const SpanVector bg_component = SpanComponent<shift>(bg);
+  const SpanVector fg_component = SpanComponent<shift>(fg);
+  switch (mode)
+  {
+    case GPU::TransparencyMode::HalfBackgroundPlusHalfForeground:
+      return SpanAdd(SpanShiftRight<1>(bg_component), SpanShiftRight<1>(fg_component));
+    case GPU::TransparencyMode::BackgroundPlusForeground:
+      return SpanMin(SpanAdd(bg_component, fg_component), SpanSplat(0x1F));
+    case GPU::TransparencyMode::BackgroundMinusForeground:
+      return SpanSubSaturate(bg_component, fg_component);
+    case GPU::TransparencyMode::BackgroundPlusQuarterForeground:
+      return SpanMin(SpanAdd(bg_component, SpanShiftRight<2>(fg_component)), SpanSplat(0x1F));
+    default:
+      return fg_component;
+  }
+}
+
+ALWAYS_INLINE SpanVector SpanBlend(GPU::TransparencyMode mode, SpanVector bg, SpanVector fg)
+{
+  return SpanPack(SpanBlendComponent<0>(mode, bg, fg), SpanBlendComponent<5>(mode, bg, fg),
+                  SpanBlendComponent<10>(mode, bg, fg), SpanAnd(fg, SpanSplat(0x8000)));
+}
+
+} // namespace
+
+#endif
+
+template<bool texture_enable, bool raw_texture_enable, bool transparency_enable, bool dithering_enable>
+void GPU_SW::ShadeSpan(const SWDrawCommand* cmd, TextureCacheEntry* texture, u32 x, u32 y, u32 count, u32 pixel_mask,
+                       const SWSpan& span)
+{
+#if defined(GPU_SW_SIMD_SSE2) || defined(GPU_SW_SIMD_NEON)
+  // Every pixel is read before any is written, so spans which can sample their own output are shaded one at a time.
+  if (count == SPAN_WIDTH && !cmd->samples_own_output)
+  {
+    if (cmd->params.interlaced_rendering && cmd->params.active_line_lsb == (y & 1u))
+      return;
+
+    SpanVector dither;
+    if constexpr (dithering_enable)
+    {
+      alignas(16) u16 dither_values[SPAN_WIDTH];
+      for (u32 i = 0; i < SPAN_WIDTH; i++)
+        dither_values[i] = static_cast<u16>(DITHER_MATRIX[y & 3u][(x + i) & 3u]);
+      dither = SpanLoad(dither_values);
+    }
+    else
+    {
+      dither = SpanSplat(static_cast<u16>(DITHER_MATRIX[2][3]));
+    }
+
+    SpanVector write_mask = SpanExpandMask(pixel_mask);
+    SpanVector color;
+    SpanVector transparent;
+    if constexpr (texture_enable)
+    {
+      alignas(16) u16 texels[SPAN_WIDTH];
+      for (u32 i = 0; i < SPAN_WIDTH; i++)
+      {
+        texels[i] =
+          (pixel_mask & (1u << i)) ? SampleTexture(cmd, texture, span.texcoord_x[i], span.texcoord_y[i]) : 0;
+      }
+
+      const SpanVector texel = SpanLoad(texels);
+      const SpanVector texel_c = SpanAnd(texel, SpanSplat(0x8000));
+      write_mask = SpanAndNot(write_mask, SpanEqual(texel, SpanSplat(0)));
+      transparent = SpanAndNot(SpanSplat(0xFFFF), SpanEqual(texel_c, SpanSplat(0)));
+
+      if constexpr (raw_texture_enable)
+      {
+        color = texel;
+      }
+      else
+      {
+        color = SpanPack(SpanModulate(SpanComponent<0>(texel), SpanLoadBytes(span.r), dither),
+                         SpanModulate(SpanComponent<5>(texel), SpanLoadBytes(span.g), dither),
+                         SpanModulate(SpanComponent<10>(texel), SpanLoadBytes(span.b), dither), texel_c);
+      }
+    }
+    else
+    {
+      transparent = SpanSplat(0xFFFF);
+      color = SpanPack(SpanDither(SpanLoadBytes(span.r), dither), SpanDither(SpanLoadBytes(span.g), dither),
+                       SpanDither(SpanLoadBytes(span.b), dither), SpanSplat(0));
+    }
+
+    u16* vram_ptr = GetPixelPtr(x, y);
+    const SpanVector bg_color = SpanLoad(vram_ptr);
+    if constexpr (transparency_enable)
+      color = SpanSelect(transparent, SpanBlend(cmd->transparency_mode, bg_color, color), color);
+    else
+      UNREFERENCED_VARIABLE(transparent);
+
+    write_mask = SpanAnd(write_mask, SpanEqual(SpanAnd(bg_color, SpanSplat(cmd->params.mask_and)),
+                                               SpanSplat(0)));
+    color = SpanOr(color, SpanSplat(cmd->params.mask_or));
+    SpanStore(vram_ptr, SpanSelect(write_mask, color, bg_color));
     return;
+  }
+#endif
+
+  for (u32 i = 0; i < count; i++)
+  {
+    if (pixel_mask & (1u << i))
+    {
+      ShadePixel<texture_enable, raw_texture_enable, transparency_enable, dithering_enable>(
+        cmd, texture, x + i, y, span.r[i], span.g[i], span.b[i], span.texcoord_x[i], span.texcoord_y[i]);
+    }
+  }
+}
+
+GPU_SW::ShadeSpanFunction GPU_SW::GetShadeSpanFunction(bool texture_enable, bool raw_texture_enable,
+                                                       bool transparency_enable, bool dithering_enable)
+{
+#define F(TEXTURE, RAW_TEXTURE, TRANSPARENCY, DITHERING)                                                               \
+  &GPU_SW::ShadeSpan<TEXTURE, RAW_TEXTURE, TRANSPARENCY, DITHERING>
+
+  static constexpr ShadeSpanFunction funcs[2][2][2][2] = {
+    {{{F(false, false, false, false), F(false, false, false, true)},
+      {F(false, false, true, false), F(false, false, true, true)}},
+     {{F(false, true, false, false), F(false, true, false, true)},
+      {F(false, true, true, false), F(false, true, true, true)}}},
+    {{{F(true, false, false, false), F(true, false, false, true)},
+      {F(true, false, true, false), F(true, false, true, true)}},
+     {{F(true, true, false, false), F(true, true, false, true)},
+      {F(true, true, true, false), F(true, true, true, true)}}}};
+
+#undef F
 
-  SetPixel(static_cast<u32>(x), static_cast<u32>(y), color.bits | m_GPUSTAT.GetMaskOR());
+  return funcs[u8(texture_enable)][u8(raw_texture_enable)][u8(transparency_enable)][u8(dithering_enable)];
 }
 
 constexpr FixedPointCoord GetLineCoordStep(s32 delta, s32 k)
@@ -749,8 +1965,42 @@ constexpr FixedPointColor GetLineColorStep(s32 delta, s32 k)
   return static_cast<s32>(static_cast<u32>(delta) << COLOR_FRAC_BITS) / k;
 }
 
+void GPU_SW::AddLineTicks(const SWVertex* p0, const SWVertex* p1, RenderCommand rc)
+{
+  // TODO: Move to base class
+  const s32 min_x = std::min(p0->x, p1->x);
+  const s32 max_x = std::max(p0->x, p1->x);
+  const s32 min_y = std::min(p0->y, p1->y);
+  const s32 max_y = std::max(p0->y, p1->y);
+
+  const u32 clip_left = static_cast<u32>(std::clamp<s32>(min_x, m_drawing_area.left, m_drawing_area.left));
+  const u32 clip_right = static_cast<u32>(std::clamp<s32>(max_x, m_drawing_area.left, m_drawing_area.right)) + 1u;
+  const u32 clip_top = static_cast<u32>(std::clamp<s32>(min_y, m_drawing_area.top, m_drawing_area.bottom));
+  const u32 clip_bottom = static_cast<u32>(std::clamp<s32>(max_y, m_drawing_area.top, m_drawing_area.bottom)) + 1u;
+
+  AddDrawLineTicks(clip_right - clip_left, clip_bottom - clip_top, rc.shading_enable);
+}
+
+void GPU_SW::IncludeLineBounds(const SWVertex* p0, const SWVertex* p1, Common::Rectangle<u32>* bounds) const
+{
+  // The rasterizer's fixed-point steps never move past the end points.
+  const s32 min_x = std::min(p0->x, p1->x) + m_drawing_offset.x;
+  const s32 max_x = std::max(p0->x, p1->x) + m_drawing_offset.x;
+  const s32 min_y = std::min(p0->y, p1->y) + m_drawing_offset.y;
+  const s32 max_y = std::max(p0->y, p1->y) + m_drawing_offset.y;
+  const s32 left = static_cast<s32>(m_drawing_area.left);
+  const s32 right = static_cast<s32>(m_drawing_area.right) + 1;
+  const s32 top = static_cast<s32>(m_drawing_area.top);
+  const s32 bottom = static_cast<s32>(m_drawing_area.bottom) + 1;
+
+  bounds->Include(static_cast<u32>(std::clamp<s32>(min_x, left, right)),
+                  static_cast<u32>(std::clamp<s32>(max_x + 1, left, right)),
+                  static_cast<u32>(std::clamp<s32>(min_y, top, bottom)),
+                  static_cast<u32>(std::clamp<s32>(max_y + 1, top, bottom)));
+}
+
 template<bool shading_enable, bool transparency_enable, bool dithering_enable>
-void GPU_SW::DrawLine(const SWVertex* p0, const SWVertex* p1)
+void GPU_SW::DrawLine(const SWDrawCommand* cmd, const SWVertex* p0, const SWVertex* p1)
 {
   // Algorithm based on Mednafen.
   if (p0->x > p1->x)
@@ -760,21 +2010,6 @@ void GPU_SW::DrawLine(const SWVertex* p0, const SWVertex* p1)
   const s32 dy = p1->y - p0->y;
   const s32 k = std::max(std::abs(dx), std::abs(dy));
 
-  {
-    // TODO: Move to base class
-    const s32 min_x = std::min(p0->x, p1->x);
-    const s32 max_x = std::max(p0->x, p1->x);
-    const s32 min_y = std::min(p0->y, p1->y);
-    const s32 max_y = std::max(p0->y, p1->y);
-
-    const u32 clip_left = static_cast<u32>(std::clamp<s32>(min_x, m_drawing_area.left, m_drawing_area.left));
-    const u32 clip_right = static_cast<u32>(std::clamp<s32>(max_x, m_drawing_area.left, m_drawing_area.right)) + 1u;
-    const u32 clip_top = static_cast<u32>(std::clamp<s32>(min_y, m_drawing_area.top, m_drawing_area.bottom));
-    const u32 clip_bottom = static_cast<u32>(std::clamp<s32>(max_y, m_drawing_area.top, m_drawing_area.bottom)) + 1u;
-
-    AddDrawLineTicks(clip_right - clip_left, clip_bottom - clip_top, shading_enable);
-  }
-
   FixedPointCoord step_x, step_y;
   FixedPointColor step_r, step_g, step_b;
   if (k > 0)
@@ -812,18 +2047,19 @@ void GPU_SW::DrawLine(const SWVertex* p0, const SWVertex* p1)
 
   for (s32 i = 0; i <= k; i++)
   {
-    const s32 x = m_drawing_offset.x + FixedToIntCoord(current_x);
-    const s32 y = m_drawing_offset.y + FixedToIntCoord(current_y);
+    const s32 x = cmd->drawing_offset.x + FixedToIntCoord(current_x);
+    const s32 y = cmd->drawing_offset.y + FixedToIntCoord(current_y);
 
     const u8 r = shading_enable ? FixedColorToInt(current_r) : p0->color_r;
     const u8 g = shading_enable ? FixedColorToInt(current_g) : p0->color_g;
     const u8 b = shading_enable ? FixedColorToInt(current_b) : p0->color_b;
 
-    if (x >= static_cast<s32>(m_drawing_area.left) && x <= static_cast<s32>(m_drawing_area.right) &&
-        y >= static_cast<s32>(m_drawing_area.top) && y <= static_cast<s32>(m_drawing_area.bottom))
+    if (x >= static_cast<s32>(cmd->drawing_area.left) && x <= static_cast<s32>(cmd->drawing_area.right) &&
+        y >= static_cast<s32>(cmd->drawing_area.top) && y <= static_cast<s32>(cmd->drawing_area.bottom) &&
+        IsRowInBands(cmd->params.band_mask, static_cast<u32>(y)))
     {
-      ShadePixel<false, false, transparency_enable, dithering_enable>(static_cast<u32>(x), static_cast<u32>(y), r, g, b,
-                                                                      0, 0);
+      ShadePixel<false, false, transparency_enable, dithering_enable>(cmd, nullptr, static_cast<u32>(x),
+                                                                      static_cast<u32>(y), r, g, b, 0, 0);
     }
 
     current_x += step_x;
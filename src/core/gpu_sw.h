@@ -1,13 +1,23 @@
 #pragma once
+#include "common/spsc_ring_buffer.h"
 #include "gpu.h"
 #include <array>
+#include <atomic>
+#include <bitset>
+#include <condition_variable>
 #include <memory>
+#include <mutex>
+#include <thread>
 #include <vector>
 
 class HostDisplayTexture;
+class GPU_SWTest;
 
 class GPU_SW final : public GPU
 {
+  // Drives the rasterizer directly in core-tests, without a System.
+  friend GPU_SWTest;
+
 public:
   GPU_SW();
   ~GPU_SW() override;
@@ -17,6 +27,7 @@ public:
   bool Initialize(HostDisplay* host_display, System* system, DMA* dma, InterruptController* interrupt_controller,
                   Timers* timers) override;
   void Reset() override;
+  void UpdateSettings() override;
 
   u16 GetPixel(u32 x, u32 y) const { return m_vram[VRAM_WIDTH * y + x]; }
   const u16* GetPixelPtr(u32 x, u32 y) const { return &m_vram[VRAM_WIDTH * y + x]; }
@@ -45,6 +56,249 @@ protected:
     ALWAYS_INLINE void SetTexcoord(u16 value) { std::tie(texcoord_x, texcoord_y) = UnpackTexcoord(value); }
   };
 
+  //////////////////////////////////////////////////////////////////////////
+  // Commands
+  //////////////////////////////////////////////////////////////////////////
+
+  // Everything which modifies VRAM goes through a command, which carries a copy of the state it depends on. Commands
+  // are executed immediately, or queued for the render threads when they are enabled. Command parsing and timing stay
+  // on the CPU thread, so the emulated timing does not depend on whether the threads are used.
+  //
+  // With more than one render thread, VRAM rows are split into bands which are interleaved between the threads. Each
+  // command is only queued for the threads owning the rows it writes to, and each thread only writes to its own rows,
+  // so the order of commands within a band is preserved. Commands which read rows belonging to other threads (texture
+  // sampling, VRAM copies) are separated from the commands they depend on by barriers.
+  enum : u32
+  {
+    COMMAND_QUEUE_SIZE = 4 * 1024 * 1024,
+
+    // How long the render threads wait for more commands before going to sleep.
+    THREAD_SPIN_TIME_NS = 100 * 1000,
+
+    MAX_THREADS = 8,
+    BAND_HEIGHT = 8,
+    NUM_BANDS = VRAM_HEIGHT / BAND_HEIGHT
+  };
+
+  /// Bit N is set if the rows in band N are included.
+  using BandMask = u64;
+  static constexpr BandMask ALL_BANDS = ~static_cast<BandMask>(0);
+  static_assert(NUM_BANDS == (sizeof(BandMask) * 8), "band mask covers all bands");
+
+  static BandMask GetBandMaskForRows(u32 top, u32 bottom);
+  ALWAYS_INLINE static bool IsRowInBands(BandMask band_mask, u32 y)
+  {
+    return ((band_mask >> (y / BAND_HEIGHT)) & 1) != 0;
+  }
+
+  enum class SWCommandType : u8
+  {
+    FillVRAM,
+    UpdateVRAM,
+    CopyVRAM,
+    DrawPolygon,
+    DrawRectangle,
+    DrawLine,
+    Barrier
+  };
+
+  struct SWCommandParameters
+  {
+    BandMask band_mask;
+    u16 mask_and;
+    u16 mask_or;
+    bool interlaced_rendering;
+    u8 active_line_lsb;
+  };
+
+  struct SWCommand
+  {
+    SWCommandType type;
+    SWCommandParameters params;
+  };
+
+  struct SWFillVRAMCommand : SWCommand
+  {
+    u32 x, y, width, height;
+    u32 color;
+  };
+
+  struct SWUpdateVRAMCommand : SWCommand
+  {
+    u32 x, y, width, height;
+
+    // Followed by width * height pixels.
+    u16* GetData() { return reinterpret_cast<u16*>(this + 1); }
+    const u16* GetData() const { return reinterpret_cast<const u16*>(this + 1); }
+  };
+
+  struct SWCopyVRAMCommand : SWCommand
+  {
+    u32 src_x, src_y, dst_x, dst_y, width, height;
+  };
+
+  struct SWDrawCommand : SWCommand
+  {
+    RenderCommand rc;
+    bool dithering_enable;
+    TextureMode texture_mode;
+    TransparencyMode transparency_mode;
+    u8 texture_window_mask_x;
+    u8 texture_window_mask_y;
+    u8 texture_window_offset_x;
+    u8 texture_window_offset_y;
+    u32 texture_page_x;
+    u32 texture_page_y;
+    u32 texture_palette_x;
+    u32 texture_palette_y;
+    Common::Rectangle<u32> drawing_area;
+    DrawingOffset drawing_offset;
+
+    // Set when the texture page or palette overlaps the area being drawn to, so pixels must be shaded in order.
+    bool samples_own_output;
+
+    // Last write to the texture page or palette when the command was issued, see GetTextureGeneration().
+    u64 texture_generation;
+  };
+
+  struct SWDrawPolygonCommand : SWDrawCommand
+  {
+    u32 num_vertices;
+    std::array<SWVertex, 4> vertices;
+  };
+
+  struct SWDrawRectangleCommand : SWDrawCommand
+  {
+    s32 x, y;
+    u32 width, height;
+    u8 r, g, b;
+    u8 texcoord_x, texcoord_y;
+  };
+
+  struct SWDrawLineCommand : SWDrawCommand
+  {
+    u32 num_vertices;
+
+    // Followed by num_vertices vertices.
+    SWVertex* GetVertices() { return reinterpret_cast<SWVertex*>(this + 1); }
+    const SWVertex* GetVertices() const { return reinterpret_cast<const SWVertex*>(this + 1); }
+  };
+
+  SWCommandParameters GetCommandParameters() const;
+  void FillDrawCommand(SWDrawCommand* cmd, RenderCommand rc, bool dithering_enable) const;
+
+  /// Returns space for a command of the specified size. The command is not executed until it is pushed, and can be
+  /// dropped by not pushing it.
+  template<typename T>
+  T* AllocateCommand(SWCommandType type, u32 size);
+
+  /// Executes or queues a command which only writes to the specified area of VRAM.
+  void PushCommand(SWCommand* cmd, u32 size, const Common::Rectangle<u32>& bounds);
+
+  /// Executes or queues a draw command, which may also sample from any part of VRAM.
+  void PushDrawCommand(SWDrawCommand* cmd, u32 size, const Common::Rectangle<u32>& bounds);
+
+  /// Executes or queues a command which can access any part of VRAM, so it runs on one thread while the others wait.
+  void PushExclusiveCommand(SWCommand* cmd, u32 size);
+  void BeginExclusiveCommand();
+  void EndExclusiveCommand();
+
+  //////////////////////////////////////////////////////////////////////////
+  // Texture cache
+  //////////////////////////////////////////////////////////////////////////
+
+  // Palettized texture pages are sampled through a cache of the page combined with its palette, so each texel is a
+  // single lookup. Rows of the page are decoded the first time they are sampled. Each render thread has its own cache.
+  //
+  // Writes to VRAM are tracked in regions, each of which records the value of a counter when it was last written to.
+  // Draw commands carry the latest value of the regions they sample from when they are issued, which a cached page
+  // must match to be used. This keeps the cache consistent with the order commands are issued in, regardless of how
+  // far behind the render threads are.
+  enum : u32
+  {
+    TEXTURE_CACHE_SIZE = 16,
+    TEXTURE_REGION_WIDTH = 64,
+    TEXTURE_REGION_HEIGHT = 16,
+    TEXTURE_REGIONS_X = VRAM_WIDTH / TEXTURE_REGION_WIDTH,
+    TEXTURE_REGIONS_Y = VRAM_HEIGHT / TEXTURE_REGION_HEIGHT
+  };
+
+  struct TextureCacheEntry
+  {
+    TextureMode texture_mode;
+    u32 texture_page_x;
+    u32 texture_page_y;
+    u32 texture_palette_x;
+    u32 texture_palette_y;
+    u64 generation;
+    u32 last_used;
+    std::bitset<TEXTURE_PAGE_HEIGHT> valid_rows;
+    std::array<u16, TEXTURE_PAGE_WIDTH * TEXTURE_PAGE_HEIGHT> texels;
+  };
+
+  struct TextureCache
+  {
+    std::array<TextureCacheEntry, TEXTURE_CACHE_SIZE> entries = {};
+    u32 use_counter = 0;
+  };
+
+  /// Marks the area as written to, so pages which sample from it are decoded again. Wraps around the edges of VRAM.
+  void InvalidateTextureCache(u32 x, u32 y, u32 width, u32 height);
+  void InvalidateTextureCache(const Common::Rectangle<u32>& rect);
+  u64 GetTextureGeneration(const Common::Rectangle<u32>& rect) const;
+
+  /// Returns the cached page for a draw command, or nullptr if it samples from VRAM directly.
+  TextureCacheEntry* GetTextureCacheEntry(TextureCache* cache, const SWDrawCommand* cmd);
+  void DecodeTextureRow(const SWDrawCommand* cmd, TextureCacheEntry* entry, u8 texcoord_y) const;
+
+  void ExecuteCommand(const SWCommand* cmd, TextureCache* texture_cache);
+
+  //////////////////////////////////////////////////////////////////////////
+  // Render threads
+  //////////////////////////////////////////////////////////////////////////
+  struct RenderThread
+  {
+    TextureCache texture_cache;
+    SPSCRingBuffer queue{COMMAND_QUEUE_SIZE};
+    std::thread thread;
+    std::condition_variable wake_cv;
+    std::atomic_bool sleeping{false};
+    std::atomic<u32> barrier_count{0};
+    BandMask band_mask = 0;
+  };
+
+  bool IsUsingThread() const { return !m_threads.empty(); }
+  u32 GetDesiredThreadCount() const;
+  void StartThreads(u32 count);
+  void StopThreads();
+  void WakeThread(RenderThread* thread);
+  void ThreadEntryPoint(RenderThread* thread);
+
+  void* BeginThreadWrite(RenderThread* thread, u32 size);
+  void EndThreadWrite(RenderThread* thread);
+  void QueueCommand(RenderThread* thread, const SWCommand* cmd, u32 size, BandMask band_mask);
+
+  /// Queues a barrier for all threads, so that no thread executes the following commands until every thread has
+  /// executed the preceding ones.
+  void PushBarrier();
+  void WaitForBarrier(RenderThread* thread);
+
+  /// Waits for the render threads to execute all queued commands, so VRAM can be accessed.
+  void Sync();
+
+  //////////////////////////////////////////////////////////////////////////
+  // VRAM
+  //////////////////////////////////////////////////////////////////////////
+  void ReadVRAM(u32 x, u32 y, u32 width, u32 height) override;
+  void FillVRAM(u32 x, u32 y, u32 width, u32 height, u32 color) override;
+  void UpdateVRAM(u32 x, u32 y, u32 width, u32 height, const void* data) override;
+  void CopyVRAM(u32 src_x, u32 src_y, u32 dst_x, u32 dst_y, u32 width, u32 height) override;
+
+  void FillVRAMImpl(u32 x, u32 y, u32 width, u32 height, u32 color, const SWCommandParameters& params);
+  void UpdateVRAMImpl(u32 x, u32 y, u32 width, u32 height, const void* data, const SWCommandParameters& params);
+  void CopyVRAMImpl(u32 src_x, u32 src_y, u32 dst_x, u32 dst_y, u32 width, u32 height,
+                    const SWCommandParameters& params);
+
   //////////////////////////////////////////////////////////////////////////
   // Scanout
   //////////////////////////////////////////////////////////////////////////
@@ -58,38 +312,104 @@ protected:
   // Rasterization
   //////////////////////////////////////////////////////////////////////////
 
-  void DispatchRenderCommand() override;
+  void DispatchRenderCommand(const u32* words) override;
 
   static bool IsClockwiseWinding(const SWVertex* v0, const SWVertex* v1, const SWVertex* v2);
 
+  /// Computes the bounds of a triangle clipped to the drawing area. Returns false if the triangle is culled.
+  static bool GetClippedTriangleBounds(s32 px0, s32 py0, s32 px1, s32 py1, s32 px2, s32 py2,
+                                       const Common::Rectangle<u32>& drawing_area, s32* min_x, s32* max_x, s32* min_y,
+                                       s32* max_y);
+
+  // Timing is computed when the command is dispatched, since the rasterizer may run on another thread.
+  void AddTriangleTicks(const SWVertex* v0, const SWVertex* v1, const SWVertex* v2, RenderCommand rc,
+                        Common::Rectangle<u32>* bounds);
+  void AddRectangleTicks(s32 origin_x, s32 origin_y, u32 width, u32 height, RenderCommand rc);
+  void AddLineTicks(const SWVertex* p0, const SWVertex* p1, RenderCommand rc);
+
+  // Areas of VRAM which primitives can write to with the current drawing offset and area, so they can be distributed
+  // between the render threads. Triangle bounds are included by AddTriangleTicks().
+  Common::Rectangle<u32> GetRectangleBounds(s32 origin_x, s32 origin_y, u32 width, u32 height) const;
+  void IncludeLineBounds(const SWVertex* p0, const SWVertex* p1, Common::Rectangle<u32>* bounds) const;
+
+  // Rows of triangles and rectangles are shaded in spans of horizontally adjacent pixels.
+  static constexpr u32 SPAN_WIDTH = 8;
+
+  struct SWSpan
+  {
+    u8 r[SPAN_WIDTH];
+    u8 g[SPAN_WIDTH];
+    u8 b[SPAN_WIDTH];
+    u8 texcoord_x[SPAN_WIDTH];
+    u8 texcoord_y[SPAN_WIDTH];
+  };
+
+  u16 ReadTexel(const SWDrawCommand* cmd, u8 texcoord_x, u8 texcoord_y) const;
+  u16 SampleTexture(const SWDrawCommand* cmd, TextureCacheEntry* texture, u8 texcoord_x, u8 texcoord_y) const;
+
+  template<bool texture_enable, bool raw_texture_enable, bool transparency_enable, bool dithering_enable>
+  void ShadePixel(const SWDrawCommand* cmd, TextureCacheEntry* texture, u32 x, u32 y, u8 color_r, u8 color_g,
+                  u8 color_b, u8 texcoord_x, u8 texcoord_y);
+
+  /// Shades the first count pixels of the span starting at (x, y), skipping those which are not set in pixel_mask.
+  /// Full spans are shaded with SIMD where it is available, and every pixel of them must be within the primitive's
+  /// bounds, even when it is not covered.
   template<bool texture_enable, bool raw_texture_enable, bool transparency_enable, bool dithering_enable>
-  void ShadePixel(u32 x, u32 y, u8 color_r, u8 color_g, u8 color_b, u8 texcoord_x, u8 texcoord_y);
+  void ShadeSpan(const SWDrawCommand* cmd, TextureCacheEntry* texture, u32 x, u32 y, u32 count, u32 pixel_mask,
+                 const SWSpan& span);
+
+  using ShadeSpanFunction = void (GPU_SW::*)(const SWDrawCommand* cmd, TextureCacheEntry* texture, u32 x, u32 y,
+                                             u32 count, u32 pixel_mask, const SWSpan& span);
+  ShadeSpanFunction GetShadeSpanFunction(bool texture_enable, bool raw_texture_enable, bool transparency_enable,
+                                         bool dithering_enable);
 
   template<bool shading_enable, bool texture_enable, bool raw_texture_enable, bool transparency_enable,
            bool dithering_enable>
-  void DrawTriangle(const SWVertex* v0, const SWVertex* v1, const SWVertex* v2);
+  void DrawTriangle(const SWDrawCommand* cmd, TextureCacheEntry* texture, const SWVertex* v0, const SWVertex* v1,
+                    const SWVertex* v2);
 
-  using DrawTriangleFunction = void (GPU_SW::*)(const SWVertex* v0, const SWVertex* v1, const SWVertex* v2);
+  using DrawTriangleFunction = void (GPU_SW::*)(const SWDrawCommand* cmd, TextureCacheEntry* texture,
+                                                const SWVertex* v0, const SWVertex* v1, const SWVertex* v2);
   DrawTriangleFunction GetDrawTriangleFunction(bool shading_enable, bool texture_enable, bool raw_texture_enable,
                                                bool transparency_enable, bool dithering_enable);
 
   template<bool texture_enable, bool raw_texture_enable, bool transparency_enable>
-  void DrawRectangle(s32 origin_x, s32 origin_y, u32 width, u32 height, u8 r, u8 g, u8 b, u8 origin_texcoord_x,
-                     u8 origin_texcoord_y);
+  void DrawRectangle(const SWDrawCommand* cmd, TextureCacheEntry* texture, s32 origin_x, s32 origin_y, u32 width,
+                     u32 height, u8 r, u8 g, u8 b, u8 origin_texcoord_x, u8 origin_texcoord_y);
 
-  using DrawRectangleFunction = void (GPU_SW::*)(s32 origin_x, s32 origin_y, u32 width, u32 height, u8 r, u8 g, u8 b,
+  using DrawRectangleFunction = void (GPU_SW::*)(const SWDrawCommand* cmd, TextureCacheEntry* texture, s32 origin_x,
+                                                 s32 origin_y, u32 width, u32 height, u8 r, u8 g, u8 b,
                                                  u8 origin_texcoord_x, u8 origin_texcoord_y);
   DrawRectangleFunction GetDrawRectangleFunction(bool texture_enable, bool raw_texture_enable,
                                                  bool transparency_enable);
 
   template<bool shading_enable, bool transparency_enable, bool dithering_enable>
-  void DrawLine(const SWVertex* p0, const SWVertex* p1);
+  void DrawLine(const SWDrawCommand* cmd, const SWVertex* p0, const SWVertex* p1);
 
-  using DrawLineFunction = void (GPU_SW::*)(const SWVertex* p0, const SWVertex* p1);
+  using DrawLineFunction = void (GPU_SW::*)(const SWDrawCommand* cmd, const SWVertex* p0, const SWVertex* p1);
   DrawLineFunction GetDrawLineFunction(bool shading_enable, bool transparency_enable, bool dithering_enable);
 
   std::vector<u32> m_display_texture_buffer;
   std::unique_ptr<HostDisplayTexture> m_display_texture;
 
   std::array<u16, VRAM_WIDTH * VRAM_HEIGHT> m_vram;
+
+  // Holds the command being built, before it is executed or copied to the render threads' queues.
+  std::vector<u8> m_command_buffer;
+
+  std::vector<std::unique_ptr<RenderThread>> m_threads;
+  std::mutex m_thread_mutex;
+  std::condition_variable m_thread_idle_cv;
+  std::atomic_bool m_thread_sync_pending{false};
+  bool m_thread_shutdown = false;
+
+  // Areas written and sampled by queued commands since the threads last waited for each other.
+  Common::Rectangle<u32> m_thread_dirty_rect;
+  Common::Rectangle<u32> m_thread_texture_rect;
+
+  // Used when commands are executed on the CPU thread.
+  TextureCache m_texture_cache;
+
+  u64 m_texture_write_counter = 0;
+  std::array<u64, TEXTURE_REGIONS_X * TEXTURE_REGIONS_Y> m_texture_region_generations = {};
 };
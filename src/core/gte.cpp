@@ -1,8 +1,17 @@
 #include "gte.h"
 #include "common/bitutils.h"
+#include "common/cpu_detect.h"
 #include <algorithm>
 #include <array>
 
+#if defined(CPU_X64)
+#include <emmintrin.h>
+#define GTE_SIMD_SSE2 1
+#elif defined(CPU_AARCH64)
+#include <arm_neon.h>
+#define GTE_SIMD_NEON 1
+#endif
+
 ALWAYS_INLINE u32 CountLeadingBits(u32 value)
 {
   // if top-most bit is set, we want to count ones not zeros
@@ -20,6 +29,20 @@ Core::~Core() = default;
 
 void Core::Initialize() {}
 
+bool Core::IsSIMDSupported()
+{
+#if defined(GTE_SIMD_SSE2) || defined(GTE_SIMD_NEON)
+  return true;
+#else
+  return false;
+#endif
+}
+
+void Core::SetUseSIMD(bool enable)
+{
+  m_use_simd = enable && IsSIMDSupported();
+}
+
 void Core::Reset()
 {
   std::memset(&m_regs, 0, sizeof(m_regs));
@@ -253,6 +276,65 @@ void Core::ExecuteInstruction(Instruction inst)
   }
 }
 
+template<void (Core::*handler)(Instruction)>
+void Core::ExecuteHandler(Core* gte, u32 instruction_bits)
+{
+  (gte->*handler)(Instruction{instruction_bits});
+}
+
+Core::InstructionHandler Core::GetInstructionHandler(Instruction inst)
+{
+  switch (inst.command)
+  {
+    case 0x01:
+      return &ExecuteHandler<&Core::Execute_RTPS>;
+    case 0x06:
+      return &ExecuteHandler<&Core::Execute_NCLIP>;
+    case 0x0C:
+      return &ExecuteHandler<&Core::Execute_OP>;
+    case 0x10:
+      return &ExecuteHandler<&Core::Execute_DPCS>;
+    case 0x11:
+      return &ExecuteHandler<&Core::Execute_INTPL>;
+    case 0x12:
+      return &ExecuteHandler<&Core::Execute_MVMVA>;
+    case 0x13:
+      return &ExecuteHandler<&Core::Execute_NCDS>;
+    case 0x14:
+      return &ExecuteHandler<&Core::Execute_CDP>;
+    case 0x16:
+      return &ExecuteHandler<&Core::Execute_NCDT>;
+    case 0x1B:
+      return &ExecuteHandler<&Core::Execute_NCCS>;
+    case 0x1C:
+      return &ExecuteHandler<&Core::Execute_CC>;
+    case 0x1E:
+      return &ExecuteHandler<&Core::Execute_NCS>;
+    case 0x20:
+      return &ExecuteHandler<&Core::Execute_NCT>;
+    case 0x28:
+      return &ExecuteHandler<&Core::Execute_SQR>;
+    case 0x29:
+      return &ExecuteHandler<&Core::Execute_DCPL>;
+    case 0x2A:
+      return &ExecuteHandler<&Core::Execute_DPCT>;
+    case 0x2D:
+      return &ExecuteHandler<&Core::Execute_AVSZ3>;
+    case 0x2E:
+      return &ExecuteHandler<&Core::Execute_AVSZ4>;
+    case 0x30:
+      return &ExecuteHandler<&Core::Execute_RTPT>;
+    case 0x3D:
+      return &ExecuteHandler<&Core::Execute_GPF>;
+    case 0x3E:
+      return &ExecuteHandler<&Core::Execute_GPL>;
+    case 0x3F:
+      return &ExecuteHandler<&Core::Execute_NCCT>;
+    default:
+      return nullptr;
+  }
+}
+
 void Core::SetOTZ(s32 value)
 {
   if (value < 0)
@@ -331,6 +413,26 @@ void Core::PushRGBFromMAC()
   m_regs.dr32[22] = r | (g << 8) | (b << 16) | (c << 24); // RGB2 <- Value
 }
 
+const std::array<u8, 257> Core::s_unr_table = {{
+  0xFF, 0xFD, 0xFB, 0xF9, 0xF7, 0xF5, 0xF3, 0xF1, 0xEF, 0xEE, 0xEC, 0xEA, 0xE8, 0xE6, 0xE4, 0xE3, //
+  0xE1, 0xDF, 0xDD, 0xDC, 0xDA, 0xD8, 0xD6, 0xD5, 0xD3, 0xD1, 0xD0, 0xCE, 0xCD, 0xCB, 0xC9, 0xC8, //  00h..3Fh
+  0xC6, 0xC5, 0xC3, 0xC1, 0xC0, 0xBE, 0xBD, 0xBB, 0xBA, 0xB8, 0xB7, 0xB5, 0xB4, 0xB2, 0xB1, 0xB0, //
+  0xAE, 0xAD, 0xAB, 0xAA, 0xA9, 0xA7, 0xA6, 0xA4, 0xA3, 0xA2, 0xA0, 0x9F, 0x9E, 0x9C, 0x9B, 0x9A, //
+  0x99, 0x97, 0x96, 0x95, 0x94, 0x92, 0x91, 0x90, 0x8F, 0x8D, 0x8C, 0x8B, 0x8A, 0x89, 0x87, 0x86, //
+  0x85, 0x84, 0x83, 0x82, 0x81, 0x7F, 0x7E, 0x7D, 0x7C, 0x7B, 0x7A, 0x79, 0x78, 0x77, 0x75, 0x74, //  40h..7Fh
+  0x73, 0x72, 0x71, 0x70, 0x6F, 0x6E, 0x6D, 0x6C, 0x6B, 0x6A, 0x69, 0x68, 0x67, 0x66, 0x65, 0x64, //
+  0x63, 0x62, 0x61, 0x60, 0x5F, 0x5E, 0x5D, 0x5D, 0x5C, 0x5B, 0x5A, 0x59, 0x58, 0x57, 0x56, 0x55, //
+  0x54, 0x53, 0x53, 0x52, 0x51, 0x50, 0x4F, 0x4E, 0x4D, 0x4D, 0x4C, 0x4B, 0x4A, 0x49, 0x48, 0x48, //
+  0x47, 0x46, 0x45, 0x44, 0x43, 0x43, 0x42, 0x41, 0x40, 0x3F, 0x3F, 0x3E, 0x3D, 0x3C, 0x3C, 0x3B, //  80h..BFh
+  0x3A, 0x39, 0x39, 0x38, 0x37, 0x36, 0x36, 0x35, 0x34, 0x33, 0x33, 0x32, 0x31, 0x31, 0x30, 0x2F, //
+  0x2E, 0x2E, 0x2D, 0x2C, 0x2C, 0x2B, 0x2A, 0x2A, 0x29, 0x28, 0x28, 0x27, 0x26, 0x26, 0x25, 0x24, //
+  0x24, 0x23, 0x22, 0x22, 0x21, 0x20, 0x20, 0x1F, 0x1E, 0x1E, 0x1D, 0x1D, 0x1C, 0x1B, 0x1B, 0x1A, //
+  0x19, 0x19, 0x18, 0x18, 0x17, 0x16, 0x16, 0x15, 0x15, 0x14, 0x14, 0x13, 0x12, 0x12, 0x11, 0x11, //  C0h..FFh
+  0x10, 0x0F, 0x0F, 0x0E, 0x0E, 0x0D, 0x0D, 0x0C, 0x0C, 0x0B, 0x0A, 0x0A, 0x09, 0x09, 0x08, 0x08, //
+  0x07, 0x07, 0x06, 0x06, 0x05, 0x05, 0x04, 0x04, 0x03, 0x03, 0x02, 0x02, 0x01, 0x01, 0x00, 0x00, //
+  0x00 // <-- one extra table entry (for "(d-7FC0h)/80h"=100h)
+}};
+
 u32 Core::UNRDivide(u32 lhs, u32 rhs)
 {
   if (rhs * 2 <= lhs)
@@ -343,28 +445,8 @@ u32 Core::UNRDivide(u32 lhs, u32 rhs)
   lhs <<= shift;
   rhs <<= shift;
 
-  static constexpr std::array<u8, 257> unr_table = {{
-    0xFF, 0xFD, 0xFB, 0xF9, 0xF7, 0xF5, 0xF3, 0xF1, 0xEF, 0xEE, 0xEC, 0xEA, 0xE8, 0xE6, 0xE4, 0xE3, //
-    0xE1, 0xDF, 0xDD, 0xDC, 0xDA, 0xD8, 0xD6, 0xD5, 0xD3, 0xD1, 0xD0, 0xCE, 0xCD, 0xCB, 0xC9, 0xC8, //  00h..3Fh
-    0xC6, 0xC5, 0xC3, 0xC1, 0xC0, 0xBE, 0xBD, 0xBB, 0xBA, 0xB8, 0xB7, 0xB5, 0xB4, 0xB2, 0xB1, 0xB0, //
-    0xAE, 0xAD, 0xAB, 0xAA, 0xA9, 0xA7, 0xA6, 0xA4, 0xA3, 0xA2, 0xA0, 0x9F, 0x9E, 0x9C, 0x9B, 0x9A, //
-    0x99, 0x97, 0x96, 0x95, 0x94, 0x92, 0x91, 0x90, 0x8F, 0x8D, 0x8C, 0x8B, 0x8A, 0x89, 0x87, 0x86, //
-    0x85, 0x84, 0x83, 0x82, 0x81, 0x7F, 0x7E, 0x7D, 0x7C, 0x7B, 0x7A, 0x79, 0x78, 0x77, 0x75, 0x74, //  40h..7Fh
-    0x73, 0x72, 0x71, 0x70, 0x6F, 0x6E, 0x6D, 0x6C, 0x6B, 0x6A, 0x69, 0x68, 0x67, 0x66, 0x65, 0x64, //
-    0x63, 0x62, 0x61, 0x60, 0x5F, 0x5E, 0x5D, 0x5D, 0x5C, 0x5B, 0x5A, 0x59, 0x58, 0x57, 0x56, 0x55, //
-    0x54, 0x53, 0x53, 0x52, 0x51, 0x50, 0x4F, 0x4E, 0x4D, 0x4D, 0x4C, 0x4B, 0x4A, 0x49, 0x48, 0x48, //
-    0x47, 0x46, 0x45, 0x44, 0x43, 0x43, 0x42, 0x41, 0x40, 0x3F, 0x3F, 0x3E, 0x3D, 0x3C, 0x3C, 0x3B, //  80h..BFh
-    0x3A, 0x39, 0x39, 0x38, 0x37, 0x36, 0x36, 0x35, 0x34, 0x33, 0x33, 0x32, 0x31, 0x31, 0x30, 0x2F, //
-    0x2E, 0x2E, 0x2D, 0x2C, 0x2C, 0x2B, 0x2A, 0x2A, 0x29, 0x28, 0x28, 0x27, 0x26, 0x26, 0x25, 0x24, //
-    0x24, 0x23, 0x22, 0x22, 0x21, 0x20, 0x20, 0x1F, 0x1E, 0x1E, 0x1D, 0x1D, 0x1C, 0x1B, 0x1B, 0x1A, //
-    0x19, 0x19, 0x18, 0x18, 0x17, 0x16, 0x16, 0x15, 0x15, 0x14, 0x14, 0x13, 0x12, 0x12, 0x11, 0x11, //  C0h..FFh
-    0x10, 0x0F, 0x0F, 0x0E, 0x0E, 0x0D, 0x0D, 0x0C, 0x0C, 0x0B, 0x0A, 0x0A, 0x09, 0x09, 0x08, 0x08, //
-    0x07, 0x07, 0x06, 0x06, 0x05, 0x05, 0x04, 0x04, 0x03, 0x03, 0x02, 0x02, 0x01, 0x01, 0x00, 0x00, //
-    0x00 // <-- one extra table entry (for "(d-7FC0h)/80h"=100h)
-  }};
-
   const u32 divisor = rhs | 0x8000;
-  const s32 x = static_cast<s32>(0x101 + ZeroExtend32(unr_table[((divisor & 0x7FFF) + 0x40) >> 7]));
+  const s32 x = static_cast<s32>(0x101 + ZeroExtend32(s_unr_table[((divisor & 0x7FFF) + 0x40) >> 7]));
   const s32 d = ((static_cast<s32>(ZeroExtend32(divisor)) * -x) + 0x80) >> 8;
   const u32 recip = static_cast<u32>(((x * (0x20000 + d)) + 0x80) >> 8);
 
@@ -375,8 +457,215 @@ u32 Core::UNRDivide(u32 lhs, u32 rhs)
   return std::min<u32>(0x1FFFF, result);
 }
 
+#if defined(GTE_SIMD_SSE2) || defined(GTE_SIMD_NEON)
+
+namespace {
+struct MatVecResult
+{
+  s64 dot[4]; // unshifted sums
+  s32 mac[4]; // sums shifted and truncated to 32 bits
+  s32 ir[4];  // MAC saturated to the IR range
+  u32 flags;  // MAC1-3 overflow/underflow and IR1-3 saturation
+};
+} // namespace
+
+static constexpr u32 MakeRowFlags(u32 row_mask, u32 first_bit)
+{
+  return ((row_mask & 1u) << first_bit) | (((row_mask >> 1) & 1u) << (first_bit - 1)) |
+         (((row_mask >> 2) & 1u) << (first_bit - 2));
+}
+
+static constexpr u32 MAC1_OVERFLOW_BIT = 30;
+static constexpr u32 MAC1_UNDERFLOW_BIT = 27;
+static constexpr u32 IR1_SATURATED_BIT = 24;
+
+#if defined(GTE_SIMD_SSE2)
+
+// Sign-extends each 64-bit lane from 44 bits. Lanes which change didn't fit, and are added to the overflow or underflow
+// masks depending on their sign.
+static ALWAYS_INLINE __m128i CheckMACResult(__m128i value, __m128i* overflow, __m128i* underflow)
+{
+  const __m128i mask = _mm_set1_epi64x((INT64_C(1) << 44) - 1);
+  const __m128i sign = _mm_set1_epi64x(INT64_C(1) << 43);
+  const __m128i extended = _mm_sub_epi64(_mm_xor_si128(_mm_and_si128(value, mask), sign), sign);
+
+  // no 64-bit compares in SSE2, so combine the two halves
+  const __m128i eq32 = _mm_cmpeq_epi32(extended, value);
+  const __m128i eq64 = _mm_and_si128(eq32, _mm_shuffle_epi32(eq32, _MM_SHUFFLE(2, 3, 0, 1)));
+  const __m128i negative = _mm_shuffle_epi32(_mm_srai_epi32(value, 31), _MM_SHUFFLE(3, 3, 1, 1));
+  *overflow = _mm_or_si128(*overflow, _mm_andnot_si128(_mm_or_si128(eq64, negative), _mm_set1_epi32(-1)));
+  *underflow = _mm_or_si128(*underflow, _mm_andnot_si128(eq64, negative));
+  return extended;
+}
+
+static void MulMatVecRows(const s16 M[3][3], const s32 T[3], const s16 V[3], u8 shift, bool lm, MatVecResult* res)
+{
+  // pmaddwd with the upper halves zeroed is an exact 16x16->32 multiply, one row per 32-bit lane
+  const auto MulColumn = [M, V](u32 col) {
+    const __m128i column = _mm_setr_epi32(ZeroExtend32(static_cast<u16>(M[0][col])),
+                                          ZeroExtend32(static_cast<u16>(M[1][col])),
+                                          ZeroExtend32(static_cast<u16>(M[2][col])), 0);
+    return _mm_madd_epi16(column, _mm_set1_epi32(ZeroExtend32(static_cast<u16>(V[col]))));
+  };
+
+  // rows 0 and 1 are in the low register, row 2 in the high register
+  const auto ExtendLow = [](__m128i v) { return _mm_unpacklo_epi32(v, _mm_srai_epi32(v, 31)); };
+  const auto ExtendHigh = [](__m128i v) { return _mm_unpackhi_epi32(v, _mm_srai_epi32(v, 31)); };
+
+  __m128i overflow_lo = _mm_setzero_si128();
+  __m128i overflow_hi = _mm_setzero_si128();
+  __m128i underflow_lo = _mm_setzero_si128();
+  __m128i underflow_hi = _mm_setzero_si128();
+
+  const __m128i translation = _mm_setr_epi32(T[0], T[1], T[2], 0);
+  __m128i lo = _mm_slli_epi64(ExtendLow(translation), 12);
+  __m128i hi = _mm_slli_epi64(ExtendHigh(translation), 12);
+  for (u32 col = 0; col < 3; col++)
+  {
+    const __m128i product = MulColumn(col);
+    lo = _mm_add_epi64(lo, ExtendLow(product));
+    hi = _mm_add_epi64(hi, ExtendHigh(product));
+
+    // the last sum is checked, but not sign-extended
+    const __m128i lo_extended = CheckMACResult(lo, &overflow_lo, &underflow_lo);
+    const __m128i hi_extended = CheckMACResult(hi, &overflow_hi, &underflow_hi);
+    if (col < 2)
+    {
+      lo = lo_extended;
+      hi = hi_extended;
+    }
+  }
+
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(&res->dot[0]), lo);
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(&res->dot[2]), hi);
+
+  // only the low 32 bits are kept, so a logical shift gives the same result as an arithmetic one
+  const __m128i shift_count = _mm_cvtsi32_si128(shift);
+  const __m128i lo_shifted = _mm_srl_epi64(lo, shift_count);
+  const __m128i hi_shifted = _mm_srl_epi64(hi, shift_count);
+  const __m128i mac = _mm_unpacklo_epi64(_mm_shuffle_epi32(lo_shifted, _MM_SHUFFLE(3, 3, 2, 0)), hi_shifted);
+
+  __m128i ir16 = _mm_packs_epi32(mac, mac);
+  if (lm)
+    ir16 = _mm_max_epi16(ir16, _mm_setzero_si128());
+  const __m128i ir = _mm_srai_epi32(_mm_unpacklo_epi16(ir16, ir16), 16);
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(res->mac), mac);
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(res->ir), ir);
+
+  const u32 overflow_rows = static_cast<u32>(_mm_movemask_pd(_mm_castsi128_pd(overflow_lo)) |
+                                             (_mm_movemask_pd(_mm_castsi128_pd(overflow_hi)) << 2));
+  const u32 underflow_rows = static_cast<u32>(_mm_movemask_pd(_mm_castsi128_pd(underflow_lo)) |
+                                              (_mm_movemask_pd(_mm_castsi128_pd(underflow_hi)) << 2));
+  const u32 saturated_rows = ~static_cast<u32>(_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(ir, mac))));
+  res->flags = MakeRowFlags(overflow_rows, MAC1_OVERFLOW_BIT) | MakeRowFlags(underflow_rows, MAC1_UNDERFLOW_BIT) |
+               MakeRowFlags(saturated_rows, IR1_SATURATED_BIT);
+}
+
+#elif defined(GTE_SIMD_NEON)
+
+// Sign-extends each 64-bit lane from 44 bits. Lanes which change didn't fit, and are added to the overflow or underflow
+// masks depending on their sign.
+static ALWAYS_INLINE int64x2_t CheckMACResult(int64x2_t value, uint64x2_t* overflow, uint64x2_t* underflow)
+{
+  const int64x2_t extended = vshrq_n_s64(vshlq_n_s64(value, 20), 20);
+  const uint64x2_t mismatch = veorq_u64(vceqq_s64(extended, value), vdupq_n_u64(UINT64_C(0xFFFFFFFFFFFFFFFF)));
+  const uint64x2_t negative = vcltzq_s64(value);
+  *overflow = vorrq_u64(*overflow, vbicq_u64(mismatch, negative));
+  *underflow = vorrq_u64(*underflow, vandq_u64(mismatch, negative));
+  return extended;
+}
+
+static void MulMatVecRows(const s16 M[3][3], const s32 T[3], const s16 V[3], u8 shift, bool lm, MatVecResult* res)
+{
+  // one row per lane
+  const auto MulColumn = [M, V](u32 col) {
+    const s16 column_values[4] = {M[0][col], M[1][col], M[2][col], 0};
+    return vmull_s16(vld1_s16(column_values), vdup_n_s16(V[col]));
+  };
+
+  uint64x2_t overflow_lo = vdupq_n_u64(0);
+  uint64x2_t overflow_hi = vdupq_n_u64(0);
+  uint64x2_t underflow_lo = vdupq_n_u64(0);
+  uint64x2_t underflow_hi = vdupq_n_u64(0);
+
+  const s32 translation_values[4] = {T[0], T[1], T[2], 0};
+  const int32x4_t translation = vld1q_s32(translation_values);
+  int64x2_t lo = vshlq_n_s64(vmovl_s32(vget_low_s32(translation)), 12);
+  int64x2_t hi = vshlq_n_s64(vmovl_s32(vget_high_s32(translation)), 12);
+  for (u32 col = 0; col < 3; col++)
+  {
+    const int32x4_t product = MulColumn(col);
+    lo = vaddq_s64(lo, vmovl_s32(vget_low_s32(product)));
+    hi = vaddq_s64(hi, vmovl_s32(vget_high_s32(product)));
+
+    // the last sum is checked, but not sign-extended
+    const int64x2_t lo_extended = CheckMACResult(lo, &overflow_lo, &underflow_lo);
+    const int64x2_t hi_extended = CheckMACResult(hi, &overflow_hi, &underflow_hi);
+    if (col < 2)
+    {
+      lo = lo_extended;
+      hi = hi_extended;
+    }
+  }
+
+  vst1q_s64(&res->dot[0], lo);
+  vst1q_s64(&res->dot[2], hi);
+
+  const int64x2_t shift_count = vdupq_n_s64(-static_cast<s64>(shift));
+  const int32x4_t mac = vcombine_s32(vmovn_s64(vshlq_s64(lo, shift_count)), vmovn_s64(vshlq_s64(hi, shift_count)));
+
+  int16x4_t ir16 = vqmovn_s32(mac);
+  if (lm)
+    ir16 = vmax_s16(ir16, vdup_n_s16(0));
+  const int32x4_t ir = vmovl_s16(ir16);
+  vst1q_s32(res->mac, mac);
+  vst1q_s32(res->ir, ir);
+
+  const uint32x4_t ir_same = vceqq_s32(ir, mac);
+  const u32 overflow_rows = static_cast<u32>((vgetq_lane_u64(overflow_lo, 0) & 1u) |
+                                             ((vgetq_lane_u64(overflow_lo, 1) & 1u) << 1) |
+                                             ((vgetq_lane_u64(overflow_hi, 0) & 1u) << 2));
+  const u32 underflow_rows = static_cast<u32>((vgetq_lane_u64(underflow_lo, 0) & 1u) |
+                                              ((vgetq_lane_u64(underflow_lo, 1) & 1u) << 1) |
+                                              ((vgetq_lane_u64(underflow_hi, 0) & 1u) << 2));
+  const u32 saturated_rows = ~((vgetq_lane_u32(ir_same, 0) & 1u) | ((vgetq_lane_u32(ir_same, 1) & 1u) << 1) |
+                               ((vgetq_lane_u32(ir_same, 2) & 1u) << 2));
+  res->flags = MakeRowFlags(overflow_rows, MAC1_OVERFLOW_BIT) | MakeRowFlags(underflow_rows, MAC1_UNDERFLOW_BIT) |
+               MakeRowFlags(saturated_rows, IR1_SATURATED_BIT);
+}
+
+#endif
+
+#endif
+
+void Core::MulMatVecSIMD(const s16 M[3][3], const s32 T[3], const s16 Vx, const s16 Vy, const s16 Vz, u8 shift,
+                         bool lm)
+{
+#if defined(GTE_SIMD_SSE2) || defined(GTE_SIMD_NEON)
+  const s16 V[3] = {Vx, Vy, Vz};
+  MatVecResult res;
+  MulMatVecRows(M, T, V, shift, lm, &res);
+
+  m_regs.FLAG.bits |= res.flags;
+  for (u32 i = 0; i < 3; i++)
+  {
+    m_regs.dr32[25 + i] = static_cast<u32>(res.mac[i]);
+    m_regs.dr32[9 + i] = static_cast<u32>(res.ir[i]);
+  }
+#else
+  UnreachableCode();
+#endif
+}
+
 void Core::MulMatVec(const s16 M[3][3], const s16 Vx, const s16 Vy, const s16 Vz, u8 shift, bool lm)
 {
+  if (m_use_simd)
+  {
+    // without a translation, none of the sums can overflow, so the order of the checks doesn't matter
+    static constexpr s32 zero_T[3] = {};
+    MulMatVecSIMD(M, zero_T, Vx, Vy, Vz, shift, lm);
+    return;
+  }
 #define dot3(i)                                                                                                        \
   TruncateAndSetMACAndIR<i + 1>(SignExtendMACResult<i + 1>((s64(M[i][0]) * s64(Vx)) + (s64(M[i][1]) * s64(Vy))) +      \
                                   (s64(M[i][2]) * s64(Vz)),                                                            \
@@ -391,6 +680,12 @@ void Core::MulMatVec(const s16 M[3][3], const s16 Vx, const s16 Vy, const s16 Vz
 
 void Core::MulMatVec(const s16 M[3][3], const s32 T[3], const s16 Vx, const s16 Vy, const s16 Vz, u8 shift, bool lm)
 {
+  if (m_use_simd)
+  {
+    MulMatVecSIMD(M, T, Vx, Vy, Vz, shift, lm);
+    return;
+  }
+
 #define dot3(i)                                                                                                        \
   TruncateAndSetMACAndIR<i + 1>(                                                                                       \
     SignExtendMACResult<i + 1>(SignExtendMACResult<i + 1>((s64(T[i]) << 12) + (s64(M[i][0]) * s64(Vx))) +              \
@@ -555,14 +850,33 @@ void Core::RTPS(const s16 V[3], u8 shift, bool lm, bool last)
   // IR1 = MAC1 = (TRX*1000h + RT11*VX0 + RT12*VY0 + RT13*VZ0) SAR (sf*12)
   // IR2 = MAC2 = (TRY*1000h + RT21*VX0 + RT22*VY0 + RT23*VZ0) SAR (sf*12)
   // IR3 = MAC3 = (TRZ*1000h + RT31*VX0 + RT32*VY0 + RT33*VZ0) SAR (sf*12)
-  const s64 x = dot3(0);
-  const s64 y = dot3(1);
-  const s64 z = dot3(2);
-  TruncateAndSetMAC<1>(x, shift);
-  TruncateAndSetMAC<2>(y, shift);
-  TruncateAndSetMAC<3>(z, shift);
-  TruncateAndSetIR<1>(m_regs.MAC1, lm);
-  TruncateAndSetIR<2>(m_regs.MAC2, lm);
+  s64 z;
+#if defined(GTE_SIMD_SSE2) || defined(GTE_SIMD_NEON)
+  if (m_use_simd)
+  {
+    MatVecResult res;
+    MulMatVecRows(m_regs.RT, m_regs.TR, V, shift, lm, &res);
+
+    // the IR3 flag is based on MAC3 SAR 12 instead, below
+    m_regs.FLAG.bits |= res.flags & ~(UINT32_C(1) << (IR1_SATURATED_BIT - 2));
+    for (u32 i = 0; i < 3; i++)
+      m_regs.dr32[25 + i] = static_cast<u32>(res.mac[i]);
+    m_regs.dr32[9] = static_cast<u32>(res.ir[0]);
+    m_regs.dr32[10] = static_cast<u32>(res.ir[1]);
+    z = res.dot[2];
+  }
+  else
+#endif
+  {
+    const s64 x = dot3(0);
+    const s64 y = dot3(1);
+    z = dot3(2);
+    TruncateAndSetMAC<1>(x, shift);
+    TruncateAndSetMAC<2>(y, shift);
+    TruncateAndSetMAC<3>(z, shift);
+    TruncateAndSetIR<1>(m_regs.MAC1, lm);
+    TruncateAndSetIR<2>(m_regs.MAC2, lm);
+  }
 
   // The command does saturate IR1,IR2,IR3 to -8000h..+7FFFh (regardless of lm bit). When using RTP with sf=0, then the
   // IR3 saturation flag (FLAG.22) gets set <only> if "MAC3 SAR 12" exceeds -8000h..+7FFFh (although IR3 is saturated
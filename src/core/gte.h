@@ -1,6 +1,7 @@
 #pragma once
 #include "common/state_wrapper.h"
 #include "gte_types.h"
+#include <array>
 
 namespace CPU {
 class Core;
@@ -31,6 +32,20 @@ public:
 
   void ExecuteInstruction(Instruction inst);
 
+  /// Returns true if the host has a vectorized path for the matrix multiplications (SSE2 on x64, NEON on AArch64).
+  static bool IsSIMDSupported();
+
+  /// Selects between the vectorized and scalar matrix multiplications. Both produce identical results, the vectorized
+  /// path is used by default when supported.
+  void SetUseSIMD(bool enable);
+  bool IsUsingSIMD() const { return m_use_simd; }
+
+  using InstructionHandler = void (*)(Core* gte, u32 instruction_bits);
+
+  /// Returns a function which executes the command without decoding it again, for callers which know the instruction
+  /// ahead of time. Returns nullptr for unknown commands.
+  static InstructionHandler GetInstructionHandler(Instruction inst);
+
 private:
   static constexpr s64 MAC0_MIN_VALUE = -(INT64_C(1) << 31);
   static constexpr s64 MAC0_MAX_VALUE = (INT64_C(1) << 31) - 1;
@@ -69,6 +84,9 @@ private:
   // Divide using Unsigned Newton-Raphson algorithm.
   u32 UNRDivide(u32 lhs, u32 rhs);
 
+  // Reciprocal approximations for UNRDivide(), also read by the recompiler's inline RTPS/RTPT.
+  static const std::array<u8, 257> s_unr_table;
+
   // 3x3 matrix * 3x1 vector, updates MAC[1-3] and IR[1-3]
   void MulMatVec(const s16 M[3][3], const s16 Vx, const s16 Vy, const s16 Vz, u8 shift, bool lm);
 
@@ -76,6 +94,9 @@ private:
   void MulMatVec(const s16 M[3][3], const s32 T[3], const s16 Vx, const s16 Vy, const s16 Vz, u8 shift, bool lm);
   void MulMatVecBuggy(const s16 M[3][3], const s32 T[3], const s16 Vx, const s16 Vy, const s16 Vz, u8 shift, bool lm);
 
+  // Vectorized MulMatVec(), used when m_use_simd is set.
+  void MulMatVecSIMD(const s16 M[3][3], const s32 T[3], const s16 Vx, const s16 Vy, const s16 Vz, u8 shift, bool lm);
+
   // Interpolate colour, or as in nocash "MAC+(FC-MAC)*IR0".
   void InterpolateColor(s64 in_MAC1, s64 in_MAC2, s64 in_MAC3, u8 shift, bool lm);
 
@@ -108,7 +129,11 @@ private:
   void Execute_GPL(Instruction inst);
   void Execute_GPF(Instruction inst);
 
+  template<void (Core::*handler)(Instruction)>
+  static void ExecuteHandler(Core* gte, u32 instruction_bits);
+
   Regs m_regs = {};
+  bool m_use_simd = IsSIMDSupported();
 };
 
 #include "gte.inl"
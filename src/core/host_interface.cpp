@@ -12,6 +12,7 @@
 #include "gpu.h"
 #include "host_display.h"
 #include "save_state_version.h"
+#include "spu.h"
 #include "system.h"
 #include <cmath>
 #include <cstring>
@@ -323,6 +324,11 @@ std::string HostInterface::GetShaderCacheBasePath() const
   return GetUserDirectoryRelativePath("cache/");
 }
 
+std::string HostInterface::GetCPUBlockCachePath(const char* game_code) const
+{
+  return GetUserDirectoryRelativePath("cache/%s.blockcache", game_code);
+}
+
 void HostInterface::SetDefaultSettings(SettingsInterface& si)
 {
   si.SetStringValue("Console", "Region", Settings::GetConsoleRegionName(Settings::DEFAULT_CONSOLE_REGION));
@@ -336,6 +342,10 @@ void HostInterface::SetDefaultSettings(SettingsInterface& si)
   si.SetBoolValue("Main", "LoadDevicesFromSaveStates", false);
 
   si.SetStringValue("CPU", "ExecutionMode", Settings::GetCPUExecutionModeName(Settings::DEFAULT_CPU_EXECUTION_MODE));
+  si.SetBoolValue("CPU", "Fastmem", true);
+  si.SetBoolValue("CPU", "ThreadedCompile", false);
+  si.SetBoolValue("CPU", "IdleLoopSkipping", true);
+  si.SetBoolValue("CPU", "AccurateTiming", false);
 
   si.SetStringValue("GPU", "Renderer", Settings::GetRendererName(Settings::DEFAULT_GPU_RENDERER));
   si.SetIntValue("GPU", "ResolutionScale", 1);
@@ -343,8 +353,11 @@ void HostInterface::SetDefaultSettings(SettingsInterface& si)
   si.SetBoolValue("GPU", "TrueColor", false);
   si.SetBoolValue("GPU", "ScaledDithering", true);
   si.SetBoolValue("GPU", "TextureFiltering", false);
+  si.SetBoolValue("GPU", "UberShaders", false);
   si.SetBoolValue("GPU", "DisableInterlacing", true);
   si.SetBoolValue("GPU", "ForceNTSCTimings", false);
+  si.SetBoolValue("GPU", "UseThread", true);
+  si.SetIntValue("GPU", "ThreadCount", 0);
 
   si.SetStringValue("Display", "CropMode", Settings::GetDisplayCropModeName(Settings::DEFAULT_DISPLAY_CROP_MODE));
   si.SetStringValue("Display", "AspectRatio",
@@ -366,6 +379,7 @@ void HostInterface::SetDefaultSettings(SettingsInterface& si)
   si.SetIntValue("Audio", "BufferSize", DEFAULT_AUDIO_BUFFER_SIZE);
   si.SetIntValue("Audio", "OutputMuted", false);
   si.SetBoolValue("Audio", "Sync", true);
+  si.SetBoolValue("Audio", "SynthesisThread", true);
   si.SetBoolValue("Audio", "DumpOnBoot", false);
 
   si.SetStringValue("BIOS", "Path", "bios/scph1001.bin");
@@ -426,9 +440,11 @@ void HostInterface::CheckForSettingsChanges(const Settings& old_settings)
         ReportFormattedMessage("Switching to %s audio backend.",
                                Settings::GetAudioBackendName(m_settings.audio_backend));
       DebugAssert(m_audio_stream);
+      m_system->GetSPU()->FlushAudioOutput();
       m_audio_stream.reset();
       CreateAudioStream();
       m_audio_stream->PauseOutput(false);
+      m_system->GetSPU()->OnAudioStreamChanged();
     }
 
     if (m_settings.emulation_speed != old_settings.emulation_speed)
@@ -441,6 +457,18 @@ void HostInterface::CheckForSettingsChanges(const Settings& old_settings)
       m_system->SetCPUExecutionMode(m_settings.cpu_execution_mode);
     }
 
+    if (m_settings.cpu_fastmem != old_settings.cpu_fastmem)
+      m_system->SetCPUFastmem(m_settings.cpu_fastmem);
+
+    if (m_settings.cpu_threaded_compile != old_settings.cpu_threaded_compile)
+      m_system->SetCPUThreadedCompile(m_settings.cpu_threaded_compile);
+
+    if (m_settings.cpu_idle_loop_skipping != old_settings.cpu_idle_loop_skipping)
+      m_system->SetCPUIdleLoopSkipping(m_settings.cpu_idle_loop_skipping);
+
+    if (m_settings.cpu_accurate_timing != old_settings.cpu_accurate_timing)
+      m_system->SetCPUAccurateTiming(m_settings.cpu_accurate_timing);
+
     m_audio_stream->SetOutputVolume(m_settings.audio_output_muted ? 0 : m_settings.audio_output_volume);
 
     if (m_settings.gpu_resolution_scale != old_settings.gpu_resolution_scale ||
@@ -449,8 +477,11 @@ void HostInterface::CheckForSettingsChanges(const Settings& old_settings)
         m_settings.gpu_true_color != old_settings.gpu_true_color ||
         m_settings.gpu_scaled_dithering != old_settings.gpu_scaled_dithering ||
         m_settings.gpu_texture_filtering != old_settings.gpu_texture_filtering ||
+        m_settings.gpu_uber_shaders != old_settings.gpu_uber_shaders ||
         m_settings.gpu_disable_interlacing != old_settings.gpu_disable_interlacing ||
         m_settings.gpu_force_ntsc_timings != old_settings.gpu_force_ntsc_timings ||
+        m_settings.gpu_use_thread != old_settings.gpu_use_thread ||
+        m_settings.gpu_thread_count != old_settings.gpu_thread_count ||
         m_settings.display_crop_mode != old_settings.display_crop_mode ||
         m_settings.display_aspect_ratio != old_settings.display_aspect_ratio)
     {
@@ -460,6 +491,9 @@ void HostInterface::CheckForSettingsChanges(const Settings& old_settings)
     if (m_settings.cdrom_read_thread != old_settings.cdrom_read_thread)
       m_system->GetCDROM()->SetUseReadThread(m_settings.cdrom_read_thread);
 
+    if (m_settings.audio_synthesis_thread != old_settings.audio_synthesis_thread)
+      m_system->GetSPU()->SetUseThread(m_settings.audio_synthesis_thread);
+
     if (m_settings.memory_card_types != old_settings.memory_card_types ||
         m_settings.memory_card_paths != old_settings.memory_card_paths)
     {
@@ -106,6 +106,9 @@ public:
   /// Returns the path to the shader cache directory.
   virtual std::string GetShaderCacheBasePath() const;
 
+  /// Returns the path to the CPU block metadata cache for a specific game.
+  virtual std::string GetCPUBlockCachePath(const char* game_code) const;
+
   /// Returns a setting value from the configuration.
   virtual std::string GetSettingValue(const char* section, const char* key, const char* default_value = "") = 0;
 
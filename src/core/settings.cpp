@@ -87,6 +87,10 @@ void Settings::Load(SettingsInterface& si)
     ParseCPUExecutionMode(
       si.GetStringValue("CPU", "ExecutionMode", GetCPUExecutionModeName(DEFAULT_CPU_EXECUTION_MODE)).c_str())
       .value_or(DEFAULT_CPU_EXECUTION_MODE);
+  cpu_fastmem = si.GetBoolValue("CPU", "Fastmem", true);
+  cpu_threaded_compile = si.GetBoolValue("CPU", "ThreadedCompile", false);
+  cpu_idle_loop_skipping = si.GetBoolValue("CPU", "IdleLoopSkipping", true);
+  cpu_accurate_timing = si.GetBoolValue("CPU", "AccurateTiming", false);
 
   gpu_renderer = ParseRendererName(si.GetStringValue("GPU", "Renderer", GetRendererName(DEFAULT_GPU_RENDERER)).c_str())
                    .value_or(DEFAULT_GPU_RENDERER);
@@ -96,8 +100,11 @@ void Settings::Load(SettingsInterface& si)
   gpu_true_color = si.GetBoolValue("GPU", "TrueColor", true);
   gpu_scaled_dithering = si.GetBoolValue("GPU", "ScaledDithering", false);
   gpu_texture_filtering = si.GetBoolValue("GPU", "TextureFiltering", false);
+  gpu_uber_shaders = si.GetBoolValue("GPU", "UberShaders", false);
   gpu_disable_interlacing = si.GetBoolValue("GPU", "DisableInterlacing", true);
   gpu_force_ntsc_timings = si.GetBoolValue("GPU", "ForceNTSCTimings", false);
+  gpu_use_thread = si.GetBoolValue("GPU", "UseThread", true);
+  gpu_thread_count = static_cast<u32>(si.GetIntValue("GPU", "ThreadCount", 0));
 
   display_crop_mode =
     ParseDisplayCropMode(
@@ -125,6 +132,7 @@ void Settings::Load(SettingsInterface& si)
   audio_buffer_size = si.GetIntValue("Audio", "BufferSize", HostInterface::DEFAULT_AUDIO_BUFFER_SIZE);
   audio_output_muted = si.GetBoolValue("Audio", "OutputMuted", false);
   audio_sync_enabled = si.GetBoolValue("Audio", "Sync", true);
+  audio_synthesis_thread = si.GetBoolValue("Audio", "SynthesisThread", true);
   audio_dump_on_boot = si.GetBoolValue("Audio", "DumpOnBoot", false);
 
   dma_max_slice_ticks = si.GetIntValue("Hacks", "DMAMaxSliceTicks", DEFAULT_DMA_MAX_SLICE_TICKS);
@@ -190,6 +198,10 @@ void Settings::Save(SettingsInterface& si) const
   si.SetBoolValue("Main", "LoadDevicesFromSaveStates", load_devices_from_save_states);
 
   si.SetStringValue("CPU", "ExecutionMode", GetCPUExecutionModeName(cpu_execution_mode));
+  si.SetBoolValue("CPU", "Fastmem", cpu_fastmem);
+  si.SetBoolValue("CPU", "ThreadedCompile", cpu_threaded_compile);
+  si.SetBoolValue("CPU", "IdleLoopSkipping", cpu_idle_loop_skipping);
+  si.SetBoolValue("CPU", "AccurateTiming", cpu_accurate_timing);
 
   si.SetStringValue("GPU", "Renderer", GetRendererName(gpu_renderer));
   si.SetStringValue("GPU", "Adapter", gpu_adapter.c_str());
@@ -198,8 +210,11 @@ void Settings::Save(SettingsInterface& si) const
   si.SetBoolValue("GPU", "TrueColor", gpu_true_color);
   si.SetBoolValue("GPU", "ScaledDithering", gpu_scaled_dithering);
   si.SetBoolValue("GPU", "TextureFiltering", gpu_texture_filtering);
+  si.SetBoolValue("GPU", "UberShaders", gpu_uber_shaders);
   si.SetBoolValue("GPU", "DisableInterlacing", gpu_disable_interlacing);
   si.SetBoolValue("GPU", "ForceNTSCTimings", gpu_force_ntsc_timings);
+  si.SetBoolValue("GPU", "UseThread", gpu_use_thread);
+  si.SetIntValue("GPU", "ThreadCount", static_cast<long>(gpu_thread_count));
 
   si.SetStringValue("Display", "CropMode", GetDisplayCropModeName(display_crop_mode));
   si.SetStringValue("Display", "AspectRatio", GetDisplayAspectRatioName(display_aspect_ratio));
@@ -219,6 +234,7 @@ void Settings::Save(SettingsInterface& si) const
   si.SetIntValue("Audio", "BufferSize", audio_buffer_size);
   si.SetBoolValue("Audio", "OutputMuted", audio_output_muted);
   si.SetBoolValue("Audio", "Sync", audio_sync_enabled);
+  si.SetBoolValue("Audio", "SynthesisThread", audio_synthesis_thread);
   si.SetBoolValue("Audio", "DumpOnBoot", audio_dump_on_boot);
 
   si.SetIntValue("Hacks", "DMAMaxSliceTicks", dma_max_slice_ticks);
@@ -347,9 +363,11 @@ const char* Settings::GetDiscRegionDisplayName(DiscRegion region)
   return s_disc_region_display_names[static_cast<int>(region)];
 }
 
-static std::array<const char*, 3> s_cpu_execution_mode_names = {{"Interpreter", "CachedInterpreter", "Recompiler"}};
-static std::array<const char*, 3> s_cpu_execution_mode_display_names = {
-  {"Intepreter (Slowest)", "Cached Interpreter (Faster)", "Recompiler (Fastest)"}};
+static std::array<const char*, 4> s_cpu_execution_mode_names = {
+  {"Interpreter", "CachedInterpreter", "ThreadedInterpreter", "Recompiler"}};
+static std::array<const char*, 4> s_cpu_execution_mode_display_names = {
+  {"Intepreter (Slowest)", "Cached Interpreter (Faster)", "Threaded Interpreter (Faster, No JIT)",
+   "Recompiler (Fastest)"}};
 
 std::optional<CPUExecutionMode> Settings::ParseCPUExecutionMode(const char* str)
 {
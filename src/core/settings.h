@@ -69,6 +69,10 @@ struct Settings
   ConsoleRegion region = ConsoleRegion::Auto;
 
   CPUExecutionMode cpu_execution_mode = CPUExecutionMode::Interpreter;
+  bool cpu_fastmem = true;
+  bool cpu_threaded_compile = false;
+  bool cpu_idle_loop_skipping = true;
+  bool cpu_accurate_timing = false;
 
   float emulation_speed = 1.0f;
   bool speed_limiter_enabled = true;
@@ -86,8 +90,11 @@ struct Settings
   bool gpu_true_color = true;
   bool gpu_scaled_dithering = false;
   bool gpu_texture_filtering = false;
+  bool gpu_uber_shaders = false;
   bool gpu_disable_interlacing = false;
   bool gpu_force_ntsc_timings = false;
+  bool gpu_use_thread = true;
+  u32 gpu_thread_count = 0; // 0 = automatic
   DisplayCropMode display_crop_mode = DisplayCropMode::None;
   DisplayAspectRatio display_aspect_ratio = DisplayAspectRatio::R4_3;
   bool display_linear_filtering = true;
@@ -106,6 +113,7 @@ struct Settings
   u32 audio_buffer_size = 2048;
   bool audio_output_muted = false;
   bool audio_sync_enabled = true;
+  bool audio_synthesis_thread = true;
   bool audio_dump_on_boot = true;
 
   // timing hacks section
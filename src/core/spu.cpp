@@ -1,6 +1,7 @@
 #include "spu.h"
 #include "common/audio_stream.h"
 #include "common/log.h"
+#include "common/timer.h"
 #include "common/state_wrapper.h"
 #include "common/wav_writer.h"
 #include "dma.h"
@@ -12,7 +13,10 @@ Log_SetChannel(SPU);
 
 SPU::SPU() = default;
 
-SPU::~SPU() = default;
+SPU::~SPU()
+{
+  StopThread();
+}
 
 void SPU::Initialize(System* system, DMA* dma, InterruptController* interrupt_controller)
 {
@@ -24,10 +28,15 @@ void SPU::Initialize(System* system, DMA* dma, InterruptController* interrupt_co
   m_transfer_event =
     m_system->CreateTimingEvent("SPU Transfer", TRANSFER_TICKS_PER_HALFWORD, TRANSFER_TICKS_PER_HALFWORD,
                                 std::bind(&SPU::ExecuteTransfer, this, std::placeholders::_1), false);
+
+  if (system->GetSettings().audio_synthesis_thread)
+    StartThread();
 }
 
 void SPU::Reset()
 {
+  Sync();
+
   m_ticks_carry = 0;
 
   m_SPUCNT.bits = 0;
@@ -36,6 +45,7 @@ void SPU::Reset()
   m_transfer_address_reg = 0;
   m_irq_address = 0;
   m_capture_buffer_position = 0;
+  m_queued_capture_buffer_position = 0;
   m_main_volume_left_reg.bits = 0;
   m_main_volume_right_reg.bits = 0;
   m_main_volume_left = {};
@@ -86,6 +96,9 @@ void SPU::Reset()
 
 bool SPU::DoState(StateWrapper& sw)
 {
+  Sync();
+  m_SPUSTAT.second_half_capture_buffer = IsCaptureBufferSecondHalf();
+
   sw.Do(&m_ticks_carry);
   sw.Do(&m_SPUCNT.bits);
   sw.Do(&m_SPUSTAT.bits);
@@ -94,6 +107,7 @@ bool SPU::DoState(StateWrapper& sw)
   sw.Do(&m_transfer_address_reg);
   sw.Do(&m_irq_address);
   sw.Do(&m_capture_buffer_position);
+  m_queued_capture_buffer_position = m_capture_buffer_position;
   sw.Do(&m_main_volume_left_reg.bits);
   sw.Do(&m_main_volume_right_reg.bits);
   sw.DoPOD(&m_main_volume_left);
@@ -157,6 +171,13 @@ bool SPU::DoState(StateWrapper& sw)
 
 u16 SPU::ReadRegister(u32 offset)
 {
+  // The transfer, IRQ, status and external volume registers are only touched by the CPU thread. Everything else can be
+  // written by, or have writes queued for, the synthesis thread, so it has to catch up first.
+  const bool cpu_thread_register = (offset >= (0x1F801DA4 - SPU_BASE) && offset <= (0x1F801DAE - SPU_BASE)) ||
+                                   offset == (0x1F801DB4 - SPU_BASE) || offset == (0x1F801DB6 - SPU_BASE);
+  if (!cpu_thread_register)
+    Sync();
+
   switch (offset)
   {
     case 0x1F801D80 - SPU_BASE:
@@ -231,8 +252,10 @@ u16 SPU::ReadRegister(u32 offset)
       return m_transfer_control.bits;
 
     case 0x1F801DAE - SPU_BASE:
+      // Queueing the pending frames is enough to know the capture buffer half, see IsCaptureBufferSecondHalf().
       m_tick_event->InvokeEarly();
       m_transfer_event->InvokeEarly();
+      m_SPUSTAT.second_half_capture_buffer = IsCaptureBufferSecondHalf();
       Log_TracePrintf("SPU status register -> 0x%04X", ZeroExtend32(m_SPUCNT.bits));
       return m_SPUSTAT.bits;
 
@@ -249,11 +272,11 @@ u16 SPU::ReadRegister(u32 offset)
       return m_external_volume_right;
 
     case 0x1F801DB8 - SPU_BASE:
-      m_tick_event->InvokeEarly();
+      GeneratePendingSamples();
       return m_main_volume_left.current_level;
 
     case 0x1F801DBA - SPU_BASE:
-      m_tick_event->InvokeEarly();
+      GeneratePendingSamples();
       return m_main_volume_right.current_level;
 
     default:
@@ -267,7 +290,7 @@ u16 SPU::ReadRegister(u32 offset)
       if (offset >= (0x1F801E00 - SPU_BASE) && offset < (0x1F801E60 - SPU_BASE))
       {
         const u32 voice_index = (offset - (0x1F801E00 - SPU_BASE)) / 4;
-        m_tick_event->InvokeEarly();
+        GeneratePendingSamples();
         if (offset & 0x02)
           return m_voices[voice_index].left_volume.current_level;
         else
@@ -281,13 +304,131 @@ u16 SPU::ReadRegister(u32 offset)
 }
 
 void SPU::WriteRegister(u32 offset, u16 value)
+{
+  switch (offset)
+  {
+    case 0x1F801DA4 - SPU_BASE:
+    {
+      Log_DebugPrintf("SPU IRQ address register <- 0x%04X", ZeroExtend32(value));
+      m_tick_event->InvokeEarly();
+      m_irq_address = value;
+      return;
+    }
+
+    case 0x1F801DA6 - SPU_BASE:
+    {
+      Log_DebugPrintf("SPU transfer address register <- 0x%04X", ZeroExtend32(value));
+      m_transfer_address_reg = value;
+      m_transfer_address = ZeroExtend32(value) * 8;
+      return;
+    }
+
+    case 0x1F801DA8 - SPU_BASE:
+    {
+      Log_TracePrintf("SPU transfer data register <- 0x%04X (RAM offset 0x%08X)", ZeroExtend32(value),
+                      m_transfer_address);
+
+      ManualTransferWrite(value);
+      return;
+    }
+
+    case 0x1F801DAA - SPU_BASE:
+    {
+      Log_DebugPrintf("SPU control register <- 0x%04X", ZeroExtend32(value));
+      m_tick_event->InvokeEarly(true);
+      Sync();
+
+      const SPUCNT new_value{value};
+      if (new_value.ram_transfer_mode != m_SPUCNT.ram_transfer_mode &&
+          new_value.ram_transfer_mode == RAMTransferMode::Stopped)
+      {
+        // clear the fifo here?
+        if (!m_transfer_fifo.IsEmpty())
+        {
+          Log_WarningPrintf("Clearing SPU transfer FIFO with %u bytes left", m_transfer_fifo.GetSize());
+          m_transfer_fifo.Clear();
+        }
+      }
+
+      if (!new_value.enable && m_SPUCNT.enable)
+      {
+        // Mute all voices.
+        // Interestingly, hardware tests found this seems to happen immediately, not on the next 44100hz cycle.
+        for (u32 i = 0; i < NUM_VOICES; i++)
+          m_voices[i].ForceOff();
+      }
+
+      m_SPUCNT.bits = new_value.bits;
+      m_SPUSTAT.mode = m_SPUCNT.mode.GetValue();
+
+      if (!m_SPUCNT.irq9_enable)
+        m_SPUSTAT.irq9_flag = false;
+
+      UpdateEventInterval();
+      UpdateDMARequest();
+      UpdateTransferEvent();
+      return;
+    }
+
+    case 0x1F801DAC - SPU_BASE:
+    {
+      Log_DebugPrintf("SPU transfer control register <- 0x%04X", ZeroExtend32(value));
+      m_transfer_control.bits = value;
+      return;
+    }
+
+    case 0x1F801DB4 - SPU_BASE:
+    {
+      // External volumes aren't used, so don't bother syncing.
+      Log_DebugPrintf("SPU left external volume register <- 0x%04X", ZeroExtend32(value));
+      m_external_volume_left = value;
+    }
+    break;
+
+    case 0x1F801DB6 - SPU_BASE:
+    {
+      // External volumes aren't used, so don't bother syncing.
+      Log_DebugPrintf("SPU right external volume register <- 0x%04X", ZeroExtend32(value));
+      m_external_volume_right = value;
+    }
+    break;
+
+      // read-only registers
+    case 0x1F801DAE - SPU_BASE:
+    {
+      return;
+    }
+
+    default:
+    {
+      // Everything else only affects sample generation, so pending samples are generated before the write.
+      if (ShouldQueueForThread())
+      {
+        m_tick_event->InvokeEarly();
+        QueueThreadCommand(0, Truncate16(offset), value);
+        return;
+      }
+
+      // Voice registers only matter if the voice is on, or key on is pending.
+      if (offset >= (0x1F801D80 - SPU_BASE) || m_voices[offset / 0x10].IsOn() ||
+          (m_key_on_register & (1u << (offset / 0x10))))
+      {
+        m_tick_event->InvokeEarly();
+      }
+
+      WriteSynthesisRegister(offset, value);
+      return;
+    }
+  }
+}
+
+void SPU::WriteSynthesisRegister(u32 offset, u16 value)
 {
   switch (offset)
   {
     case 0x1F801D80 - SPU_BASE:
     {
       Log_DebugPrintf("SPU main volume left <- 0x%04X", ZeroExtend32(value));
-      m_tick_event->InvokeEarly();
       m_main_volume_left_reg.bits = value;
       m_main_volume_left.Reset(m_main_volume_left_reg);
       return;
@@ -296,7 +437,6 @@ void SPU::WriteRegister(u32 offset, u16 value)
     case 0x1F801D82 - SPU_BASE:
     {
       Log_DebugPrintf("SPU main volume right <- 0x%04X", ZeroExtend32(value));
-      m_tick_event->InvokeEarly();
       m_main_volume_right_reg.bits = value;
       m_main_volume_right.Reset(m_main_volume_right_reg);
       return;
@@ -305,7 +445,6 @@ void SPU::WriteRegister(u32 offset, u16 value)
     case 0x1F801D84 - SPU_BASE:
     {
       Log_DebugPrintf("SPU reverb output volume left <- 0x%04X", ZeroExtend32(value));
-      m_tick_event->InvokeEarly();
       m_reverb_registers.vLOUT = value;
       return;
     }
@@ -313,7 +452,6 @@ void SPU::WriteRegister(u32 offset, u16 value)
     case 0x1F801D86 - SPU_BASE:
     {
       Log_DebugPrintf("SPU reverb output volume right <- 0x%04X", ZeroExtend32(value));
-      m_tick_event->InvokeEarly();
       m_reverb_registers.vROUT = value;
       return;
     }
@@ -321,7 +459,6 @@ void SPU::WriteRegister(u32 offset, u16 value)
     case 0x1F801D88 - SPU_BASE:
     {
       Log_DebugPrintf("SPU key on low <- 0x%04X", ZeroExtend32(value));
-      m_tick_event->InvokeEarly();
       m_key_on_register = (m_key_on_register & 0xFFFF0000) | ZeroExtend32(value);
     }
     break;
@@ -329,7 +466,6 @@ void SPU::WriteRegister(u32 offset, u16 value)
     case 0x1F801D8A - SPU_BASE:
     {
       Log_DebugPrintf("SPU key on high <- 0x%04X", ZeroExtend32(value));
-      m_tick_event->InvokeEarly();
       m_key_on_register = (m_key_on_register & 0x0000FFFF) | (ZeroExtend32(value) << 16);
     }
     break;
@@ -337,7 +473,6 @@ void SPU::WriteRegister(u32 offset, u16 value)
     case 0x1F801D8C - SPU_BASE:
     {
       Log_DebugPrintf("SPU key off low <- 0x%04X", ZeroExtend32(value));
-      m_tick_event->InvokeEarly();
       m_key_off_register = (m_key_off_register & 0xFFFF0000) | ZeroExtend32(value);
     }
     break;
@@ -345,14 +480,12 @@ void SPU::WriteRegister(u32 offset, u16 value)
     case 0x1F801D8E - SPU_BASE:
     {
       Log_DebugPrintf("SPU key off high <- 0x%04X", ZeroExtend32(value));
-      m_tick_event->InvokeEarly();
       m_key_off_register = (m_key_off_register & 0x0000FFFF) | (ZeroExtend32(value) << 16);
     }
     break;
 
     case 0x1F801D90 - SPU_BASE:
     {
-      m_tick_event->InvokeEarly();
       m_pitch_modulation_enable_register = (m_pitch_modulation_enable_register & 0xFFFF0000) | ZeroExtend32(value);
       Log_DebugPrintf("SPU pitch modulation enable register <- 0x%08X", m_pitch_modulation_enable_register);
     }
@@ -360,7 +493,6 @@ void SPU::WriteRegister(u32 offset, u16 value)
 
     case 0x1F801D92 - SPU_BASE:
     {
-      m_tick_event->InvokeEarly();
       m_pitch_modulation_enable_register =
         (m_pitch_modulation_enable_register & 0x0000FFFF) | (ZeroExtend32(value) << 16);
       Log_DebugPrintf("SPU pitch modulation enable register <- 0x%08X", m_pitch_modulation_enable_register);
@@ -370,7 +502,6 @@ void SPU::WriteRegister(u32 offset, u16 value)
     case 0x1F801D94 - SPU_BASE:
     {
       Log_DebugPrintf("SPU noise mode register <- 0x%04X", ZeroExtend32(value));
-      m_tick_event->InvokeEarly();
       m_noise_mode_register = (m_noise_mode_register & 0xFFFF0000) | ZeroExtend32(value);
     }
     break;
@@ -378,7 +509,6 @@ void SPU::WriteRegister(u32 offset, u16 value)
     case 0x1F801D96 - SPU_BASE:
     {
       Log_DebugPrintf("SPU noise mode register <- 0x%04X", ZeroExtend32(value));
-      m_tick_event->InvokeEarly();
       m_noise_mode_register = (m_noise_mode_register & 0x0000FFFF) | (ZeroExtend32(value) << 16);
     }
     break;
@@ -386,7 +516,6 @@ void SPU::WriteRegister(u32 offset, u16 value)
     case 0x1F801D98 - SPU_BASE:
     {
       Log_DebugPrintf("SPU reverb on register <- 0x%04X", ZeroExtend32(value));
-      m_tick_event->InvokeEarly();
       m_reverb_on_register = (m_reverb_on_register & 0xFFFF0000) | ZeroExtend32(value);
     }
     break;
@@ -394,7 +523,6 @@ void SPU::WriteRegister(u32 offset, u16 value)
     case 0x1F801D9A - SPU_BASE:
     {
       Log_DebugPrintf("SPU reverb on register <- 0x%04X", ZeroExtend32(value));
-      m_tick_event->InvokeEarly();
       m_reverb_on_register = (m_reverb_on_register & 0x0000FFFF) | (ZeroExtend32(value) << 16);
     }
     break;
@@ -402,86 +530,15 @@ void SPU::WriteRegister(u32 offset, u16 value)
     case 0x1F801DA2 - SPU_BASE:
     {
       Log_DebugPrintf("SPU reverb base address < 0x%04X", ZeroExtend32(value));
-      m_tick_event->InvokeEarly();
       m_reverb_registers.mBASE = value;
       m_reverb_base_address = ZeroExtend32(value << 2) & 0x3FFFFu;
       m_reverb_current_address = m_reverb_base_address;
     }
     break;
 
-    case 0x1F801DA4 - SPU_BASE:
-    {
-      Log_DebugPrintf("SPU IRQ address register <- 0x%04X", ZeroExtend32(value));
-      m_tick_event->InvokeEarly();
-      m_irq_address = value;
-      return;
-    }
-
-    case 0x1F801DA6 - SPU_BASE:
-    {
-      Log_DebugPrintf("SPU transfer address register <- 0x%04X", ZeroExtend32(value));
-      m_transfer_address_reg = value;
-      m_transfer_address = ZeroExtend32(value) * 8;
-      return;
-    }
-
-    case 0x1F801DA8 - SPU_BASE:
-    {
-      Log_TracePrintf("SPU transfer data register <- 0x%04X (RAM offset 0x%08X)", ZeroExtend32(value),
-                      m_transfer_address);
-
-      ManualTransferWrite(value);
-      return;
-    }
-
-    case 0x1F801DAA - SPU_BASE:
-    {
-      Log_DebugPrintf("SPU control register <- 0x%04X", ZeroExtend32(value));
-      m_tick_event->InvokeEarly(true);
-
-      const SPUCNT new_value{value};
-      if (new_value.ram_transfer_mode != m_SPUCNT.ram_transfer_mode &&
-          new_value.ram_transfer_mode == RAMTransferMode::Stopped)
-      {
-        // clear the fifo here?
-        if (!m_transfer_fifo.IsEmpty())
-        {
-          Log_WarningPrintf("Clearing SPU transfer FIFO with %u bytes left", m_transfer_fifo.GetSize());
-          m_transfer_fifo.Clear();
-        }
-      }
-
-      if (!new_value.enable && m_SPUCNT.enable)
-      {
-        // Mute all voices.
-        // Interestingly, hardware tests found this seems to happen immediately, not on the next 44100hz cycle.
-        for (u32 i = 0; i < NUM_VOICES; i++)
-          m_voices[i].ForceOff();
-      }
-
-      m_SPUCNT.bits = new_value.bits;
-      m_SPUSTAT.mode = m_SPUCNT.mode.GetValue();
-
-      if (!m_SPUCNT.irq9_enable)
-        m_SPUSTAT.irq9_flag = false;
-
-      UpdateEventInterval();
-      UpdateDMARequest();
-      UpdateTransferEvent();
-      return;
-    }
-
-    case 0x1F801DAC - SPU_BASE:
-    {
-      Log_DebugPrintf("SPU transfer control register <- 0x%04X", ZeroExtend32(value));
-      m_transfer_control.bits = value;
-      return;
-    }
-
     case 0x1F801DB0 - SPU_BASE:
     {
       Log_DebugPrintf("SPU left cd audio register <- 0x%04X", ZeroExtend32(value));
-      m_tick_event->InvokeEarly();
       m_cd_audio_volume_left = value;
     }
     break;
@@ -489,33 +546,10 @@ void SPU::WriteRegister(u32 offset, u16 value)
     case 0x1F801DB2 - SPU_BASE:
     {
       Log_DebugPrintf("SPU right cd audio register <- 0x%04X", ZeroExtend32(value));
-      m_tick_event->InvokeEarly();
       m_cd_audio_volume_right = value;
     }
     break;
 
-    case 0x1F801DB4 - SPU_BASE:
-    {
-      // External volumes aren't used, so don't bother syncing.
-      Log_DebugPrintf("SPU left external volume register <- 0x%04X", ZeroExtend32(value));
-      m_external_volume_left = value;
-    }
-    break;
-
-    case 0x1F801DB6 - SPU_BASE:
-    {
-      // External volumes aren't used, so don't bother syncing.
-      Log_DebugPrintf("SPU right external volume register <- 0x%04X", ZeroExtend32(value));
-      m_external_volume_right = value;
-    }
-    break;
-
-      // read-only registers
-    case 0x1F801DAE - SPU_BASE:
-    {
-      return;
-    }
-
     default:
     {
       if (offset < (0x1F801D80 - SPU_BASE))
@@ -528,7 +562,6 @@ void SPU::WriteRegister(u32 offset, u16 value)
       {
         const u32 reg = (offset - (0x1F801DC0 - SPU_BASE)) / 2;
         Log_DebugPrintf("SPU reverb register %u <- 0x%04X", reg, value);
-        m_tick_event->InvokeEarly();
         m_reverb_registers.rev[reg] = value;
         return;
       }
@@ -546,10 +579,11 @@ u16 SPU::ReadVoiceRegister(u32 offset)
   const u32 voice_index = (offset / 0x10);   //((offset >> 4) & 0x1F);
   Assert(voice_index < 24);
 
-  // ADSR volume needs to be updated when reading. A voice might be off as well, but key on is pending.
+  // ADSR volume needs to be updated when reading. A voice might be off as well, but key on is pending. The other
+  // registers have already been synced with the synthesis thread by ReadRegister().
   const Voice& voice = m_voices[voice_index];
   if (reg_index >= 6 && (voice.IsOn() || m_key_on_register & (1u << voice_index)))
-    m_tick_event->InvokeEarly();
+    GeneratePendingSamples();
 
   Log_TracePrintf("Read voice %u register %u -> 0x%02X", voice_index, reg_index, voice.regs.index[reg_index]);
   return voice.regs.index[reg_index];
@@ -563,9 +597,6 @@ void SPU::WriteVoiceRegister(u32 offset, u16 value)
   Assert(voice_index < 24);
 
   Voice& voice = m_voices[voice_index];
-  if (voice.IsOn() || m_key_on_register & (1u << voice_index))
-    m_tick_event->InvokeEarly();
-
   switch (reg_index)
   {
     case 0x00: // volume left
@@ -665,14 +696,41 @@ void SPU::IncrementCaptureBufferPosition()
 {
   m_capture_buffer_position += sizeof(s16);
   m_capture_buffer_position %= CAPTURE_BUFFER_SIZE_PER_CHANNEL;
-  m_SPUSTAT.second_half_capture_buffer = m_capture_buffer_position >= (CAPTURE_BUFFER_SIZE_PER_CHANNEL / 2);
+
+  // SPUSTAT is owned by the CPU thread, the capture buffer half flag is updated when it is read.
 }
 
 void SPU::Execute(TickCount ticks)
 {
-  u32 remaining_frames = static_cast<u32>((ticks + m_ticks_carry) / SYSCLK_TICKS_PER_SPU_TICK);
+  const u32 frames = static_cast<u32>((ticks + m_ticks_carry) / SYSCLK_TICKS_PER_SPU_TICK);
   m_ticks_carry = (ticks + m_ticks_carry) % SYSCLK_TICKS_PER_SPU_TICK;
+  if (frames == 0)
+    return;
+
+  m_queued_capture_buffer_position = static_cast<u16>(
+    (m_queued_capture_buffer_position + frames * sizeof(s16)) % CAPTURE_BUFFER_SIZE_PER_CHANNEL);
+
+  if (ShouldQueueForThread())
+  {
+    QueueThreadCommand(frames, NO_REGISTER_WRITE, 0);
+
+    // Audio sync blocks the synthesis thread rather than the CPU thread, so don't let the CPU get more than a buffer
+    // ahead of the output, otherwise it's no longer throttled.
+    if (m_thread_queued_frames.load(std::memory_order_relaxed) >
+        m_system->GetHostInterface()->GetAudioStream()->GetBufferSize())
+    {
+      Sync();
+    }
+
+    return;
+  }
 
+  Sync();
+  GenerateFrames(frames);
+}
+
+void SPU::GenerateFrames(u32 remaining_frames)
+{
   while (remaining_frames > 0)
   {
     AudioStream* const output_stream = m_system->GetHostInterface()->GetAudioStream();
@@ -795,8 +853,12 @@ void SPU::UpdateEventInterval()
   // the SPU state.
   const u32 max_slice_frames = m_system->GetHostInterface()->GetAudioStream()->GetBufferSize();
 
+  // When the synthesis thread is used, samples are queued in smaller slices so it can work while the CPU runs. The
+  // generated samples don't depend on the slice size.
   // TODO: Make this predict how long until the interrupt will be hit instead...
-  const u32 interval = (m_SPUCNT.enable && m_SPUCNT.irq9_enable) ? 1 : max_slice_frames;
+  const u32 interval = (m_SPUCNT.enable && m_SPUCNT.irq9_enable) ?
+                         1 :
+                         (ShouldQueueForThread() ? std::min(THREAD_SLICE_FRAMES, max_slice_frames) : max_slice_frames);
   const TickCount interval_ticks = static_cast<TickCount>(interval) * SYSCLK_TICKS_PER_SPU_TICK;
   if (m_tick_event->IsActive() && m_tick_event->GetInterval() == interval_ticks)
     return;
@@ -809,6 +871,9 @@ void SPU::UpdateEventInterval()
 
 void SPU::ExecuteTransfer(TickCount ticks)
 {
+  // Sample generation reads and writes SPU RAM.
+  Sync();
+
   const RAMTransferMode mode = m_SPUCNT.ram_transfer_mode;
   Assert(mode != RAMTransferMode::Stopped);
 
@@ -1031,10 +1096,149 @@ void SPU::DMAWrite(const u32* words, u32 word_count)
 void SPU::GeneratePendingSamples()
 {
   m_tick_event->InvokeEarly();
+  Sync();
+}
+
+void SPU::SetUseThread(bool enabled)
+{
+  if (enabled == IsUsingThread())
+    return;
+
+  if (enabled)
+    StartThread();
+  else
+    StopThread();
+
+  UpdateEventInterval();
+}
+
+void SPU::FlushAudioOutput()
+{
+  Sync();
+}
+
+void SPU::OnAudioStreamChanged()
+{
+  UpdateEventInterval();
+}
+
+void SPU::StartThread()
+{
+  Log_InfoPrintf("Starting SPU synthesis thread");
+  m_thread_shutdown = false;
+  m_thread = std::thread(&SPU::ThreadEntryPoint, this);
+}
+
+void SPU::StopThread()
+{
+  if (!IsUsingThread())
+    return;
+
+  // The thread executes all queued commands before exiting.
+  {
+    std::unique_lock<std::mutex> lock(m_thread_mutex);
+    m_thread_shutdown = true;
+    m_thread_wake_cv.notify_one();
+  }
+
+  m_thread.join();
+}
+
+void SPU::WakeThread()
+{
+  std::unique_lock<std::mutex> lock(m_thread_mutex);
+  m_thread_wake_cv.notify_one();
+}
+
+void SPU::ThreadEntryPoint()
+{
+  Common::Timer::Value spin_start_time = 0;
+  for (;;)
+  {
+    u32 size;
+    const ThreadCommand* cmd = static_cast<const ThreadCommand*>(m_thread_queue.BeginRead(&size));
+    if (cmd)
+    {
+      if (cmd->num_frames > 0)
+      {
+        GenerateFrames(cmd->num_frames);
+        m_thread_queued_frames.fetch_sub(cmd->num_frames, std::memory_order_relaxed);
+      }
+      if (cmd->register_offset != NO_REGISTER_WRITE)
+        WriteSynthesisRegister(cmd->register_offset, cmd->register_value);
+
+      m_thread_queue.EndRead();
+      spin_start_time = 0;
+      continue;
+    }
+
+    // Pairs with the fence in Sync(), so either we see the sync request or it sees the empty queue.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (m_thread_sync_pending.load(std::memory_order_relaxed))
+    {
+      std::unique_lock<std::mutex> lock(m_thread_mutex);
+      m_thread_idle_cv.notify_all();
+    }
+
+    // Register writes usually come in bursts, so avoid the cost of sleeping and waking up again.
+    const Common::Timer::Value current_time = Common::Timer::GetValue();
+    if (spin_start_time == 0)
+      spin_start_time = current_time;
+    if (Common::Timer::ConvertValueToNanoseconds(current_time - spin_start_time) < THREAD_SPIN_TIME_NS)
+    {
+      std::this_thread::yield();
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(m_thread_mutex);
+    if (m_thread_shutdown)
+      break;
+
+    // Pairs with the fence in QueueThreadCommand(), so either we see the new command or it sees us sleeping.
+    m_thread_sleeping.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    m_thread_wake_cv.wait(lock, [this]() { return m_thread_shutdown || !m_thread_queue.IsEmpty(); });
+    m_thread_sleeping.store(false, std::memory_order_relaxed);
+    spin_start_time = 0;
+  }
+}
+
+void SPU::QueueThreadCommand(u32 num_frames, u16 register_offset, u16 register_value)
+{
+  void* ptr;
+  while (!(ptr = m_thread_queue.BeginWrite(sizeof(ThreadCommand))))
+  {
+    WakeThread();
+    std::this_thread::yield();
+  }
+
+  ThreadCommand* cmd = static_cast<ThreadCommand*>(ptr);
+  cmd->num_frames = num_frames;
+  cmd->register_offset = register_offset;
+  cmd->register_value = register_value;
+  m_thread_queued_frames.fetch_add(num_frames, std::memory_order_relaxed);
+  m_thread_queue.EndWrite();
+
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (m_thread_sleeping.load(std::memory_order_relaxed))
+    WakeThread();
+}
+
+void SPU::Sync()
+{
+  if (m_thread_queue.IsEmpty())
+    return;
+
+  std::unique_lock<std::mutex> lock(m_thread_mutex);
+  m_thread_sync_pending.store(true, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  m_thread_idle_cv.wait(lock, [this]() { return m_thread_queue.IsEmpty(); });
+  m_thread_sync_pending.store(false, std::memory_order_relaxed);
 }
 
 bool SPU::StartDumpingAudio(const char* filename)
 {
+  Sync();
   if (m_dump_writer)
     m_dump_writer.reset();
 
@@ -1051,6 +1255,7 @@ bool SPU::StartDumpingAudio(const char* filename)
 
 bool SPU::StopDumpingAudio()
 {
+  Sync();
   if (!m_dump_writer)
     return false;
 
@@ -1751,6 +1956,9 @@ void SPU::ProcessReverb(s16 left_in, s16 right_in, s32* left_out, s32* right_out
 
 void SPU::EnsureCDAudioSpace(u32 remaining_frames)
 {
+  // The CD audio buffer is consumed when generating samples.
+  Sync();
+
   if (m_cd_audio_buffer.GetSpace() >= (remaining_frames * 2))
     return;
 
@@ -1768,6 +1976,8 @@ void SPU::DrawDebugStateWindow()
   static const ImVec4 inactive_color{0.4f, 0.4f, 0.4f, 1.0f};
   const float framebuffer_scale = ImGui::GetIO().DisplayFramebufferScale.x;
 
+  Sync();
+
   ImGui::SetNextWindowSize(ImVec2(800.0f * framebuffer_scale, 800.0f * framebuffer_scale), ImGuiCond_FirstUseEver);
   if (!ImGui::Begin("SPU State", &m_system->GetSettings().debugging.show_spu_state))
   {
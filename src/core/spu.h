@@ -1,9 +1,14 @@
 #pragma once
 #include "common/bitfield.h"
 #include "common/fifo_queue.h"
+#include "common/spsc_ring_buffer.h"
 #include "types.h"
 #include <array>
+#include <atomic>
+#include <condition_variable>
 #include <memory>
+#include <mutex>
+#include <thread>
 
 class StateWrapper;
 
@@ -35,7 +40,7 @@ public:
   // Render statistics debug window.
   void DrawDebugStateWindow();
 
-  // External input from CD controller.
+  // External input from CD controller. Must be preceded by EnsureCDAudioSpace(), which waits for the synthesis thread.
   void AddCDAudioSample(s16 left, s16 right)
   {
     m_cd_audio_buffer.Push(left);
@@ -46,6 +51,16 @@ public:
   // Executes the SPU, generating any pending samples.
   void GeneratePendingSamples();
 
+  /// Starts or stops generating samples on a separate thread.
+  void SetUseThread(bool enabled);
+
+  /// Waits for the synthesis thread to write everything queued to the host audio stream. Must be called before the
+  /// stream is paused, emptied or replaced, since the thread could be writing to it or waiting for it to drain.
+  void FlushAudioOutput();
+
+  /// Picks up the buffer size of a new host audio stream.
+  void OnAudioStreamChanged();
+
   /// Returns true if currently dumping audio.
   ALWAYS_INLINE bool IsDumpingAudio() const { return static_cast<bool>(m_dump_writer); }
 
@@ -74,6 +89,16 @@ private:
   static constexpr u32 FIFO_SIZE_IN_HALFWORDS = 32;
   static constexpr TickCount TRANSFER_TICKS_PER_HALFWORD = 32;
 
+  // Sample generation can run on a worker thread, behind the CPU thread. Register writes which only affect sample
+  // generation are queued in order with the requests to generate samples, so each write takes effect at the same
+  // sample as it would on the CPU thread. Anything which observes the generated state or SPU RAM waits for the thread
+  // to catch up first. While the SPU IRQ is enabled, samples are generated on the CPU thread, so that the interrupt is
+  // raised at the exact sample.
+  static constexpr u32 THREAD_QUEUE_SIZE = 64 * 1024;
+  static constexpr u32 THREAD_SPIN_TIME_NS = 100 * 1000;
+  static constexpr u32 THREAD_SLICE_FRAMES = 128;
+  static constexpr u16 NO_REGISTER_WRITE = 0xFFFF;
+
   enum class RAMTransferMode : u8
   {
     Stopped = 0,
@@ -354,7 +379,16 @@ private:
   }
   ALWAYS_INLINE s16 GetVoiceNoiseLevel() const { return static_cast<s16>(static_cast<u16>(m_noise_level)); }
 
+  /// Uses the position after all queued frames, so it doesn't have to wait for the synthesis thread.
+  ALWAYS_INLINE bool IsCaptureBufferSecondHalf() const
+  {
+    return (m_queued_capture_buffer_position >= (CAPTURE_BUFFER_SIZE_PER_CHANNEL / 2));
+  }
+
   u16 ReadVoiceRegister(u32 offset);
+
+  /// Applies a write to a register which only affects sample generation. Called on the synthesis thread when in use.
+  void WriteSynthesisRegister(u32 offset, u16 value);
   void WriteVoiceRegister(u32 offset, u16 value);
 
   void CheckRAMIRQ(u32 address);
@@ -373,8 +407,30 @@ private:
   void ProcessReverb(s16 left_in, s16 right_in, s32* left_out, s32* right_out);
 
   void Execute(TickCount ticks);
+  void GenerateFrames(u32 remaining_frames);
   void UpdateEventInterval();
 
+  struct ThreadCommand
+  {
+    u32 num_frames;      // generated before the register write
+    u16 register_offset; // NO_REGISTER_WRITE if there is no write
+    u16 register_value;
+  };
+
+  bool IsUsingThread() const { return m_thread.joinable(); }
+
+  /// Returns true if sample generation and register writes should be passed to the synthesis thread.
+  bool ShouldQueueForThread() const { return (IsUsingThread() && !m_SPUCNT.irq9_enable); }
+
+  void StartThread();
+  void StopThread();
+  void WakeThread();
+  void ThreadEntryPoint();
+  void QueueThreadCommand(u32 num_frames, u16 register_offset, u16 register_value);
+
+  /// Waits for the synthesis thread to execute all queued commands, so the SPU state can be accessed.
+  void Sync();
+
   void ExecuteTransfer(TickCount ticks);
   void ManualTransferWrite(u16 value);
   void UpdateTransferEvent();
@@ -397,6 +453,7 @@ private:
 
   u16 m_irq_address = 0;
   u16 m_capture_buffer_position = 0;
+  u16 m_queued_capture_buffer_position = 0; // owned by the CPU thread, where the position will be once frames are done
 
   VolumeRegister m_main_volume_left_reg = {};
   VolumeRegister m_main_volume_right_reg = {};
@@ -433,4 +490,14 @@ private:
   std::array<u8, RAM_SIZE> m_ram{};
 
   InlineFIFOQueue<s16, CD_AUDIO_SAMPLE_BUFFER_SIZE> m_cd_audio_buffer;
+
+  SPSCRingBuffer m_thread_queue{THREAD_QUEUE_SIZE};
+  std::thread m_thread;
+  std::mutex m_thread_mutex;
+  std::condition_variable m_thread_wake_cv;
+  std::condition_variable m_thread_idle_cv;
+  std::atomic<u32> m_thread_queued_frames{0};
+  std::atomic_bool m_thread_sleeping{false};
+  std::atomic_bool m_thread_sync_pending{false};
+  bool m_thread_shutdown = false;
 };
\ No newline at end of file
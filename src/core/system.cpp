@@ -65,6 +65,9 @@ System::System(HostInterface* host_interface) : m_host_interface(host_interface)
 
 System::~System()
 {
+  SaveCPUBlockCache();
+  LogFrameTimeHistogram();
+
   // we have to explicitly destroy components because they can deregister events
   DestroyComponents();
 }
@@ -129,6 +132,29 @@ void System::SetCPUExecutionMode(CPUExecutionMode mode)
   m_cpu_execution_mode = mode;
   m_cpu_code_cache->Flush();
   m_cpu_code_cache->SetUseRecompiler(mode == CPUExecutionMode::Recompiler);
+  m_cpu_code_cache->SetUseThreadedInterpreter(mode == CPUExecutionMode::ThreadedInterpreter);
+  m_bus->SetRAMWriteProtection(mode != CPUExecutionMode::Interpreter);
+}
+
+void System::SetCPUFastmem(bool enabled)
+{
+  m_cpu_code_cache->SetUseFastmem(enabled);
+}
+
+void System::SetCPUThreadedCompile(bool enabled)
+{
+  m_cpu_code_cache->SetUseThreadedCompile(enabled);
+}
+
+void System::SetCPUIdleLoopSkipping(bool enabled)
+{
+  m_cpu_code_cache->SetUseIdleLoopSkipping(enabled);
+}
+
+void System::SetCPUAccurateTiming(bool enabled)
+{
+  m_cpu->SetAccurateTiming(enabled);
+  m_cpu_code_cache->SetUseAccurateTiming(enabled);
 }
 
 bool System::Boot(const SystemBootParameters& params)
@@ -246,10 +272,17 @@ bool System::InitializeComponents(bool force_software_renderer)
     return false;
 
   m_cpu->Initialize(m_bus.get());
-  m_cpu_code_cache->Initialize(this, m_cpu.get(), m_bus.get(), m_cpu_execution_mode == CPUExecutionMode::Recompiler);
+  m_cpu->SetAccurateTiming(GetSettings().cpu_accurate_timing);
+  m_cpu_code_cache->Initialize(this, m_cpu.get(), m_bus.get(), m_cpu_execution_mode == CPUExecutionMode::Recompiler,
+                               m_cpu_execution_mode == CPUExecutionMode::ThreadedInterpreter,
+                               GetSettings().cpu_fastmem, GetSettings().cpu_threaded_compile,
+                               GetSettings().cpu_idle_loop_skipping, GetSettings().cpu_accurate_timing);
   m_bus->Initialize(m_cpu.get(), m_cpu_code_cache.get(), m_dma.get(), m_interrupt_controller.get(), m_gpu.get(),
                     m_cdrom.get(), m_pad.get(), m_timers.get(), m_spu.get(), m_mdec.get(), m_sio.get());
 
+  // Only the code cache relies on code pages being protected.
+  m_bus->SetRAMWriteProtection(m_cpu_execution_mode != CPUExecutionMode::Interpreter);
+
   m_dma->Initialize(this, m_bus.get(), m_interrupt_controller.get(), m_gpu.get(), m_cdrom.get(), m_spu.get(),
                     m_mdec.get());
 
@@ -586,6 +619,16 @@ void System::Throttle()
   // Don't sleep for <1ms or >=period.
   constexpr s64 MINIMUM_SLEEP_TIME = INT64_C(1000000);
 
+  // Spend some of the time we'd otherwise sleep for compiling blocks from previous runs ahead of time. The interpreter
+  // doesn't run blocks, so they'd only be flagging code pages for nothing.
+  if (m_cpu_execution_mode != CPUExecutionMode::Interpreter)
+  {
+    const u64 idle_start_time = static_cast<u64>(m_throttle_timer.GetTimeNanoseconds());
+    const s64 idle_time = static_cast<s64>(m_last_throttle_time - idle_start_time);
+    if (idle_time >= MINIMUM_SLEEP_TIME && idle_time <= m_throttle_period)
+      m_cpu_code_cache->PrecompileBlocksFromMetadata(static_cast<double>(idle_time / 2) / 1000000.0);
+  }
+
   // Use unsigned for defined overflow/wrap-around.
   const u64 time = static_cast<u64>(m_throttle_timer.GetTimeNanoseconds());
   const s64 sleep_time = static_cast<s64>(m_last_throttle_time - time);
@@ -622,6 +665,7 @@ void System::UpdatePerformanceCounters()
   const float frame_time = static_cast<float>(m_frame_timer.GetTimeMilliseconds());
   m_average_frame_time_accumulator += frame_time;
   m_worst_frame_time_accumulator = std::max(m_worst_frame_time_accumulator, frame_time);
+  m_frame_time_histogram[std::min(static_cast<u32>(frame_time), FRAME_TIME_HISTOGRAM_SIZE - 1)]++;
 
   // update fps counter
   const float time = static_cast<float>(m_fps_timer.GetTimeSeconds());
@@ -644,9 +688,36 @@ void System::UpdatePerformanceCounters()
   m_last_global_tick_counter = m_global_tick_counter;
   m_fps_timer.Reset();
 
+  // Logged as it goes, so it can be compared while changing settings without restarting.
+  if (m_frame_time_histogram_log_timer.GetTimeSeconds() >= FRAME_TIME_HISTOGRAM_LOG_INTERVAL)
+  {
+    LogFrameTimeHistogram();
+    m_frame_time_histogram_log_timer.Reset();
+  }
+
   m_host_interface->OnSystemPerformanceCountersUpdated();
 }
 
+void System::LogFrameTimeHistogram()
+{
+  u32 total_frames = 0;
+  for (const u32 count : m_frame_time_histogram)
+    total_frames += count;
+  if (total_frames == 0)
+    return;
+
+  Log_InfoPrintf("Frame time histogram (%u frames):", total_frames);
+  for (u32 i = 0; i < FRAME_TIME_HISTOGRAM_SIZE; i++)
+  {
+    const u32 count = m_frame_time_histogram[i];
+    if (count == 0)
+      continue;
+
+    Log_InfoPrintf("  %2u%s ms: %6u (%.2f%%)", i, (i == (FRAME_TIME_HISTOGRAM_SIZE - 1)) ? "+" : " ", count,
+                   (static_cast<float>(count) * 100.0f) / static_cast<float>(total_frames));
+  }
+}
+
 void System::ResetPerformanceCounters()
 {
   m_last_frame_number = m_frame_number;
@@ -1080,7 +1151,8 @@ void System::RunEvents()
 
 void System::UpdateCPUDowncount()
 {
-  m_cpu->SetDowncount(m_events[0]->GetDowncount());
+  // A store to a code page has to get the CPU back to the execution loop first, see Bus::RAMPageFaultHandler().
+  m_cpu->SetDowncount(m_bus->HasPendingCodeInvalidation() ? 0 : m_events[0]->GetDowncount());
 }
 
 bool System::DoEventsState(StateWrapper& sw)
@@ -1155,6 +1227,8 @@ TimingEvent* System::FindActiveEvent(const char* name)
 
 void System::UpdateRunningGame(const char* path, CDImage* image)
 {
+  SaveCPUBlockCache();
+
   m_running_game_path.clear();
   m_running_game_code.clear();
   m_running_game_title.clear();
@@ -1165,5 +1239,26 @@ void System::UpdateRunningGame(const char* path, CDImage* image)
     m_host_interface->GetGameInfo(path, image, &m_running_game_code, &m_running_game_title);
   }
 
+  LoadCPUBlockCache();
+
   m_host_interface->OnRunningGameChanged();
 }
+
+void System::LoadCPUBlockCache()
+{
+  if (m_running_game_code.empty())
+  {
+    m_cpu_code_cache->ClearBlockMetadata();
+    return;
+  }
+
+  m_cpu_code_cache->LoadBlockMetadata(m_host_interface->GetCPUBlockCachePath(m_running_game_code.c_str()).c_str());
+}
+
+void System::SaveCPUBlockCache()
+{
+  if (m_running_game_code.empty())
+    return;
+
+  m_cpu_code_cache->SaveBlockMetadata(m_host_interface->GetCPUBlockCachePath(m_running_game_code.c_str()).c_str());
+}
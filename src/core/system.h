@@ -3,6 +3,7 @@
 #include "host_interface.h"
 #include "timing_event.h"
 #include "types.h"
+#include <array>
 #include <memory>
 #include <optional>
 #include <string>
@@ -99,6 +100,16 @@ public:
   float GetWorstFrameTime() const { return m_worst_frame_time; }
   float GetThrottleFrequency() const { return m_throttle_frequency; }
 
+  /// Number of frames which took [N, N+1) milliseconds, since the system was created. The last bucket also holds
+  /// any frames which were slower. Useful for spotting stutter, e.g. from block compilation.
+  enum : u32
+  {
+    FRAME_TIME_HISTOGRAM_SIZE = 32,
+    FRAME_TIME_HISTOGRAM_LOG_INTERVAL = 60
+  };
+  using FrameTimeHistogram = std::array<u32, FRAME_TIME_HISTOGRAM_SIZE>;
+  const FrameTimeHistogram& GetFrameTimeHistogram() const { return m_frame_time_histogram; }
+
   bool Boot(const SystemBootParameters& params);
   void Reset();
 
@@ -114,6 +125,18 @@ public:
   /// Forcibly changes the CPU execution mode, ignoring settings.
   void SetCPUExecutionMode(CPUExecutionMode mode);
 
+  /// Enables or disables fastmem in the recompiler. Flushes all compiled blocks.
+  void SetCPUFastmem(bool enabled);
+
+  /// Enables or disables compiling blocks on a worker thread in the recompiler. Flushes all compiled blocks.
+  void SetCPUThreadedCompile(bool enabled);
+
+  /// Enables or disables skipping ahead to the next event in idle loops. Flushes all compiled blocks.
+  void SetCPUIdleLoopSkipping(bool enabled);
+
+  /// Enables or disables instruction fetch wait states and i-cache emulation. Flushes all compiled blocks.
+  void SetCPUAccurateTiming(bool enabled);
+
   void RunFrame();
 
   /// Adjusts the throttle frequency, i.e. how many times we should sleep per second.
@@ -128,6 +151,9 @@ public:
   void UpdatePerformanceCounters();
   void ResetPerformanceCounters();
 
+  /// Logs the frame time histogram. Also done every FRAME_TIME_HISTOGRAM_LOG_INTERVAL seconds, and on shutdown.
+  void LogFrameTimeHistogram();
+
   bool LoadEXE(const char* filename, std::vector<u8>& bios_image);
   bool LoadEXEFromBuffer(const void* buffer, u32 buffer_size, std::vector<u8>& bios_image);
   bool LoadPSF(const char* filename, std::vector<u8>& bios_image);
@@ -189,6 +215,10 @@ private:
 
   void UpdateRunningGame(const char* path, CDImage* image);
 
+  /// Block metadata is per-game, so it's swapped out when the running game changes.
+  void LoadCPUBlockCache();
+  void SaveCPUBlockCache();
+
   HostInterface* m_host_interface;
   std::unique_ptr<CPU::Core> m_cpu;
   std::unique_ptr<CPU::CodeCache> m_cpu_code_cache;
@@ -237,4 +267,6 @@ private:
   u32 m_last_global_tick_counter = 0;
   Common::Timer m_fps_timer;
   Common::Timer m_frame_timer;
+  FrameTimeHistogram m_frame_time_histogram = {};
+  Common::Timer m_frame_time_histogram_log_timer;
 };
@@ -352,7 +352,10 @@ static std::array<retro_core_option_definition, 22> s_option_definitions = {{
   {"CPU.ExecutionMode",
    "CPU Execution Mode",
    "Which mode to use for CPU emulation. Recompiler provides the best performance.",
-   {{"Interpreter", "Interpreter"}, {"CachedIntepreter", "Cached Interpreter"}, {"Recompiler", "Recompiler"}},
+   {{"Interpreter", "Interpreter"},
+    {"CachedIntepreter", "Cached Interpreter"},
+    {"ThreadedInterpreter", "Threaded Interpreter"},
+    {"Recompiler", "Recompiler"}},
    "Recompiler"},
   {"GPU.Renderer",
    "GPU Renderer",
@@ -19,6 +19,7 @@ AudioSettingsWidget::AudioSettingsWidget(QtHostInterface* host_interface, QWidge
   SettingWidgetBinder::BindWidgetToIntSetting(m_host_interface, m_ui.volume, "Audio/OutputVolume");
   SettingWidgetBinder::BindWidgetToBoolSetting(m_host_interface, m_ui.muted, "Audio/OutputMuted");
   SettingWidgetBinder::BindWidgetToBoolSetting(m_host_interface, m_ui.startDumpingOnBoot, "Audio/DumpOnBoot");
+  SettingWidgetBinder::BindWidgetToBoolSetting(m_host_interface, m_ui.synthesisThread, "Audio/SynthesisThread");
 
   connect(m_ui.bufferSize, &QSlider::valueChanged, this, &AudioSettingsWidget::updateBufferingLabel);
   connect(m_ui.volume, &QSlider::valueChanged, this, &AudioSettingsWidget::updateVolumeLabel);
@@ -41,6 +42,10 @@ AudioSettingsWidget::AudioSettingsWidget(QtHostInterface* host_interface, QWidge
   dialog->registerWidgetHelp(
     m_ui.startDumpingOnBoot, "Start Dumping On Boot", "Unchecked",
     "Start dumping audio to file as soon as the emulator is started. Mainly useful as a debug option.");
+  dialog->registerWidgetHelp(
+    m_ui.synthesisThread, "Use Synthesis Thread (Asynchronous)", "Checked",
+    "Generates audio on a separate thread, which runs alongside the emulated CPU. The output is identical, but the "
+    "thread has to catch up whenever the game accesses the SPU, so the speedup depends on the game.");
   dialog->registerWidgetHelp(m_ui.volume, "Volume", "100",
                              "Controls the volume of the audio played on the host. Values are in percentage.");
   dialog->registerWidgetHelp(m_ui.muted, "Mute", "Unchecked",
@@ -43,6 +43,7 @@ GPUSettingsWidget::GPUSettingsWidget(QtHostInterface* host_interface, QWidget* p
                                                QStringLiteral("GPU/ForceNTSCTimings"));
   SettingWidgetBinder::BindWidgetToBoolSetting(m_host_interface, m_ui.linearTextureFiltering,
                                                QStringLiteral("GPU/TextureFiltering"));
+  SettingWidgetBinder::BindWidgetToBoolSetting(m_host_interface, m_ui.uberShaders, QStringLiteral("GPU/UberShaders"));
 
   connect(m_ui.resolutionScale, QOverload<int>::of(&QComboBox::currentIndexChanged), this,
           &GPUSettingsWidget::updateScaledDitheringEnabled);
@@ -113,6 +114,11 @@ GPUSettingsWidget::GPUSettingsWidget(QtHostInterface* host_interface, QWidget* p
     "Smooths out the blockyness of magnified textures on 3D object by using bilinear "
     "filtering. Will have a greater effect on higher resolution scales. Currently this option "
     "produces artifacts around objects in many games and needs further work. Only applies to the hardware renderers.");
+  dialog->registerWidgetHelp(
+    m_ui.uberShaders, "Uber Shaders (reduce shader compilation stutter)", "Unchecked",
+    "Renders with a small set of generic shaders while the full set of specialised shaders is compiled in the "
+    "background, instead of waiting for every shader to compile. Rendering may be slightly slower until compilation "
+    "completes. Only applies to the OpenGL and Vulkan renderers.");
 }
 
 GPUSettingsWidget::~GPUSettingsWidget() = default;
@@ -174,6 +174,7 @@ void CommonHostInterface::PauseSystem(bool paused)
     return;
 
   m_paused = paused;
+  m_system->GetSPU()->FlushAudioOutput();
   m_audio_stream->PauseOutput(m_paused);
   OnSystemPaused(paused);
   UpdateSpeedLimiterState();
@@ -547,6 +548,8 @@ void CommonHostInterface::UpdateSpeedLimiterState()
   Log_InfoPrintf("Syncing to %s%s", audio_sync_enabled ? "audio" : "",
                  (audio_sync_enabled && video_sync_enabled) ? " and video" : (video_sync_enabled ? "video" : ""));
 
+  if (m_system)
+    m_system->GetSPU()->FlushAudioOutput();
   m_audio_stream->SetSync(audio_sync_enabled);
   if (audio_sync_enabled)
     m_audio_stream->EmptyBuffers();